@@ -0,0 +1,88 @@
+/*
+ * Underground Beats
+ * BenchMain.cpp
+ *
+ * Entry point of the microbenchmark runner
+ */
+
+#include "Benchmarks.h"
+#include <cstdio>
+
+using namespace UndergroundBeats;
+
+namespace {
+
+void printUsage()
+{
+    std::printf("Usage: ugbeats_bench [--list] [--filter=<text>] [--out=<file.json>]\n"
+                "                     [--min-time=<seconds>] [--repetitions=<count>]\n");
+}
+
+} // namespace
+
+std::vector<float> Bench::makeNoise(int numSamples, int seed)
+{
+    juce::Random random(seed);
+    std::vector<float> noise(static_cast<size_t>(numSamples));
+
+    for (auto& sample : noise)
+    {
+        sample = random.nextFloat() * 2.0f - 1.0f;
+    }
+
+    return noise;
+}
+
+int main(int argc, char* argv[])
+{
+    const juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    Bench::Runner runner;
+    Bench::registerSynthBenchmarks(runner);
+    Bench::registerEffectsBenchmarks(runner);
+    Bench::registerSequencerBenchmarks(runner);
+
+    if (args.containsOption("--list"))
+    {
+        for (const auto& name : runner.getNames())
+        {
+            std::printf("%s\n", name.c_str());
+        }
+
+        return 0;
+    }
+
+    Bench::Options options;
+    options.filter = args.getValueForOption("--filter");
+
+    if (args.containsOption("--min-time"))
+        options.minTime = juce::jmax(0.001, args.getValueForOption("--min-time").getDoubleValue());
+
+    if (args.containsOption("--repetitions"))
+        options.repetitions = juce::jmax(1, args.getValueForOption("--repetitions").getIntValue());
+
+    const auto results = runner.run(options);
+
+    const auto outPath = args.getValueForOption("--out");
+
+    if (outPath.isNotEmpty())
+    {
+        const auto outFile = juce::File::getCurrentWorkingDirectory().getChildFile(outPath);
+
+        if (!outFile.replaceWithText(juce::JSON::toString(Bench::Runner::toJson(results, options))))
+        {
+            std::fprintf(stderr, "Could not write %s\n", outFile.getFullPathName().toRawUTF8());
+            return 1;
+        }
+
+        std::printf("Results written to %s\n", outFile.getFullPathName().toRawUTF8());
+    }
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Underground Beats
+ * BenchmarkHarness.cpp
+ *
+ * Implementation of the microbenchmark harness
+ */
+
+#include "BenchmarkHarness.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace UndergroundBeats {
+namespace Bench {
+
+namespace {
+
+constexpr juce::int64 maxIterations = 1000000000;
+
+double runOnce(const Runner::Function& function, juce::int64 iterations, juce::int64& itemsPerIteration)
+{
+    State state(iterations);
+
+    {
+        juce::ScopedNoDenormals noDenormals;
+        function(state);
+    }
+
+    // A benchmark that skipped its loop has nothing meaningful to report
+    jassert(state.getElapsedNanoseconds() > 0.0);
+
+    itemsPerIteration = state.getItemsPerIteration();
+    return state.getElapsedNanoseconds();
+}
+
+juce::String formatTime(double nanoseconds)
+{
+    if (nanoseconds >= 1.0e6)
+        return juce::String(nanoseconds / 1.0e6, 3) + " ms";
+
+    if (nanoseconds >= 1.0e3)
+        return juce::String(nanoseconds / 1.0e3, 3) + " us";
+
+    return juce::String(nanoseconds, 1) + " ns";
+}
+
+} // namespace
+
+//==============================================================================
+State::State(juce::int64 numIterations)
+    : iterations(numIterations)
+    , remaining(numIterations)
+{
+}
+
+bool State::keepRunning()
+{
+    if (!started)
+    {
+        started = true;
+        start = Clock::now();
+    }
+
+    if (remaining > 0)
+    {
+        --remaining;
+        return true;
+    }
+
+    elapsedNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return false;
+}
+
+void State::setItemsPerIteration(juce::int64 items)
+{
+    itemsPerIteration = items;
+}
+
+juce::int64 State::getIterations() const
+{
+    return iterations;
+}
+
+juce::int64 State::getItemsPerIteration() const
+{
+    return itemsPerIteration;
+}
+
+double State::getElapsedNanoseconds() const
+{
+    return elapsedNanoseconds;
+}
+
+//==============================================================================
+void Runner::add(const std::string& name, Function function)
+{
+    benchmarks.push_back({ name, std::move(function) });
+}
+
+std::vector<std::string> Runner::getNames() const
+{
+    std::vector<std::string> names;
+
+    for (const auto& benchmark : benchmarks)
+    {
+        names.push_back(benchmark.name);
+    }
+
+    return names;
+}
+
+std::vector<Result> Runner::run(const Options& options) const
+{
+    std::vector<Result> results;
+
+    std::printf("%-40s %14s %14s %14s %12s\n", "Benchmark", "Time", "Min", "Max", "Iterations");
+
+    for (const auto& benchmark : benchmarks)
+    {
+        if (options.filter.isNotEmpty() && !juce::String(benchmark.name).containsIgnoreCase(options.filter))
+            continue;
+
+        const Result result = runBenchmark(benchmark, options);
+
+        std::printf("%-40s %14s %14s %14s %12lld",
+                    result.name.c_str(),
+                    formatTime(result.nanosecondsPerIteration).toRawUTF8(),
+                    formatTime(result.minNanoseconds).toRawUTF8(),
+                    formatTime(result.maxNanoseconds).toRawUTF8(),
+                    static_cast<long long>(result.iterations));
+
+        if (result.itemsPerSecond > 0.0)
+            std::printf("  %.3g items/s", result.itemsPerSecond);
+
+        std::printf("\n");
+        std::fflush(stdout);
+
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+Result Runner::runBenchmark(const Benchmark& benchmark, const Options& options)
+{
+    const double minNanoseconds = options.minTime * 1.0e9;
+    juce::int64 itemsPerIteration = 0;
+
+    // Grow the iteration count until one run takes long enough to time reliably
+    juce::int64 iterations = 1;
+    double elapsed = runOnce(benchmark.function, iterations, itemsPerIteration);
+
+    while (elapsed < minNanoseconds && iterations < maxIterations)
+    {
+        const double scale = elapsed > 0.0 ? 1.4 * minNanoseconds / elapsed : 10.0;
+        iterations = std::min(maxIterations, static_cast<juce::int64>(static_cast<double>(iterations) * juce::jlimit(2.0, 10.0, scale)));
+        elapsed = runOnce(benchmark.function, iterations, itemsPerIteration);
+    }
+
+    std::vector<double> times;
+
+    for (int i = 0; i < juce::jmax(1, options.repetitions); ++i)
+    {
+        times.push_back(runOnce(benchmark.function, iterations, itemsPerIteration) / static_cast<double>(iterations));
+    }
+
+    std::sort(times.begin(), times.end());
+
+    Result result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.nanosecondsPerIteration = times[times.size() / 2];
+    result.minNanoseconds = times.front();
+    result.maxNanoseconds = times.back();
+
+    if (itemsPerIteration > 0)
+        result.itemsPerSecond = static_cast<double>(itemsPerIteration) * 1.0e9 / result.nanosecondsPerIteration;
+
+    return result;
+}
+
+juce::var Runner::toJson(const std::vector<Result>& results, const Options& options)
+{
+    auto* context = new juce::DynamicObject();
+    context->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+    context->setProperty("host_name", juce::SystemStats::getComputerName());
+    context->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    context->setProperty("cpu", juce::SystemStats::getCpuModel());
+    context->setProperty("num_cpus", juce::SystemStats::getNumCpus());
+    context->setProperty("mhz_per_cpu", juce::SystemStats::getCpuSpeedInMegahertz());
+#if JUCE_DEBUG
+    context->setProperty("build_type", "debug");
+#else
+    context->setProperty("build_type", "release");
+#endif
+    context->setProperty("min_time", options.minTime);
+    context->setProperty("repetitions", options.repetitions);
+
+    juce::Array<juce::var> entries;
+
+    for (const auto& result : results)
+    {
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("name", juce::String(result.name));
+        entry->setProperty("iterations", result.iterations);
+        entry->setProperty("real_time", result.nanosecondsPerIteration);
+        entry->setProperty("min_time", result.minNanoseconds);
+        entry->setProperty("max_time", result.maxNanoseconds);
+        entry->setProperty("time_unit", "ns");
+
+        if (result.itemsPerSecond > 0.0)
+            entry->setProperty("items_per_second", result.itemsPerSecond);
+
+        entries.add(juce::var(entry));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("context", juce::var(context));
+    root->setProperty("benchmarks", entries);
+    return juce::var(root);
+}
+
+} // namespace Bench
+} // namespace UndergroundBeats
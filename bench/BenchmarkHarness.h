@@ -0,0 +1,151 @@
+/*
+ * Underground Beats
+ * BenchmarkHarness.h
+ *
+ * Minimal microbenchmark harness with JSON results
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace UndergroundBeats {
+namespace Bench {
+
+/**
+ * @brief Keep the compiler from optimising a value away
+ */
+template <typename T>
+inline void doNotOptimise(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * @class State
+ * @brief Drives the timed loop of one benchmark run
+ *
+ * A benchmark sets up whatever it needs, then repeats the work being
+ * measured while keepRunning() returns true. Only the loop is timed, so
+ * setup costs are excluded:
+ *
+ * @code
+ * while (state.keepRunning())
+ *     oscillator.process(buffer.data(), blockSize);
+ * @endcode
+ */
+class State {
+public:
+    explicit State(juce::int64 numIterations);
+
+    /**
+     * @brief Check whether to run another iteration
+     *
+     * Starts the clock on the first call and stops it on the last.
+     */
+    bool keepRunning();
+
+    /**
+     * @brief Set how many items (e.g. samples) each iteration processes
+     *
+     * Results then include a throughput in items per second.
+     */
+    void setItemsPerIteration(juce::int64 items);
+
+    juce::int64 getIterations() const;
+    juce::int64 getItemsPerIteration() const;
+    double getElapsedNanoseconds() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    juce::int64 iterations;
+    juce::int64 remaining;
+    juce::int64 itemsPerIteration = 0;
+    bool started = false;
+    Clock::time_point start;
+    double elapsedNanoseconds = 0.0;
+};
+
+/**
+ * @brief Timing of one benchmark
+ */
+struct Result {
+    std::string name;
+    juce::int64 iterations = 0;
+    double nanosecondsPerIteration = 0.0; // Median over the repetitions
+    double minNanoseconds = 0.0;
+    double maxNanoseconds = 0.0;
+    double itemsPerSecond = 0.0;          // 0 if the benchmark processes no items
+};
+
+/**
+ * @brief How benchmarks are run
+ */
+struct Options {
+    juce::String filter;  // Only run benchmarks whose names contain this
+    double minTime = 0.2; // Seconds each repetition should take at least
+    int repetitions = 5;
+};
+
+/**
+ * @class Runner
+ * @brief Registers benchmarks, runs them and reports the results
+ *
+ * Each benchmark is first run with growing iteration counts until a run
+ * takes at least the minimum time, then repeated at that count. The median
+ * of the repetitions is reported, so a stray preemption does not skew it.
+ * Runs happen with denormals flushed, as they are on the audio thread.
+ */
+class Runner {
+public:
+    using Function = std::function<void(State&)>;
+
+    /**
+     * @brief Register a benchmark
+     *
+     * @param name Name in Group/Case form, e.g. "Oscillator/Sine"
+     * @param function The benchmark
+     */
+    void add(const std::string& name, Function function);
+
+    /**
+     * @brief Get the names of every registered benchmark
+     */
+    std::vector<std::string> getNames() const;
+
+    /**
+     * @brief Run the benchmarks selected by the options, printing each result
+     *
+     * @param options How to run them
+     * @return The results, in registration order
+     */
+    std::vector<Result> run(const Options& options) const;
+
+    /**
+     * @brief Describe results and the machine they came from as JSON
+     */
+    static juce::var toJson(const std::vector<Result>& results, const Options& options);
+
+private:
+    struct Benchmark {
+        std::string name;
+        Function function;
+    };
+
+    static Result runBenchmark(const Benchmark& benchmark, const Options& options);
+
+    std::vector<Benchmark> benchmarks;
+};
+
+} // namespace Bench
+} // namespace UndergroundBeats
@@ -0,0 +1,29 @@
+/*
+ * Underground Beats
+ * Benchmarks.h
+ *
+ * Registration of the benchmark suites
+ */
+
+#pragma once
+
+#include "BenchmarkHarness.h"
+
+namespace UndergroundBeats {
+namespace Bench {
+
+// Shared settings, chosen to match a typical live setup
+constexpr double benchmarkSampleRate = 48000.0;
+constexpr int benchmarkBlockSize = 512;
+
+/**
+ * @brief Fill a buffer with repeatable white noise for effects and filters to chew on
+ */
+std::vector<float> makeNoise(int numSamples, int seed = 1);
+
+void registerSynthBenchmarks(Runner& runner);
+void registerEffectsBenchmarks(Runner& runner);
+void registerSequencerBenchmarks(Runner& runner);
+
+} // namespace Bench
+} // namespace UndergroundBeats
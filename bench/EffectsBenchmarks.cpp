@@ -0,0 +1,99 @@
+/*
+ * Underground Beats
+ * EffectsBenchmarks.cpp
+ *
+ * Benchmarks of the effects and effects chains
+ */
+
+#include "Benchmarks.h"
+#include "../src/effects/Delay.h"
+#include "../src/effects/Reverb.h"
+#include "../src/effects/EffectsChain.h"
+
+namespace UndergroundBeats {
+namespace Bench {
+
+namespace {
+
+constexpr double sampleRate = benchmarkSampleRate;
+constexpr int blockSize = benchmarkBlockSize;
+
+std::unique_ptr<Delay> makeDelay()
+{
+    auto delay = std::make_unique<Delay>();
+    delay->setDelayTime(0, 250.0f);
+    delay->setDelayTime(1, 375.0f);
+    delay->setFeedback(0, 0.5f);
+    delay->setFeedback(1, 0.5f);
+    delay->setCrossFeedback(0, 0.2f);
+    delay->setCrossFeedback(1, 0.2f);
+    delay->setMix(0.5f);
+    return delay;
+}
+
+std::unique_ptr<Reverb> makeReverb()
+{
+    auto reverb = std::make_unique<Reverb>();
+    reverb->setRoomSize(0.8f);
+    reverb->setDamping(0.5f);
+    reverb->setWidth(1.0f);
+    reverb->setMix(0.3f);
+    return reverb;
+}
+
+// Process stereo noise through something with a processStereo method
+template <typename Processor>
+void benchmarkStereo(State& state, Processor& processor)
+{
+    const auto inputLeft = makeNoise(blockSize, 1);
+    const auto inputRight = makeNoise(blockSize, 2);
+    std::vector<float> left(blockSize);
+    std::vector<float> right(blockSize);
+
+    while (state.keepRunning())
+    {
+        std::copy(inputLeft.begin(), inputLeft.end(), left.begin());
+        std::copy(inputRight.begin(), inputRight.end(), right.begin());
+        processor.processStereo(left.data(), right.data(), blockSize);
+        doNotOptimise(left.front());
+        doNotOptimise(right.front());
+    }
+
+    state.setItemsPerIteration(blockSize);
+}
+
+void benchmarkChain(State& state, RoutingNode::Type groupType)
+{
+    // The same three effects, one after another or side by side
+    EffectsChain chain;
+    const int group = chain.createGroup(groupType);
+    chain.addEffect(makeDelay(), group);
+    chain.addEffect(makeReverb(), group);
+    chain.addEffect(makeDelay(), group);
+    chain.prepare(sampleRate, blockSize);
+
+    benchmarkStereo(state, chain);
+}
+
+} // namespace
+
+void registerEffectsBenchmarks(Runner& runner)
+{
+    runner.add("Delay/Stereo", [](State& state) {
+        auto delay = makeDelay();
+        delay->prepare(sampleRate, blockSize);
+        benchmarkStereo(state, *delay);
+    });
+
+    runner.add("Reverb/Stereo", [](State& state) {
+        auto reverb = makeReverb();
+        reverb->prepare(sampleRate, blockSize);
+        benchmarkStereo(state, *reverb);
+    });
+
+    runner.add("EffectsChain/Serial", [](State& state) { benchmarkChain(state, RoutingNode::Type::Serial); });
+    runner.add("EffectsChain/Parallel", [](State& state) { benchmarkChain(state, RoutingNode::Type::Parallel); });
+}
+
+} // namespace Bench
+} // namespace UndergroundBeats
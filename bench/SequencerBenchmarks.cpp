@@ -0,0 +1,98 @@
+/*
+ * Underground Beats
+ * SequencerBenchmarks.cpp
+ *
+ * Benchmarks of timeline queries on large arrangements
+ */
+
+#include "Benchmarks.h"
+#include "../src/sequencer/Timeline.h"
+
+namespace UndergroundBeats {
+namespace Bench {
+
+namespace {
+
+constexpr double sampleRate = benchmarkSampleRate;
+constexpr int blockSize = benchmarkBlockSize;
+constexpr double tempo = 120.0;
+
+// Arrangement shape: four-bar patterns stacked four deep, like layered tracks
+constexpr double patternLengthInBeats = 16.0;
+constexpr int notesPerPattern = 64;
+constexpr int numDistinctPatterns = 8;
+constexpr int numLayers = 4;
+
+void buildArrangement(Timeline& timeline, int numNotes)
+{
+    juce::Random random(42);
+    std::vector<int> patternIds;
+
+    for (int i = 0; i < numDistinctPatterns; ++i)
+    {
+        auto pattern = std::make_unique<Pattern>("Pattern " + std::to_string(i), patternLengthInBeats);
+
+        for (int note = 0; note < notesPerPattern; ++note)
+        {
+            const double startTime = patternLengthInBeats * note / notesPerPattern;
+            pattern->addNote(36 + random.nextInt(48), 64 + random.nextInt(64), startTime, 0.25);
+        }
+
+        patternIds.push_back(timeline.addPattern(std::move(pattern)));
+    }
+
+    const int numInstances = juce::jmax(1, numNotes / notesPerPattern);
+
+    for (int instance = 0; instance < numInstances; ++instance)
+    {
+        const double startTime = patternLengthInBeats * (instance / numLayers);
+        timeline.addPatternInstance(patternIds[static_cast<size_t>(instance % numDistinctPatterns)], startTime);
+    }
+}
+
+void benchmarkNotesInRange(State& state, int numNotes)
+{
+    Timeline timeline;
+    buildArrangement(timeline, numNotes);
+
+    // Query a snapshot with its own cursors, as the sequencer does on the audio thread
+    const auto index = timeline.createIndex();
+    auto cursors = index->createCursors();
+
+    // One audio block's worth of ticks, swept across the whole arrangement as playback would
+    const Tick blockTicks = TimeBase::beatsToTicks(blockSize / sampleRate * tempo / 60.0);
+    const Tick lengthTicks = TimeBase::beatsToTicks(timeline.getLength());
+
+    std::vector<NoteEvent> notes;
+    notes.reserve(1024);
+    Tick position = 0;
+
+    while (state.keepRunning())
+    {
+        notes.clear();
+        index->findNotes(position, position + blockTicks, notes, &cursors);
+        doNotOptimise(notes.size());
+
+        position += blockTicks;
+
+        if (position >= lengthTicks)
+            position = 0;
+    }
+
+    state.setItemsPerIteration(1);
+}
+
+} // namespace
+
+void registerSequencerBenchmarks(Runner& runner)
+{
+    for (int numNotes : { 1000, 10000, 100000 })
+    {
+        runner.add("Timeline/NotesInRange:" + std::to_string(numNotes), [numNotes](State& state) {
+            benchmarkNotesInRange(state, numNotes);
+        });
+    }
+}
+
+} // namespace Bench
+} // namespace UndergroundBeats
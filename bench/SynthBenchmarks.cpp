@@ -0,0 +1,259 @@
+/*
+ * Underground Beats
+ * SynthBenchmarks.cpp
+ *
+ * Benchmarks of the oscillators, filters, envelopes and synth voices
+ */
+
+#include "Benchmarks.h"
+#include "../src/synthesis/Oscillator.h"
+#include "../src/synthesis/Filter.h"
+#include "../src/synthesis/Envelope.h"
+#include "../src/synthesis/EnvelopeProcessor.h"
+#include "../src/synthesis/EnvelopeGenerator.h"
+#include "../src/synthesis/FilterEnvelope.h"
+#include "../src/synthesis/SynthModule.h"
+
+namespace UndergroundBeats {
+namespace Bench {
+
+namespace {
+
+constexpr double sampleRate = benchmarkSampleRate;
+constexpr int blockSize = benchmarkBlockSize;
+
+// Modulated filters get a new cutoff this often, as from a control-rate LFO
+constexpr int modulationInterval = 32;
+
+// Envelopes are gated open for most of a cycle of blocks, so every stage runs
+constexpr juce::int64 gateCycleBlocks = 64;
+constexpr juce::int64 gateOpenBlocks = 48;
+
+void benchmarkOscillator(State& state, WaveformType waveform)
+{
+    Oscillator oscillator;
+    oscillator.prepare(sampleRate);
+    oscillator.setWaveform(waveform);
+    oscillator.setFrequency(220.0f);
+
+    if (waveform == WaveformType::Wavetable)
+    {
+        std::vector<float> wavetable(2048);
+
+        for (size_t i = 0; i < wavetable.size(); ++i)
+        {
+            wavetable[i] = std::sin(juce::MathConstants<float>::twoPi * static_cast<float>(i) / static_cast<float>(wavetable.size()));
+        }
+
+        oscillator.setWavetable(wavetable.data(), static_cast<int>(wavetable.size()));
+    }
+
+    std::vector<float> buffer(blockSize);
+
+    while (state.keepRunning())
+    {
+        oscillator.process(buffer.data(), blockSize);
+        doNotOptimise(buffer.front());
+    }
+
+    state.setItemsPerIteration(blockSize);
+}
+
+void benchmarkFilter(State& state, bool modulated)
+{
+    Filter filter;
+    filter.prepare(sampleRate);
+    filter.setType(FilterType::LowPass);
+    filter.setCutoff(1000.0f);
+    filter.setResonance(0.5f);
+
+    const auto input = makeNoise(blockSize);
+    std::vector<float> buffer(blockSize);
+    float lfoPhase = 0.0f;
+
+    while (state.keepRunning())
+    {
+        std::copy(input.begin(), input.end(), buffer.begin());
+
+        if (!modulated)
+        {
+            filter.process(buffer.data(), blockSize);
+        }
+        else
+        {
+            for (int offset = 0; offset < blockSize; offset += modulationInterval)
+            {
+                // Sweep between 200 Hz and 5 kHz
+                lfoPhase = std::fmod(lfoPhase + 0.01f, juce::MathConstants<float>::twoPi);
+                filter.setCutoff(2600.0f + 2400.0f * std::sin(lfoPhase));
+                filter.process(buffer.data() + offset, juce::jmin(modulationInterval, blockSize - offset));
+            }
+        }
+
+        doNotOptimise(buffer.front());
+    }
+
+    state.setItemsPerIteration(blockSize);
+}
+
+void benchmarkStereoFilter(State& state)
+{
+    Filter filter;
+    filter.prepare(sampleRate);
+    filter.setType(FilterType::LowPass);
+    filter.setCutoff(1000.0f);
+    filter.setResonance(0.5f);
+
+    const auto leftInput = makeNoise(blockSize, 1);
+    const auto rightInput = makeNoise(blockSize, 2);
+    std::vector<float> left(blockSize);
+    std::vector<float> right(blockSize);
+
+    while (state.keepRunning())
+    {
+        std::copy(leftInput.begin(), leftInput.end(), left.begin());
+        std::copy(rightInput.begin(), rightInput.end(), right.begin());
+        filter.processStereo(left.data(), right.data(), blockSize);
+        doNotOptimise(left.front());
+        doNotOptimise(right.front());
+    }
+
+    state.setItemsPerIteration(blockSize);
+}
+
+template <typename EnvelopeType, typename ProcessFunction>
+void benchmarkEnvelope(State& state, EnvelopeType& envelope, ProcessFunction process)
+{
+    const auto input = makeNoise(blockSize);
+    std::vector<float> buffer(blockSize);
+    juce::int64 block = 0;
+
+    while (state.keepRunning())
+    {
+        const auto gatePosition = block++ % gateCycleBlocks;
+
+        if (gatePosition == 0)
+            envelope.noteOn();
+        else if (gatePosition == gateOpenBlocks)
+            envelope.noteOff();
+
+        std::copy(input.begin(), input.end(), buffer.begin());
+        process(buffer.data(), blockSize);
+        doNotOptimise(buffer.front());
+    }
+
+    state.setItemsPerIteration(blockSize);
+}
+
+void benchmarkSynth(State& state, int numVoices)
+{
+    SynthModule synth(numVoices);
+    synth.prepare(sampleRate);
+    synth.setEnvelopeParameters(5.0f, 50.0f, 0.8f, 200.0f);
+
+    // Start every voice before timing, so the loop renders them all
+    juce::MidiBuffer noteOns;
+
+    for (int voice = 0; voice < numVoices; ++voice)
+    {
+        noteOns.addEvent(juce::MidiMessage::noteOn(1, (24 + voice) % 128, 0.8f), 0);
+    }
+
+    std::vector<float> buffer(blockSize);
+    synth.processBlock(noteOns, buffer.data(), blockSize);
+
+    const juce::MidiBuffer noMidi;
+
+    while (state.keepRunning())
+    {
+        synth.processBlock(noMidi, buffer.data(), blockSize);
+        doNotOptimise(buffer.front());
+    }
+
+    state.setItemsPerIteration(blockSize);
+}
+
+} // namespace
+
+void registerSynthBenchmarks(Runner& runner)
+{
+    const std::pair<const char*, WaveformType> waveforms[] = {
+        { "Sine", WaveformType::Sine },
+        { "Triangle", WaveformType::Triangle },
+        { "Sawtooth", WaveformType::Sawtooth },
+        { "Square", WaveformType::Square },
+        { "Noise", WaveformType::Noise },
+        { "Wavetable", WaveformType::Wavetable }
+    };
+
+    for (const auto& [name, waveform] : waveforms)
+    {
+        runner.add(std::string("Oscillator/") + name, [waveform = waveform](State& state) {
+            benchmarkOscillator(state, waveform);
+        });
+    }
+
+    runner.add("Filter/Static", [](State& state) { benchmarkFilter(state, false); });
+    runner.add("Filter/Modulated", [](State& state) { benchmarkFilter(state, true); });
+    runner.add("Filter/Stereo", [](State& state) { benchmarkStereoFilter(state); });
+
+    runner.add("Envelope/Envelope", [](State& state) {
+        Envelope envelope;
+        envelope.prepare(sampleRate);
+        envelope.setAttackTime(10.0f);
+        envelope.setDecayTime(100.0f);
+        envelope.setSustainLevel(0.7f);
+        envelope.setReleaseTime(200.0f);
+        benchmarkEnvelope(state, envelope, [&envelope](float* buffer, int numSamples) {
+            envelope.process(buffer, numSamples);
+        });
+    });
+
+    runner.add("Envelope/EnvelopeProcessor", [](State& state) {
+        EnvelopeProcessor envelope;
+        envelope.prepare(sampleRate);
+        envelope.setAttackTime(10.0f);
+        envelope.setDecayTime(100.0f);
+        envelope.setSustainLevel(0.7f);
+        envelope.setReleaseTime(200.0f);
+        benchmarkEnvelope(state, envelope, [&envelope](float* buffer, int numSamples) {
+            envelope.process(buffer, numSamples);
+        });
+    });
+
+    runner.add("Envelope/EnvelopeGenerator", [](State& state) {
+        EnvelopeGenerator envelope;
+        envelope.prepare(sampleRate);
+        envelope.setAttack(10.0f);
+        envelope.setDecay(100.0f);
+        envelope.setSustain(0.7f);
+        envelope.setRelease(200.0f);
+        benchmarkEnvelope(state, envelope, [&envelope](float* buffer, int numSamples) {
+            envelope.processBlock(buffer, numSamples);
+        });
+    });
+
+    runner.add("Envelope/FilterEnvelope", [](State& state) {
+        FilterEnvelope envelope;
+        envelope.prepare(sampleRate);
+        envelope.setBaseCutoff(500.0f);
+        envelope.setCutoffEnvelopeAmount(0.8f);
+        envelope.setAttackTime(10.0f);
+        envelope.setDecayTime(100.0f);
+        envelope.setSustainLevel(0.7f);
+        envelope.setReleaseTime(200.0f);
+        benchmarkEnvelope(state, envelope, [&envelope](float* buffer, int numSamples) {
+            envelope.process(buffer, numSamples);
+        });
+    });
+
+    for (int numVoices : { 8, 32, 128 })
+    {
+        runner.add("SynthModule/Voices:" + std::to_string(numVoices), [numVoices](State& state) {
+            benchmarkSynth(state, numVoices);
+        });
+    }
+}
+
+} // namespace Bench
+} // namespace UndergroundBeats
@@ -40,6 +40,14 @@ MainComponent::MainComponent() :
         addAndMakeVisible(tabs);
         juce::Logger::writeToLog("MainComponent: Tab component added.");
         
+        // Profiler overlay, hidden until chosen from the View menu
+        auto& profiler = audioEngine.getProfiler();
+        profiler.setNodeName(OscillatorStage, "Oscillator Bank");
+        profiler.setNodeName(EnvelopeStage, "Envelope");
+        profiler.setNodeName(FilterStage, "Filter");
+        profilerOverlay = std::make_unique<ProfilerOverlay>(profiler, deviceManager);
+        addChildComponent(profilerOverlay.get());
+        
         // Add sequencer transport controls
         juce::Logger::writeToLog("MainComponent: Adding transport controls...");
         addAndMakeVisible(playButton);
@@ -167,6 +175,11 @@ void MainComponent::createAudioProcessors()
     delay = std::make_unique<Delay>();
     reverb = std::make_unique<UndergroundBeats::Reverb>();
     
+    // Create the sequencer and the MIDI devices it plays through
+    sequencer = std::make_unique<Sequencer>();
+    midiEngine = std::make_unique<MidiEngine>();
+    midiEngine->initialize();
+    
     // Set up the oscillator bank
     oscillatorBank->setMasterFrequency(440.0f);
     oscillatorBank->setMasterLevel(0.5f);
@@ -187,6 +200,19 @@ void MainComponent::createAudioProcessors()
     filterEnvelope->setBaseResonance(0.5f);
     filterEnvelope->setCutoffEnvelopeAmount(0.8f);
     
+    // Play the synth through the lookahead renderer; it follows live input,
+    // so the audio callback renders it directly
+    LookaheadRenderer::TrackSource synthTrack;
+    synthTrack.name = "Synth";
+    synthTrack.render = [this](juce::AudioBuffer<float>& buffer, juce::int64, int numSamples) {
+        renderSynth(buffer, numSamples);
+    };
+    
+    auto& lookaheadRenderer = audioEngine.getLookaheadRenderer();
+    synthTrackIndex = lookaheadRenderer.addTrack(synthTrack);
+    lookaheadRenderer.setTrackLive(synthTrackIndex, true);
+    audioEngine.setLookaheadEnabled(true);
+    
     // Set up effects
     delay->setDelayTime(0, 300.0f); // Fix: Add channel parameter (0 = left)
     delay->setFeedback(0, 0.4f); // Fix: Add channel parameter (0 = left)
@@ -285,8 +311,24 @@ void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate
         delay->prepare(sampleRate, samplesPerBlockExpected); // Fix: Add blockSize parameter
         reverb->prepare(sampleRate, samplesPerBlockExpected); // Fix: Add blockSize parameter
         
-        // Prepare audio buffer
-        audioBuffer.setSize(2, samplesPerBlockExpected);
+        currentSampleRate = sampleRate;
+        
+        // Prepare the engine, which starts the lookahead renderer's workers
+        AudioDeviceSettings settings;
+        settings.sampleRate = sampleRate;
+        settings.bufferSize = samplesPerBlockExpected;
+        audioEngine.initialize(settings);
+        
+        // Prepare the sequencer and keep its MIDI buffers off the audio thread's heap
+        sequencer->prepare(sampleRate, samplesPerBlockExpected);
+        incomingMidi.ensureSize(1024 * 3);
+        outgoingMidi.ensureSize(1024 * 3);
+        
+        // Line outgoing MIDI up with the audio that leaves the device
+        if (auto* device = deviceManager.getCurrentAudioDevice())
+        {
+            midiEngine->setOutputLatency(device->getOutputLatencyInSamples() / sampleRate);
+        }
         
         juce::Logger::writeToLog("MainComponent: Audio processors prepared.");
     }
@@ -298,34 +340,48 @@ void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    auto& profiler = audioEngine.getProfiler();
+    AudioProfiler::CallbackScope callbackScope(profiler, bufferToFill.numSamples, currentSampleRate);
+    
     // Clear the buffer first
     bufferToFill.clearActiveBufferRegion();
     
-    // Create temporary buffer for mono processing
-    if (audioBuffer.getNumSamples() < bufferToFill.numSamples) {
-        audioBuffer.setSize(2, bufferToFill.numSamples, false, true, true);
-    }
+    // Collect incoming MIDI, run the sequencer and schedule its output for the device
+    incomingMidi.clear();
+    outgoingMidi.clear();
+    midiEngine->readIncomingMessages(incomingMidi, bufferToFill.numSamples, currentSampleRate);
+    sequencer->processMidi(incomingMidi, outgoingMidi, bufferToFill.numSamples);
+    midiEngine->processMidiBuffer(outgoingMidi, bufferToFill.numSamples, currentSampleRate);
     
-    // Fill buffer with oscillator samples
-    float* monoBuffer = audioBuffer.getWritePointer(0);
-    std::fill(monoBuffer, monoBuffer + bufferToFill.numSamples, 0.0f);
+    // Mix the tracks, rendered ahead or, for live ones, right here
+    audioEngine.mixLookaheadTracks(bufferToFill);
+}
+
+void MainComponent::renderSynth(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    auto& profiler = audioEngine.getProfiler();
+    float* monoBuffer = buffer.getWritePointer(0);
     
     // Process through oscillator bank
-    oscillatorBank->process(monoBuffer, bufferToFill.numSamples);
+    {
+        AudioProfiler::NodeScope stageScope(profiler, OscillatorStage);
+        oscillatorBank->process(monoBuffer, numSamples);
+    }
     
     // Process through envelope
-    envelopeProcessor->process(monoBuffer, bufferToFill.numSamples);
+    {
+        AudioProfiler::NodeScope stageScope(profiler, EnvelopeStage);
+        envelopeProcessor->process(monoBuffer, numSamples);
+    }
     
     // Process through filter
-    filter->process(monoBuffer, bufferToFill.numSamples);
-    
-    // Copy mono to stereo output
-    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel) {
-        float* channelData = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample);
-        for (int i = 0; i < bufferToFill.numSamples; ++i) {
-            channelData[i] = monoBuffer[i];
-        }
+    {
+        AudioProfiler::NodeScope stageScope(profiler, FilterStage);
+        filter->process(monoBuffer, numSamples);
     }
+    
+    // Copy mono to stereo
+    buffer.copyFrom(1, 0, buffer, 0, 0, numSamples);
 }
 
 void MainComponent::releaseResources()
@@ -333,8 +389,8 @@ void MainComponent::releaseResources()
     // Clean up any resources
     juce::Logger::writeToLog("MainComponent: Releasing resources...");
     
-    // Reset audio buffer
-    audioBuffer.setSize(0, 0);
+    // Stop the engine's lookahead workers
+    audioEngine.shutdown();
     
     juce::Logger::writeToLog("MainComponent: Resources released.");
 }
@@ -370,6 +426,12 @@ void MainComponent::resized()
     // Tab component takes up the rest of the space
     tabs.setBounds(area);
     
+    // Profiler overlay in the top right corner of the tabs
+    if (profilerOverlay)
+    {
+        profilerOverlay->setBounds(area.getRight() - 330, area.getY() + 30, 320, profilerOverlay->getIdealHeight());
+    }
+    
     // Resize components in tabs
     resizeTabComponents();
 }
@@ -433,6 +495,15 @@ juce::PopupMenu MainComponent::getMenuForIndex(int menuIndex, const juce::String
         menu.addSeparator();
         menu.addItem(5, "Exit");
     }
+    else if (menuIndex == 2) // View menu
+    {
+        menu.addItem(ShowProfiler, "Audio Profiler", true, profilerOverlay && profilerOverlay->isVisible());
+        
+        // The profiler only measures while the overlay is shown, so there may be nothing to export
+        auto& profiler = audioEngine.getProfiler();
+        profiler.update();
+        menu.addItem(ExportProfilerReport, "Export Profiler Report...", profiler.getSummary().numCallbacks > 0);
+    }
     
     return menu;
 }
@@ -444,6 +515,62 @@ void MainComponent::menuItemSelected(int menuItemID, int)
     {
         juce::JUCEApplication::getInstance()->systemRequestedQuit();
     }
+    else if (menuItemID == ShowProfiler)
+    {
+        toggleProfiler();
+    }
+    else if (menuItemID == ExportProfilerReport)
+    {
+        exportProfilerReport();
+    }
+}
+
+// Audio profiling
+void MainComponent::toggleProfiler()
+{
+    profilerOverlay->setVisible(!profilerOverlay->isVisible());
+    
+    if (profilerOverlay->isVisible())
+    {
+        profilerOverlay->toFront(false);
+    }
+}
+
+void MainComponent::exportProfilerReport()
+{
+    auto defaultFile = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                           .getChildFile("UndergroundBeatsProfile.json");
+    
+    profilerReportChooser = std::make_unique<juce::FileChooser>("Export Profiler Report", defaultFile, "*.json;*.csv");
+    
+    auto flags = juce::FileBrowserComponent::saveMode
+               | juce::FileBrowserComponent::canSelectFiles
+               | juce::FileBrowserComponent::warnAboutOverwritingExistingFiles;
+    
+    profilerReportChooser->launchAsync(flags, [this](const juce::FileChooser& chooser) {
+        auto file = chooser.getResult();
+        
+        if (file == juce::File())
+            return;
+        
+        auto& profiler = audioEngine.getProfiler();
+        profiler.update();
+        
+        // Showing the overlay while the chooser was open starts a new measurement
+        if (profiler.getSummary().numCallbacks == 0)
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Export Profiler Report",
+                                                   "No audio callbacks have been measured yet. Show the audio profiler "
+                                                   "while audio is playing, then export again.");
+            return;
+        }
+        
+        if (!profiler.writeReport(file))
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Export Profiler Report",
+                                                   "Could not write " + file.getFullPathName());
+        }
+    });
 }
 
 // Projects
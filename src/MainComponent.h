@@ -20,6 +20,7 @@
 #include "ui/components/synth/EnvelopePanel.h"
 #include "ui/components/synth/FilterPanel.h"
 #include "ui/components/synth/FilterEnvelopePanel.h"
+#include "ui/components/ProfilerOverlay.h"
 
 using namespace UndergroundBeats;
 
@@ -66,8 +67,13 @@ private:
     std::shared_ptr<Timeline> timeline;
     std::unique_ptr<ProjectManager> projectManager;
     
-    // Audio buffer for processing
-    juce::AudioBuffer<float> audioBuffer;
+    // The synth's track in the engine's lookahead renderer
+    int synthTrackIndex = -1;
+    
+    // MIDI read from the input device and the sequencer's output for the block
+    juce::MidiBuffer incomingMidi;
+    juce::MidiBuffer outgoingMidi;
+    double currentSampleRate = 0.0;
     
     // Audio format manager
     juce::AudioFormatManager formatManager;
@@ -94,6 +100,10 @@ private:
     // Tab component for different sections
     juce::TabbedComponent tabs;
     
+    // Audio timing overlay and the chooser for exporting its report
+    std::unique_ptr<ProfilerOverlay> profilerOverlay;
+    std::unique_ptr<juce::FileChooser> profilerReportChooser;
+    
     // Container components for each tab
     std::unique_ptr<juce::Component> oscillatorTab;
     std::unique_ptr<juce::Component> envelopeTab;
@@ -140,7 +150,18 @@ private:
         AddPattern,
         AddTrack,
         DeletePattern,
-        DeleteTrack
+        DeleteTrack,
+        
+        ShowProfiler,
+        ExportProfilerReport
+    };
+    
+    // Profiler IDs for the stages of getNextAudioBlock, clear of graph node IDs
+    enum ProfilerStage
+    {
+        OscillatorStage = -100,
+        EnvelopeStage,
+        FilterStage
     };
     
     // Component creation and setup
@@ -159,6 +180,9 @@ private:
     // Connect processors in the graph
     void connectProcessors();
     
+    // Render the synth voice into a stereo block (audio thread)
+    void renderSynth(juce::AudioBuffer<float>& buffer, int numSamples);
+    
     // Update UI based on current effect
     void updateEffectsUI();
     
@@ -168,6 +192,10 @@ private:
     void saveProject(bool saveAs = false);
     void exportAudio();
     
+    // Audio profiling
+    void toggleProfiler();
+    void exportProfilerReport();
+    
     // Handle sequencer events
     void handleNoteEvent(const NoteEvent& event);
     void handleParameterChange(const std::string& paramId, float value);
@@ -0,0 +1,316 @@
+/*
+ * Underground Beats
+ * AudioProfiler.cpp
+ *
+ * Implementation of the audio callback profiler
+ */
+
+#include "AudioProfiler.h"
+#include <algorithm>
+
+namespace UndergroundBeats {
+
+namespace {
+
+// A gap of more than this many buffers between callbacks means the device ran dry
+constexpr double xrunGapInBuffers = 2.0;
+
+double nanosecondsToMicroseconds(double nanoseconds)
+{
+    return nanoseconds / 1000.0;
+}
+
+juce::var statsToJson(const AudioProfiler::Stats& stats)
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("count", stats.count);
+    object->setProperty("p50_us", nanosecondsToMicroseconds(stats.p50));
+    object->setProperty("p99_us", nanosecondsToMicroseconds(stats.p99));
+    object->setProperty("max_us", nanosecondsToMicroseconds(stats.max));
+    object->setProperty("mean_us", nanosecondsToMicroseconds(stats.mean));
+    return juce::var(object);
+}
+
+juce::String statsToCsv(const AudioProfiler::Stats& stats)
+{
+    return juce::String(stats.count) + ","
+         + juce::String(nanosecondsToMicroseconds(stats.p50), 2) + ","
+         + juce::String(nanosecondsToMicroseconds(stats.p99), 2) + ","
+         + juce::String(nanosecondsToMicroseconds(stats.max), 2) + ","
+         + juce::String(nanosecondsToMicroseconds(stats.mean), 2);
+}
+
+} // namespace
+
+//==============================================================================
+AudioProfiler::CallbackScope::CallbackScope(AudioProfiler& profilerToUse, int numSamplesToUse, double sampleRateToUse)
+    : profiler(profilerToUse)
+    , start(profilerToUse.isEnabled() ? now() : 0)
+    , numSamples(numSamplesToUse)
+    , sampleRate(sampleRateToUse)
+{
+}
+
+AudioProfiler::CallbackScope::~CallbackScope()
+{
+    if (start != 0)
+        profiler.recordCallback(start, numSamples, sampleRate);
+}
+
+AudioProfiler::NodeScope::NodeScope(AudioProfiler& profilerToUse, int nodeIdToUse)
+    : profiler(profilerToUse)
+    , start(profilerToUse.isEnabled() ? now() : 0)
+    , nodeId(nodeIdToUse)
+{
+}
+
+AudioProfiler::NodeScope::~NodeScope()
+{
+    if (start != 0)
+        profiler.recordNode(nodeId, start, now());
+}
+
+//==============================================================================
+void AudioProfiler::Window::add(double value, size_t capacity)
+{
+    if (values.size() < capacity)
+    {
+        values.push_back(value);
+        return;
+    }
+
+    values[next] = value;
+    next = (next + 1) % capacity;
+}
+
+AudioProfiler::Stats AudioProfiler::Window::getStats() const
+{
+    Stats stats;
+
+    if (values.empty())
+        return stats;
+
+    std::vector<double> sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+
+    const auto percentile = [&sorted](double fraction) {
+        const auto index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    };
+
+    double total = 0.0;
+    for (double value : sorted)
+    {
+        total += value;
+    }
+
+    stats.count = static_cast<int>(sorted.size());
+    stats.p50 = percentile(0.5);
+    stats.p99 = percentile(0.99);
+    stats.max = sorted.back();
+    stats.mean = total / static_cast<double>(sorted.size());
+    return stats;
+}
+
+//==============================================================================
+AudioProfiler::AudioProfiler(int windowSizeToUse)
+    : windowSize(static_cast<size_t>(juce::jmax(16, windowSizeToUse)))
+    , nanosecondsPerTick(1.0e9 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()))
+{
+}
+
+AudioProfiler::~AudioProfiler() = default;
+
+void AudioProfiler::setEnabled(bool shouldBeEnabled)
+{
+    enabled.store(shouldBeEnabled, std::memory_order_relaxed);
+}
+
+bool AudioProfiler::isEnabled() const
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+juce::int64 AudioProfiler::now()
+{
+    return juce::Time::getHighResolutionTicks();
+}
+
+void AudioProfiler::recordCallback(juce::int64 start, int numSamples, double sampleRate)
+{
+    push({ start, now() - start, callbackRecord, numSamples, sampleRate });
+}
+
+void AudioProfiler::recordNode(int nodeId, juce::int64 start, juce::int64 end)
+{
+    push({ start, end - start, nodeId, 0, 0.0 });
+}
+
+void AudioProfiler::setNodeName(int nodeId, const juce::String& name)
+{
+    const juce::ScopedLock lock(nameLock);
+    nodeNames[nodeId] = name;
+}
+
+void AudioProfiler::setDeviceXRunCount(int count)
+{
+    deviceXRuns = count;
+}
+
+void AudioProfiler::update()
+{
+    Record record;
+
+    while (records.pop(record))
+    {
+        const double duration = toNanoseconds(record.duration);
+
+        if (record.nodeId != callbackRecord)
+        {
+            nodeTimes[record.nodeId].add(duration, windowSize);
+            continue;
+        }
+
+        const double budget = record.sampleRate > 0.0
+                            ? 1.0e9 * static_cast<double>(record.numSamples) / record.sampleRate
+                            : 0.0;
+
+        if (budget > 0.0 && duration > budget)
+        {
+            ++deadlineMisses;
+        }
+
+        if (numCallbacks > 0 && lastBudget > 0.0
+            && toNanoseconds(record.start - lastCallbackStart) > xrunGapInBuffers * lastBudget)
+        {
+            ++xruns;
+        }
+
+        callbackTimes.add(duration, windowSize);
+        lastCallbackStart = record.start;
+        lastBudget = budget;
+        ++numCallbacks;
+    }
+}
+
+AudioProfiler::Summary AudioProfiler::getSummary() const
+{
+    Summary summary;
+    summary.callback = callbackTimes.getStats();
+    summary.budget = lastBudget;
+    summary.load = lastBudget > 0.0 ? summary.callback.p50 / lastBudget : 0.0;
+    summary.numCallbacks = numCallbacks;
+    summary.deadlineMisses = deadlineMisses;
+    summary.xruns = xruns;
+    summary.deviceXRuns = deviceXRuns;
+    summary.droppedRecords = droppedRecords.load(std::memory_order_relaxed);
+
+    const juce::ScopedLock lock(nameLock);
+
+    for (const auto& [nodeId, window] : nodeTimes)
+    {
+        NodeStats node;
+        node.nodeId = nodeId;
+
+        const auto name = nodeNames.find(nodeId);
+        node.name = name != nodeNames.end() ? name->second : "Node " + juce::String(nodeId);
+        node.stats = window.getStats();
+
+        summary.nodes.push_back(std::move(node));
+    }
+
+    std::sort(summary.nodes.begin(), summary.nodes.end(), [](const NodeStats& a, const NodeStats& b) {
+        return a.stats.p99 > b.stats.p99;
+    });
+
+    return summary;
+}
+
+void AudioProfiler::reset()
+{
+    // Discard whatever the audio thread has queued
+    Record record;
+    while (records.pop(record))
+    {
+    }
+
+    callbackTimes = Window();
+    nodeTimes.clear();
+    numCallbacks = 0;
+    deadlineMisses = 0;
+    xruns = 0;
+    lastCallbackStart = 0;
+    lastBudget = 0.0;
+    droppedRecords.store(0, std::memory_order_relaxed);
+}
+
+juce::var AudioProfiler::toJson() const
+{
+    const Summary summary = getSummary();
+
+    auto* object = new juce::DynamicObject();
+    object->setProperty("callback", statsToJson(summary.callback));
+    object->setProperty("budget_us", nanosecondsToMicroseconds(summary.budget));
+    object->setProperty("load", summary.load);
+    object->setProperty("callbacks", summary.numCallbacks);
+    object->setProperty("deadline_misses", summary.deadlineMisses);
+    object->setProperty("xruns", summary.xruns);
+    object->setProperty("device_xruns", summary.deviceXRuns);
+    object->setProperty("dropped_records", summary.droppedRecords);
+
+    juce::Array<juce::var> nodes;
+
+    for (const auto& node : summary.nodes)
+    {
+        auto* nodeObject = new juce::DynamicObject();
+        nodeObject->setProperty("id", node.nodeId);
+        nodeObject->setProperty("name", node.name);
+        nodeObject->setProperty("stats", statsToJson(node.stats));
+        nodes.add(juce::var(nodeObject));
+    }
+
+    object->setProperty("nodes", nodes);
+    return juce::var(object);
+}
+
+bool AudioProfiler::writeReport(const juce::File& file) const
+{
+    if (!file.hasFileExtension("csv"))
+    {
+        return file.replaceWithText(juce::JSON::toString(toJson()));
+    }
+
+    const Summary summary = getSummary();
+
+    juce::String csv;
+    csv << "# callbacks=" << summary.numCallbacks
+        << " deadline_misses=" << summary.deadlineMisses
+        << " xruns=" << summary.xruns
+        << " device_xruns=" << summary.deviceXRuns
+        << " budget_us=" << juce::String(nanosecondsToMicroseconds(summary.budget), 2) << "\n";
+    csv << "id,name,count,p50_us,p99_us,max_us,mean_us\n";
+    csv << "callback,Callback," << statsToCsv(summary.callback) << "\n";
+
+    for (const auto& node : summary.nodes)
+    {
+        csv << node.nodeId << "," << node.name.replaceCharacter(',', ' ') << "," << statsToCsv(node.stats) << "\n";
+    }
+
+    return file.replaceWithText(csv);
+}
+
+void AudioProfiler::push(const Record& record)
+{
+    // A full ring means the reader has fallen behind; the timing is lost, not the audio
+    if (!records.push(record))
+    {
+        droppedRecords.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+double AudioProfiler::toNanoseconds(juce::int64 ticks) const
+{
+    return static_cast<double>(ticks) * nanosecondsPerTick;
+}
+
+} // namespace UndergroundBeats
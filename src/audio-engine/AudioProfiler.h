@@ -0,0 +1,235 @@
+/*
+ * Underground Beats
+ * AudioProfiler.h
+ *
+ * Measures audio callback and node render times and detects dropouts
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../utils/Concurrency.h"
+#include <atomic>
+#include <map>
+#include <vector>
+
+namespace UndergroundBeats {
+
+/**
+ * @class AudioProfiler
+ * @brief Measures audio callback and node render times and detects dropouts
+ *
+ * The audio thread time-stamps each callback, and each node or stage within
+ * it, with the high-resolution clock and pushes the timings into a lock-free
+ * ring. Nothing else happens on the audio thread: no allocation, no locks.
+ *
+ * A reader on another thread (usually a UI timer) calls update() to drain
+ * the ring into rolling windows, from which it reports percentiles of the
+ * callback and per-node times. A callback that takes longer than the audio
+ * it produces is a deadline miss. A gap between two callbacks of more than
+ * two buffers' worth is counted as an xrun, since the device must have run
+ * dry. The device's own xrun count can be reported alongside where the
+ * driver supports it.
+ *
+ * Node IDs are chosen by whoever records them; GraphScheduler uses the
+ * graph's node IDs, and callers timing fixed stages use their own.
+ */
+class AudioProfiler {
+public:
+    /**
+     * @brief Rolling statistics of a set of durations, in nanoseconds
+     */
+    struct Stats {
+        int count = 0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+    };
+
+    /**
+     * @brief Statistics of one node
+     */
+    struct NodeStats {
+        int nodeId = 0;
+        juce::String name;
+        Stats stats;
+    };
+
+    /**
+     * @brief Everything the profiler has measured
+     */
+    struct Summary {
+        Stats callback;
+        double budget = 0.0;           // Duration of audio in the last callback, in nanoseconds
+        double load = 0.0;             // Median callback time as a fraction of the budget
+        juce::int64 numCallbacks = 0;
+        juce::int64 deadlineMisses = 0;
+        juce::int64 xruns = 0;         // Gaps between callbacks
+        int deviceXRuns = -1;          // As reported by the device, or -1 if unknown
+        juce::int64 droppedRecords = 0;
+        std::vector<NodeStats> nodes;  // Slowest (by p99) first
+    };
+
+    /**
+     * @brief Times one audio callback (audio thread)
+     */
+    class CallbackScope {
+    public:
+        CallbackScope(AudioProfiler& profilerToUse, int numSamples, double sampleRate);
+        ~CallbackScope();
+
+    private:
+        AudioProfiler& profiler;
+        juce::int64 start;
+        int numSamples;
+        double sampleRate;
+    };
+
+    /**
+     * @brief Times one node or stage within a callback (audio thread)
+     */
+    class NodeScope {
+    public:
+        NodeScope(AudioProfiler& profilerToUse, int nodeId);
+        ~NodeScope();
+
+    private:
+        AudioProfiler& profiler;
+        juce::int64 start;
+        int nodeId;
+    };
+
+    /**
+     * @brief Create a profiler
+     *
+     * @param windowSize Number of recent callbacks (and renders of each node) the statistics cover
+     */
+    explicit AudioProfiler(int windowSize = 1024);
+    ~AudioProfiler();
+
+    /**
+     * @brief Turn measuring on or off
+     *
+     * Measuring starts switched off, so the audio thread reads no clocks.
+     */
+    void setEnabled(bool shouldBeEnabled);
+
+    /**
+     * @brief Check whether measuring is on
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Read the high-resolution clock (any thread)
+     */
+    static juce::int64 now();
+
+    /**
+     * @brief Record a finished callback (audio thread)
+     *
+     * @param start The clock reading when the callback started
+     * @param numSamples Number of samples the callback produced
+     * @param sampleRate The sample rate
+     */
+    void recordCallback(juce::int64 start, int numSamples, double sampleRate);
+
+    /**
+     * @brief Record a finished node render (audio thread)
+     *
+     * Nodes rendered on worker threads are recorded by the audio thread
+     * once the block is complete, since the ring has a single writer.
+     *
+     * @param nodeId The node's ID
+     * @param start The clock reading when the render started
+     * @param end The clock reading when the render finished
+     */
+    void recordNode(int nodeId, juce::int64 start, juce::int64 end);
+
+    /**
+     * @brief Name a node for reports (any thread but the audio thread)
+     */
+    void setNodeName(int nodeId, const juce::String& name);
+
+    /**
+     * @brief Report the device's own xrun count (reader thread)
+     *
+     * @param count From juce::AudioIODevice::getXRunCount(), or -1 if unsupported
+     */
+    void setDeviceXRunCount(int count);
+
+    /**
+     * @brief Move new timings from the ring into the statistics (reader thread)
+     */
+    void update();
+
+    /**
+     * @brief Get the current statistics (reader thread)
+     */
+    Summary getSummary() const;
+
+    /**
+     * @brief Forget every measurement (reader thread)
+     */
+    void reset();
+
+    /**
+     * @brief Get the statistics as a JSON object (reader thread)
+     */
+    juce::var toJson() const;
+
+    /**
+     * @brief Write the statistics to a file (reader thread)
+     *
+     * @param file Destination; written as CSV if the extension is .csv, JSON otherwise
+     * @return true if successful
+     */
+    bool writeReport(const juce::File& file) const;
+
+private:
+    // One timing, as passed from the audio thread to the reader
+    struct Record {
+        juce::int64 start;
+        juce::int64 duration;
+        int nodeId;     // callbackRecord for a whole callback
+        int numSamples;
+        double sampleRate;
+    };
+
+    static constexpr int callbackRecord = -1;
+
+    // Fixed-size history of durations, in nanoseconds
+    struct Window {
+        std::vector<double> values;
+        size_t next = 0; // Oldest value, once the window is full
+
+        void add(double value, size_t capacity);
+        Stats getStats() const;
+    };
+
+    void push(const Record& record);
+    double toNanoseconds(juce::int64 ticks) const;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<juce::int64> droppedRecords { 0 };
+    Concurrency::LockFreeQueue<Record, 8192> records;
+
+    // Reader state
+    size_t windowSize;
+    double nanosecondsPerTick;
+    Window callbackTimes;
+    std::map<int, Window> nodeTimes;
+    juce::int64 numCallbacks = 0;
+    juce::int64 deadlineMisses = 0;
+    juce::int64 xruns = 0;
+    juce::int64 lastCallbackStart = 0;
+    double lastBudget = 0.0;
+    int deviceXRuns = -1;
+
+    juce::CriticalSection nameLock;
+    std::map<int, juce::String> nodeNames;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioProfiler)
+};
+
+} // namespace UndergroundBeats
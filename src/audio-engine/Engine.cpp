@@ -6,6 +6,7 @@ Engine::Engine()
 {
     // Create the processor graph
     processorGraph = std::make_unique<ProcessorGraph>();
+    processorGraph->getScheduler().setProfiler(&profiler);
     
     // Default initialization for test oscillator
     testOscillator.initialise([](float x) { return std::sin(x); }, 128);
@@ -41,6 +42,14 @@ bool Engine::initialize(const AudioDeviceSettings& settings)
     
     // Mark as initialized
     initialized = true;
+    
+    if (lookaheadEnabled)
+    {
+        lookaheadRenderer.prepare(deviceSettings.sampleRate, deviceSettings.bufferSize);
+        lookaheadRenderer.start(streamPosition);
+        lookaheadPrepared = true;
+    }
+    
     return true;
 }
 
@@ -50,12 +59,18 @@ bool Engine::shutdown()
     if (processorGraph)
         processorGraph->reset();
     
+    // Stop the lookahead workers; the audio callback is no longer running
+    lookaheadRenderer.release();
+    lookaheadPrepared = false;
+    
     initialized = false;
     return true;
 }
 
 void Engine::processAudio(const juce::AudioSourceChannelInfo& bufferToFill)
 {
+    AudioProfiler::CallbackScope callbackScope(profiler, bufferToFill.numSamples, processSpec.sampleRate);
+    
     if (!initialized || transportState != TransportState::Playing)
     {
         // Clear the buffer if not playing
@@ -77,6 +92,23 @@ void Engine::processAudio(const juce::AudioSourceChannelInfo& bufferToFill)
     
     // Process the audio block
     processingChain.process(context);
+    
+    // Add the tracks the lookahead workers rendered ahead of time
+    mixLookaheadTracks(bufferToFill);
+}
+
+void Engine::mixLookaheadTracks(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const juce::int64 position = streamPosition.load(std::memory_order_relaxed);
+    
+    if (lookaheadEnabled.load(std::memory_order_acquire) && bufferToFill.buffer->getNumChannels() >= 2)
+    {
+        juce::AudioBuffer<float> output(bufferToFill.buffer->getArrayOfWritePointers(), 2,
+                                        bufferToFill.startSample, bufferToFill.numSamples);
+        lookaheadRenderer.mixTracks(output, position, bufferToFill.numSamples);
+    }
+    
+    streamPosition.store(position + bufferToFill.numSamples, std::memory_order_relaxed);
 }
 
 bool Engine::start()
@@ -84,6 +116,12 @@ bool Engine::start()
     if (transportState == TransportState::Stopped || 
         transportState == TransportState::Stopping)
     {
+        // Playback restarts the stream, so the lookahead tracks render from its start
+        streamPosition = 0;
+        
+        if (lookaheadPrepared)
+            lookaheadRenderer.start(0);
+        
         setTransportState(TransportState::Starting);
         return true;
     }
@@ -182,4 +220,40 @@ TransportState Engine::getTransportState() const
     return transportState;
 }
 
+AudioProfiler& Engine::getProfiler()
+{
+    return profiler;
+}
+
+LookaheadRenderer& Engine::getLookaheadRenderer()
+{
+    return lookaheadRenderer;
+}
+
+void Engine::setLookaheadEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == lookaheadEnabled.load())
+        return;
+    
+    if (shouldBeEnabled && initialized)
+    {
+        if (!lookaheadPrepared)
+        {
+            // The audio thread has not touched the renderer yet, so it can be prepared while running
+            lookaheadRenderer.prepare(deviceSettings.sampleRate, deviceSettings.bufferSize);
+            lookaheadPrepared = true;
+        }
+        
+        // Render from where the audio callback will read next
+        lookaheadRenderer.start(streamPosition);
+    }
+    
+    lookaheadEnabled.store(shouldBeEnabled, std::memory_order_release);
+}
+
+bool Engine::isLookaheadEnabled() const
+{
+    return lookaheadEnabled;
+}
+
 } // namespace UndergroundBeats
@@ -3,6 +3,8 @@
 #include <JuceHeader.h>
 #include "ProcessorNode.h"
 #include "ProcessorGraph.h"
+#include "AudioProfiler.h"
+#include "LookaheadRenderer.h"
 
 // Audio device settings structure
 struct AudioDeviceSettings
@@ -53,11 +55,28 @@ public:
     // Transport control
     void setTransportState(TransportState newState);
     TransportState getTransportState() const;
+    
+    // Callback and per-node timing (read from the message thread)
+    AudioProfiler& getProfiler();
+    
+    // Tracks rendered ahead of the playhead on background threads and mixed
+    // into the output while enabled. Tracks can be added and removed at any
+    // time; disabling lookahead only stops the mixing.
+    LookaheadRenderer& getLookaheadRenderer();
+    void setLookaheadEnabled(bool shouldBeEnabled);
+    bool isLookaheadEnabled() const;
+    
+    // Add the lookahead tracks to a block and advance the stream position
+    // (audio thread; processAudio calls this itself)
+    void mixLookaheadTracks(const juce::AudioSourceChannelInfo& bufferToFill);
 
 private:
     // Audio device management
     AudioDeviceSettings deviceSettings;
     
+    // Declared before the graph, whose scheduler reports to it
+    AudioProfiler profiler;
+    
     // Audio processor graph
     std::unique_ptr<UndergroundBeats::ProcessorGraph> processorGraph;
     
@@ -67,6 +86,12 @@ private:
     // Lock-free transport state
     std::atomic<TransportState> transportState{TransportState::Stopped};
     
+    // Lookahead track rendering; positions count samples since playback started
+    LookaheadRenderer lookaheadRenderer;
+    std::atomic<bool> lookaheadEnabled{false};
+    bool lookaheadPrepared = false;
+    std::atomic<juce::int64> streamPosition{0};
+    
     // Test oscillator for initial implementation
     juce::dsp::Oscillator<float> testOscillator;
     juce::dsp::Gain<float> outputGain;
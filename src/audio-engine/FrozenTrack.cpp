@@ -0,0 +1,279 @@
+/*
+ * Underground Beats
+ * FrozenTrack.cpp
+ *
+ * Implementation of track freezing
+ */
+
+#include "FrozenTrack.h"
+#include "../utils/Hash.h"
+
+namespace UndergroundBeats {
+
+FrozenTrack::FrozenTrack(const juce::File& cacheDirectoryToUse)
+    : juce::Thread("Track freeze"),
+      cacheDirectory(cacheDirectoryToUse),
+      currentHash(0),
+      currentLength(0),
+      frozen(false)
+{
+}
+
+FrozenTrack::~FrozenTrack()
+{
+    stopFreeze();
+    cancelPendingUpdate();
+}
+
+bool FrozenTrack::freeze(const Track& track, OfflineRenderer::RenderCallback render, const EffectsChain* effects,
+                         double sampleRate, int blockSize, juce::int64 lengthInSamples,
+                         const juce::String& sourceState, FreezeCallback onComplete)
+{
+    if (sampleRate <= 0.0 || lengthInSamples <= 0 || !render)
+    {
+        return false;
+    }
+
+    // Only the latest freeze matters
+    cancelFreeze();
+
+    const juce::uint64 stateHash = computeStateHash(track, effects, sourceState);
+
+    // The file also depends on how it was rendered
+    const juce::uint64 fileKey = Hash::combineText(stateHash, juce::String(sampleRate) + ":" + juce::String(lengthInSamples));
+
+    auto newJob = std::make_unique<FreezeJob>();
+    newJob->file = cacheDirectory.getChildFile("freeze_" + juce::String::toHexString(static_cast<juce::int64>(fileKey)) + ".wav");
+    newJob->stateHash = stateHash;
+    newJob->sampleRate = sampleRate;
+    newJob->blockSize = blockSize;
+    newJob->lengthInSamples = lengthInSamples;
+    newJob->needsRender = !newJob->file.existsAsFile();
+    newJob->onComplete = std::move(onComplete);
+
+    if (newJob->needsRender)
+    {
+        if (cacheDirectory.createDirectory().failed())
+        {
+            return false;
+        }
+
+        // Render through a copy of the chain, so the live one is never
+        // prepared or processed away from the audio thread
+        if (effects != nullptr)
+        {
+            newJob->effects = std::make_unique<EffectsChain>();
+
+            if (!newJob->effects->restoreStateFromXml(effects->createStateXml().get()))
+            {
+                return false;
+            }
+        }
+
+        // Pre-fader: volume, pan, mute and solo are applied live
+        newJob->source.name = track.getName();
+        newJob->source.render = std::move(render);
+        newJob->source.effects = newJob->effects.get();
+    }
+
+    job = std::move(newJob);
+
+    if (job->needsRender)
+    {
+        startThread(juce::Thread::Priority::low);
+    }
+    else
+    {
+        // Already in the cache; switch over once this call has returned
+        triggerAsyncUpdate();
+    }
+
+    return true;
+}
+
+void FrozenTrack::cancelFreeze()
+{
+    auto cancelled = stopFreeze();
+    cancelPendingUpdate();
+
+    if (cancelled != nullptr && cancelled->onComplete)
+    {
+        cancelled->onComplete(false);
+    }
+}
+
+void FrozenTrack::unfreeze()
+{
+    cancelFreeze();
+
+    if (!frozen)
+    {
+        return;
+    }
+
+    currentFile = juce::File();
+    currentHash = 0;
+    currentLength = 0;
+    frozen = false;
+
+    audioState.publish(std::make_unique<FrozenAudio>());
+}
+
+bool FrozenTrack::isFrozen() const
+{
+    return frozen;
+}
+
+bool FrozenTrack::isFreezing() const
+{
+    return job != nullptr;
+}
+
+bool FrozenTrack::isUpToDate(const Track& track, const EffectsChain* effects, const juce::String& sourceState) const
+{
+    return frozen && computeStateHash(track, effects, sourceState) == currentHash;
+}
+
+bool FrozenTrack::invalidateIfChanged(const Track& track, const EffectsChain* effects, const juce::String& sourceState)
+{
+    if (!frozen || isUpToDate(track, effects, sourceState))
+    {
+        return false;
+    }
+
+    unfreeze();
+    return true;
+}
+
+juce::File FrozenTrack::getFile() const
+{
+    return currentFile;
+}
+
+juce::int64 FrozenTrack::getLengthInSamples() const
+{
+    return currentLength;
+}
+
+void FrozenTrack::render(juce::AudioBuffer<float>& buffer, juce::int64 startSample, int numSamples)
+{
+    audioState.acquire();
+
+    const FrozenAudio* audio = audioState.get();
+
+    if (audio == nullptr || audio->reader == nullptr)
+    {
+        buffer.clear(0, numSamples);
+        return;
+    }
+
+    // Reads straight from the mapped file; samples outside it come back silent
+    audio->reader->read(&buffer, 0, numSamples, startSample, true, true);
+}
+
+juce::uint64 FrozenTrack::computeStateHash(const Track& track, const EffectsChain* effects, const juce::String& sourceState)
+{
+    juce::uint64 hash = Hash::offsetBasis;
+
+    hash = Hash::combineText(hash, juce::String(track.getMidiChannel()) + ":" + juce::String(track.getMidiProgram()));
+
+    for (size_t i = 0; i < track.getPatternCount(); ++i)
+    {
+        if (auto pattern = track.getPattern(i))
+        {
+            hash = Hash::combineText(hash, pattern->createStateXml()->toString());
+        }
+    }
+
+    if (effects != nullptr)
+    {
+        hash = Hash::combineText(hash, effects->createStateXml()->toString());
+    }
+
+    return Hash::combineText(hash, sourceState);
+}
+
+void FrozenTrack::run()
+{
+    OfflineRenderer renderer;
+    renderer.addTrack(job->source);
+
+    // Checked after every chunk, so cancelling never waits for the whole render
+    renderer.setProgressCallback([this] (float) { return !threadShouldExit(); });
+
+    // Render next to the cache file and move it into place, so a failed
+    // render never leaves a truncated file behind under the real name
+    const juce::File tempFile = job->file.withFileExtension(".tmp");
+
+    if (renderer.renderToFile(tempFile, job->sampleRate, job->blockSize, job->lengthInSamples, 32)
+        && tempFile.moveFileTo(job->file))
+    {
+        job->rendered = true;
+    }
+    else
+    {
+        tempFile.deleteFile();
+    }
+
+    if (!threadShouldExit())
+    {
+        triggerAsyncUpdate();
+    }
+}
+
+void FrozenTrack::handleAsyncUpdate()
+{
+    auto finished = stopFreeze();
+
+    if (finished == nullptr)
+    {
+        return;
+    }
+
+    bool succeeded = false;
+
+    if (!finished->needsRender || finished->rendered)
+    {
+        if (auto reader = openReader(finished->file))
+        {
+            currentFile = finished->file;
+            currentHash = finished->stateHash;
+            currentLength = reader->lengthInSamples;
+
+            auto audio = std::make_unique<FrozenAudio>();
+            audio->reader = std::move(reader);
+            frozen = true;
+
+            audioState.publish(std::move(audio));
+            succeeded = true;
+        }
+    }
+
+    if (finished->onComplete)
+    {
+        finished->onComplete(succeeded);
+    }
+}
+
+std::unique_ptr<FrozenTrack::FreezeJob> FrozenTrack::stopFreeze()
+{
+    // A finished render has already exited; a running one stops at its next chunk
+    stopThread(10000);
+
+    return std::move(job);
+}
+
+std::unique_ptr<juce::MemoryMappedAudioFormatReader> FrozenTrack::openReader(const juce::File& file)
+{
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(wavFormat.createMemoryMappedReader(file));
+
+    if (reader == nullptr || !reader->mapEntireFile())
+    {
+        return nullptr;
+    }
+
+    return reader;
+}
+
+} // namespace UndergroundBeats
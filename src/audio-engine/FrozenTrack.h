@@ -0,0 +1,200 @@
+/*
+ * Underground Beats
+ * FrozenTrack.h
+ *
+ * Renders a track to a cached audio file and streams it back
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "../sequencer/Track.h"
+#include "../effects/EffectsChain.h"
+#include "../utils/Concurrency.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace UndergroundBeats {
+
+/**
+ * @class FrozenTrack
+ * @brief Renders a track to a cached audio file and streams it back
+ *
+ * Freezing renders a track's synth and insert effects offline into a 32-bit
+ * float WAV file in a cache directory. Playback then reads the file through a
+ * memory-mapped reader instead of synthesising the track live, which costs a
+ * copy per block no matter how heavy the track was.
+ *
+ * The frozen audio is pre-fader: volume, pan, mute and solo stay live. The
+ * cache file is named after a hash of everything else that shapes the audio
+ * (the track's patterns and MIDI settings, its effect chain state and any
+ * state the caller supplies for the source), so freezing an unchanged track
+ * again reuses the file, and isUpToDate() tells when a freeze has gone stale.
+ *
+ * freeze() and unfreeze() run on the message thread. The render itself runs
+ * on a background thread from a copy of the effect chain, so the live chain
+ * keeps playing untouched. When it finishes, the new reader is handed to the
+ * audio thread with an atomic exchange at the start of the next render(), and
+ * the old one is freed back on the message thread.
+ */
+class FrozenTrack : private juce::Thread,
+                    private juce::AsyncUpdater {
+public:
+    /**
+     * @brief Called on the message thread when a freeze finishes
+     *
+     * The argument is true if the track is now frozen, and false if the
+     * render failed or was cancelled.
+     */
+    using FreezeCallback = std::function<void(bool frozen)>;
+
+    /**
+     * @brief Create an unfrozen track
+     *
+     * @param cacheDirectory Directory the frozen audio files are written to
+     */
+    explicit FrozenTrack(const juce::File& cacheDirectory);
+    ~FrozenTrack() override;
+
+    /**
+     * @brief Render the track into the cache in the background and switch playback to it
+     *
+     * The track keeps playing as before until the render finishes. A freeze
+     * that is still running is cancelled first. If the cache already holds
+     * audio for this state, nothing is rendered.
+     *
+     * @param track The track whose patterns and MIDI settings are frozen
+     * @param render Callback that renders the track's source material (e.g. its synth); called on the freeze thread
+     * @param effects Optional insert effect chain for the track; only its state is read
+     * @param sampleRate The sample rate in Hz
+     * @param blockSize The block size used for the source and effects
+     * @param lengthInSamples Length of the frozen audio, including any tail
+     * @param sourceState Serialised state of the source (e.g. the synth preset)
+     * @param onComplete Optional callback for when the freeze finishes
+     * @return true if the freeze was started
+     */
+    bool freeze(const Track& track, OfflineRenderer::RenderCallback render, const EffectsChain* effects,
+                double sampleRate, int blockSize, juce::int64 lengthInSamples,
+                const juce::String& sourceState = {}, FreezeCallback onComplete = nullptr);
+
+    /**
+     * @brief Cancel a running freeze; its callback is called with false
+     */
+    void cancelFreeze();
+
+    /**
+     * @brief Switch playback back to the live track
+     *
+     * Cancels a running freeze. The cache file is kept so an unchanged track
+     * can be frozen again instantly.
+     */
+    void unfreeze();
+
+    /**
+     * @brief Check whether the track is frozen
+     */
+    bool isFrozen() const;
+
+    /**
+     * @brief Check whether a freeze is rendering or waiting to complete
+     */
+    bool isFreezing() const;
+
+    /**
+     * @brief Check whether the frozen audio still matches the track
+     *
+     * @return true if frozen and nothing that shapes the audio has changed
+     */
+    bool isUpToDate(const Track& track, const EffectsChain* effects, const juce::String& sourceState = {}) const;
+
+    /**
+     * @brief Unfreeze the track if it has changed since it was frozen
+     *
+     * @return true if the freeze was invalidated
+     */
+    bool invalidateIfChanged(const Track& track, const EffectsChain* effects, const juce::String& sourceState = {});
+
+    /**
+     * @brief Get the cache file holding the frozen audio
+     */
+    juce::File getFile() const;
+
+    /**
+     * @brief Get the length of the frozen audio in samples
+     */
+    juce::int64 getLengthInSamples() const;
+
+    /**
+     * @brief Copy frozen audio into a buffer (audio thread)
+     *
+     * Has the same signature as OfflineRenderer::RenderCallback, so a frozen
+     * track can stand in for the live source. Samples past the end of the
+     * frozen audio, or any samples while unfrozen, are silent.
+     *
+     * @param buffer Stereo buffer to write to
+     * @param startSample Position in the frozen audio of the first sample
+     * @param numSamples Number of samples to write
+     */
+    void render(juce::AudioBuffer<float>& buffer, juce::int64 startSample, int numSamples);
+
+    /**
+     * @brief Hash everything that shapes a track's pre-fader audio
+     *
+     * @return The hash of the patterns, MIDI settings, effect and source state
+     */
+    static juce::uint64 computeStateHash(const Track& track, const EffectsChain* effects,
+                                         const juce::String& sourceState = {});
+
+private:
+    // A mapped cache file, or an empty one while unfrozen
+    struct FrozenAudio {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+    };
+
+    // A freeze in progress; the freeze thread only renders, the message
+    // thread does everything else
+    struct FreezeJob {
+        juce::File file;
+        juce::uint64 stateHash = 0;
+        OfflineRenderer::TrackSource source;
+        std::unique_ptr<EffectsChain> effects; // Private copy of the track's chain
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        juce::int64 lengthInSamples = 0;
+        bool needsRender = false;
+        std::atomic<bool> rendered { false };
+        FreezeCallback onComplete;
+    };
+
+    juce::File cacheDirectory;
+
+    // What the message thread last published
+    juce::File currentFile;
+    juce::uint64 currentHash;
+    juce::int64 currentLength;
+    bool frozen;
+
+    // Published by the message thread, picked up by the audio thread in render()
+    Concurrency::RetiringPointer<FrozenAudio> audioState;
+
+    // The running freeze, if any (message thread, read by the freeze thread while it renders)
+    std::unique_ptr<FreezeJob> job;
+
+    // Thread implementation
+    void run() override;
+
+    // AsyncUpdater implementation
+    void handleAsyncUpdate() override;
+
+    // Stop the freeze thread and take its job back (message thread)
+    std::unique_ptr<FreezeJob> stopFreeze();
+
+    // Open the cache file with a memory-mapped reader
+    static std::unique_ptr<juce::MemoryMappedAudioFormatReader> openReader(const juce::File& file);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FrozenTrack)
+};
+
+} // namespace UndergroundBeats
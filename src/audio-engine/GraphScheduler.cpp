@@ -0,0 +1,703 @@
+/*
+ * Underground Beats
+ * GraphScheduler.cpp
+ *
+ * Implementation of the dependency-aware multithreaded graph renderer
+ */
+
+#include "GraphScheduler.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace UndergroundBeats {
+
+using IOProcessor = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+
+//==============================================================================
+// Worker thread that sleeps until the audio thread dispatches a block
+//==============================================================================
+
+class GraphScheduler::Worker : public juce::Thread {
+public:
+    Worker(GraphScheduler& ownerToUse, int index)
+        : juce::Thread("Graph worker " + juce::String(index))
+        , owner(ownerToUse)
+    {
+    }
+
+    // Lock-free, so the audio thread can call it every block
+    void wake()
+    {
+        blockReady.notify();
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            // Spins briefly, then sleeps until the next wake(); stopWorkers() wakes it to exit
+            blockReady.wait();
+
+            if (threadShouldExit())
+                break;
+
+            owner.workerEntry();
+        }
+    }
+
+private:
+    GraphScheduler& owner;
+    Concurrency::WakeSignal blockReady;
+};
+
+//==============================================================================
+// Background thread that compiles schedules and frees retired ones
+//==============================================================================
+
+class GraphScheduler::Compiler : public juce::Thread {
+public:
+    explicit Compiler(GraphScheduler& ownerToUse)
+        : juce::Thread("Graph compiler")
+        , owner(ownerToUse)
+    {
+    }
+
+    void wake()
+    {
+        snapshotQueued.signal();
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            // Wake periodically even when idle so retired schedules get freed
+            snapshotQueued.wait(50);
+            owner.runCompilerPass();
+        }
+    }
+
+private:
+    GraphScheduler& owner;
+    juce::WaitableEvent snapshotQueued;
+};
+
+//==============================================================================
+
+GraphScheduler::GraphScheduler()
+    : requestedWorkers(-1)
+    , parallelThreshold(8)
+    , currentSampleRate(44100.0)
+    , currentBlockSize(512)
+    , prepared(false)
+{
+}
+
+GraphScheduler::~GraphScheduler()
+{
+    release();
+}
+
+void GraphScheduler::setNumWorkers(int numWorkers)
+{
+    requestedWorkers = numWorkers;
+
+    if (prepared)
+    {
+        stopWorkers();
+        startWorkers();
+    }
+}
+
+int GraphScheduler::getNumWorkers() const
+{
+    return static_cast<int>(workers.size());
+}
+
+void GraphScheduler::setParallelThreshold(int minNodes)
+{
+    parallelThreshold = std::max(2, minNodes);
+}
+
+void GraphScheduler::prepare(double sampleRate, int blockSize)
+{
+    currentSampleRate = sampleRate;
+    currentBlockSize = blockSize;
+
+    if (!prepared)
+    {
+        prepared = true;
+        startWorkers();
+
+        compiler = std::make_unique<Compiler>(*this);
+        compiler->startThread(juce::Thread::Priority::low);
+    }
+}
+
+void GraphScheduler::release()
+{
+    // Only called while the audio callback is stopped
+    if (compiler != nullptr)
+    {
+        compiler->stopThread(1000);
+        compiler.reset();
+    }
+
+    stopWorkers();
+    prepared = false;
+
+    schedule.reset();
+    schedulePublished = false;
+    activeIsParallel = false;
+
+    const juce::ScopedLock lock(snapshotLock);
+    queuedSnapshot.reset();
+}
+
+void GraphScheduler::startWorkers()
+{
+    const int numCpus = juce::SystemStats::getNumCpus();
+    const int numWorkers = requestedWorkers >= 0 ? requestedWorkers
+                                                 : juce::jlimit(0, 7, numCpus - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto worker = std::make_unique<Worker>(*this, i + 1);
+
+        // Keep each worker on its own core, leaving core 0 for the audio thread
+        if (numCpus > 1)
+        {
+            worker->setAffinityMask(juce::uint32(1) << ((i + 1) % std::min(numCpus, 32)));
+        }
+
+        worker->startRealtimeThread(juce::Thread::RealtimeOptions{});
+        workers.push_back(std::move(worker));
+    }
+}
+
+void GraphScheduler::stopWorkers()
+{
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wake();
+    }
+
+    for (auto& worker : workers)
+    {
+        worker->stopThread(1000);
+    }
+
+    workers.clear();
+}
+
+bool GraphScheduler::rebuild(juce::AudioProcessorGraph& graph)
+{
+    auto newSchedule = compile(takeSnapshot(graph), parallelThreshold);
+
+    if (newSchedule == nullptr)
+    {
+        // Feedback loop; keep rendering the previous schedule
+        return false;
+    }
+
+    publish(std::move(newSchedule));
+    return true;
+}
+
+void GraphScheduler::rebuildAsync(juce::AudioProcessorGraph& graph)
+{
+    auto snapshot = std::make_unique<GraphSnapshot>(takeSnapshot(graph));
+
+    {
+        // Only the latest snapshot matters; an older queued one is dropped
+        const juce::ScopedLock lock(snapshotLock);
+        queuedSnapshot = std::move(snapshot);
+    }
+
+    if (compiler != nullptr)
+    {
+        compiler->wake();
+    }
+}
+
+GraphScheduler::GraphSnapshot GraphScheduler::takeSnapshot(juce::AudioProcessorGraph& graph) const
+{
+    GraphSnapshot snapshot;
+
+    for (auto* node : graph.getNodes())
+    {
+        snapshot.nodes.push_back(node);
+    }
+
+    snapshot.connections = graph.getConnections();
+    snapshot.blockSize = currentBlockSize;
+    snapshot.allowParallel = !workers.empty();
+
+    return snapshot;
+}
+
+std::unique_ptr<GraphScheduler::Schedule> GraphScheduler::compile(const GraphSnapshot& snapshot, int minParallelNodes)
+{
+    auto newSchedule = std::make_unique<Schedule>();
+    newSchedule->blockSize = snapshot.blockSize;
+    newSchedule->chunkMidiIn.ensureSize(2048);
+    newSchedule->chunkMidiOut.ensureSize(2048);
+
+    // Create a scheduled node for every graph node
+    std::unordered_map<juce::uint32, int> indexForNode;
+
+    for (const auto& node : snapshot.nodes)
+    {
+        auto scheduled = std::make_unique<ScheduledNode>();
+        scheduled->node = node;
+        scheduled->processor = node->getProcessor();
+
+        if (auto* ioProcessor = dynamic_cast<IOProcessor*>(scheduled->processor))
+        {
+            scheduled->ioType = static_cast<int>(ioProcessor->getType());
+        }
+
+        const int numChannels = std::max({ scheduled->processor->getTotalNumInputChannels(),
+                                           scheduled->processor->getTotalNumOutputChannels(), 1 });
+        scheduled->buffer.setSize(numChannels, snapshot.blockSize);
+        scheduled->midi.ensureSize(2048);
+
+        indexForNode[node->nodeID.uid] = static_cast<int>(newSchedule->nodes.size());
+        newSchedule->nodes.push_back(std::move(scheduled));
+    }
+
+    // Turn the connection list into per-node inputs and dependency edges
+    for (const auto& connection : snapshot.connections)
+    {
+        auto sourceIt = indexForNode.find(connection.source.nodeID.uid);
+        auto destIt = indexForNode.find(connection.destination.nodeID.uid);
+
+        if (sourceIt == indexForNode.end() || destIt == indexForNode.end())
+            continue;
+
+        auto& source = *newSchedule->nodes[sourceIt->second];
+        auto& dest = *newSchedule->nodes[destIt->second];
+
+        if (connection.source.isMIDI())
+        {
+            dest.midiInputs.push_back(sourceIt->second);
+        }
+        else
+        {
+            dest.audioInputs.push_back({ sourceIt->second,
+                                         connection.source.channelIndex,
+                                         connection.destination.channelIndex });
+        }
+
+        if (std::find(source.successors.begin(), source.successors.end(), destIt->second) == source.successors.end())
+        {
+            source.successors.push_back(destIt->second);
+            ++dest.numDependencies;
+        }
+    }
+
+    // Kahn's algorithm gives the serial order and the width of each dependency level
+    const int numNodes = static_cast<int>(newSchedule->nodes.size());
+    std::vector<int> pending(numNodes);
+    std::vector<int> level(numNodes, 0);
+    std::vector<int> ready;
+
+    for (int i = 0; i < numNodes; ++i)
+    {
+        pending[i] = newSchedule->nodes[i]->numDependencies;
+        if (pending[i] == 0)
+        {
+            ready.push_back(i);
+            newSchedule->rootNodes.push_back(i);
+        }
+    }
+
+    while (!ready.empty())
+    {
+        const int index = ready.back();
+        ready.pop_back();
+        newSchedule->topologicalOrder.push_back(index);
+
+        for (int successor : newSchedule->nodes[index]->successors)
+        {
+            level[successor] = std::max(level[successor], level[index] + 1);
+            if (--pending[successor] == 0)
+            {
+                ready.push_back(successor);
+            }
+        }
+    }
+
+    if (static_cast<int>(newSchedule->topologicalOrder.size()) != numNodes)
+    {
+        return nullptr;
+    }
+
+    std::vector<int> nodesPerLevel(numNodes + 1, 0);
+    for (int i = 0; i < numNodes; ++i)
+    {
+        newSchedule->maxParallelism = std::max(newSchedule->maxParallelism, ++nodesPerLevel[level[i]]);
+    }
+
+    newSchedule->renderInParallel = snapshot.allowParallel
+                                    && numNodes >= minParallelNodes
+                                    && newSchedule->maxParallelism > 1;
+
+    newSchedule->readySlots = std::make_unique<std::atomic<int>[]>(static_cast<size_t>(std::max(1, numNodes)));
+
+    return newSchedule;
+}
+
+void GraphScheduler::setProfiler(AudioProfiler* profilerToUse)
+{
+    profiler.store(profilerToUse, std::memory_order_release);
+}
+
+void GraphScheduler::publish(std::unique_ptr<Schedule> newSchedule)
+{
+    // Name the nodes for profiler reports while off the audio thread
+    if (auto* nodeProfiler = profiler.load(std::memory_order_acquire))
+    {
+        for (const auto& node : newSchedule->nodes)
+        {
+            if (node->ioType < 0)
+            {
+                nodeProfiler->setNodeName(static_cast<int>(node->node->nodeID.uid), node->processor->getName());
+            }
+        }
+    }
+
+    // rebuild() publishes from the caller's thread, so keep it and the compiler
+    // from freeing retired schedules at the same time
+    const juce::ScopedLock lock(publishLock);
+
+    // A schedule the audio thread never picked up is superseded and can go now
+    schedule.publish(std::move(newSchedule));
+    schedulePublished = true;
+}
+
+void GraphScheduler::runCompilerPass()
+{
+    {
+        // Destroying a schedule drops the last reference to any node removed from the graph
+        const juce::ScopedLock lock(publishLock);
+        schedule.releaseRetired();
+    }
+
+    std::unique_ptr<GraphSnapshot> snapshot;
+    {
+        const juce::ScopedLock lock(snapshotLock);
+        snapshot = std::move(queuedSnapshot);
+    }
+
+    if (snapshot == nullptr)
+        return;
+
+    if (auto newSchedule = compile(*snapshot, parallelThreshold))
+    {
+        publish(std::move(newSchedule));
+    }
+
+    // Dropping the snapshot here releases this thread's references to removed nodes
+}
+
+void GraphScheduler::acquirePendingSchedule()
+{
+    if (schedule.acquire())
+    {
+        activeIsParallel.store(schedule.get()->renderInParallel, std::memory_order_relaxed);
+    }
+}
+
+bool GraphScheduler::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    acquirePendingSchedule();
+
+    if (schedule.get() == nullptr || schedule.get()->blockSize <= 0)
+    {
+        return false;
+    }
+
+    auto& s = *schedule.get();
+    const int totalSamples = buffer.getNumSamples();
+
+    if (totalSamples <= s.blockSize)
+    {
+        renderBlock(s, buffer, midiMessages);
+        return true;
+    }
+
+    // The host sent more than the prepared block size; render it in chunks that fit the node buffers
+    s.chunkMidiOut.clear();
+
+    for (int start = 0; start < totalSamples; start += s.blockSize)
+    {
+        const int numSamples = std::min(s.blockSize, totalSamples - start);
+        juce::AudioBuffer<float> chunk(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, numSamples);
+
+        s.chunkMidiIn.clear();
+        s.chunkMidiIn.addEvents(midiMessages, start, numSamples, -start);
+
+        renderBlock(s, chunk, s.chunkMidiIn);
+
+        s.chunkMidiOut.addEvents(s.chunkMidiIn, 0, numSamples, start);
+    }
+
+    midiMessages.swapWith(s.chunkMidiOut);
+    return true;
+}
+
+void GraphScheduler::renderBlock(Schedule& s, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    ioBuffer = &buffer;
+    ioMidi = &midiMessages;
+    blockNumSamples = numSamples;
+
+    // Capture the graph inputs before the output node starts writing to the same buffer
+    for (auto& node : s.nodes)
+    {
+        if (node->ioType == IOProcessor::audioInputNode)
+        {
+            const int numChannels = std::min(node->buffer.getNumChannels(), buffer.getNumChannels());
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                node->buffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+            }
+        }
+        else if (node->ioType == IOProcessor::midiInputNode)
+        {
+            node->midi.clear();
+            node->midi.addEvents(midiMessages, 0, numSamples, 0);
+        }
+    }
+
+    buffer.clear();
+    midiMessages.clear();
+
+    // Sampled once, so the whole block is either timed or not
+    AudioProfiler* blockProfiler = profiler.load(std::memory_order_acquire);
+    profilingBlock = blockProfiler != nullptr && blockProfiler->isEnabled();
+
+    if (!s.renderInParallel)
+    {
+        for (int index : s.topologicalOrder)
+        {
+            renderNode(s, index);
+        }
+
+        reportNodeTimes(s, blockProfiler);
+        return;
+    }
+
+    // Reset the dependency counters and seed the ready queue with the root nodes
+    const int numNodes = static_cast<int>(s.nodes.size());
+    for (int i = 0; i < numNodes; ++i)
+    {
+        s.nodes[i]->pendingDependencies.store(s.nodes[i]->numDependencies, std::memory_order_relaxed);
+        s.readySlots[i].store(-1, std::memory_order_relaxed);
+    }
+
+    s.readyWrite.store(0, std::memory_order_relaxed);
+    s.readyRead.store(0, std::memory_order_relaxed);
+    s.numCompleted.store(0, std::memory_order_relaxed);
+
+    for (int index : s.rootNodes)
+    {
+        pushReady(s, index);
+    }
+
+    dispatchedSchedule.store(&s);
+
+    // The audio thread renders nodes too, so it needs at most one helper per extra parallel node
+    const int numToWake = std::min(static_cast<int>(workers.size()), s.maxParallelism - 1);
+
+    for (int i = 0; i < numToWake; ++i)
+    {
+        workers[static_cast<size_t>(i)]->wake();
+    }
+
+    runReadyNodes(s);
+
+    // Make sure no worker is still looking at this block before returning
+    dispatchedSchedule.store(nullptr);
+    while (workersInside.load() > 0)
+    {
+        Concurrency::pauseCpu();
+    }
+
+    reportNodeTimes(s, blockProfiler);
+}
+
+bool GraphScheduler::hasSchedule() const
+{
+    return schedulePublished.load(std::memory_order_relaxed);
+}
+
+bool GraphScheduler::isRenderingInParallel() const
+{
+    return activeIsParallel.load(std::memory_order_relaxed);
+}
+
+void GraphScheduler::workerEntry()
+{
+    workersInside.fetch_add(1);
+
+    if (auto* s = dispatchedSchedule.load())
+    {
+        runReadyNodes(*s);
+    }
+
+    workersInside.fetch_sub(1);
+}
+
+void GraphScheduler::runReadyNodes(Schedule& s)
+{
+    const int numNodes = static_cast<int>(s.nodes.size());
+
+    while (s.numCompleted.load(std::memory_order_acquire) < numNodes)
+    {
+        const int index = popReady(s);
+
+        if (index < 0)
+        {
+            // Nothing ready yet; another thread is finishing an input
+            Concurrency::pauseCpu();
+            continue;
+        }
+
+        renderNode(s, index);
+
+        for (int successor : s.nodes[index]->successors)
+        {
+            if (s.nodes[successor]->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                pushReady(s, successor);
+            }
+        }
+
+        s.numCompleted.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+void GraphScheduler::pushReady(Schedule& s, int nodeIndex)
+{
+    const int slot = s.readyWrite.fetch_add(1, std::memory_order_acq_rel);
+    s.readySlots[slot].store(nodeIndex, std::memory_order_release);
+}
+
+int GraphScheduler::popReady(Schedule& s)
+{
+    int readPos = s.readyRead.load(std::memory_order_acquire);
+
+    while (readPos < s.readyWrite.load(std::memory_order_acquire))
+    {
+        const int nodeIndex = s.readySlots[readPos].load(std::memory_order_acquire);
+
+        if (nodeIndex < 0)
+        {
+            // Slot reserved but not yet published
+            return -1;
+        }
+
+        if (s.readyRead.compare_exchange_weak(readPos, readPos + 1, std::memory_order_acq_rel))
+        {
+            return nodeIndex;
+        }
+    }
+
+    return -1;
+}
+
+void GraphScheduler::renderNode(Schedule& s, int nodeIndex)
+{
+    auto& node = *s.nodes[nodeIndex];
+    const int numSamples = blockNumSamples;
+
+    switch (node.ioType)
+    {
+        case IOProcessor::audioInputNode:
+        case IOProcessor::midiInputNode:
+            // Filled in before the block was dispatched
+            return;
+
+        case IOProcessor::audioOutputNode:
+            for (const auto& input : node.audioInputs)
+            {
+                const auto& sourceBuffer = s.nodes[input.sourceNode]->buffer;
+                if (input.destChannel < ioBuffer->getNumChannels() && input.sourceChannel < sourceBuffer.getNumChannels())
+                {
+                    ioBuffer->addFrom(input.destChannel, 0, sourceBuffer, input.sourceChannel, 0, numSamples);
+                }
+            }
+            return;
+
+        case IOProcessor::midiOutputNode:
+            for (int source : node.midiInputs)
+            {
+                ioMidi->addEvents(s.nodes[source]->midi, 0, numSamples, 0);
+            }
+            return;
+
+        default:
+            break;
+    }
+
+    // Gather the node's inputs; every source has finished rendering by now
+    juce::AudioBuffer<float> block(node.buffer.getArrayOfWritePointers(), node.buffer.getNumChannels(), numSamples);
+    block.clear();
+
+    for (const auto& input : node.audioInputs)
+    {
+        const auto& sourceBuffer = s.nodes[input.sourceNode]->buffer;
+        if (input.destChannel < block.getNumChannels() && input.sourceChannel < sourceBuffer.getNumChannels())
+        {
+            block.addFrom(input.destChannel, 0, sourceBuffer, input.sourceChannel, 0, numSamples);
+        }
+    }
+
+    node.midi.clear();
+    for (int source : node.midiInputs)
+    {
+        node.midi.addEvents(s.nodes[source]->midi, 0, numSamples, 0);
+    }
+
+    // Never block on the message thread; a processor it is reconfiguring stays silent for this block
+    const juce::ScopedTryLock processorLock(node.processor->getCallbackLock());
+
+    if (!processorLock.isLocked() || node.processor->isSuspended())
+    {
+        block.clear();
+        node.midi.clear();
+    }
+    else if (profilingBlock)
+    {
+        node.renderStart = AudioProfiler::now();
+        node.processor->processBlock(block, node.midi);
+        node.renderEnd = AudioProfiler::now();
+    }
+    else
+    {
+        node.processor->processBlock(block, node.midi);
+    }
+}
+
+void GraphScheduler::reportNodeTimes(Schedule& s, AudioProfiler* blockProfiler)
+{
+    if (!profilingBlock)
+        return;
+
+    // Workers have all finished, so their timings are visible here
+    for (const auto& node : s.nodes)
+    {
+        if (node->ioType < 0 && node->renderEnd > node->renderStart)
+        {
+            blockProfiler->recordNode(static_cast<int>(node->node->nodeID.uid), node->renderStart, node->renderEnd);
+            node->renderStart = node->renderEnd = 0;
+        }
+    }
+}
+
+} // namespace UndergroundBeats
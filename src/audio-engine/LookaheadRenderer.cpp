@@ -0,0 +1,560 @@
+/*
+ * Underground Beats
+ * LookaheadRenderer.cpp
+ *
+ * Implementation of the lookahead track renderer
+ */
+
+#include "LookaheadRenderer.h"
+#include <algorithm>
+
+namespace UndergroundBeats {
+
+namespace {
+
+// readProgress packs the low bits of the generation above the sample offset
+constexpr int progressSampleBits = 40;
+constexpr juce::uint64 progressSampleMask = (juce::uint64(1) << progressSampleBits) - 1;
+constexpr juce::uint64 progressGenerationMask = ~juce::uint64(0) >> progressSampleBits;
+
+} // namespace
+
+//==============================================================================
+// Worker thread that keeps the rings of its tracks filled
+//==============================================================================
+
+class LookaheadRenderer::Worker : public juce::Thread {
+public:
+    Worker(LookaheadRenderer& ownerToUse, int index, int numWorkersToUse)
+        : juce::Thread("Lookahead worker " + juce::String(index + 1))
+        , owner(ownerToUse)
+        , workerIndex(index)
+        , numWorkers(numWorkersToUse)
+    {
+    }
+
+    // Lock-free, so the audio thread can call it every block
+    void wake()
+    {
+        slotsFreed.notify();
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            // Sleep only once every ring is full; the audio thread wakes us as it
+            // frees slots, and start(), invalidate() and release() wake us too
+            if (!owner.serviceTracks(workerIndex, numWorkers))
+            {
+                slotsFreed.wait();
+            }
+        }
+    }
+
+private:
+    LookaheadRenderer& owner;
+    const int workerIndex;
+    const int numWorkers;
+    Concurrency::WakeSignal slotsFreed;
+};
+
+//==============================================================================
+
+LookaheadRenderer::LookaheadRenderer()
+    : requestedThreads(0)
+    , lookaheadSamples(8192)
+    , numSlots(0)
+    , currentSampleRate(44100.0)
+    , currentBlockSize(512)
+    , prepared(false)
+{
+}
+
+LookaheadRenderer::~LookaheadRenderer()
+{
+    release();
+}
+
+int LookaheadRenderer::addTrack(const TrackSource& source)
+{
+    auto track = std::make_shared<TrackState>();
+    track->source = source;
+
+    if (prepared)
+    {
+        // Rendered directly until the next start(), so it never plays from an empty ring
+        prepareTrack(*track);
+        track->owner = Owner::Direct;
+    }
+
+    {
+        const juce::ScopedLock sl(trackLock);
+        tracks.push_back(std::move(track));
+    }
+
+    updateAudibility();
+    publishTracks();
+
+    return static_cast<int>(tracks.size() - 1);
+}
+
+void LookaheadRenderer::removeTrack(int trackIndex)
+{
+    if (trackIndex < 0 || trackIndex >= static_cast<int>(tracks.size()))
+        return;
+
+    {
+        // Waits for a worker that is rendering the track
+        const juce::ScopedLock sl(trackLock);
+        tracks.erase(tracks.begin() + trackIndex);
+    }
+
+    updateAudibility();
+    publishTracks();
+}
+
+void LookaheadRenderer::clear()
+{
+    {
+        const juce::ScopedLock sl(trackLock);
+        tracks.clear();
+    }
+
+    publishTracks();
+}
+
+void LookaheadRenderer::setNumThreads(int numThreads)
+{
+    requestedThreads = std::max(0, numThreads);
+}
+
+void LookaheadRenderer::setLookahead(int newLookaheadSamples)
+{
+    lookaheadSamples = std::max(1, newLookaheadSamples);
+}
+
+void LookaheadRenderer::prepare(double sampleRate, int blockSize)
+{
+    release();
+
+    currentSampleRate = sampleRate;
+    currentBlockSize = std::max(1, blockSize);
+    numSlots = juce::jlimit(2, maxSlots, (lookaheadSamples + currentBlockSize - 1) / currentBlockSize);
+
+    // Every non-live track starts out rendering ahead from the start of the stream
+    startRequest = 0;
+    startRequestSample = 0;
+    underruns = 0;
+
+    for (auto& track : tracks)
+    {
+        prepareTrack(*track);
+        track->owner = track->live ? Owner::Direct : Owner::Lookahead;
+    }
+
+    updateAudibility();
+    publishTracks();
+
+    // Leave one core for the audio thread; tracks added later share these workers
+    const int numThreads = requestedThreads > 0 ? requestedThreads
+                                                : juce::jlimit(1, 8, juce::SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        auto worker = std::make_unique<Worker>(*this, i, numThreads);
+        worker->startThread(juce::Thread::Priority::high);
+        workers.push_back(std::move(worker));
+    }
+
+    prepared = true;
+}
+
+void LookaheadRenderer::release()
+{
+    // Only called while the audio callback is stopped
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wake();
+    }
+
+    for (auto& worker : workers)
+    {
+        worker->stopThread(1000);
+    }
+
+    workers.clear();
+
+    for (auto& track : tracks)
+    {
+        track->slots.reset();
+    }
+
+    prepared = false;
+}
+
+void LookaheadRenderer::start(juce::int64 streamSample)
+{
+    startRequestSample.store(streamSample, std::memory_order_relaxed);
+    startRequest.fetch_add(1, std::memory_order_acq_rel);
+
+    for (auto& track : tracks)
+    {
+        if (track->live.load())
+            continue;
+
+        // Take back tracks that are idle; one the audio thread is rendering right
+        // now is handed over by the audio thread when it finishes the block
+        Owner expected = Owner::Direct;
+        track->owner.compare_exchange_strong(expected, Owner::Lookahead, std::memory_order_acq_rel);
+    }
+
+    for (auto& worker : workers)
+    {
+        worker->wake();
+    }
+}
+
+void LookaheadRenderer::invalidate(int trackIndex)
+{
+    if (trackIndex < 0 || trackIndex >= static_cast<int>(tracks.size()))
+        return;
+
+    auto& track = *tracks[static_cast<size_t>(trackIndex)];
+    track.directSince.store(startRequest.load(std::memory_order_acquire), std::memory_order_release);
+
+    // The worker finishes its current block and then hands the track to the audio thread
+    Owner expected = Owner::Lookahead;
+    if (track.owner.compare_exchange_strong(expected, Owner::Releasing, std::memory_order_acq_rel))
+    {
+        wakeWorker(trackIndex);
+    }
+}
+
+void LookaheadRenderer::setTrackLive(int trackIndex, bool isLive)
+{
+    if (trackIndex < 0 || trackIndex >= static_cast<int>(tracks.size()))
+        return;
+
+    tracks[static_cast<size_t>(trackIndex)]->live.store(isLive);
+
+    // A track that stops being live rejoins lookahead at the next start()
+    if (isLive)
+    {
+        invalidate(trackIndex);
+    }
+}
+
+bool LookaheadRenderer::isPrimed() const
+{
+    const juce::uint32 generation = startRequest.load(std::memory_order_acquire);
+
+    for (const auto& track : tracks)
+    {
+        if (track->audible && track->owner.load() == Owner::Lookahead
+            && track->primedGeneration.load(std::memory_order_acquire) != generation)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void LookaheadRenderer::mixTracks(juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples)
+{
+    if (!prepared || numSamples <= 0)
+        return;
+
+    audioTracks.acquire();
+
+    if (auto* list = audioTracks.get())
+    {
+        for (auto& track : list->tracks)
+        {
+            mixTrackState(*track, output, streamSample, numSamples);
+        }
+    }
+
+    // One wake per worker per block, however many tracks it looks after
+    for (auto& worker : workers)
+    {
+        worker->wake();
+    }
+}
+
+void LookaheadRenderer::mixTrack(int trackIndex, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples)
+{
+    if (!prepared || numSamples <= 0)
+        return;
+
+    audioTracks.acquire();
+    auto* list = audioTracks.get();
+
+    if (list == nullptr || trackIndex < 0 || trackIndex >= static_cast<int>(list->tracks.size()))
+        return;
+
+    mixTrackState(*list->tracks[static_cast<size_t>(trackIndex)], output, streamSample, numSamples);
+    wakeWorker(trackIndex);
+}
+
+void LookaheadRenderer::mixTrackState(TrackState& track, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples)
+{
+    if (!track.audible)
+        return;
+
+    const juce::uint32 generation = startRequest.load(std::memory_order_acquire);
+    const juce::int64 generationStart = startRequestSample.load(std::memory_order_relaxed);
+
+    Owner expected = Owner::Direct;
+    if (track.owner.compare_exchange_strong(expected, Owner::DirectRendering, std::memory_order_acq_rel))
+    {
+        mixDirect(track, output, streamSample, numSamples);
+
+        // Rejoin lookahead if start() was called since the track was invalidated
+        const bool rejoin = !track.live.load() && track.directSince.load(std::memory_order_acquire) != generation;
+        track.owner.store(rejoin ? Owner::Lookahead : Owner::Direct, std::memory_order_release);
+    }
+    else if (mixFromRing(track, output, streamSample, numSamples, generation, generationStart) < numSamples)
+    {
+        // The worker fell behind; the rest of the block stays silent for this track
+        ++underruns;
+    }
+
+    track.readProgress.store(packProgress(generation, streamSample + numSamples - generationStart),
+                             std::memory_order_release);
+}
+
+int LookaheadRenderer::getNumUnderruns() const
+{
+    return underruns.load();
+}
+
+void LookaheadRenderer::prepareTrack(TrackState& track)
+{
+    if (track.source.effects != nullptr)
+    {
+        track.source.effects->prepare(currentSampleRate, currentBlockSize);
+    }
+
+    track.slots.reset(new Slot[static_cast<size_t>(numSlots)]);
+    for (int i = 0; i < numSlots; ++i)
+    {
+        track.slots[i].audio.setSize(2, currentBlockSize);
+    }
+
+    track.directBuffer.setSize(2, currentBlockSize);
+    track.readProgress = packProgress(0, 0);
+    track.renderedGeneration = ~juce::uint32(0);
+    track.primedGeneration = ~juce::uint32(0);
+    track.directSince = startRequest.load();
+}
+
+void LookaheadRenderer::updateAudibility()
+{
+    const bool anySolo = std::any_of(tracks.begin(), tracks.end(),
+                                     [](const std::shared_ptr<TrackState>& track) { return track->source.solo; });
+
+    for (auto& track : tracks)
+    {
+        const auto& source = track->source;
+        track->audible = !source.muted && (!anySolo || source.solo) && source.render != nullptr;
+    }
+}
+
+void LookaheadRenderer::publishTracks()
+{
+    audioTracks.publish(std::make_unique<TrackList>(TrackList { tracks }));
+}
+
+juce::uint64 LookaheadRenderer::packProgress(juce::uint32 generation, juce::int64 samplesIntoGeneration)
+{
+    const auto samples = static_cast<juce::uint64>(std::max<juce::int64>(0, samplesIntoGeneration)) & progressSampleMask;
+    return (static_cast<juce::uint64>(generation) << progressSampleBits) | samples;
+}
+
+bool LookaheadRenderer::serviceTracks(int workerIndex, int numWorkers)
+{
+    bool didWork = false;
+
+    // Held for the whole pass, so a removed track is never rendered after removeTrack() returns
+    const juce::ScopedLock sl(trackLock);
+
+    // Each track belongs to one worker, so its ring has a single writer
+    for (int i = workerIndex; i < static_cast<int>(tracks.size()); i += numWorkers)
+    {
+        auto& track = *tracks[static_cast<size_t>(i)];
+
+        if (!track.audible)
+            continue;
+
+        if (track.owner.load(std::memory_order_acquire) == Owner::Releasing)
+        {
+            // Finished with the track: stay on it only if start() has been called since the edit
+            const bool rejoin = !track.live.load()
+                             && track.directSince.load(std::memory_order_acquire) != startRequest.load(std::memory_order_acquire);
+            track.owner.store(rejoin ? Owner::Lookahead : Owner::Direct, std::memory_order_release);
+        }
+
+        if (track.owner.load(std::memory_order_acquire) == Owner::Lookahead)
+        {
+            didWork = fillRing(track) || didWork;
+        }
+    }
+
+    return didWork;
+}
+
+bool LookaheadRenderer::fillRing(TrackState& track)
+{
+    const juce::uint32 generation = startRequest.load(std::memory_order_acquire);
+
+    if (generation != track.renderedGeneration)
+    {
+        track.renderedGeneration = generation;
+        track.generationStart = startRequestSample.load(std::memory_order_relaxed);
+        track.writeSample = track.generationStart;
+    }
+
+    const juce::int64 blockSize = currentBlockSize;
+    bool didWork = false;
+
+    for (;;)
+    {
+        // Stop between blocks if the track is being handed back or playback relocated
+        if (track.owner.load(std::memory_order_acquire) != Owner::Lookahead
+            || startRequest.load(std::memory_order_acquire) != generation)
+        {
+            return didWork;
+        }
+
+        // Where the audio thread has got to in this generation, if it has caught up with it
+        const juce::uint64 progress = track.readProgress.load(std::memory_order_acquire);
+        const bool readerInGeneration = (progress >> progressSampleBits) == (generation & progressGenerationMask);
+        const juce::int64 readSample = readerInGeneration
+                                     ? track.generationStart + static_cast<juce::int64>(progress & progressSampleMask)
+                                     : track.generationStart;
+
+        // Blocks the audio thread has already played past are not worth rendering
+        if (track.writeSample + blockSize <= readSample)
+        {
+            track.writeSample += (readSample - track.writeSample) / blockSize * blockSize;
+        }
+
+        const juce::int64 blockIndex = (track.writeSample - track.generationStart) / blockSize;
+        Slot& slot = track.slots[static_cast<size_t>(blockIndex % numSlots)];
+
+        // A slot can be overwritten once it is free, stale, or already played
+        SlotState expected = slot.state.load(std::memory_order_acquire);
+        const bool reusable = expected == SlotState::Free
+                           || (expected == SlotState::Filled
+                               && (slot.generation != generation || slot.startSample + blockSize <= readSample));
+
+        if (!reusable || !slot.state.compare_exchange_strong(expected, SlotState::Writing, std::memory_order_acq_rel))
+        {
+            // The ring is full
+            track.primedGeneration.store(generation, std::memory_order_release);
+            return didWork;
+        }
+
+        renderBlock(track, slot.audio, track.writeSample, currentBlockSize);
+        slot.startSample = track.writeSample;
+        slot.generation = generation;
+        slot.state.store(SlotState::Filled, std::memory_order_release);
+
+        track.writeSample += blockSize;
+        didWork = true;
+    }
+}
+
+void LookaheadRenderer::renderBlock(TrackState& track, juce::AudioBuffer<float>& buffer, juce::int64 startSample, int numSamples)
+{
+    auto& source = track.source;
+
+    juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), 0, numSamples);
+    block.clear();
+
+    source.render(block, startSample, numSamples);
+
+    if (source.effects != nullptr)
+    {
+        source.effects->processStereo(block.getWritePointer(0), block.getWritePointer(1), numSamples);
+    }
+
+    // Apply volume and balance, as the offline renderer does
+    const float pan = juce::jlimit(-1.0f, 1.0f, source.pan);
+    block.applyGain(0, 0, numSamples, source.volume * std::min(1.0f, 1.0f - pan));
+    block.applyGain(1, 0, numSamples, source.volume * std::min(1.0f, 1.0f + pan));
+}
+
+int LookaheadRenderer::mixFromRing(TrackState& track, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples,
+                                   juce::uint32 generation, juce::int64 generationStart)
+{
+    const juce::int64 blockSize = currentBlockSize;
+    int mixed = 0;
+
+    while (mixed < numSamples)
+    {
+        const juce::int64 position = streamSample + mixed;
+
+        if (position < generationStart)
+            break;
+
+        const juce::int64 blockIndex = (position - generationStart) / blockSize;
+        Slot& slot = track.slots[static_cast<size_t>(blockIndex % numSlots)];
+
+        SlotState expected = SlotState::Filled;
+        if (!slot.state.compare_exchange_strong(expected, SlotState::Reading, std::memory_order_acq_rel))
+            break;
+
+        if (slot.generation != generation || slot.startSample != generationStart + blockIndex * blockSize)
+        {
+            // Not rendered yet: the slot still holds an older block
+            slot.state.store(SlotState::Filled, std::memory_order_release);
+            break;
+        }
+
+        const int offsetInSlot = static_cast<int>(position - slot.startSample);
+        const int length = std::min(numSamples - mixed, currentBlockSize - offsetInSlot);
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            output.addFrom(channel, mixed, slot.audio, channel, offsetInSlot, length);
+        }
+
+        mixed += length;
+
+        // Hand the slot back once the whole block has been played
+        slot.state.store(offsetInSlot + length == currentBlockSize ? SlotState::Free : SlotState::Filled,
+                         std::memory_order_release);
+    }
+
+    return mixed;
+}
+
+void LookaheadRenderer::mixDirect(TrackState& track, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples)
+{
+    // Render in prepared-size blocks so the source and effects see the block size they expect
+    for (int offset = 0; offset < numSamples; offset += currentBlockSize)
+    {
+        const int length = std::min(currentBlockSize, numSamples - offset);
+
+        renderBlock(track, track.directBuffer, streamSample + offset, length);
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            output.addFrom(channel, offset, track.directBuffer, channel, 0, length);
+        }
+    }
+}
+
+void LookaheadRenderer::wakeWorker(int trackIndex)
+{
+    if (!workers.empty())
+    {
+        workers[static_cast<size_t>(trackIndex) % workers.size()]->wake();
+    }
+}
+
+} // namespace UndergroundBeats
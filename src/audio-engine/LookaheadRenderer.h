@@ -0,0 +1,269 @@
+/*
+ * Underground Beats
+ * LookaheadRenderer.h
+ *
+ * Renders deterministic tracks ahead of the playhead on background threads
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "../utils/Concurrency.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace UndergroundBeats {
+
+/**
+ * @class LookaheadRenderer
+ * @brief Renders deterministic tracks ahead of the playhead on background threads
+ *
+ * A sequenced track that is neither record-armed nor played live depends only
+ * on the arrangement, so its synth and effect chain can be rendered before the
+ * audio callback needs them. Each track has a ring of block-sized slots that a
+ * worker thread keeps filled up to the lookahead distance; the audio callback
+ * only mixes finished slots, so heavy tracks no longer have to fit inside a
+ * small device buffer.
+ *
+ * Positions are positions in the stream passed to each track's RenderCallback,
+ * which counts samples since playback started. The callback must produce the
+ * same output whenever it is asked for the same position, as it must for
+ * OfflineRenderer.
+ *
+ * A track is rendered by exactly one thread at a time. When a live edit
+ * invalidates a track, the worker hands the track back after the block it is
+ * rendering and the audio callback renders it directly from then on; the
+ * track rejoins lookahead at the next call to start(). Live tracks are always
+ * rendered directly.
+ *
+ * Tracks can be added and removed while the renderer is prepared. The audio
+ * callback picks up the new track list at the start of its next block, and a
+ * track added during playback is rendered directly until the next start().
+ */
+class LookaheadRenderer {
+public:
+    using TrackSource = OfflineRenderer::TrackSource;
+
+    LookaheadRenderer();
+    ~LookaheadRenderer();
+
+    /**
+     * @brief Add a track (message thread)
+     *
+     * @param source The track description
+     * @return The index of the added track
+     */
+    int addTrack(const TrackSource& source);
+
+    /**
+     * @brief Remove a track (message thread)
+     *
+     * Later tracks move down one index. The audio callback may still render
+     * the track in the block it is processing, so keep its effect chain alive
+     * until the next block has been mixed.
+     *
+     * @param trackIndex The track to remove
+     */
+    void removeTrack(int trackIndex);
+
+    /**
+     * @brief Remove all tracks (message thread)
+     */
+    void clear();
+
+    /**
+     * @brief Set the number of worker threads
+     *
+     * @param numThreads Number of threads, or 0 to use one per spare CPU core
+     */
+    void setNumThreads(int numThreads);
+
+    /**
+     * @brief Set how far ahead of the playhead tracks are rendered
+     *
+     * Takes effect at the next prepare().
+     *
+     * @param lookaheadSamples Lookahead distance in samples
+     */
+    void setLookahead(int lookaheadSamples);
+
+    /**
+     * @brief Allocate the rings, prepare the effect chains and start the workers
+     *
+     * @param sampleRate The sample rate in Hz
+     * @param blockSize The block size used for the track sources and effects
+     */
+    void prepare(double sampleRate, int blockSize);
+
+    /**
+     * @brief Stop the workers and free the rings
+     *
+     * Must only be called while the audio callback is stopped.
+     */
+    void release();
+
+    /**
+     * @brief Start rendering every non-live track ahead from a position
+     *
+     * Call this before playback starts and after every locate. Tracks that
+     * were invalidated rejoin lookahead here.
+     *
+     * @param streamSample The position the audio callback will read from next
+     */
+    void start(juce::int64 streamSample);
+
+    /**
+     * @brief Discard a track's rendered audio after a live edit
+     *
+     * The track is rendered directly by the audio callback until the next start().
+     *
+     * @param trackIndex The track whose parameters changed
+     */
+    void invalidate(int trackIndex);
+
+    /**
+     * @brief Mark a track as live (record-armed or played live)
+     *
+     * @param trackIndex The track
+     * @param isLive Whether the track must be rendered in the audio callback
+     */
+    void setTrackLive(int trackIndex, bool isLive);
+
+    /**
+     * @brief Check whether every lookahead track has its ring filled
+     *
+     * @return true if playback can start without underruns
+     */
+    bool isPrimed() const;
+
+    /**
+     * @brief Mix every audible track into a buffer (audio thread)
+     *
+     * @param output Stereo buffer to add the tracks to
+     * @param streamSample Position of the first sample of the block
+     * @param numSamples Number of samples to mix
+     */
+    void mixTracks(juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples);
+
+    /**
+     * @brief Mix a single track into a buffer (audio thread)
+     *
+     * @param trackIndex The track to mix
+     * @param output Stereo buffer to add the track to
+     * @param streamSample Position of the first sample of the block
+     * @param numSamples Number of samples to mix
+     */
+    void mixTrack(int trackIndex, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples);
+
+    /**
+     * @brief Get the number of blocks in which a lookahead track ran out of audio
+     */
+    int getNumUnderruns() const;
+
+private:
+    class Worker;
+
+    // Who renders a track: a worker, the audio callback, or a worker about to hand it back
+    enum class Owner { Lookahead, Releasing, Direct, DirectRendering };
+
+    // A slot holds one block; the block at stream position start + k * blockSize
+    // always lives in slot k % numSlots, so both sides can find it without a queue
+    enum class SlotState { Free, Writing, Filled, Reading };
+
+    static constexpr int maxSlots = 256;
+
+    struct Slot {
+        juce::AudioBuffer<float> audio;
+        juce::int64 startSample = 0;
+        juce::uint32 generation = 0;
+        std::atomic<SlotState> state { SlotState::Free };
+    };
+
+    struct TrackState {
+        TrackSource source;
+        std::atomic<bool> audible { true };
+        std::atomic<bool> live { false };
+        std::atomic<Owner> owner { Owner::Direct };
+
+        // Value of startRequest when the track last left lookahead
+        std::atomic<juce::uint32> directSince { 0 };
+
+        std::unique_ptr<Slot[]> slots;
+
+        // How far the audio callback has read: generation in the top bits,
+        // samples since the generation's start position in the rest
+        std::atomic<juce::uint64> readProgress { 0 };
+
+        // Worker side
+        juce::uint32 renderedGeneration = 0;
+        juce::int64 generationStart = 0;
+        juce::int64 writeSample = 0;
+        std::atomic<juce::uint32> primedGeneration { ~juce::uint32(0) };
+
+        // Audio thread side
+        juce::AudioBuffer<float> directBuffer;
+    };
+
+    struct TrackList {
+        std::vector<std::shared_ptr<TrackState>> tracks;
+    };
+
+    // Changed only on the message thread; the workers read it under trackLock
+    std::vector<std::shared_ptr<TrackState>> tracks;
+    juce::CriticalSection trackLock;
+
+    // The audio thread's copy of the track list, so removed tracks outlive its current block
+    Concurrency::RetiringPointer<TrackList> audioTracks;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    int requestedThreads;
+    int lookaheadSamples;
+    int numSlots;
+    double currentSampleRate;
+    int currentBlockSize;
+    bool prepared;
+
+    // Every start() begins a new generation; slots rendered for an older one are stale
+    std::atomic<juce::uint32> startRequest { 0 };
+    std::atomic<juce::int64> startRequestSample { 0 };
+
+    std::atomic<int> underruns { 0 };
+
+    static juce::uint64 packProgress(juce::uint32 generation, juce::int64 samplesIntoGeneration);
+
+    // Allocate a track's ring and prepare its effects for the current settings
+    void prepareTrack(TrackState& track);
+
+    // Apply mute and solo across all tracks
+    void updateAudibility();
+
+    // Hand the current track list to the audio thread
+    void publishTracks();
+
+    // Render ahead for the tracks owned by one worker; returns true if anything was rendered
+    bool serviceTracks(int workerIndex, int numWorkers);
+
+    // Render as many slots of a track as the ring has room for
+    bool fillRing(TrackState& track);
+
+    // Render one block of a track, including its effects, volume and pan
+    void renderBlock(TrackState& track, juce::AudioBuffer<float>& buffer, juce::int64 startSample, int numSamples);
+
+    // Copy rendered slots into the output; returns the number of samples mixed
+    int mixFromRing(TrackState& track, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples,
+                    juce::uint32 generation, juce::int64 generationStart);
+
+    // Mix one track without waking its worker (audio thread)
+    void mixTrackState(TrackState& track, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples);
+
+    // Render a track in the audio callback and mix it into the output
+    void mixDirect(TrackState& track, juce::AudioBuffer<float>& output, juce::int64 streamSample, int numSamples);
+
+    void wakeWorker(int trackIndex);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LookaheadRenderer)
+};
+
+} // namespace UndergroundBeats
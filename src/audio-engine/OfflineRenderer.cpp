@@ -0,0 +1,462 @@
+/*
+ * Underground Beats
+ * OfflineRenderer.cpp
+ *
+ * Implementation of the multi-threaded offline renderer
+ */
+
+#include "OfflineRenderer.h"
+#include <algorithm>
+#include <limits>
+
+namespace UndergroundBeats {
+
+OfflineRenderer::OfflineRenderer()
+    : numThreads(0)
+{
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+}
+
+int OfflineRenderer::addTrack(const TrackSource& source)
+{
+    tracks.push_back(source);
+    return static_cast<int>(tracks.size() - 1);
+}
+
+int OfflineRenderer::addTrack(const Track& track, RenderCallback render, EffectsChain* effects, int outputBus)
+{
+    TrackSource source;
+    source.name = track.getName();
+    source.render = std::move(render);
+    source.effects = effects;
+    source.volume = track.getVolume();
+    source.pan = track.getPan();
+    source.muted = track.isMuted();
+    source.solo = track.isSolo();
+    source.outputBus = outputBus;
+
+    return addTrack(source);
+}
+
+int OfflineRenderer::addBus(const Bus& bus)
+{
+    buses.push_back(bus);
+    return static_cast<int>(buses.size() - 1);
+}
+
+void OfflineRenderer::clear()
+{
+    tracks.clear();
+    buses.clear();
+}
+
+void OfflineRenderer::setNumThreads(int newNumThreads)
+{
+    numThreads = std::max(0, newNumThreads);
+}
+
+int OfflineRenderer::getNumThreads() const
+{
+    return numThreads > 0 ? numThreads : juce::SystemStats::getNumCpus();
+}
+
+void OfflineRenderer::setProgressCallback(ProgressCallback callback)
+{
+    progressCallback = std::move(callback);
+}
+
+bool OfflineRenderer::render(juce::AudioBuffer<float>& output, double sampleRate, int blockSize, juce::int64 lengthInSamples)
+{
+    if (lengthInSamples <= 0 || lengthInSamples > std::numeric_limits<int>::max())
+    {
+        return false;
+    }
+
+    output.setSize(2, static_cast<int>(lengthInSamples));
+    output.clear();
+
+    return renderInternal(sampleRate, blockSize, lengthInSamples,
+                          [&output](const juce::AudioBuffer<float>& master, juce::int64 startSample, int numSamples) {
+                              for (int channel = 0; channel < output.getNumChannels(); ++channel)
+                              {
+                                  output.copyFrom(channel, static_cast<int>(startSample), master, channel, 0, numSamples);
+                              }
+                              return true;
+                          });
+}
+
+bool OfflineRenderer::renderToFile(const juce::File& file, double sampleRate, int blockSize,
+                                   juce::int64 lengthInSamples, int bitsPerSample)
+{
+    if (lengthInSamples <= 0)
+    {
+        return false;
+    }
+
+    file.deleteFile();
+
+    auto outputStream = std::make_unique<juce::FileOutputStream>(file);
+    if (!outputStream->openedOk())
+    {
+        return false;
+    }
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(outputStream.get(), sampleRate, 2,
+                                                                              bitsPerSample, {}, 0));
+    if (writer == nullptr)
+    {
+        return false;
+    }
+
+    // The writer now owns the stream
+    outputStream.release();
+
+    return renderInternal(sampleRate, blockSize, lengthInSamples,
+                          [&writer](const juce::AudioBuffer<float>& master, juce::int64, int numSamples) {
+                              return writer->writeFromAudioSampleBuffer(master, 0, numSamples);
+                          });
+}
+
+bool OfflineRenderer::buildRenderGraph()
+{
+    const int numBuses = static_cast<int>(buses.size());
+
+    busLevels.clear();
+    busTrackInputs.assign(numBuses, {});
+    busBusInputs.assign(numBuses, {});
+    masterTrackInputs.clear();
+    masterBusInputs.clear();
+    activeTracks.clear();
+
+    auto isValidOutput = [numBuses](int outputBus) {
+        return outputBus == masterBus || (outputBus >= 0 && outputBus < numBuses);
+    };
+
+    // Route the buses and work out how deep each one sits in the graph
+    for (int busIndex = 0; busIndex < numBuses; ++busIndex)
+    {
+        const int outputBus = buses[busIndex].outputBus;
+        if (!isValidOutput(outputBus) || outputBus == busIndex)
+        {
+            return false;
+        }
+
+        if (outputBus == masterBus)
+            masterBusInputs.push_back(busIndex);
+        else
+            busBusInputs[outputBus].push_back(busIndex);
+    }
+
+    // Kahn's algorithm: a bus is ready once every bus feeding it has been mixed
+    std::vector<int> pendingInputs(numBuses);
+    std::vector<int> level(numBuses, 0);
+    std::vector<int> ready;
+
+    for (int busIndex = 0; busIndex < numBuses; ++busIndex)
+    {
+        pendingInputs[busIndex] = static_cast<int>(busBusInputs[busIndex].size());
+        if (pendingInputs[busIndex] == 0)
+        {
+            ready.push_back(busIndex);
+        }
+    }
+
+    int numOrdered = 0;
+    while (!ready.empty())
+    {
+        const int busIndex = ready.back();
+        ready.pop_back();
+        ++numOrdered;
+
+        if (static_cast<int>(busLevels.size()) <= level[busIndex])
+        {
+            busLevels.resize(level[busIndex] + 1);
+        }
+        busLevels[level[busIndex]].push_back(busIndex);
+
+        const int outputBus = buses[busIndex].outputBus;
+        if (outputBus != masterBus)
+        {
+            level[outputBus] = std::max(level[outputBus], level[busIndex] + 1);
+            if (--pendingInputs[outputBus] == 0)
+            {
+                ready.push_back(outputBus);
+            }
+        }
+    }
+
+    if (numOrdered != numBuses)
+    {
+        // The bus routing contains a feedback loop
+        return false;
+    }
+
+    // Keep the mixing order independent of the order the graph was traversed in
+    for (auto& levelBuses : busLevels)
+    {
+        std::sort(levelBuses.begin(), levelBuses.end());
+    }
+
+    for (auto& inputs : busBusInputs)
+    {
+        std::sort(inputs.begin(), inputs.end());
+    }
+
+    // Route the tracks, honouring mute and solo
+    const bool anySolo = std::any_of(tracks.begin(), tracks.end(),
+                                     [](const TrackSource& track) { return track.solo; });
+
+    for (int trackIndex = 0; trackIndex < static_cast<int>(tracks.size()); ++trackIndex)
+    {
+        const auto& track = tracks[trackIndex];
+
+        if (!isValidOutput(track.outputBus))
+        {
+            return false;
+        }
+
+        if (track.muted || (anySolo && !track.solo) || !track.render)
+        {
+            continue;
+        }
+
+        activeTracks.push_back(trackIndex);
+
+        if (track.outputBus == masterBus)
+            masterTrackInputs.push_back(trackIndex);
+        else
+            busTrackInputs[track.outputBus].push_back(trackIndex);
+    }
+
+    return true;
+}
+
+bool OfflineRenderer::renderInternal(double sampleRate, int blockSize, juce::int64 lengthInSamples, const ChunkSink& sink)
+{
+    if (sampleRate <= 0.0 || !buildRenderGraph())
+    {
+        return false;
+    }
+
+    blockSize = std::max(1, blockSize);
+    const int chunkSize = blockSize * blocksPerChunk;
+
+    // Prepare every effect chain and the working buffers
+    for (auto& track : tracks)
+    {
+        if (track.effects != nullptr)
+        {
+            track.effects->prepare(sampleRate, blockSize);
+        }
+    }
+
+    for (auto& bus : buses)
+    {
+        if (bus.effects != nullptr)
+        {
+            bus.effects->prepare(sampleRate, blockSize);
+        }
+    }
+
+    trackBuffers.resize(tracks.size());
+    for (auto& buffer : trackBuffers)
+    {
+        buffer.setSize(2, chunkSize);
+    }
+
+    busBuffers.resize(buses.size());
+    for (auto& buffer : busBuffers)
+    {
+        buffer.setSize(2, chunkSize);
+    }
+
+    masterBuffer.setSize(2, chunkSize);
+
+    // The calling thread takes part in the render, so the pool needs one fewer thread
+    const int threadsToUse = getNumThreads();
+    if (threadsToUse > 1)
+    {
+        threadPool = std::make_unique<juce::ThreadPool>(threadsToUse - 1);
+    }
+
+    bool completed = true;
+
+    for (juce::int64 chunkStart = 0; chunkStart < lengthInSamples; chunkStart += chunkSize)
+    {
+        const int chunkLength = static_cast<int>(std::min<juce::int64>(chunkSize, lengthInSamples - chunkStart));
+
+        // Tracks are independent of each other, so they all render concurrently
+        runParallel(static_cast<int>(activeTracks.size()), [&](int task) {
+            renderTrack(activeTracks[task], chunkStart, chunkLength, blockSize);
+        });
+
+        // Buses on the same level only depend on lower levels
+        for (const auto& levelBuses : busLevels)
+        {
+            runParallel(static_cast<int>(levelBuses.size()), [&](int task) {
+                renderBus(levelBuses[task], chunkLength, blockSize);
+            });
+        }
+
+        // Mix into the master output
+        masterBuffer.clear();
+
+        for (int trackIndex : masterTrackInputs)
+        {
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                masterBuffer.addFrom(channel, 0, trackBuffers[trackIndex], channel, 0, chunkLength);
+            }
+        }
+
+        for (int busIndex : masterBusInputs)
+        {
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                masterBuffer.addFrom(channel, 0, busBuffers[busIndex], channel, 0, chunkLength);
+            }
+        }
+
+        if (!sink(masterBuffer, chunkStart, chunkLength))
+        {
+            completed = false;
+            break;
+        }
+
+        if (progressCallback)
+        {
+            const float progress = static_cast<float>(chunkStart + chunkLength) / static_cast<float>(lengthInSamples);
+            if (!progressCallback(progress))
+            {
+                completed = false;
+                break;
+            }
+        }
+    }
+
+    threadPool.reset();
+
+    return completed;
+}
+
+void OfflineRenderer::renderTrack(int trackIndex, juce::int64 chunkStart, int chunkLength, int blockSize)
+{
+    auto& track = tracks[trackIndex];
+    auto& buffer = trackBuffers[trackIndex];
+
+    buffer.clear();
+
+    // Render block by block so the source and effects see the block size they were prepared for
+    for (int offset = 0; offset < chunkLength; offset += blockSize)
+    {
+        const int numSamples = std::min(blockSize, chunkLength - offset);
+        juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), offset, numSamples);
+
+        track.render(block, chunkStart + offset, numSamples);
+
+        if (track.effects != nullptr)
+        {
+            track.effects->processStereo(block.getWritePointer(0), block.getWritePointer(1), numSamples);
+        }
+    }
+
+    // Apply volume and balance
+    const float pan = juce::jlimit(-1.0f, 1.0f, track.pan);
+    buffer.applyGain(0, 0, chunkLength, track.volume * std::min(1.0f, 1.0f - pan));
+    buffer.applyGain(1, 0, chunkLength, track.volume * std::min(1.0f, 1.0f + pan));
+}
+
+void OfflineRenderer::renderBus(int busIndex, int chunkLength, int blockSize)
+{
+    auto& bus = buses[busIndex];
+    auto& buffer = busBuffers[busIndex];
+
+    buffer.clear();
+
+    // Sum inputs in index order so the result doesn't depend on thread timing
+    for (int trackIndex : busTrackInputs[busIndex])
+    {
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            buffer.addFrom(channel, 0, trackBuffers[trackIndex], channel, 0, chunkLength);
+        }
+    }
+
+    for (int inputBus : busBusInputs[busIndex])
+    {
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            buffer.addFrom(channel, 0, busBuffers[inputBus], channel, 0, chunkLength);
+        }
+    }
+
+    if (bus.effects != nullptr)
+    {
+        for (int offset = 0; offset < chunkLength; offset += blockSize)
+        {
+            const int numSamples = std::min(blockSize, chunkLength - offset);
+            bus.effects->processStereo(buffer.getWritePointer(0, offset), buffer.getWritePointer(1, offset), numSamples);
+        }
+    }
+
+    buffer.applyGain(0, chunkLength, bus.volume);
+}
+
+void OfflineRenderer::runParallel(int numTasks, const std::function<void(int)>& task)
+{
+    if (numTasks <= 0)
+    {
+        return;
+    }
+
+    if (threadPool == nullptr || numTasks == 1)
+    {
+        for (int i = 0; i < numTasks; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    // Workers keep claiming the next unclaimed task until none are left, so a
+    // thread that finishes a light track immediately picks up another one
+    std::atomic<int> nextTask { 0 };
+    std::atomic<int> helpersRunning { 0 };
+    juce::WaitableEvent helpersFinished;
+
+    auto claimTasks = [&]() {
+        for (int i = nextTask.fetch_add(1); i < numTasks; i = nextTask.fetch_add(1))
+        {
+            task(i);
+        }
+    };
+
+    const int numHelpers = std::min(threadPool->getNumThreads(), numTasks - 1);
+    helpersRunning = numHelpers;
+
+    for (int i = 0; i < numHelpers; ++i)
+    {
+        threadPool->addJob([&]() {
+            claimTasks();
+
+            if (--helpersRunning == 0)
+            {
+                helpersFinished.signal();
+            }
+        });
+    }
+
+    // The calling thread works too rather than just waiting
+    claimTasks();
+
+    if (numHelpers > 0)
+    {
+        helpersFinished.wait();
+    }
+}
+
+} // namespace UndergroundBeats
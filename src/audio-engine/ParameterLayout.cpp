@@ -0,0 +1,40 @@
+/*
+ * Underground Beats
+ * ParameterLayout.cpp
+ *
+ * Implementation of the processor parameter layout
+ */
+
+#include "ParameterLayout.h"
+
+namespace UndergroundBeats {
+
+ParameterLayout::ParameterLayout(std::initializer_list<ParameterSpec> specsToUse)
+    : specs(specsToUse)
+{
+}
+
+int ParameterLayout::add(const ParameterSpec& spec)
+{
+    specs.push_back(spec);
+    return size() - 1;
+}
+
+int ParameterLayout::indexOf(const juce::String& name) const
+{
+    for (int i = 0; i < size(); ++i)
+    {
+        if (specs[static_cast<size_t>(i)].name == name)
+            return i;
+    }
+
+    return -1;
+}
+
+float ParameterLayout::clampValue(int index, float value) const
+{
+    const auto& spec = specs[static_cast<size_t>(index)];
+    return juce::jlimit(spec.minValue, spec.maxValue, value);
+}
+
+} // namespace UndergroundBeats
@@ -0,0 +1,79 @@
+/*
+ * Underground Beats
+ * ParameterLayout.h
+ *
+ * Declarative description of a processor node's parameters
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <initializer_list>
+#include <vector>
+
+namespace UndergroundBeats {
+
+/**
+ * @brief Description of a single processor parameter
+ */
+struct ParameterSpec
+{
+    juce::String name;
+    float minValue = 0.0f;
+    float maxValue = 1.0f;
+    float defaultValue = 0.0f;
+    float smoothingMs = 0.0f; // Ramp time for changes; 0 applies changes at the next block
+};
+
+/**
+ * @class ParameterLayout
+ * @brief Declarative description of a processor node's parameters
+ *
+ * Each node type defines one static layout listing its parameters by index.
+ * ProcessorNode sizes its parameter storage from the layout, so a node only
+ * pays for the parameters it actually has, and uses the ranges and smoothing
+ * times to clamp incoming values and ramp them across each block.
+ */
+class ParameterLayout
+{
+public:
+    ParameterLayout() = default;
+    ParameterLayout(std::initializer_list<ParameterSpec> specs);
+
+    /**
+     * @brief Append a parameter to the layout
+     *
+     * @return The index of the new parameter
+     */
+    int add(const ParameterSpec& spec);
+
+    /**
+     * @brief Get the number of parameters
+     */
+    int size() const { return static_cast<int>(specs.size()); }
+
+    /**
+     * @brief Get the description of a parameter
+     *
+     * @param index The parameter index, which must be in range
+     */
+    const ParameterSpec& operator[](int index) const { return specs[static_cast<size_t>(index)]; }
+
+    /**
+     * @brief Find a parameter by name
+     *
+     * @param name The parameter name
+     * @return The parameter index, or -1 if there is no such parameter
+     */
+    int indexOf(const juce::String& name) const;
+
+    /**
+     * @brief Clamp a value to a parameter's range
+     */
+    float clampValue(int index, float value) const;
+
+private:
+    std::vector<ParameterSpec> specs;
+};
+
+} // namespace UndergroundBeats
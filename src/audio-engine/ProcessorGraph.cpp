@@ -16,24 +16,114 @@ ProcessorGraph::ProcessorGraph()
 
 ProcessorGraph::~ProcessorGraph()
 {
-    // Clear all connections and nodes
-    clear();
+    // Stop the workers before the nodes they render go away
+    scheduler.release();
+    
+    // Drop the nodes directly: clear() would commit a topology change, and
+    // with no schedule left that means a full synchronous rebuild
+    juce::AudioProcessorGraph::clear(UpdateKind::none);
+}
+
+void ProcessorGraph::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    juce::AudioProcessorGraph::prepareToPlay(sampleRate, maximumExpectedSamplesPerBlock);
+    
+    scheduler.prepare(sampleRate, maximumExpectedSamplesPerBlock);
+    scheduler.rebuild(*this);
+}
+
+void ProcessorGraph::releaseResources()
+{
+    scheduler.release();
+    
+    juce::AudioProcessorGraph::releaseResources();
+}
+
+void ProcessorGraph::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // Fall back to JUCE's renderer while the schedule is being rebuilt
+    if (!scheduler.process(buffer, midiMessages))
+    {
+        juce::AudioProcessorGraph::processBlock(buffer, midiMessages);
+    }
+}
+
+void ProcessorGraph::beginTransaction()
+{
+    ++transactionDepth;
+}
+
+void ProcessorGraph::commitTransaction()
+{
+    jassert(transactionDepth > 0);
+    
+    if (--transactionDepth > 0 || !topologyDirty)
+    {
+        return;
+    }
+    
+    topologyDirty = false;
+    
+    if (scheduler.hasSchedule())
+    {
+        // JUCE's renderer is not used while the scheduler has a schedule, so
+        // skip its rebuild and only prepare the new nodes, as it would have
+        if (getSampleRate() > 0.0)
+        {
+            for (auto& node : nodesToPrepare)
+            {
+                auto* processor = node->getProcessor();
+                processor->setRateAndBufferSizeDetails(getSampleRate(), getBlockSize());
+                processor->prepareToPlay(getSampleRate(), getBlockSize());
+            }
+        }
+    }
+    else
+    {
+        // Let JUCE prepare any new nodes and refresh the render sequence it
+        // falls back to; the audio thread picks that up with a try-lock
+        rebuild();
+    }
+    
+    nodesToPrepare.clear();
+    
+    // Compile the multithreaded schedule off the message thread
+    scheduler.rebuildAsync(*this);
+}
+
+void ProcessorGraph::topologyChanged()
+{
+    topologyDirty = true;
+    
+    if (transactionDepth == 0)
+    {
+        beginTransaction();
+        commitTransaction();
+    }
 }
 
 void ProcessorGraph::initializeDefaultNodes()
 {
+    ScopedTransaction transaction(*this);
+    
     // Create the default nodes (input, output, midi input, midi output)
     audioInputNodeID = addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(
-                              juce::AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode))->nodeID;
+                              juce::AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode),
+                              {}, UpdateKind::none)->nodeID;
     
     audioOutputNodeID = addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(
-                               juce::AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode))->nodeID;
+                               juce::AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode),
+                               {}, UpdateKind::none)->nodeID;
     
     midiInputNodeID = addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(
-                             juce::AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode))->nodeID;
+                             juce::AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode),
+                             {}, UpdateKind::none)->nodeID;
     
     midiOutputNodeID = addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(
-                              juce::AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode))->nodeID;
+                              juce::AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode),
+                              {}, UpdateKind::none)->nodeID;
+    
+    topologyChanged();
     
     // Add to the node map for easier lookup
     nodeMap["audio_input"] = audioInputNodeID;
@@ -53,12 +143,14 @@ juce::AudioProcessorGraph::NodeID ProcessorGraph::addProcessor(std::unique_ptr<j
     }
     
     // Add the processor to the graph
-    auto node = addNode(std::move(processor));
+    auto node = addNode(std::move(processor), {}, UpdateKind::none);
     
     if (node != nullptr)
     {
         // Store the mapping and return the ID
         nodeMap[nodeID] = node->nodeID;
+        nodesToPrepare.push_back(node);
+        topologyChanged();
         return node->nodeID;
     }
     
@@ -80,7 +172,13 @@ bool ProcessorGraph::connectNodes(const std::string& sourceNodeID, int sourceCha
     auto destID = nodeMap[destNodeID];
     
     // Create the connection
-    auto result = addConnection({ { sourceID, sourceChannelIndex }, { destID, destChannelIndex } });
+    auto result = addConnection({ { sourceID, sourceChannelIndex }, { destID, destChannelIndex } },
+                                UpdateKind::none);
+    
+    if (result)
+    {
+        topologyChanged();
+    }
     
     return result;
 }
@@ -99,7 +197,13 @@ bool ProcessorGraph::disconnectNodes(const std::string& sourceNodeID, int source
     auto destID = nodeMap[destNodeID];
     
     // Remove the connection
-    auto result = removeConnection({ { sourceID, sourceChannelIndex }, { destID, destChannelIndex } });
+    auto result = removeConnection({ { sourceID, sourceChannelIndex }, { destID, destChannelIndex } },
+                                   UpdateKind::none);
+    
+    if (result)
+    {
+        topologyChanged();
+    }
     
     return result;
 }
@@ -116,17 +220,31 @@ bool ProcessorGraph::removeProcessor(const std::string& nodeID)
     auto id = nodeMap[nodeID];
     
     // Remove the node
-    auto result = removeNode(id);
+    // The scheduler's current schedule keeps the node alive until the audio
+    // thread has moved past it, so it is destroyed on the compiler thread
+    auto result = removeNode(id, UpdateKind::none) != nullptr;
     
     if (result)
     {
         // Remove from the node map
         nodeMap.erase(nodeID);
+        topologyChanged();
     }
     
     return result;
 }
 
+void ProcessorGraph::clear()
+{
+    // The scheduler's current schedule keeps the nodes alive until the audio
+    // thread has moved past them
+    juce::AudioProcessorGraph::clear(UpdateKind::none);
+    
+    nodeMap.clear();
+    nodesToPrepare.clear();
+    topologyChanged();
+}
+
 juce::AudioProcessorGraph::Node::Ptr ProcessorGraph::getNodeForID(const std::string& nodeID)
 {
     // Check if the node exists
@@ -8,8 +8,10 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "GraphScheduler.h"
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 namespace UndergroundBeats {
 
@@ -20,12 +22,56 @@ namespace UndergroundBeats {
  * This class extends JUCE's AudioProcessorGraph to provide a higher-level
  * interface for managing audio processors, connections, and signal flow.
  * It handles the creation, connection, and removal of audio processing nodes.
+ *
+ * Rendering is handed to a GraphScheduler, which runs independent nodes on
+ * multiple cores and falls back to JUCE's single-threaded renderer whenever
+ * no compiled schedule is available.
+ *
+ * Topology edits never rebuild the graph synchronously. Edits made between
+ * beginTransaction() and commitTransaction() are batched, and committing
+ * compiles the new schedule on a background thread; the audio thread swaps
+ * it in at the next block boundary. An edit made outside a transaction is
+ * committed on its own. JUCE's own render sequence is only rebuilt while the
+ * scheduler has no schedule to render with.
  */
 class ProcessorGraph : public juce::AudioProcessorGraph {
 public:
     ProcessorGraph();
     ~ProcessorGraph() override;
     
+    using juce::AudioProcessorGraph::processBlock;
+    
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
+    
+    /**
+     * @brief Start batching topology edits
+     * 
+     * Transactions nest; the graph is recompiled when the outermost one is committed.
+     */
+    void beginTransaction();
+    
+    /**
+     * @brief Finish a batch of topology edits and recompile the graph in the background
+     */
+    void commitTransaction();
+    
+    /**
+     * @class ScopedTransaction
+     * @brief Batches the edits made during its lifetime into one transaction
+     */
+    class ScopedTransaction {
+    public:
+        explicit ScopedTransaction(ProcessorGraph& graphToEdit) : graph(graphToEdit) { graph.beginTransaction(); }
+        ~ScopedTransaction() { graph.commitTransaction(); }
+        
+    private:
+        ProcessorGraph& graph;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedTransaction)
+    };
+    
     /**
      * @brief Add a processor to the graph with a unique ID
      * 
@@ -67,6 +113,13 @@ public:
      */
     bool removeProcessor(const std::string& nodeID);
     
+    /**
+     * @brief Remove every node and connection, including the default nodes
+     * 
+     * Hides juce::AudioProcessorGraph::clear() so the scheduler is recompiled too.
+     */
+    void clear();
+    
     /**
      * @brief Get a node by its string ID
      * 
@@ -80,6 +133,13 @@ public:
      */
     void initializeDefaultNodes();
     
+    /**
+     * @brief Get the scheduler that renders the graph
+     * 
+     * @return Reference to the graph scheduler
+     */
+    GraphScheduler& getScheduler() { return scheduler; }
+    
 private:
     std::unordered_map<std::string, juce::AudioProcessorGraph::NodeID> nodeMap;
     
@@ -89,6 +149,19 @@ private:
     juce::AudioProcessorGraph::NodeID midiInputNodeID;
     juce::AudioProcessorGraph::NodeID midiOutputNodeID;
     
+    // Multithreaded renderer, recompiled whenever the topology changes
+    GraphScheduler scheduler;
+    
+    // Transaction state (message thread only)
+    int transactionDepth = 0;
+    bool topologyDirty = false;
+    
+    // Nodes added since the last commit, prepared on commit when JUCE does not rebuild
+    std::vector<juce::AudioProcessorGraph::Node::Ptr> nodesToPrepare;
+    
+    // Record an edit, committing it straight away if no transaction is open
+    void topologyChanged();
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorGraph)
 };
 
@@ -2,11 +2,32 @@
 
 namespace UndergroundBeats {
 
+namespace {
+    const ParameterLayout& getEmptyLayout()
+    {
+        static const ParameterLayout layout;
+        return layout;
+    }
+}
+
 ProcessorNode::ProcessorNode()
+    : ProcessorNode(getEmptyLayout())
+{
+}
+
+ProcessorNode::ProcessorNode(const ParameterLayout& layout)
+    : parameterLayout(layout)
+    , parameterTargets(std::make_unique<std::atomic<float>[]>(static_cast<size_t>(layout.size())))
+    , parameterStates(std::make_unique<ParameterState[]>(static_cast<size_t>(layout.size())))
 {
-    // Initialize parameters to default values
-    for (auto& param : parameters)
-        param.store(0.0f);
+    // Initialize parameters to their default values
+    for (int i = 0; i < layout.size(); ++i)
+    {
+        const float defaultValue = layout[i].defaultValue;
+        parameterTargets[i].store(defaultValue);
+        parameterStates[i].smoother.setCurrentAndTargetValue(defaultValue);
+        parameterStates[i].ramp = { defaultValue, defaultValue };
+    }
 }
 
 ProcessorNode::~ProcessorNode()
@@ -16,18 +37,43 @@ ProcessorNode::~ProcessorNode()
 
 void ProcessorNode::setParameter(int index, float newValue)
 {
-    if (index >= 0 && index < MAX_PARAMETERS)
-        parameters[index].store(newValue);
+    if (index >= 0 && index < getParameterCount())
+        parameterTargets[index].store(parameterLayout.clampValue(index, newValue));
 }
 
 float ProcessorNode::getParameter(int index)
 {
-    if (index >= 0 && index < MAX_PARAMETERS)
-        return parameters[index].load();
+    return getParameterValue(index);
+}
+
+float ProcessorNode::getParameterValue(int index) const
+{
+    if (index >= 0 && index < getParameterCount())
+        return parameterTargets[index].load();
     
     return 0.0f;
 }
 
+void ProcessorNode::updateSmoothedParameters(int numSamples)
+{
+    for (int i = 0; i < getParameterCount(); ++i)
+    {
+        auto& state = parameterStates[i];
+        const float target = parameterTargets[i].load(std::memory_order_relaxed);
+        
+        if (!isPrepared || parameterLayout[i].smoothingMs <= 0.0f)
+        {
+            state.smoother.setCurrentAndTargetValue(target);
+            state.ramp = { target, target };
+            continue;
+        }
+        
+        state.ramp.start = state.smoother.getCurrentValue();
+        state.smoother.setTargetValue(target);
+        state.ramp.end = state.smoother.skip(numSamples);
+    }
+}
+
 void ProcessorNode::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     currentSampleRate = sampleRate;
@@ -36,6 +82,15 @@ void ProcessorNode::prepareToPlay(double sampleRate, int samplesPerBlock)
     // Allocate processing buffer
     processingBuffer.setSize(2, samplesPerBlock);
     
+    // Restart the smoothers at the current values with ramp lengths for this rate
+    for (int i = 0; i < getParameterCount(); ++i)
+    {
+        const float value = parameterTargets[i].load();
+        parameterStates[i].smoother.reset(sampleRate, parameterLayout[i].smoothingMs * 0.001);
+        parameterStates[i].smoother.setCurrentAndTargetValue(value);
+        parameterStates[i].ramp = { value, value };
+    }
+    
     isPrepared = true;
 }
 
@@ -48,18 +103,8 @@ void ProcessorNode::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuf
 {
     // Base implementation just passes audio through
     // Derived classes will override this with actual processing
-    
-    // For SIMD-optimized processing
-    processBlockSIMD(buffer, midiMessages);
-}
-
-void ProcessorNode::processBlockSIMD(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    // Basic implementation - will be enhanced later with SIMD optimizations
-    juce::ScopedNoDenormals noDenormals;
-    
-    // This base implementation just passes audio through
-    // Subclasses will override with real DSP
+    juce::ignoreUnused(midiMessages);
+    updateSmoothedParameters(buffer.getNumSamples());
 }
 
 } // namespace UndergroundBeats
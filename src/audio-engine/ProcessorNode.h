@@ -1,6 +1,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ParameterLayout.h"
+#include <atomic>
+#include <memory>
 
 namespace UndergroundBeats {
 
@@ -16,28 +19,26 @@ private:
     uint32_t nodeID;
 };
 
-// Maximum number of parameters per node
-constexpr int MAX_PARAMETERS = 128;
-
 //==============================================================================
 class ProcessorNode : public juce::AudioProcessor
 {
 public:
     ProcessorNode();
+    explicit ProcessorNode(const ParameterLayout& layout);
     ~ProcessorNode() override;
     
-    // Parameter management
+    // Parameter management (values are clamped to the layout's ranges)
     void setParameter(int index, float newValue) override;
     [[deprecated]] float getParameter(int index) override;
     
+    const ParameterLayout& getParameterLayout() const { return parameterLayout; }
+    int getParameterCount() const { return parameterLayout.size(); }
+    
     // AudioProcessor methods (minimal implementations for now)
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
     
-    // SIMD-optimized processing (will be implemented in future)
-    virtual void processBlockSIMD(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
-    
     // Metadata methods
     const juce::String getName() const override { return "Processor Node"; }
     bool acceptsMidi() const override { return true; }
@@ -60,8 +61,22 @@ public:
     void setStateInformation(const void*, int) override {}
 
 protected:
-    // Parameter storage (atomic for thread safety)
-    std::array<std::atomic<float>, MAX_PARAMETERS> parameters;
+    // Start and end value of a parameter across the current block
+    struct ParameterRamp
+    {
+        float start = 0.0f;
+        float end = 0.0f;
+    };
+    
+    // Latest value set for a parameter (any thread)
+    float getParameterValue(int index) const;
+    
+    // Advance every parameter's smoother by one block; call at the top of processBlock
+    void updateSmoothedParameters(int numSamples);
+    
+    // Smoothed values for the current block (audio thread, after updateSmoothedParameters)
+    ParameterRamp getParameterRamp(int index) const { return parameterStates[index].ramp; }
+    float getSmoothedValue(int index) const { return parameterStates[index].ramp.end; }
     
     // Processing buffer
     juce::AudioBuffer<float> processingBuffer;
@@ -70,6 +85,21 @@ protected:
     double currentSampleRate = 44100.0;
     int currentBlockSize = 256;
     bool isPrepared = false;
+    
+private:
+    struct ParameterState
+    {
+        juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear> smoother;
+        ParameterRamp ramp;
+    };
+    
+    // Shared, per-node-type description of the parameters
+    const ParameterLayout& parameterLayout;
+    
+    // Storage sized exactly from the layout: targets written from any thread,
+    // smoothing state owned by the audio thread
+    std::unique_ptr<std::atomic<float>[]> parameterTargets;
+    std::unique_ptr<ParameterState[]> parameterStates;
 };
 
 } // namespace UndergroundBeats
@@ -7,6 +7,7 @@
 
 #include "Effect.h"
 #include "ParameterAutomation.h"
+#include "../utils/SIMDKernels.h"
 #include <algorithm>
 
 namespace UndergroundBeats {
@@ -104,10 +105,7 @@ void Effect::process(float* buffer, int numSamples)
     processBuffer(tempData, numSamples);
     
     // Mix wet and dry signals
-    for (int i = 0; i < numSamples; ++i)
-    {
-        buffer[i] = buffer[i] * (1.0f - mixLevel) + tempData[i] * mixLevel;
-    }
+    SIMD::crossfade(buffer, tempData, mixLevel, numSamples);
 }
 
 void Effect::processStereo(float* leftBuffer, float* rightBuffer, int numSamples)
@@ -141,11 +139,8 @@ void Effect::processStereo(float* leftBuffer, float* rightBuffer, int numSamples
     processBufferStereo(tempLeft, tempRight, numSamples);
     
     // Mix wet and dry signals
-    for (int i = 0; i < numSamples; ++i)
-    {
-        leftBuffer[i] = leftBuffer[i] * (1.0f - mixLevel) + tempLeft[i] * mixLevel;
-        rightBuffer[i] = rightBuffer[i] * (1.0f - mixLevel) + tempRight[i] * mixLevel;
-    }
+    SIMD::crossfade(leftBuffer, tempLeft, mixLevel, numSamples);
+    SIMD::crossfade(rightBuffer, tempRight, mixLevel, numSamples);
 }
 
 void Effect::prepare(double sampleRate, int blockSize)
@@ -106,6 +106,14 @@ bool EffectsChain::moveNode(int nodeId, int newParentId, int position)
     return true;
 }
 
+bool EffectsChain::setGroupMix(int groupId, float mix) {
+    auto* node = getNode(groupId);
+    if (!node || node->getType() == RoutingNode::Type::Effect) return false;
+    
+    node->setMixLevel(mix);
+    return true;
+}
+
 int EffectsChain::getNumEffects() const
 {
     int count = 0;
@@ -34,6 +34,7 @@ public:
     int addEffect(std::unique_ptr<Effect> effect, int groupId = 0);
     bool removeNode(int nodeId);
     bool moveNode(int nodeId, int newParentId, int position = -1);
+    bool setGroupMix(int groupId, float mix);
     
     // Effect access
     Effect* getEffect(int nodeId);
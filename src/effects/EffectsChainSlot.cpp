@@ -0,0 +1,46 @@
+/*
+ * Underground Beats
+ * EffectsChainSlot.cpp
+ */
+
+#include "EffectsChainSlot.h"
+
+namespace UndergroundBeats {
+
+EffectsChainSlot::EffectsChainSlot() = default;
+
+EffectsChainSlot::~EffectsChainSlot() = default;
+
+void EffectsChainSlot::setChain(std::unique_ptr<EffectsChain> chain)
+{
+    jassert(chain != nullptr);
+    
+    // Replaces any chain the audio thread has not picked up yet
+    currentChain.publish(std::move(chain));
+}
+
+void EffectsChainSlot::process(juce::AudioBuffer<float>& buffer)
+{
+    currentChain.acquire();
+    
+    auto* activeChain = currentChain.get();
+    
+    if (activeChain == nullptr || buffer.getNumChannels() == 0)
+        return;
+    
+    if (buffer.getNumChannels() >= 2)
+    {
+        activeChain->processStereo(buffer.getWritePointer(0), buffer.getWritePointer(1), buffer.getNumSamples());
+    }
+    else
+    {
+        activeChain->process(buffer.getWritePointer(0), buffer.getNumSamples());
+    }
+}
+
+void EffectsChainSlot::releaseRetiredChains()
+{
+    currentChain.releaseRetired();
+}
+
+} // namespace UndergroundBeats
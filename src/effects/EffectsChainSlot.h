@@ -0,0 +1,61 @@
+/*
+ * Underground Beats
+ * EffectsChainSlot.h
+ * 
+ * Holds the effects chain the audio thread plays, swappable without glitches
+ */
+
+#pragma once
+
+#include "EffectsChain.h"
+#include "../utils/Concurrency.h"
+#include <JuceHeader.h>
+#include <memory>
+
+namespace UndergroundBeats {
+
+/**
+ * @class EffectsChainSlot
+ * @brief Holds the effects chain the audio thread plays, swappable without glitches
+ * 
+ * A new chain is built and prepared elsewhere (e.g. by PresetPrefetcher)
+ * and handed to the slot already prepared. The audio thread picks it up at
+ * the start of its next block, so switching costs a pointer swap. The chain
+ * it replaces is handed back and freed on the message thread, never on the
+ * audio thread.
+ */
+class EffectsChainSlot {
+public:
+    EffectsChainSlot();
+    ~EffectsChainSlot();
+    
+    /**
+     * @brief Switch to a new chain (message thread)
+     * 
+     * Replaces any chain the audio thread has not picked up yet.
+     * 
+     * @param chain The new chain, already prepared for the current sample rate and block size
+     */
+    void setChain(std::unique_ptr<EffectsChain> chain);
+    
+    /**
+     * @brief Process a block through the current chain (audio thread)
+     * 
+     * Without a chain the audio passes through unchanged.
+     * 
+     * @param buffer The audio to process in place
+     */
+    void process(juce::AudioBuffer<float>& buffer);
+    
+    /**
+     * @brief Free chains the audio thread has finished with (message thread)
+     */
+    void releaseRetiredChains();
+    
+private:
+    Concurrency::RetiringPointer<EffectsChain> currentChain;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EffectsChainSlot)
+};
+
+} // namespace UndergroundBeats
@@ -0,0 +1,574 @@
+/*
+ * Underground Beats
+ * PresetIndex.cpp
+ */
+
+#include "PresetIndex.h"
+#include "../utils/Hash.h"
+#include <algorithm>
+#include <cctype>
+#include <numeric>
+#include <unordered_set>
+
+namespace UndergroundBeats {
+
+namespace {
+
+constexpr int indexVersion = 1;
+constexpr size_t defaultCacheCapacity = 32;
+
+const char* const chainStateTag = "EffectChainState";
+
+// Older presets stored times in a display format that cannot be parsed back
+juce::Time parseTime(const juce::String& text, juce::Time fallback)
+{
+    const juce::Time time = juce::Time::fromISO8601(text);
+    return time.toMilliseconds() != 0 ? time : fallback;
+}
+
+// Score for the query's characters appearing in order, or -1 if they don't
+int fuzzyScore(const std::string& key, const std::string& query)
+{
+    int score = 0;
+    size_t from = 0;
+    size_t last = std::string::npos;
+    
+    for (char c : query)
+    {
+        const size_t position = key.find(c, from);
+        
+        if (position == std::string::npos)
+        {
+            return -1;
+        }
+        
+        // Runs of characters and matches at word starts count more
+        if (last != std::string::npos && position == last + 1)
+        {
+            score += 2;
+        }
+        
+        if (position == 0 || !std::isalnum(static_cast<unsigned char>(key[position - 1])))
+        {
+            score += 3;
+        }
+        
+        last = position;
+        from = position + 1;
+    }
+    
+    return score;
+}
+
+} // namespace
+
+PresetIndex::PresetIndex(const juce::File& indexFileToUse)
+    : indexFile(indexFileToUse),
+      cacheCapacity(defaultCacheCapacity)
+{
+    load();
+}
+
+PresetIndex::~PresetIndex() = default;
+
+bool PresetIndex::refresh(const std::vector<juce::File>& directories)
+{
+    std::vector<juce::File> files;
+    
+    for (const auto& directory : directories)
+    {
+        for (const auto& file : directory.findChildFiles(juce::File::findFiles, false, "*.xml"))
+        {
+            files.push_back(file);
+        }
+    }
+    
+    // Drop entries whose files are gone
+    std::unordered_set<std::string> present;
+    
+    for (const auto& file : files)
+    {
+        present.insert(file.getFullPathName().toStdString());
+    }
+    
+    const size_t previousSize = entries.size();
+    
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&present](const Entry& entry) {
+        return present.count(entry.file.getFullPathName().toStdString()) == 0;
+    }), entries.end());
+    
+    bool changed = entries.size() != previousSize;
+    
+    std::unordered_map<std::string, size_t> indexByPath;
+    
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        indexByPath[entries[i].file.getFullPathName().toStdString()] = i;
+    }
+    
+    // Only parse files that are new or have changed since they were indexed
+    std::vector<size_t> invalid;
+    
+    for (const auto& file : files)
+    {
+        const auto existing = indexByPath.find(file.getFullPathName().toStdString());
+        
+        if (existing != indexByPath.end())
+        {
+            const Entry& entry = entries[existing->second];
+            
+            if (entry.fileSize == file.getSize() && entry.fileModified == file.getLastModificationTime())
+            {
+                continue;
+            }
+        }
+        
+        Entry entry;
+        const bool valid = readEntry(file, entry);
+        
+        if (existing != indexByPath.end())
+        {
+            if (valid)
+            {
+                entries[existing->second] = std::move(entry);
+            }
+            else
+            {
+                invalid.push_back(existing->second);
+            }
+        }
+        else if (valid)
+        {
+            entries.push_back(std::move(entry));
+        }
+        else
+        {
+            continue;
+        }
+        
+        changed = true;
+    }
+    
+    // Files that no longer parse as presets
+    std::sort(invalid.rbegin(), invalid.rend());
+    
+    for (size_t index : invalid)
+    {
+        entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+    
+    if (changed)
+    {
+        sortEntries();
+        save();
+    }
+    
+    return changed;
+}
+
+bool PresetIndex::update(const juce::File& file)
+{
+    Entry entry;
+    const bool valid = readEntry(file, entry);
+    
+    auto existing = std::find_if(entries.begin(), entries.end(), [&file](const Entry& e) {
+        return e.file == file;
+    });
+    
+    if (existing != entries.end())
+    {
+        entries.erase(existing);
+    }
+    
+    if (valid)
+    {
+        entries.push_back(std::move(entry));
+    }
+    
+    sortEntries();
+    save();
+    
+    return valid;
+}
+
+void PresetIndex::remove(const juce::File& file)
+{
+    auto existing = std::find_if(entries.begin(), entries.end(), [&file](const Entry& e) {
+        return e.file == file;
+    });
+    
+    if (existing == entries.end())
+    {
+        return;
+    }
+    
+    sortKeys.erase(sortKeys.begin() + std::distance(entries.begin(), existing));
+    entries.erase(existing);
+    save();
+}
+
+const std::vector<PresetIndex::Entry>& PresetIndex::getEntries() const
+{
+    return entries;
+}
+
+const PresetIndex::Entry* PresetIndex::find(const std::string& name) const
+{
+    const std::string key = toSortKey(name);
+    const auto range = std::equal_range(sortKeys.begin(), sortKeys.end(), key);
+    
+    // User presets sort before factory presets of the same name
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const Entry& entry = entries[static_cast<size_t>(std::distance(sortKeys.begin(), it))];
+        
+        if (entry.name == name)
+        {
+            return &entry;
+        }
+    }
+    
+    return nullptr;
+}
+
+std::vector<const PresetIndex::Entry*> PresetIndex::search(const std::string& query, int maxResults) const
+{
+    std::vector<const Entry*> results;
+    const size_t limit = static_cast<size_t>(juce::jmax(0, maxResults));
+    const std::string key = toSortKey(query);
+    
+    if (key.empty())
+    {
+        for (size_t i = 0; i < entries.size() && results.size() < limit; ++i)
+        {
+            results.push_back(&entries[i]);
+        }
+        
+        return results;
+    }
+    
+    struct Match {
+        int tier;   // 2 = prefix, 1 = substring, 0 = fuzzy
+        int score;
+        size_t index;
+    };
+    
+    std::vector<Match> matches;
+    
+    // Prefix matches are one run of the sorted keys
+    const auto prefixBegin = std::lower_bound(sortKeys.begin(), sortKeys.end(), key);
+    auto prefixEnd = prefixBegin;
+    
+    while (prefixEnd != sortKeys.end() && prefixEnd->compare(0, key.size(), key) == 0)
+    {
+        matches.push_back({ 2, 0, static_cast<size_t>(std::distance(sortKeys.begin(), prefixEnd)) });
+        ++prefixEnd;
+    }
+    
+    const size_t skipBegin = static_cast<size_t>(std::distance(sortKeys.begin(), prefixBegin));
+    const size_t skipEnd = static_cast<size_t>(std::distance(sortKeys.begin(), prefixEnd));
+    
+    for (size_t i = 0; i < sortKeys.size(); ++i)
+    {
+        if (i >= skipBegin && i < skipEnd)
+        {
+            continue;
+        }
+        
+        const size_t position = sortKeys[i].find(key);
+        
+        if (position != std::string::npos)
+        {
+            matches.push_back({ 1, -static_cast<int>(position), i });
+        }
+        else
+        {
+            const int score = fuzzyScore(sortKeys[i], key);
+            
+            if (score >= 0)
+            {
+                matches.push_back({ 0, score, i });
+            }
+        }
+    }
+    
+    const auto better = [](const Match& a, const Match& b) {
+        if (a.tier != b.tier)
+            return a.tier > b.tier;
+        
+        if (a.score != b.score)
+            return a.score > b.score;
+        
+        return a.index < b.index;
+    };
+    
+    const size_t count = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(count), matches.end(), better);
+    
+    for (size_t i = 0; i < count; ++i)
+    {
+        results.push_back(&entries[matches[i].index]);
+    }
+    
+    return results;
+}
+
+std::shared_ptr<const juce::XmlElement> PresetIndex::getChainState(const Entry& entry)
+{
+    auto cached = cache.find(entry.contentHash);
+    
+    if (cached != cache.end())
+    {
+        cacheOrder.splice(cacheOrder.begin(), cacheOrder, cached->second.position);
+        return cached->second.state;
+    }
+    
+    // A file edited since it was indexed fails the hash check and needs re-indexing
+    juce::MemoryBlock data;
+    
+    if (!entry.file.loadFileAsData(data) || Hash::fnv1a(data.getData(), data.getSize()) != entry.contentHash)
+    {
+        return nullptr;
+    }
+    
+    const auto* text = static_cast<const char*>(data.getData());
+    std::unique_ptr<juce::XmlElement> state;
+    
+    // Parse just the chain state, skipping the rest of the file
+    if (entry.stateSize > 0 && entry.stateOffset + entry.stateSize <= static_cast<juce::int64>(data.getSize()))
+    {
+        state = juce::XmlDocument::parse(juce::String::fromUTF8(text + entry.stateOffset,
+                                                                 static_cast<int>(entry.stateSize)));
+    }
+    
+    if (state == nullptr || !state->hasTagName(chainStateTag))
+    {
+        state.reset();
+        
+        if (auto xml = juce::XmlDocument::parse(juce::String::fromUTF8(text, static_cast<int>(data.getSize()))))
+        {
+            if (auto* child = xml->getChildByName(chainStateTag))
+            {
+                state = std::make_unique<juce::XmlElement>(*child);
+            }
+        }
+    }
+    
+    if (state == nullptr)
+    {
+        return nullptr;
+    }
+    
+    std::shared_ptr<const juce::XmlElement> shared = std::move(state);
+    
+    cacheOrder.push_front(entry.contentHash);
+    cache[entry.contentHash] = { shared, cacheOrder.begin() };
+    trimCache();
+    
+    return shared;
+}
+
+void PresetIndex::setCacheCapacity(int numStates)
+{
+    cacheCapacity = static_cast<size_t>(juce::jmax(1, numStates));
+    trimCache();
+}
+
+bool PresetIndex::save() const
+{
+    juce::ValueTree tree("PresetIndex");
+    tree.setProperty("version", indexVersion, nullptr);
+    
+    for (const auto& entry : entries)
+    {
+        juce::ValueTree preset("Preset");
+        preset.setProperty("name", juce::String(entry.name), nullptr);
+        preset.setProperty("category", juce::String(entry.category), nullptr);
+        preset.setProperty("description", juce::String(entry.description), nullptr);
+        preset.setProperty("factory", entry.isFactory, nullptr);
+        preset.setProperty("created", entry.created.toMilliseconds(), nullptr);
+        preset.setProperty("modified", entry.modified.toMilliseconds(), nullptr);
+        preset.setProperty("file", entry.file.getFullPathName(), nullptr);
+        preset.setProperty("fileSize", entry.fileSize, nullptr);
+        preset.setProperty("fileModified", entry.fileModified.toMilliseconds(), nullptr);
+        preset.setProperty("hash", static_cast<juce::int64>(entry.contentHash), nullptr);
+        preset.setProperty("stateOffset", entry.stateOffset, nullptr);
+        preset.setProperty("stateSize", entry.stateSize, nullptr);
+        tree.appendChild(preset, nullptr);
+    }
+    
+    indexFile.getParentDirectory().createDirectory();
+    juce::TemporaryFile tempFile(indexFile);
+    
+    {
+        juce::FileOutputStream output(tempFile.getFile());
+        
+        if (!output.openedOk())
+        {
+            return false;
+        }
+        
+        tree.writeToStream(output);
+        output.flush();
+        
+        if (output.getStatus().failed())
+        {
+            return false;
+        }
+    }
+    
+    return tempFile.overwriteTargetFileWithTemporary();
+}
+
+bool PresetIndex::readEntry(const juce::File& file, Entry& entry)
+{
+    juce::MemoryBlock data;
+    
+    if (!file.loadFileAsData(data))
+    {
+        return false;
+    }
+    
+    const auto* text = static_cast<const char*>(data.getData());
+    const size_t size = data.getSize();
+    
+    auto xml = juce::XmlDocument::parse(juce::String::fromUTF8(text, static_cast<int>(size)));
+    
+    if (xml == nullptr || !xml->hasTagName("EffectChainPreset"))
+    {
+        return false;
+    }
+    
+    auto* info = xml->getChildByName("PresetInfo");
+    
+    if (info == nullptr)
+    {
+        return false;
+    }
+    
+    const juce::Time fileModified = file.getLastModificationTime();
+    
+    entry.name = info->getStringAttribute("name", file.getFileNameWithoutExtension()).toStdString();
+    entry.category = info->getStringAttribute("category").toStdString();
+    entry.description = info->getStringAttribute("description").toStdString();
+    entry.isFactory = info->getBoolAttribute("factory", false);
+    entry.created = parseTime(info->getStringAttribute("created"), fileModified);
+    entry.modified = parseTime(info->getStringAttribute("modified"), fileModified);
+    
+    entry.file = file;
+    entry.fileSize = static_cast<juce::int64>(size);
+    entry.fileModified = fileModified;
+    entry.contentHash = Hash::fnv1a(text, size);
+    
+    // Locate the chain state, so a cache miss parses only that element
+    const std::string openTag = std::string("<") + chainStateTag;
+    const std::string closeTag = std::string("</") + chainStateTag + ">";
+    
+    const char* stateBegin = std::search(text, text + size, openTag.begin(), openTag.end());
+    const char* stateEnd = std::find_end(text, text + size, closeTag.begin(), closeTag.end());
+    
+    if (stateBegin != text + size && stateEnd != text + size && stateEnd > stateBegin)
+    {
+        entry.stateOffset = stateBegin - text;
+        entry.stateSize = (stateEnd + closeTag.size()) - stateBegin;
+    }
+    else
+    {
+        entry.stateOffset = 0;
+        entry.stateSize = 0;
+    }
+    
+    return true;
+}
+
+std::string PresetIndex::toSortKey(const std::string& name)
+{
+    return juce::String(name).toLowerCase().toStdString();
+}
+
+void PresetIndex::load()
+{
+    juce::FileInputStream input(indexFile);
+    
+    if (!input.openedOk())
+    {
+        return;
+    }
+    
+    const juce::ValueTree tree = juce::ValueTree::readFromStream(input);
+    
+    // An index from another version is rebuilt from the preset files
+    if (!tree.hasType("PresetIndex") || static_cast<int>(tree.getProperty("version")) != indexVersion)
+    {
+        return;
+    }
+    
+    for (const auto& preset : tree)
+    {
+        Entry entry;
+        entry.name = preset.getProperty("name").toString().toStdString();
+        entry.category = preset.getProperty("category").toString().toStdString();
+        entry.description = preset.getProperty("description").toString().toStdString();
+        entry.isFactory = preset.getProperty("factory");
+        entry.created = juce::Time(static_cast<juce::int64>(preset.getProperty("created")));
+        entry.modified = juce::Time(static_cast<juce::int64>(preset.getProperty("modified")));
+        entry.file = juce::File(preset.getProperty("file").toString());
+        entry.fileSize = preset.getProperty("fileSize");
+        entry.fileModified = juce::Time(static_cast<juce::int64>(preset.getProperty("fileModified")));
+        entry.contentHash = static_cast<juce::uint64>(static_cast<juce::int64>(preset.getProperty("hash")));
+        entry.stateOffset = preset.getProperty("stateOffset");
+        entry.stateSize = preset.getProperty("stateSize");
+        entries.push_back(std::move(entry));
+    }
+    
+    sortEntries();
+}
+
+void PresetIndex::sortEntries()
+{
+    std::vector<std::string> keys;
+    keys.reserve(entries.size());
+    
+    for (const auto& entry : entries)
+    {
+        keys.push_back(toSortKey(entry.name));
+    }
+    
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    
+    // By name, with user presets before factory presets of the same name
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (keys[a] != keys[b])
+            return keys[a] < keys[b];
+        
+        if (entries[a].isFactory != entries[b].isFactory)
+            return !entries[a].isFactory;
+        
+        return entries[a].name < entries[b].name;
+    });
+    
+    std::vector<Entry> sortedEntries;
+    sortedEntries.reserve(entries.size());
+    sortKeys.clear();
+    sortKeys.reserve(entries.size());
+    
+    for (size_t index : order)
+    {
+        sortedEntries.push_back(std::move(entries[index]));
+        sortKeys.push_back(std::move(keys[index]));
+    }
+    
+    entries = std::move(sortedEntries);
+}
+
+void PresetIndex::trimCache()
+{
+    while (cache.size() > cacheCapacity)
+    {
+        cache.erase(cacheOrder.back());
+        cacheOrder.pop_back();
+    }
+}
+
+} // namespace UndergroundBeats
@@ -0,0 +1,172 @@
+/*
+ * Underground Beats
+ * PresetIndex.h
+ * 
+ * Persistent index of preset metadata with a cache of parsed chain states
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace UndergroundBeats {
+
+/**
+ * @class PresetIndex
+ * @brief Persistent index of preset metadata with a cache of parsed chain states
+ * 
+ * The index records each preset file's metadata, size, modification time,
+ * content hash and the byte range of its chain state, and is saved to disk
+ * between sessions. Refreshing the index only parses files whose size or
+ * modification time changed, so browsing presets never parses XML.
+ * 
+ * Parsed chain states are kept in a least-recently-used cache keyed by
+ * content hash, so switching back and forth between presets reads nothing
+ * from disk. Identical preset files share one cache entry.
+ * 
+ * Entries are kept sorted by case-insensitive name, which makes prefix
+ * searches a binary search. Pointers to entries stay valid until the index
+ * next changes. The index is not thread-safe.
+ */
+class PresetIndex {
+public:
+    /**
+     * @brief Indexed information about one preset file
+     */
+    struct Entry {
+        std::string name;
+        std::string category;
+        std::string description;
+        bool isFactory = false;
+        juce::Time created;
+        juce::Time modified;
+        
+        juce::File file;
+        juce::int64 fileSize = 0;
+        juce::Time fileModified;
+        juce::uint64 contentHash = 0;
+        
+        // Byte range of the chain state element within the file
+        juce::int64 stateOffset = 0;
+        juce::int64 stateSize = 0;
+    };
+    
+    /**
+     * @brief Create an index, loading it from disk if it was saved before
+     * 
+     * @param indexFileToUse Where the index is saved
+     */
+    explicit PresetIndex(const juce::File& indexFileToUse);
+    ~PresetIndex();
+    
+    /**
+     * @brief Bring the index up to date with the preset files in some directories
+     * 
+     * New and changed files are parsed and deleted files are dropped. The
+     * index is saved if anything changed.
+     * 
+     * @param directories The directories holding preset files
+     * @return true if the index changed
+     */
+    bool refresh(const std::vector<juce::File>& directories);
+    
+    /**
+     * @brief Index or re-index a single preset file
+     * 
+     * @param file The preset file
+     * @return true if the file is a valid preset
+     */
+    bool update(const juce::File& file);
+    
+    /**
+     * @brief Drop a preset file from the index
+     */
+    void remove(const juce::File& file);
+    
+    /**
+     * @brief Get all entries, sorted by case-insensitive name
+     */
+    const std::vector<Entry>& getEntries() const;
+    
+    /**
+     * @brief Find a preset by name
+     * 
+     * When a user preset and a factory preset share a name, the user preset
+     * is returned.
+     * 
+     * @param name The preset name
+     * @return The entry, or nullptr if not found
+     */
+    const Entry* find(const std::string& name) const;
+    
+    /**
+     * @brief Find presets whose names match a query
+     * 
+     * Names starting with the query rank first, then names containing it,
+     * then names containing its characters in order (e.g. "dlrv" matches
+     * "Delay + Reverb"). Matching ignores case.
+     * 
+     * @param query The text to search for; empty matches every preset
+     * @param maxResults The maximum number of results
+     * @return The matching entries, best match first
+     */
+    std::vector<const Entry*> search(const std::string& query, int maxResults) const;
+    
+    /**
+     * @brief Get the parsed chain state of a preset
+     * 
+     * Served from the cache when possible. On a miss the file is read, its
+     * hash checked against the index, and only the chain state is parsed.
+     * 
+     * @param entry The preset's entry
+     * @return The chain state element, or nullptr if the file changed or could not be read
+     */
+    std::shared_ptr<const juce::XmlElement> getChainState(const Entry& entry);
+    
+    /**
+     * @brief Set how many parsed chain states are cached
+     */
+    void setCacheCapacity(int numStates);
+    
+    /**
+     * @brief Save the index to disk
+     * 
+     * @return true if successful
+     */
+    bool save() const;
+    
+private:
+    using CacheList = std::list<juce::uint64>;
+    
+    struct CachedState {
+        std::shared_ptr<const juce::XmlElement> state;
+        CacheList::iterator position;
+    };
+    
+    // Parse a preset file into an entry
+    static bool readEntry(const juce::File& file, Entry& entry);
+    
+    // Lower-case a name for sorting and matching
+    static std::string toSortKey(const std::string& name);
+    
+    void load();
+    void sortEntries();
+    void trimCache();
+    
+    juce::File indexFile;
+    std::vector<Entry> entries;
+    std::vector<std::string> sortKeys; // Parallel to entries
+    
+    CacheList cacheOrder; // Most recently used first
+    std::unordered_map<juce::uint64, CachedState> cache;
+    size_t cacheCapacity;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetIndex)
+};
+
+} // namespace UndergroundBeats
@@ -4,15 +4,21 @@
  */
 
 #include "PresetManager.h"
+#include "Delay.h"
+#include "Reverb.h"
 #include <algorithm>
 
 namespace UndergroundBeats {
 
 PresetManager::PresetManager()
+    : index(getPresetDirectory(false).getSiblingFile("PresetIndex.dat"))
 {
     // Create preset directories if they don't exist
     getPresetDirectory(false).createDirectory();
     getPresetDirectory(true).createDirectory();
+    
+    // Only presets changed since the last session are parsed
+    refreshPresets();
 }
 
 PresetManager::~PresetManager() = default;
@@ -32,74 +38,73 @@ bool PresetManager::savePreset(EffectsChain& chain, const PresetInfo& info)
     
     // Save to file
     auto presetFile = getPresetFile(info.name);
-    return presetXml->writeTo(presetFile);
+    if (!presetXml->writeTo(presetFile)) {
+        return false;
+    }
+    
+    const juce::ScopedLock lock(indexLock);
+    return index.update(presetFile);
 }
 
 bool PresetManager::loadPreset(EffectsChain& chain, const std::string& presetName)
 {
-    auto presetFile = getPresetFile(presetName);
-    if (!presetFile.existsAsFile()) {
-        return false;
-    }
+    auto chainState = getPresetState(presetName);
+    return chainState != nullptr && chain.restoreStateFromXml(chainState.get());
+}
+
+std::shared_ptr<const juce::XmlElement> PresetManager::getPresetState(const std::string& presetName)
+{
+    const juce::ScopedLock lock(indexLock);
     
-    // Load and parse XML
-    auto presetXml = juce::XmlDocument::parse(presetFile);
-    if (!presetXml || presetXml->getTagName() != "EffectChainPreset") {
-        return false;
+    const auto* entry = index.find(presetName);
+    if (entry == nullptr) {
+        return nullptr;
     }
     
-    // Find chain state element
-    if (auto* chainState = presetXml->getChildByName("EffectChainState")) {
-        return chain.restoreStateFromXml(chainState);
+    // Cached states are reused without touching the disk
+    auto chainState = index.getChainState(*entry);
+    
+    // The file was edited since it was indexed
+    if (chainState == nullptr) {
+        const juce::File presetFile = entry->file;
+        if (!index.update(presetFile) || (entry = index.find(presetName)) == nullptr) {
+            return nullptr;
+        }
+        
+        chainState = index.getChainState(*entry);
     }
     
-    return false;
+    return chainState;
 }
 
 std::vector<PresetManager::PresetInfo> PresetManager::getPresetList(const std::string& category) const
 {
+    const juce::ScopedLock lock(indexLock);
+    
     std::vector<PresetInfo> presets;
     
-    // Helper to load presets from a directory
-    auto loadFromDirectory = [&](const juce::File& directory) {
-        for (auto& file : directory.findChildFiles(juce::File::findFiles, false, "*.xml")) {
-            if (auto xml = juce::XmlDocument::parse(file)) {
-                if (auto* infoXml = xml->getChildByName("PresetInfo")) {
-                    auto info = loadPresetInfo(*infoXml);
-                    if (category.empty() || info.category == category) {
-                        presets.push_back(std::move(info));
-                    }
-                }
-            }
+    // The index is already sorted by name
+    for (const auto& entry : index.getEntries()) {
+        if (category.empty() || entry.category == category) {
+            presets.push_back(toPresetInfo(entry));
         }
-    };
-    
-    // Load factory presets
-    loadFromDirectory(getPresetDirectory(true));
-    
-    // Load user presets
-    loadFromDirectory(getPresetDirectory(false));
-    
-    // Sort by name
-    std::sort(presets.begin(), presets.end(),
-              [](const PresetInfo& a, const PresetInfo& b) {
-                  return a.name < b.name;
-              });
+    }
     
     return presets;
 }
 
 std::vector<std::string> PresetManager::getCategories() const
 {
+    const juce::ScopedLock lock(indexLock);
+    
     std::vector<std::string> categories;
     
-    for (const auto& preset : getPresetList()) {
-        if (std::find(categories.begin(), categories.end(), preset.category) == categories.end()) {
-            categories.push_back(preset.category);
-        }
+    for (const auto& entry : index.getEntries()) {
+        categories.push_back(entry.category);
     }
     
     std::sort(categories.begin(), categories.end());
+    categories.erase(std::unique(categories.begin(), categories.end()), categories.end());
     return categories;
 }
 
@@ -111,25 +116,46 @@ bool PresetManager::deletePreset(const std::string& presetName)
     }
     
     auto presetFile = getPresetFile(presetName);
-    return presetFile.deleteFile();
+    if (!presetFile.deleteFile()) {
+        return false;
+    }
+    
+    const juce::ScopedLock lock(indexLock);
+    index.remove(presetFile);
+    return true;
 }
 
 std::optional<PresetManager::PresetInfo> PresetManager::getPresetInfo(const std::string& presetName) const
 {
-    auto presetFile = getPresetFile(presetName);
-    if (!presetFile.existsAsFile()) {
-        return std::nullopt;
-    }
+    const juce::ScopedLock lock(indexLock);
     
-    if (auto xml = juce::XmlDocument::parse(presetFile)) {
-        if (auto* infoXml = xml->getChildByName("PresetInfo")) {
-            return loadPresetInfo(*infoXml);
-        }
+    if (const auto* entry = index.find(presetName)) {
+        return toPresetInfo(*entry);
     }
     
     return std::nullopt;
 }
 
+std::vector<PresetManager::PresetInfo> PresetManager::searchPresets(const std::string& query, int maxResults) const
+{
+    const juce::ScopedLock lock(indexLock);
+    
+    std::vector<PresetInfo> presets;
+    
+    for (const auto* entry : index.search(query, maxResults)) {
+        presets.push_back(toPresetInfo(*entry));
+    }
+    
+    return presets;
+}
+
+void PresetManager::refreshPresets()
+{
+    const juce::ScopedLock lock(indexLock);
+    
+    index.refresh({ getPresetDirectory(true), getPresetDirectory(false) });
+}
+
 void PresetManager::initializeFactoryPresets()
 {
     // Create some basic effect chain presets
@@ -160,11 +186,13 @@ void PresetManager::initializeFactoryPresets()
         
         // Add two delays with different settings
         auto delay1 = std::make_unique<Delay>("Delay 1");
-        delay1->getParameter("time")->setValue(0.25f);
+        delay1->setDelayTime(0, 250.0f);
+        delay1->setDelayTime(1, 250.0f);
         chain.addEffect(std::move(delay1), parallelId);
         
         auto delay2 = std::make_unique<Delay>("Delay 2");
-        delay2->getParameter("time")->setValue(0.375f);
+        delay2->setDelayTime(0, 375.0f);
+        delay2->setDelayTime(1, 375.0f);
         chain.addEffect(std::move(delay2), parallelId);
         
         chain.setGroupMix(parallelId, 0.7f);
@@ -193,15 +221,11 @@ juce::File PresetManager::getPresetDirectory(bool factory) const
                   : appDir.getChildFile("UserPresets");
 }
 
-PresetManager::PresetInfo PresetManager::loadPresetInfo(const juce::XmlElement& xml) const
+PresetManager::PresetInfo PresetManager::toPresetInfo(const PresetIndex::Entry& entry)
 {
-    PresetInfo info;
-    info.name = xml.getStringAttribute("name", "");
-    info.category = xml.getStringAttribute("category", "");
-    info.description = xml.getStringAttribute("description", "");
-    info.isFactory = xml.getBoolAttribute("factory", false);
-    info.created = juce::Time(xml.getStringAttribute("created", ""));
-    info.modified = juce::Time(xml.getStringAttribute("modified", ""));
+    PresetInfo info(entry.name, entry.category, entry.description, entry.isFactory);
+    info.created = entry.created;
+    info.modified = entry.modified;
     return info;
 }
 
@@ -212,8 +236,8 @@ std::unique_ptr<juce::XmlElement> PresetManager::createPresetInfoXml(const Prese
     xml->setAttribute("category", info.category);
     xml->setAttribute("description", info.description);
     xml->setAttribute("factory", info.isFactory);
-    xml->setAttribute("created", info.created.toString(true, true));
-    xml->setAttribute("modified", info.modified.toString(true, true));
+    xml->setAttribute("created", info.created.toISO8601(true));
+    xml->setAttribute("modified", info.modified.toISO8601(true));
     return xml;
 }
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "EffectsChain.h"
+#include "PresetIndex.h"
 #include <JuceHeader.h>
 #include <string>
 #include <vector>
@@ -25,6 +26,11 @@ namespace UndergroundBeats {
  * - Loading presets with proper recreation of the effect chain
  * - Preset categories and metadata
  * - Factory presets and user presets
+ * 
+ * Preset metadata comes from a PresetIndex kept on disk, so listing and
+ * searching presets does not parse preset files, and recently loaded chain
+ * states are cached in memory. The index is locked, so presets may be read
+ * from background threads such as PresetPrefetcher's.
  */
 class PresetManager {
 public:
@@ -69,6 +75,16 @@ public:
      */
     bool loadPreset(EffectsChain& chain, const std::string& presetName);
     
+    /**
+     * @brief Get the chain state of a preset without building a chain
+     * 
+     * Recently used states come from memory. Safe to call from any thread.
+     * 
+     * @param presetName Name of the preset
+     * @return The EffectChainState element, or nullptr if not found
+     */
+    std::shared_ptr<const juce::XmlElement> getPresetState(const std::string& presetName);
+    
     /**
      * @brief Get list of available presets
      * 
@@ -100,6 +116,24 @@ public:
      */
     std::optional<PresetInfo> getPresetInfo(const std::string& presetName) const;
     
+    /**
+     * @brief Find presets by name
+     * 
+     * Prefix matches rank first, then substring and fuzzy matches.
+     * 
+     * @param query Text to search for
+     * @param maxResults Maximum number of results
+     * @return Matching presets, best match first
+     */
+    std::vector<PresetInfo> searchPresets(const std::string& query, int maxResults = 50) const;
+    
+    /**
+     * @brief Pick up preset files added, changed or removed outside the application
+     * 
+     * Only files that changed since they were last indexed are parsed.
+     */
+    void refreshPresets();
+    
     /**
      * @brief Initialize factory presets
      * 
@@ -125,12 +159,12 @@ private:
     juce::File getPresetDirectory(bool factory = false) const;
     
     /**
-     * @brief Load preset metadata from XML
+     * @brief Get the metadata of an indexed preset
      * 
-     * @param xml XML element containing metadata
+     * @param entry The preset's index entry
      * @return PresetInfo structure
      */
-    PresetInfo loadPresetInfo(const juce::XmlElement& xml) const;
+    static PresetInfo toPresetInfo(const PresetIndex::Entry& entry);
     
     /**
      * @brief Save preset metadata to XML
@@ -140,6 +174,9 @@ private:
      */
     std::unique_ptr<juce::XmlElement> createPresetInfoXml(const PresetInfo& info) const;
     
+    juce::CriticalSection indexLock;
+    PresetIndex index;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetManager)
 };
 
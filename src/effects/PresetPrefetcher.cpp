@@ -0,0 +1,234 @@
+/*
+ * Underground Beats
+ * PresetPrefetcher.cpp
+ */
+
+#include "PresetPrefetcher.h"
+#include <algorithm>
+
+namespace UndergroundBeats {
+
+PresetPrefetcher::PresetPrefetcher(PresetManager& presetManagerToUse)
+    : juce::Thread("Preset prefetch")
+    , presetManager(presetManagerToUse)
+    , depth(3)
+    , currentSampleRate(0.0)
+    , currentBlockSize(0)
+    , generation(0)
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+PresetPrefetcher::~PresetPrefetcher()
+{
+    signalThreadShouldExit();
+    workQueued.signal();
+    stopThread(5000);
+}
+
+void PresetPrefetcher::prepare(double sampleRate, int blockSize)
+{
+    std::map<std::string, std::unique_ptr<EffectsChain>> discarded;
+    
+    {
+        const juce::ScopedLock scopedLock(lock);
+        
+        if (sampleRate == currentSampleRate && blockSize == currentBlockSize)
+            return;
+        
+        currentSampleRate = sampleRate;
+        currentBlockSize = blockSize;
+        ++generation;
+        
+        discarded.swap(prepared);
+        failed.clear();
+    }
+    
+    workQueued.signal();
+}
+
+void PresetPrefetcher::setUpcoming(const std::vector<std::string>& presetNames)
+{
+    std::vector<std::unique_ptr<EffectsChain>> discarded;
+    
+    {
+        const juce::ScopedLock scopedLock(lock);
+        upcoming = presetNames;
+        failed.clear();
+        discarded = trimPrepared();
+    }
+    
+    workQueued.signal();
+}
+
+void PresetPrefetcher::setDepth(int numPresets)
+{
+    std::vector<std::unique_ptr<EffectsChain>> discarded;
+    
+    {
+        const juce::ScopedLock scopedLock(lock);
+        depth = juce::jmax(0, numPresets);
+        discarded = trimPrepared();
+    }
+    
+    workQueued.signal();
+}
+
+bool PresetPrefetcher::isReady(const std::string& presetName) const
+{
+    const juce::ScopedLock scopedLock(lock);
+    return prepared.find(presetName) != prepared.end();
+}
+
+std::unique_ptr<EffectsChain> PresetPrefetcher::take(const std::string& presetName)
+{
+    std::unique_ptr<EffectsChain> chain;
+    
+    {
+        const juce::ScopedLock scopedLock(lock);
+        auto it = prepared.find(presetName);
+        
+        if (it == prepared.end())
+            return nullptr;
+        
+        chain = std::move(it->second);
+        prepared.erase(it);
+    }
+    
+    // Prepare a fresh copy in case the preset is selected again
+    workQueued.signal();
+    
+    return chain;
+}
+
+std::unique_ptr<EffectsChain> PresetPrefetcher::takeOrBuild(const std::string& presetName)
+{
+    if (auto chain = take(presetName))
+        return chain;
+    
+    double sampleRate = 0.0;
+    int blockSize = 0;
+    
+    {
+        const juce::ScopedLock scopedLock(lock);
+        sampleRate = currentSampleRate;
+        blockSize = currentBlockSize;
+    }
+    
+    return build(presetName, sampleRate, blockSize);
+}
+
+void PresetPrefetcher::run()
+{
+    while (!threadShouldExit())
+    {
+        std::string presetName;
+        int buildGeneration = 0;
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        
+        if (!findNextToBuild(presetName, buildGeneration, sampleRate, blockSize))
+        {
+            workQueued.wait(100);
+            continue;
+        }
+        
+        // Loading and preparing allocate, which is why it happens here
+        auto chain = build(presetName, sampleRate, blockSize);
+        
+        {
+            const juce::ScopedLock scopedLock(lock);
+            
+            // The format or the upcoming list may have changed meanwhile
+            if (buildGeneration == generation && isWanted(presetName))
+            {
+                if (chain == nullptr)
+                {
+                    failed.insert(presetName);
+                }
+                else if (prepared.find(presetName) == prepared.end())
+                {
+                    prepared[presetName] = std::move(chain);
+                }
+            }
+        }
+        
+        // A chain nobody wants any more is freed here, off the message thread
+    }
+}
+
+bool PresetPrefetcher::findNextToBuild(std::string& presetName, int& buildGeneration,
+                                       double& sampleRate, int& blockSize) const
+{
+    const juce::ScopedLock scopedLock(lock);
+    
+    // Nothing is built until the format is known
+    if (currentBlockSize <= 0)
+        return false;
+    
+    const size_t count = std::min(upcoming.size(), static_cast<size_t>(depth));
+    
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::string& name = upcoming[i];
+        
+        if (prepared.find(name) == prepared.end() && failed.find(name) == failed.end())
+        {
+            presetName = name;
+            buildGeneration = generation;
+            sampleRate = currentSampleRate;
+            blockSize = currentBlockSize;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+bool PresetPrefetcher::isWanted(const std::string& presetName) const
+{
+    const auto end = upcoming.begin() + static_cast<std::ptrdiff_t>(std::min(upcoming.size(), static_cast<size_t>(depth)));
+    return std::find(upcoming.begin(), end, presetName) != end;
+}
+
+std::unique_ptr<EffectsChain> PresetPrefetcher::build(const std::string& presetName, double sampleRate, int blockSize)
+{
+    auto chainState = presetManager.getPresetState(presetName);
+    
+    if (chainState == nullptr)
+        return nullptr;
+    
+    auto chain = std::make_unique<EffectsChain>();
+    
+    if (!chain->restoreStateFromXml(chainState.get()))
+        return nullptr;
+    
+    if (blockSize > 0)
+    {
+        chain->prepare(sampleRate, blockSize);
+    }
+    
+    return chain;
+}
+
+std::vector<std::unique_ptr<EffectsChain>> PresetPrefetcher::trimPrepared()
+{
+    std::vector<std::unique_ptr<EffectsChain>> discarded;
+    
+    for (auto it = prepared.begin(); it != prepared.end();)
+    {
+        if (isWanted(it->first))
+        {
+            ++it;
+        }
+        else
+        {
+            discarded.push_back(std::move(it->second));
+            it = prepared.erase(it);
+        }
+    }
+    
+    return discarded;
+}
+
+} // namespace UndergroundBeats
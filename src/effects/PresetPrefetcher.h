@@ -0,0 +1,125 @@
+/*
+ * Underground Beats
+ * PresetPrefetcher.h
+ * 
+ * Builds and prepares upcoming preset chains in the background
+ */
+
+#pragma once
+
+#include "EffectsChain.h"
+#include "PresetManager.h"
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace UndergroundBeats {
+
+/**
+ * @class PresetPrefetcher
+ * @brief Builds and prepares upcoming preset chains in the background
+ * 
+ * Loading a preset creates its effects and prepares them, which allocates
+ * delay lines and reverb state. The prefetcher does that work ahead of time
+ * on a worker thread for the next few presets in browser or setlist order,
+ * so switching to one of them only hands over a ready chain (see
+ * EffectsChainSlot).
+ * 
+ * Every method is called on the message thread. Chains that drop out of
+ * the upcoming list, or were prepared for an old sample rate or block size,
+ * are discarded.
+ */
+class PresetPrefetcher : private juce::Thread {
+public:
+    /**
+     * @brief Create a prefetcher reading presets from a manager
+     * 
+     * @param presetManagerToUse The preset manager; must outlive the prefetcher
+     */
+    explicit PresetPrefetcher(PresetManager& presetManagerToUse);
+    ~PresetPrefetcher() override;
+    
+    /**
+     * @brief Set the format chains are prepared for
+     * 
+     * Chains prepared for a different format are rebuilt.
+     * 
+     * @param sampleRate The sample rate
+     * @param blockSize The maximum block size
+     */
+    void prepare(double sampleRate, int blockSize);
+    
+    /**
+     * @brief Set the presets likely to be selected next, most likely first
+     * 
+     * @param presetNames Upcoming presets in browser or setlist order
+     */
+    void setUpcoming(const std::vector<std::string>& presetNames);
+    
+    /**
+     * @brief Set how many of the upcoming presets are kept prepared
+     */
+    void setDepth(int numPresets);
+    
+    /**
+     * @brief Check whether a preset's chain is ready to take
+     */
+    bool isReady(const std::string& presetName) const;
+    
+    /**
+     * @brief Take a preset's prepared chain
+     * 
+     * The prefetcher starts preparing a replacement, so the same preset can
+     * be taken again later (e.g. for A/B switching).
+     * 
+     * @param presetName The preset to take
+     * @return The prepared chain, or nullptr if it is not ready yet
+     */
+    std::unique_ptr<EffectsChain> take(const std::string& presetName);
+    
+    /**
+     * @brief Take a preset's chain, building it now if it is not ready
+     * 
+     * @param presetName The preset to take
+     * @return The prepared chain, or nullptr if the preset could not be loaded
+     */
+    std::unique_ptr<EffectsChain> takeOrBuild(const std::string& presetName);
+    
+private:
+    // Thread implementation
+    void run() override;
+    
+    // The next upcoming preset without a prepared chain, and the format to prepare it for
+    bool findNextToBuild(std::string& presetName, int& buildGeneration, double& sampleRate, int& blockSize) const;
+    
+    // Whether a preset is within the first depth upcoming presets (lock held)
+    bool isWanted(const std::string& presetName) const;
+    
+    // Create a chain for a preset and prepare it
+    std::unique_ptr<EffectsChain> build(const std::string& presetName, double sampleRate, int blockSize);
+    
+    // Drop prepared chains no longer in the upcoming window (lock held)
+    std::vector<std::unique_ptr<EffectsChain>> trimPrepared();
+    
+    PresetManager& presetManager;
+    
+    juce::CriticalSection lock;
+    std::vector<std::string> upcoming;
+    std::map<std::string, std::unique_ptr<EffectsChain>> prepared;
+    std::set<std::string> failed; // Presets that could not be loaded
+    int depth;
+    double currentSampleRate;
+    int currentBlockSize;
+    
+    // Changes whenever the format does, so chains built for the old one are dropped
+    int generation;
+    
+    juce::WaitableEvent workQueued;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PresetPrefetcher)
+};
+
+} // namespace UndergroundBeats
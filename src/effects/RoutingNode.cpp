@@ -4,6 +4,7 @@
  */
 
 #include "RoutingNode.h"
+#include "../utils/SIMDKernels.h"
 #include <algorithm>
 
 namespace UndergroundBeats {
@@ -52,16 +53,12 @@ void RoutingNode::process(float* buffer, juce::AudioBuffer<float>& tempBuffer, i
                 children[i]->process(procBuffer, tempBuffer, numSamples);
                 
                 // Mix into accumulation buffer
-                for (int j = 0; j < numSamples; ++j) {
-                    mixBuffer[j] += procBuffer[j];
-                }
+                SIMD::addWithGain(mixBuffer, procBuffer, 1.0f, numSamples);
             }
             
             // Apply mix level and copy back to main buffer
-            for (int i = 0; i < numSamples; ++i) {
-                buffer[i] = buffer[i] * (1.0f - mixLevel) + 
-                           (mixBuffer[i] / static_cast<float>(children.size())) * mixLevel;
-            }
+            SIMD::mix(buffer, mixBuffer, 1.0f - mixLevel,
+                      mixLevel / static_cast<float>(children.size()), numSamples);
             break;
     }
 }
@@ -112,20 +109,14 @@ void RoutingNode::processStereo(float* leftBuffer, float* rightBuffer,
                 
                 children[i]->processStereo(procLeftBuffer, procRightBuffer, tempBuffer, numSamples);
                 
-                for (int j = 0; j < numSamples; ++j) {
-                    mixLeftBuffer[j] += procLeftBuffer[j];
-                    mixRightBuffer[j] += procRightBuffer[j];
-                }
+                SIMD::addWithGain(mixLeftBuffer, procLeftBuffer, 1.0f, numSamples);
+                SIMD::addWithGain(mixRightBuffer, procRightBuffer, 1.0f, numSamples);
             }
             
             // Apply mix level and copy back to main buffers
             float scale = 1.0f / static_cast<float>(children.size());
-            for (int i = 0; i < numSamples; ++i) {
-                leftBuffer[i] = leftBuffer[i] * (1.0f - mixLevel) + 
-                               mixLeftBuffer[i] * scale * mixLevel;
-                rightBuffer[i] = rightBuffer[i] * (1.0f - mixLevel) + 
-                                mixRightBuffer[i] * scale * mixLevel;
-            }
+            SIMD::mix(leftBuffer, mixLeftBuffer, 1.0f - mixLevel, scale * mixLevel, numSamples);
+            SIMD::mix(rightBuffer, mixRightBuffer, 1.0f - mixLevel, scale * mixLevel, numSamples);
             break;
     }
 }
@@ -0,0 +1,297 @@
+/*
+ * Underground Beats
+ * ProjectFile.cpp
+ */
+
+#include "ProjectFile.h"
+#include <cstring>
+
+namespace UndergroundBeats {
+
+namespace {
+
+const char formatMagic[4] = { 'U', 'B', 'P', 'J' };
+constexpr juce::uint32 formatVersion = 1;
+
+// Magic, version, chunk count, reserved, table of contents offset
+constexpr size_t headerSize = 4 + 4 + 4 + 4 + 8;
+
+// Type, reserved, offset, size
+constexpr size_t tocEntrySize = 4 + 4 + 8 + 8;
+
+// The sections stored one chunk per child element
+const ProjectFile::ChunkType sectionTypes[] = {
+    ProjectFile::ChunkType::Track,
+    ProjectFile::ChunkType::Pattern,
+    ProjectFile::ChunkType::Instrument,
+    ProjectFile::ChunkType::Effect
+};
+
+} // namespace
+
+ProjectFile::ProjectFile()
+{
+}
+
+ProjectFile::~ProjectFile()
+{
+    close();
+}
+
+bool ProjectFile::isBinaryProject(const juce::File& file)
+{
+    juce::FileInputStream input(file);
+    char magic[4] = {};
+    
+    return input.openedOk()
+        && input.read(magic, sizeof(magic)) == static_cast<int>(sizeof(magic))
+        && std::memcmp(magic, formatMagic, sizeof(magic)) == 0;
+}
+
+bool ProjectFile::write(const juce::File& file, const juce::XmlElement& projectXml,
+                        const ProgressCallback& progress)
+{
+    juce::TemporaryFile tempFile(file);
+    
+    // The root chunk plus one per section element
+    int totalChunks = 1;
+    
+    for (auto type : sectionTypes)
+    {
+        if (auto* section = projectXml.getChildByName(getSectionName(type)))
+        {
+            totalChunks += section->getNumChildElements();
+        }
+    }
+    
+    {
+        juce::FileOutputStream output(tempFile.getFile());
+        
+        if (!output.openedOk())
+        {
+            return false;
+        }
+        
+        // Header; the chunk count and table offset are filled in at the end
+        output.write(formatMagic, sizeof(formatMagic));
+        output.writeInt(static_cast<int>(formatVersion));
+        output.writeInt(0);
+        output.writeInt(0);
+        output.writeInt64(0);
+        
+        std::vector<ChunkInfo> toc;
+        
+        auto writeChunk = [&output, &toc, &progress, totalChunks](ChunkType type, const juce::XmlElement& element) {
+            if (progress && !progress(static_cast<double>(toc.size()) / totalChunks))
+            {
+                return false;
+            }
+            
+            const juce::int64 offset = output.getPosition();
+            juce::ValueTree::fromXml(element).writeToStream(output);
+            
+            toc.push_back({ static_cast<juce::uint32>(type),
+                            static_cast<juce::uint64>(offset),
+                            static_cast<juce::uint64>(output.getPosition() - offset) });
+            
+            return true;
+        };
+        
+        // The root chunk keeps the chunked sections as empty elements, so
+        // their attributes and position survive
+        juce::XmlElement root(projectXml.getTagName());
+        
+        for (int i = 0; i < projectXml.getNumAttributes(); ++i)
+        {
+            root.setAttribute(projectXml.getAttributeName(i), projectXml.getAttributeValue(i));
+        }
+        
+        for (auto* child : projectXml.getChildIterator())
+        {
+            bool chunked = false;
+            
+            for (auto type : sectionTypes)
+            {
+                chunked = chunked || child->hasTagName(getSectionName(type));
+            }
+            
+            if (chunked)
+            {
+                auto* section = root.createNewChildElement(child->getTagName());
+                
+                for (int i = 0; i < child->getNumAttributes(); ++i)
+                {
+                    section->setAttribute(child->getAttributeName(i), child->getAttributeValue(i));
+                }
+            }
+            else
+            {
+                root.addChildElement(new juce::XmlElement(*child));
+            }
+        }
+        
+        // A cancelled write leaves the temporary file to be deleted
+        if (!writeChunk(ChunkType::Root, root))
+        {
+            return false;
+        }
+        
+        for (auto type : sectionTypes)
+        {
+            if (auto* section = projectXml.getChildByName(getSectionName(type)))
+            {
+                for (auto* child : section->getChildIterator())
+                {
+                    if (!writeChunk(type, *child))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        
+        // Table of contents
+        const juce::int64 tocOffset = output.getPosition();
+        
+        for (const auto& chunk : toc)
+        {
+            output.writeInt(static_cast<int>(chunk.type));
+            output.writeInt(0);
+            output.writeInt64(static_cast<juce::int64>(chunk.offset));
+            output.writeInt64(static_cast<juce::int64>(chunk.size));
+        }
+        
+        if (!output.setPosition(8))
+        {
+            return false;
+        }
+        
+        output.writeInt(static_cast<int>(toc.size()));
+        output.writeInt(0);
+        output.writeInt64(tocOffset);
+        output.flush();
+        
+        if (output.getStatus().failed())
+        {
+            return false;
+        }
+    }
+    
+    return tempFile.overwriteTargetFileWithTemporary();
+}
+
+bool ProjectFile::open(const juce::File& file)
+{
+    close();
+    
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    const auto* data = static_cast<const char*>(mapped->getData());
+    const juce::uint64 fileSize = static_cast<juce::uint64>(mapped->getSize());
+    
+    if (data == nullptr || fileSize < headerSize || std::memcmp(data, formatMagic, sizeof(formatMagic)) != 0)
+    {
+        return false;
+    }
+    
+    // Newer versions may change the layout
+    if (juce::ByteOrder::littleEndianInt(data + 4) != formatVersion)
+    {
+        return false;
+    }
+    
+    const juce::uint64 numChunks = juce::ByteOrder::littleEndianInt(data + 8);
+    const juce::uint64 tocOffset = juce::ByteOrder::littleEndianInt64(data + 16);
+    
+    if (tocOffset < headerSize || tocOffset > fileSize || numChunks > (fileSize - tocOffset) / tocEntrySize)
+    {
+        return false;
+    }
+    
+    std::vector<ChunkInfo> toc;
+    toc.reserve(static_cast<size_t>(numChunks));
+    
+    for (juce::uint64 i = 0; i < numChunks; ++i)
+    {
+        const char* entry = data + tocOffset + i * tocEntrySize;
+        
+        ChunkInfo chunk;
+        chunk.type = juce::ByteOrder::littleEndianInt(entry);
+        chunk.offset = juce::ByteOrder::littleEndianInt64(entry + 8);
+        chunk.size = juce::ByteOrder::littleEndianInt64(entry + 16);
+        
+        // Chunks must lie between the header and the table of contents
+        if (chunk.offset < headerSize || chunk.offset > tocOffset || chunk.size > tocOffset - chunk.offset)
+        {
+            return false;
+        }
+        
+        toc.push_back(chunk);
+    }
+    
+    mappedFile = std::move(mapped);
+    chunks = std::move(toc);
+    
+    return true;
+}
+
+void ProjectFile::close()
+{
+    chunks.clear();
+    mappedFile.reset();
+}
+
+bool ProjectFile::isOpen() const
+{
+    return mappedFile != nullptr;
+}
+
+std::vector<int> ProjectFile::getChunksOfType(ChunkType type) const
+{
+    std::vector<int> indices;
+    
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        if (chunks[i].type == static_cast<juce::uint32>(type))
+        {
+            indices.push_back(static_cast<int>(i));
+        }
+    }
+    
+    return indices;
+}
+
+std::unique_ptr<juce::XmlElement> ProjectFile::readChunk(int index) const
+{
+    if (mappedFile == nullptr || index < 0 || index >= static_cast<int>(chunks.size()))
+    {
+        return nullptr;
+    }
+    
+    const ChunkInfo& chunk = chunks[static_cast<size_t>(index)];
+    const auto* data = static_cast<const char*>(mappedFile->getData()) + chunk.offset;
+    
+    auto tree = juce::ValueTree::readFromData(data, static_cast<size_t>(chunk.size));
+    
+    if (!tree.isValid())
+    {
+        return nullptr;
+    }
+    
+    return tree.createXml();
+}
+
+juce::String ProjectFile::getSectionName(ChunkType type)
+{
+    switch (type)
+    {
+        case ChunkType::Pattern:    return "Patterns";
+        case ChunkType::Track:      return "Tracks";
+        case ChunkType::Instrument: return "Instruments";
+        case ChunkType::Effect:     return "Effects";
+        case ChunkType::Root:       break;
+    }
+    
+    return {};
+}
+
+} // namespace UndergroundBeats
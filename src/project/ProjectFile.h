@@ -0,0 +1,134 @@
+/*
+ * Underground Beats
+ * ProjectFile.h
+ * 
+ * Chunked binary project file format
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace UndergroundBeats {
+
+/**
+ * @class ProjectFile
+ * @brief Chunked binary project file format
+ * 
+ * A project file starts with a fixed header, followed by one chunk per
+ * pattern, track, instrument and effect, and ends with a table of contents
+ * giving the type, offset and size of every chunk. A root chunk holds the
+ * project element itself with its settings and any other sections.
+ * 
+ * Each chunk stores its element as a binary ValueTree, which reads back
+ * without tokenising any text. Files are opened through a memory mapping, so
+ * opening only reads the table of contents; chunks are decoded when they are
+ * asked for and the rest of the file stays in the OS page cache.
+ * 
+ * All integers are little-endian.
+ */
+class ProjectFile
+{
+public:
+    /**
+     * @brief What a chunk holds
+     */
+    enum class ChunkType : juce::uint32
+    {
+        Root       = 0x544f4f52, // "ROOT": the project element with its settings
+        Pattern    = 0x4e544150, // "PATN": one element of the Patterns section
+        Track      = 0x4b415254, // "TRAK": one element of the Tracks section
+        Instrument = 0x54534e49, // "INST": one element of the Instruments section
+        Effect     = 0x54434645  // "EFCT": one element of the Effects section
+    };
+    
+    /**
+     * @brief Called with the fraction of work done; return false to cancel
+     */
+    using ProgressCallback = std::function<bool(double progress)>;
+    
+    ProjectFile();
+    ~ProjectFile();
+    
+    /**
+     * @brief Check whether a file is in the binary format
+     * 
+     * @param file The file to check
+     * @return true if the file starts with the binary project header
+     */
+    static bool isBinaryProject(const juce::File& file);
+    
+    /**
+     * @brief Write a project element to a file in the binary format
+     * 
+     * The file is written next to the target and moved into place, so a
+     * failed save leaves the previous file intact.
+     * 
+     * @param file The file to write
+     * @param projectXml The project element, as created by ProjectState
+     * @param progress Optional callback, called before each chunk
+     * @return true if successful, false if writing failed or was cancelled
+     */
+    static bool write(const juce::File& file, const juce::XmlElement& projectXml,
+                      const ProgressCallback& progress = nullptr);
+    
+    /**
+     * @brief Map a binary project file and read its table of contents
+     * 
+     * @param file The file to open
+     * @return true if the file is a valid binary project
+     */
+    bool open(const juce::File& file);
+    
+    /**
+     * @brief Release the mapping
+     */
+    void close();
+    
+    /**
+     * @brief Check whether a file is open
+     */
+    bool isOpen() const;
+    
+    /**
+     * @brief Get the indices of the chunks of a type, in file order
+     * 
+     * @param type The chunk type
+     * @return The chunk indices
+     */
+    std::vector<int> getChunksOfType(ChunkType type) const;
+    
+    /**
+     * @brief Decode a chunk
+     * 
+     * @param index The chunk index
+     * @return The chunk's element, or nullptr if it is invalid
+     */
+    std::unique_ptr<juce::XmlElement> readChunk(int index) const;
+    
+    /**
+     * @brief Get the section of the project element a chunk type belongs to
+     * 
+     * @param type The chunk type
+     * @return The section's tag name, or an empty string for the root chunk
+     */
+    static juce::String getSectionName(ChunkType type);
+    
+private:
+    struct ChunkInfo
+    {
+        juce::uint32 type;
+        juce::uint64 offset;
+        juce::uint64 size;
+    };
+    
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    std::vector<ChunkInfo> chunks;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectFile)
+};
+
+} // namespace UndergroundBeats
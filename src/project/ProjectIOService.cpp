@@ -0,0 +1,250 @@
+/*
+ * Underground Beats
+ * ProjectIOService.cpp
+ */
+
+#include "ProjectIOService.h"
+#include "ProjectState.h"
+
+namespace UndergroundBeats {
+
+ProjectIOService::ProjectIOService()
+    : juce::Thread("Project I/O")
+{
+    startThread(juce::Thread::Priority::normal);
+}
+
+ProjectIOService::~ProjectIOService()
+{
+    cancelAll();
+    signalThreadShouldExit();
+    requestQueued.signal();
+    
+    // Legacy XML parsing cannot be interrupted, so allow it time to finish
+    stopThread(10000);
+    
+    cancelPendingUpdate();
+}
+
+void ProjectIOService::loadAsync(const juce::File& file, LoadCallback onComplete)
+{
+    auto request = std::make_unique<Request>();
+    request->file = file;
+    request->onLoaded = std::move(onComplete);
+    
+    queue(std::move(request));
+}
+
+void ProjectIOService::saveAsync(const juce::File& file, std::shared_ptr<const juce::XmlElement> snapshot,
+                                 SaveCallback onComplete)
+{
+    auto request = std::make_unique<Request>();
+    request->isSave = true;
+    request->file = file;
+    request->snapshot = std::move(snapshot);
+    request->onSaved = std::move(onComplete);
+    
+    queue(std::move(request));
+}
+
+void ProjectIOService::runAsync(Task task, SaveCallback onComplete)
+{
+    auto request = std::make_unique<Request>();
+    request->task = std::move(task);
+    request->onSaved = std::move(onComplete);
+    
+    queue(std::move(request));
+}
+
+void ProjectIOService::cancelAll()
+{
+    // The running request sees the new generation at its next progress check
+    ++cancelGeneration;
+    
+    const juce::ScopedLock lock(requestLock);
+    
+    for (auto& request : queuedRequests)
+    {
+        request->outcome = Outcome::Cancelled;
+        finishedRequests.push_back(std::move(request));
+    }
+    
+    queuedRequests.clear();
+    triggerAsyncUpdate();
+}
+
+bool ProjectIOService::isBusy() const
+{
+    const juce::ScopedLock lock(requestLock);
+    return activeRequests > 0;
+}
+
+double ProjectIOService::getProgress() const
+{
+    return progress.load();
+}
+
+std::unique_ptr<ProjectState> ProjectIOService::readProject(const juce::File& file, bool decodeAllSections,
+                                                            const ProjectFile::ProgressCallback& progressCallback)
+{
+    auto state = std::make_unique<ProjectState>();
+    
+    if (ProjectFile::isBinaryProject(file))
+    {
+        // Map the file; sections are decoded now or when they are first used
+        auto binaryFile = std::make_unique<ProjectFile>();
+        
+        if (!binaryFile->open(file) || !state->restoreFromProjectFile(std::move(binaryFile)))
+        {
+            return nullptr;
+        }
+        
+        if (decodeAllSections && !state->loadAllSections(progressCallback))
+        {
+            return nullptr;
+        }
+        
+        return state;
+    }
+    
+    // Projects saved before the binary format are plain XML
+    std::unique_ptr<juce::XmlElement> xml = juce::XmlDocument::parse(file);
+    
+    if (xml == nullptr || !state->restoreFromXml(xml.get()))
+    {
+        return nullptr;
+    }
+    
+    return state;
+}
+
+void ProjectIOService::run()
+{
+    while (!threadShouldExit())
+    {
+        std::unique_ptr<Request> request;
+        
+        {
+            const juce::ScopedLock lock(requestLock);
+            
+            if (!queuedRequests.empty())
+            {
+                request = std::move(queuedRequests.front());
+                queuedRequests.pop_front();
+            }
+        }
+        
+        if (request == nullptr)
+        {
+            requestQueued.wait(100);
+            continue;
+        }
+        
+        progress = 0.0;
+        perform(*request);
+        progress = 1.0;
+        
+        finish(std::move(request));
+    }
+}
+
+void ProjectIOService::handleAsyncUpdate()
+{
+    std::vector<std::unique_ptr<Request>> finished;
+    
+    {
+        const juce::ScopedLock lock(requestLock);
+        finished.swap(finishedRequests);
+    }
+    
+    for (auto& request : finished)
+    {
+        if (request->isSave || request->task)
+        {
+            if (request->onSaved)
+            {
+                request->onSaved(request->outcome);
+            }
+        }
+        else if (request->onLoaded)
+        {
+            request->onLoaded(request->outcome, std::move(request->loadedState));
+        }
+        
+        const juce::ScopedLock lock(requestLock);
+        --activeRequests;
+    }
+}
+
+void ProjectIOService::queue(std::unique_ptr<Request> request)
+{
+    request->generation = cancelGeneration.load();
+    
+    {
+        const juce::ScopedLock lock(requestLock);
+        queuedRequests.push_back(std::move(request));
+        ++activeRequests;
+    }
+    
+    requestQueued.signal();
+}
+
+void ProjectIOService::perform(Request& request)
+{
+    if (isCancelled(request))
+    {
+        request.outcome = Outcome::Cancelled;
+        return;
+    }
+    
+    auto reportProgress = [this, &request](double fraction) {
+        progress = fraction;
+        return !isCancelled(request) && !threadShouldExit();
+    };
+    
+    if (request.task)
+    {
+        request.outcome = request.task(reportProgress);
+        return;
+    }
+    
+    if (request.isSave)
+    {
+        const bool written = request.snapshot != nullptr
+                          && ProjectFile::write(request.file, *request.snapshot, reportProgress);
+        
+        request.outcome = written ? Outcome::Succeeded
+                                  : isCancelled(request) ? Outcome::Cancelled : Outcome::Failed;
+        return;
+    }
+    
+    request.loadedState = readProject(request.file, true, reportProgress);
+    
+    // A load that finished after being cancelled is still thrown away
+    if (isCancelled(request))
+    {
+        request.loadedState.reset();
+        request.outcome = Outcome::Cancelled;
+    }
+    else
+    {
+        request.outcome = request.loadedState != nullptr ? Outcome::Succeeded : Outcome::Failed;
+    }
+}
+
+bool ProjectIOService::isCancelled(const Request& request) const
+{
+    return request.generation != cancelGeneration.load();
+}
+
+void ProjectIOService::finish(std::unique_ptr<Request> request)
+{
+    {
+        const juce::ScopedLock lock(requestLock);
+        finishedRequests.push_back(std::move(request));
+    }
+    
+    triggerAsyncUpdate();
+}
+
+} // namespace UndergroundBeats
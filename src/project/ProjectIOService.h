@@ -0,0 +1,157 @@
+/*
+ * Underground Beats
+ * ProjectIOService.h
+ * 
+ * Loads and saves projects on a background thread
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectFile.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace UndergroundBeats {
+
+// Forward declarations
+class ProjectState;
+
+/**
+ * @class ProjectIOService
+ * @brief Loads and saves projects on a background thread
+ * 
+ * Requests are queued and run one at a time on a worker thread, so file I/O
+ * and (de)serialisation never block the message thread. Loads build a
+ * complete ProjectState off-thread, decoding every section, and hand it over
+ * whole when done. Saves write a snapshot of the project taken when the save
+ * was requested, so the project can be edited while the file is written.
+ * 
+ * Completion callbacks are called on the message thread. Pending and running
+ * requests can be cancelled; they then complete with Outcome::Cancelled.
+ */
+class ProjectIOService : private juce::Thread,
+                         private juce::AsyncUpdater
+{
+public:
+    /**
+     * @brief How a request ended
+     */
+    enum class Outcome
+    {
+        Succeeded,
+        Failed,
+        Cancelled
+    };
+    
+    using LoadCallback = std::function<void(Outcome outcome, std::unique_ptr<ProjectState> state)>;
+    using SaveCallback = std::function<void(Outcome outcome)>;
+    
+    /**
+     * @brief Work run on the I/O thread; should check the progress callback to allow cancelling
+     */
+    using Task = std::function<Outcome(const ProjectFile::ProgressCallback& progress)>;
+    
+    ProjectIOService();
+    ~ProjectIOService() override;
+    
+    /**
+     * @brief Queue a project load
+     * 
+     * @param file The file to load
+     * @param onComplete Called on the message thread with the loaded state
+     */
+    void loadAsync(const juce::File& file, LoadCallback onComplete);
+    
+    /**
+     * @brief Queue a project save
+     * 
+     * @param file The file to save to
+     * @param snapshot The project element to write, as created by ProjectState
+     * @param onComplete Called on the message thread when the file is written
+     */
+    void saveAsync(const juce::File& file, std::shared_ptr<const juce::XmlElement> snapshot,
+                   SaveCallback onComplete);
+    
+    /**
+     * @brief Queue other work that reads or writes project files
+     * 
+     * Runs in order with loads and saves, so it never writes a file at the
+     * same time as they do.
+     * 
+     * @param task The work to run on the I/O thread
+     * @param onComplete Called on the message thread with the task's outcome
+     */
+    void runAsync(Task task, SaveCallback onComplete);
+    
+    /**
+     * @brief Cancel the running request and every queued one
+     */
+    void cancelAll();
+    
+    /**
+     * @brief Check whether any request is queued or running
+     */
+    bool isBusy() const;
+    
+    /**
+     * @brief Get the progress of the running request, from 0 to 1
+     */
+    double getProgress() const;
+    
+    /**
+     * @brief Read a project file in either the binary or legacy XML format
+     * 
+     * @param file The file to read
+     * @param decodeAllSections Whether to decode binary sections now rather than on first use
+     * @param progress Optional callback for decoding progress
+     * @return The project state, or nullptr if the file could not be read or reading was cancelled
+     */
+    static std::unique_ptr<ProjectState> readProject(const juce::File& file, bool decodeAllSections,
+                                                     const ProjectFile::ProgressCallback& progress = nullptr);
+    
+private:
+    struct Request
+    {
+        bool isSave = false;
+        juce::File file;
+        std::shared_ptr<const juce::XmlElement> snapshot;
+        Task task;
+        LoadCallback onLoaded;
+        SaveCallback onSaved;
+        
+        // Value of cancelGeneration when the request was queued
+        int generation = 0;
+        
+        // Filled in by the worker
+        Outcome outcome = Outcome::Failed;
+        std::unique_ptr<ProjectState> loadedState;
+    };
+    
+    // Thread implementation
+    void run() override;
+    
+    // AsyncUpdater implementation
+    void handleAsyncUpdate() override;
+    
+    void queue(std::unique_ptr<Request> request);
+    void perform(Request& request);
+    bool isCancelled(const Request& request) const;
+    void finish(std::unique_ptr<Request> request);
+    
+    juce::CriticalSection requestLock;
+    std::deque<std::unique_ptr<Request>> queuedRequests;
+    std::vector<std::unique_ptr<Request>> finishedRequests;
+    int activeRequests = 0;
+    
+    juce::WaitableEvent requestQueued;
+    std::atomic<int> cancelGeneration { 0 };
+    std::atomic<double> progress { 0.0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectIOService)
+};
+
+} // namespace UndergroundBeats
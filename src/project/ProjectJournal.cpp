@@ -0,0 +1,396 @@
+/*
+ * Underground Beats
+ * ProjectJournal.cpp
+ */
+
+#include "ProjectJournal.h"
+#include "ProjectState.h"
+#include "../utils/Hash.h"
+#include <algorithm>
+#include <cstring>
+
+namespace UndergroundBeats {
+
+namespace {
+
+const char journalMagic[4] = { 'U', 'B', 'J', 'L' };
+constexpr int journalVersion = 1;
+
+// Sequence, operation, index
+constexpr int entryHeaderSize = 8 + 4 + 4;
+
+} // namespace
+
+ProjectJournal::ProjectJournal(ProjectIOService& ioServiceToUse)
+    : ioService(ioServiceToUse),
+      nextSequence(1),
+      compactionPending(false),
+      compactionInterval(30000)
+{
+}
+
+ProjectJournal::~ProjectJournal()
+{
+    close();
+}
+
+bool ProjectJournal::open(const juce::File& projectFileToUse, const juce::String& journalIdToUse,
+                          juce::int64 savedSequence)
+{
+    // Entries made while a save was running belong to the new file too
+    EntryList carried;
+    juce::File retiredJournal;
+    
+    if (journalIdToUse == journalId)
+    {
+        carried = entries;
+        
+        // After a save-as the entries move with the project, so the old journal
+        // must not replay them into the old project file when it is next loaded
+        if (projectFile != juce::File() && projectFile != projectFileToUse)
+        {
+            retiredJournal = getJournalFile(projectFile);
+        }
+    }
+    
+    close();
+    
+    EntryList merged = readEntries(getJournalFile(projectFileToUse), journalIdToUse);
+    merged.insert(merged.end(), carried.begin(), carried.end());
+    
+    // Keep one copy of each entry the project file does not contain, in order
+    std::sort(merged.begin(), merged.end(), [](const auto& a, const auto& b) {
+        return a->sequence < b->sequence;
+    });
+    
+    merged.erase(std::unique(merged.begin(), merged.end(), [](const auto& a, const auto& b) {
+        return a->sequence == b->sequence;
+    }), merged.end());
+    
+    merged.erase(std::remove_if(merged.begin(), merged.end(), [savedSequence](const auto& entry) {
+        return entry->sequence <= savedSequence;
+    }), merged.end());
+    
+    projectFile = projectFileToUse;
+    journalId = journalIdToUse;
+    entries = std::move(merged);
+    nextSequence = juce::jmax(savedSequence, entries.empty() ? 0 : entries.back()->sequence) + 1;
+    
+    if (!rewrite())
+    {
+        close();
+        return false;
+    }
+    
+    // Only once the entries are safe in the new journal
+    if (retiredJournal != juce::File())
+    {
+        retiredJournal.deleteFile();
+    }
+    
+    startTimer(compactionInterval);
+    
+    return true;
+}
+
+void ProjectJournal::close()
+{
+    stopTimer();
+    
+    output.reset();
+    entries.clear();
+    projectFile = juce::File();
+    journalId = {};
+    nextSequence = 1;
+    compactionPending = false;
+}
+
+bool ProjectJournal::isOpen() const
+{
+    return output != nullptr;
+}
+
+juce::int64 ProjectJournal::append(Operation operation, int index, const juce::XmlElement& element)
+{
+    const juce::int64 sequence = nextSequence++;
+    
+    if (output == nullptr)
+    {
+        return sequence;
+    }
+    
+    auto entry = createEntry(sequence, operation, index, element);
+    
+    // Flushed to the OS right away, so a crash of the app loses nothing
+    output->write(entry->record.getData(), entry->record.getSize());
+    output->flush();
+    
+    entries.push_back(std::move(entry));
+    
+    return sequence;
+}
+
+void ProjectJournal::discardThrough(juce::int64 sequence)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+    
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [sequence](const auto& entry) {
+        return entry->sequence <= sequence;
+    }), entries.end());
+    
+    rewrite();
+}
+
+void ProjectJournal::compactNow()
+{
+    if (!isOpen() || entries.empty() || compactionPending)
+    {
+        return;
+    }
+    
+    compactionPending = true;
+    
+    const juce::int64 throughSequence = entries.back()->sequence;
+    
+    auto task = [file = projectFile, id = journalId, pending = entries](const ProjectFile::ProgressCallback& progress) {
+        auto state = ProjectIOService::readProject(file, true, progress);
+        
+        if (state == nullptr || state->getJournalId() != id)
+        {
+            return ProjectIOService::Outcome::Failed;
+        }
+        
+        for (const auto& entry : pending)
+        {
+            if (entry->sequence > state->getJournalSequence())
+            {
+                apply(*state, entry->operation, entry->index, *entry->element);
+                state->setJournalSequence(entry->sequence);
+            }
+        }
+        
+        return ProjectFile::write(file, *state->createXml(), progress) ? ProjectIOService::Outcome::Succeeded
+                                                                      : ProjectIOService::Outcome::Failed;
+    };
+    
+    ioService.runAsync(std::move(task), [this, file = projectFile, throughSequence](ProjectIOService::Outcome outcome) {
+        // The journal may have moved on to another project meanwhile
+        if (file != projectFile)
+        {
+            return;
+        }
+        
+        compactionPending = false;
+        
+        if (outcome == ProjectIOService::Outcome::Succeeded)
+        {
+            discardThrough(throughSequence);
+        }
+    });
+}
+
+void ProjectJournal::setCompactionInterval(int milliseconds)
+{
+    compactionInterval = juce::jmax(1000, milliseconds);
+    
+    if (isOpen())
+    {
+        startTimer(compactionInterval);
+    }
+}
+
+int ProjectJournal::getNumPendingEntries() const
+{
+    return static_cast<int>(entries.size());
+}
+
+juce::File ProjectJournal::getJournalFile(const juce::File& projectFile)
+{
+    return projectFile.withFileExtension(".ubj");
+}
+
+int ProjectJournal::recover(const juce::File& projectFile, ProjectState& state)
+{
+    int applied = 0;
+    
+    for (const auto& entry : readEntries(getJournalFile(projectFile), state.getJournalId()))
+    {
+        if (entry->sequence > state.getJournalSequence()
+            && apply(state, entry->operation, entry->index, *entry->element))
+        {
+            state.setJournalSequence(entry->sequence);
+            ++applied;
+        }
+    }
+    
+    // Recovered edits are not in the project file yet
+    if (applied > 0)
+    {
+        state.setModified(true);
+    }
+    
+    return applied;
+}
+
+bool ProjectJournal::apply(ProjectState& state, Operation operation, int index, const juce::XmlElement& element)
+{
+    switch (operation)
+    {
+        case Operation::SetSettings:   return state.restoreSettingsFromXml(&element);
+        case Operation::AddPattern:    return state.addPattern(&element);
+        case Operation::AddTrack:      return state.addTrack(&element);
+        case Operation::UpdatePattern: return state.updatePattern(index, &element);
+        case Operation::UpdateTrack:   return state.updateTrack(index, &element);
+    }
+    
+    return false;
+}
+
+void ProjectJournal::timerCallback()
+{
+    compactNow();
+}
+
+bool ProjectJournal::rewrite()
+{
+    const juce::File journalFile = getJournalFile(projectFile);
+    
+    output.reset();
+    
+    {
+        juce::TemporaryFile tempFile(journalFile);
+        juce::FileOutputStream tempOutput(tempFile.getFile());
+        
+        if (!tempOutput.openedOk())
+        {
+            return false;
+        }
+        
+        tempOutput.write(journalMagic, sizeof(journalMagic));
+        tempOutput.writeInt(journalVersion);
+        tempOutput.writeString(journalId);
+        
+        for (const auto& entry : entries)
+        {
+            tempOutput.write(entry->record.getData(), entry->record.getSize());
+        }
+        
+        tempOutput.flush();
+        
+        if (tempOutput.getStatus().failed() || !tempFile.overwriteTargetFileWithTemporary())
+        {
+            return false;
+        }
+    }
+    
+    // Opens at the end of the file, ready for appending
+    output = std::make_unique<juce::FileOutputStream>(journalFile);
+    
+    if (!output->openedOk())
+    {
+        output.reset();
+        return false;
+    }
+    
+    return true;
+}
+
+std::shared_ptr<const ProjectJournal::Entry> ProjectJournal::createEntry(juce::int64 sequence, Operation operation,
+                                                                         int index, const juce::XmlElement& element)
+{
+    juce::MemoryOutputStream body;
+    body.writeInt64(sequence);
+    body.writeInt(static_cast<int>(operation));
+    body.writeInt(index);
+    juce::ValueTree::fromXml(element).writeToStream(body);
+    
+    juce::MemoryOutputStream record;
+    record.writeInt(static_cast<int>(body.getDataSize()));
+    record.write(body.getData(), body.getDataSize());
+    record.writeInt(static_cast<int>(Hash::fnv1a32(body.getData(), body.getDataSize())));
+    
+    auto entry = std::make_shared<Entry>();
+    entry->sequence = sequence;
+    entry->operation = operation;
+    entry->index = index;
+    entry->element = std::make_shared<const juce::XmlElement>(element);
+    entry->record = record.getMemoryBlock();
+    
+    return entry;
+}
+
+ProjectJournal::EntryList ProjectJournal::readEntries(const juce::File& journalFile, const juce::String& journalId)
+{
+    EntryList result;
+    juce::MemoryBlock data;
+    
+    if (!journalFile.existsAsFile() || !journalFile.loadFileAsData(data))
+    {
+        return result;
+    }
+    
+    juce::MemoryInputStream input(data, false);
+    char magic[4] = {};
+    
+    if (input.read(magic, sizeof(magic)) != static_cast<int>(sizeof(magic))
+        || std::memcmp(magic, journalMagic, sizeof(magic)) != 0
+        || input.readInt() != journalVersion)
+    {
+        return result;
+    }
+    
+    // A journal left behind by another project is never replayed
+    if (input.readString() != journalId)
+    {
+        return result;
+    }
+    
+    const auto* bytes = static_cast<const char*>(data.getData());
+    
+    while (input.getNumBytesRemaining() >= 4)
+    {
+        const juce::int64 recordStart = input.getPosition();
+        const int bodySize = input.readInt();
+        
+        // Stop at the first torn or damaged record; everything after it is lost
+        if (bodySize < entryHeaderSize || bodySize > input.getNumBytesRemaining() - 4)
+        {
+            break;
+        }
+        
+        const char* body = bytes + input.getPosition();
+        
+        if (juce::ByteOrder::littleEndianInt(body + bodySize) != Hash::fnv1a32(body, static_cast<size_t>(bodySize)))
+        {
+            break;
+        }
+        
+        const int operation = static_cast<int>(juce::ByteOrder::littleEndianInt(body + 8));
+        auto tree = juce::ValueTree::readFromData(body + entryHeaderSize, static_cast<size_t>(bodySize - entryHeaderSize));
+        
+        if (operation < static_cast<int>(Operation::SetSettings)
+            || operation > static_cast<int>(Operation::UpdateTrack)
+            || !tree.isValid())
+        {
+            break;
+        }
+        
+        auto entry = std::make_shared<Entry>();
+        entry->sequence = static_cast<juce::int64>(juce::ByteOrder::littleEndianInt64(body));
+        entry->operation = static_cast<Operation>(operation);
+        entry->index = static_cast<int>(juce::ByteOrder::littleEndianInt(body + 12));
+        entry->element = tree.createXml();
+        entry->record.append(bytes + recordStart, static_cast<size_t>(4 + bodySize + 4));
+        
+        result.push_back(std::move(entry));
+        
+        input.skipNextBytes(bodySize + 4);
+    }
+    
+    return result;
+}
+
+} // namespace UndergroundBeats
@@ -0,0 +1,180 @@
+/*
+ * Underground Beats
+ * ProjectJournal.h
+ * 
+ * Append-only log of project edits for autosave and crash recovery
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectIOService.h"
+#include <memory>
+#include <vector>
+
+namespace UndergroundBeats {
+
+// Forward declarations
+class ProjectState;
+
+/**
+ * @class ProjectJournal
+ * @brief Append-only log of project edits for autosave and crash recovery
+ * 
+ * Each edit to the project is appended to a journal file next to the project
+ * file as it happens, so autosaving costs as much as the edit rather than the
+ * whole project. Every entry has a sequence number, and the project file
+ * records the last one it contains.
+ * 
+ * A timer periodically compacts the journal on the project I/O thread. The
+ * compaction loads the project file, applies the pending entries, writes the
+ * file back and drops those entries from the journal. After a crash,
+ * recover() replays the entries the project file does not contain yet.
+ * 
+ * A journal file starts with a header naming the project it belongs to.
+ * Each entry is a length-prefixed, checksummed record, so a write torn by a
+ * crash is detected and ignored. Every method runs on the message thread.
+ */
+class ProjectJournal : private juce::Timer
+{
+public:
+    /**
+     * @brief The kind of edit an entry records
+     */
+    enum class Operation
+    {
+        SetSettings = 1,
+        AddPattern,
+        AddTrack,
+        UpdatePattern,
+        UpdateTrack
+    };
+    
+    /**
+     * @brief Create a closed journal
+     * 
+     * @param ioServiceToUse The service compactions run on, so they never overlap a save
+     */
+    explicit ProjectJournal(ProjectIOService& ioServiceToUse);
+    ~ProjectJournal() override;
+    
+    /**
+     * @brief Start journaling edits to a project file
+     * 
+     * Entries already in the journal file that the project file does not
+     * contain are kept, as are this journal's own entries for the same project.
+     * When the same project moves to a new file, as on save-as, the journal
+     * next to the old file is deleted once the entries have moved.
+     * 
+     * @param projectFileToUse The project file
+     * @param journalIdToUse The project's journal identifier
+     * @param savedSequence The last sequence number the project file contains
+     * @return true if the journal file could be written
+     */
+    bool open(const juce::File& projectFileToUse, const juce::String& journalIdToUse, juce::int64 savedSequence);
+    
+    /**
+     * @brief Stop journaling
+     */
+    void close();
+    
+    /**
+     * @brief Check whether the journal is open
+     */
+    bool isOpen() const;
+    
+    /**
+     * @brief Append an edit to the journal
+     * 
+     * @param operation The kind of edit
+     * @param index The index of the edited element, or -1 if not applicable
+     * @param element The new element
+     * @return The sequence number of the entry
+     */
+    juce::int64 append(Operation operation, int index, const juce::XmlElement& element);
+    
+    /**
+     * @brief Drop entries the project file now contains
+     * 
+     * @param sequence The last sequence number the project file contains
+     */
+    void discardThrough(juce::int64 sequence);
+    
+    /**
+     * @brief Queue a compaction of the pending entries into the project file
+     */
+    void compactNow();
+    
+    /**
+     * @brief Set how often the journal is compacted
+     * 
+     * @param milliseconds The interval between compactions
+     */
+    void setCompactionInterval(int milliseconds);
+    
+    /**
+     * @brief Get the number of entries not yet compacted
+     */
+    int getNumPendingEntries() const;
+    
+    /**
+     * @brief Get the journal file belonging to a project file
+     */
+    static juce::File getJournalFile(const juce::File& projectFile);
+    
+    /**
+     * @brief Apply journal entries the project does not contain yet
+     * 
+     * @param projectFile The project file the state was loaded from
+     * @param state The loaded project state
+     * @return The number of entries applied
+     */
+    static int recover(const juce::File& projectFile, ProjectState& state);
+    
+    /**
+     * @brief Apply one journal entry to a project state
+     * 
+     * @return true if successful
+     */
+    static bool apply(ProjectState& state, Operation operation, int index, const juce::XmlElement& element);
+    
+private:
+    struct Entry
+    {
+        juce::int64 sequence;
+        Operation operation;
+        int index;
+        std::shared_ptr<const juce::XmlElement> element;
+        
+        // The entry as written to the journal file
+        juce::MemoryBlock record;
+    };
+    
+    // Entries are immutable and shared with compactions on the I/O thread
+    using EntryList = std::vector<std::shared_ptr<const Entry>>;
+    
+    // Timer implementation
+    void timerCallback() override;
+    
+    // Rewrite the journal file from the pending entries and reopen it for appending
+    bool rewrite();
+    
+    static std::shared_ptr<const Entry> createEntry(juce::int64 sequence, Operation operation, int index,
+                                                    const juce::XmlElement& element);
+    static EntryList readEntries(const juce::File& journalFile, const juce::String& journalId);
+    
+    ProjectIOService& ioService;
+    
+    juce::File projectFile;
+    juce::String journalId;
+    std::unique_ptr<juce::FileOutputStream> output;
+    
+    EntryList entries;
+    juce::int64 nextSequence;
+    bool compactionPending;
+    int compactionInterval;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectJournal)
+};
+
+} // namespace UndergroundBeats
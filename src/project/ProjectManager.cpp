@@ -5,6 +5,7 @@
 
 #include "ProjectManager.h"
 #include "ProjectState.h"
+#include "ProjectFile.h"
 
 namespace UndergroundBeats {
 
@@ -31,6 +32,9 @@ bool ProjectManager::createNewProject(const juce::String& name, double sampleRat
         // For now, we'll just assume they don't want to save
     }
     
+    // An unsaved project has no file to journal against
+    journal.close();
+    
     // Create a new project state
     projectState = std::make_unique<ProjectState>();
     projectState->initializeDefault(name, sampleRate);
@@ -46,52 +50,53 @@ bool ProjectManager::createNewProject(const juce::String& name, double sampleRat
     return true;
 }
 
+void ProjectManager::setSaveLocationChooser(SaveLocationChooser chooser)
+{
+    saveLocationChooser = std::move(chooser);
+}
+
 bool ProjectManager::saveProject(bool saveAs)
 {
     // If we haven't saved before, or saveAs is true, prompt for a file
     if (projectFile == juce::File() || saveAs)
     {
-        juce::FileChooser fileChooser("Save Project",
-                                      juce::File::getSpecialLocation(juce::File::userDocumentsDirectory),
-                                      "*.ubp");
+        if (!saveLocationChooser)
+            return false;
         
-        fileChooser.launchAsync(juce::FileBrowserComponent::saveMode, [this](const juce::FileChooser& chooser) {
-            juce::File file = chooser.getResult();
+        saveLocationChooser([this](const juce::File& file) {
             if (file != juce::File())
-                saveProjectAs(file);
+                saveProjectAsync(file);
         });
         
         return true; // Returning true since we launched the dialog
     }
     
     // Save to the existing file
-    return saveProjectAs(projectFile);
+    saveProjectAsync(projectFile);
+    return true;
 }
 
 bool ProjectManager::saveProjectAs(const juce::File& file)
 {
     // Create XML from project state
     std::unique_ptr<juce::XmlElement> xml = projectState->createXml();
+    const juce::int64 savedSequence = projectState->getJournalSequence();
     
-    // Save XML to file
-    juce::FileOutputStream outputStream(file);
-    if (outputStream.openedOk())
+    // Save in the chunked binary format; older XML projects are converted on save
+    if (ProjectFile::write(file, *xml))
     {
-        xml->writeTo(outputStream);
+        projectFile = file;
+        unsavedChanges = false;
         
-        if (outputStream.getStatus().wasOk())
-        {
-            projectFile = file;
-            unsavedChanges = false;
-            
-            // Update project name from filename
-            projectName = file.getFileNameWithoutExtension();
-            
-            // Notify listeners
-            changeNotifier.sendChangeMessage();
-            
-            return true;
-        }
+        // Update project name from filename
+        projectName = file.getFileNameWithoutExtension();
+        
+        attachJournal(savedSequence);
+        
+        // Notify listeners
+        changeNotifier.sendChangeMessage();
+        
+        return true;
     }
     
     return false;
@@ -106,33 +111,111 @@ bool ProjectManager::loadProject(const juce::File& file)
         // For now, we'll just assume they don't want to save
     }
     
-    // Load XML from file
-    std::unique_ptr<juce::XmlElement> xml = juce::XmlDocument::parse(file);
+    // Sections of binary projects are decoded when they are first used
+    std::unique_ptr<ProjectState> newState = ProjectIOService::readProject(file, false);
     
-    if (xml != nullptr)
+    if (newState != nullptr)
     {
-        // Create a new project state
-        std::unique_ptr<ProjectState> newState = std::make_unique<ProjectState>();
+        // Replay edits a crash kept out of the project file
+        const juce::int64 savedSequence = newState->getJournalSequence();
+        ProjectJournal::recover(file, *newState);
         
-        // Restore from XML
-        if (newState->restoreFromXml(xml.get()))
-        {
-            // Update project state
-            projectState = std::move(newState);
-            projectFile = file;
-            projectName = file.getFileNameWithoutExtension();
-            unsavedChanges = false;
-            
-            // Notify listeners
-            changeNotifier.sendChangeMessage();
-            
-            return true;
-        }
+        // Update project state
+        projectState = std::move(newState);
+        projectFile = file;
+        projectName = file.getFileNameWithoutExtension();
+        unsavedChanges = false;
+        
+        // The previous project's pending edits stay in its own journal
+        journal.close();
+        attachJournal(savedSequence);
+        
+        // Notify listeners
+        changeNotifier.sendChangeMessage();
+        
+        return true;
     }
     
     return false;
 }
 
+void ProjectManager::saveProjectAsync(const juce::File& file)
+{
+    // The snapshot is a private copy, so editing can continue during the write
+    std::shared_ptr<const juce::XmlElement> snapshot = projectState->createXml();
+    ProjectState* savedState = projectState.get();
+    const juce::int64 savedSequence = projectState->getJournalSequence();
+    
+    // Edits made from here on mark the project modified again
+    projectState->setModified(false);
+    
+    ioService.saveAsync(file, std::move(snapshot), [this, file, savedState, savedSequence](ProjectIOService::Outcome outcome) {
+        // Ignore saves of a project that has since been replaced
+        if (projectState.get() != savedState)
+        {
+            return;
+        }
+        
+        if (outcome != ProjectIOService::Outcome::Succeeded)
+        {
+            projectState->setModified(true);
+            return;
+        }
+        
+        projectFile = file;
+        unsavedChanges = false;
+        projectName = file.getFileNameWithoutExtension();
+        
+        // The file now holds every entry up to the snapshot
+        attachJournal(savedSequence);
+        
+        // Notify listeners
+        changeNotifier.sendChangeMessage();
+    });
+}
+
+void ProjectManager::loadProjectAsync(const juce::File& file)
+{
+    ioService.loadAsync(file, [this, file](ProjectIOService::Outcome outcome, std::unique_ptr<ProjectState> newState) {
+        if (outcome != ProjectIOService::Outcome::Succeeded || newState == nullptr)
+        {
+            return;
+        }
+        
+        // Replay edits a crash kept out of the project file
+        const juce::int64 savedSequence = newState->getJournalSequence();
+        ProjectJournal::recover(file, *newState);
+        
+        // Swap in the fully loaded project in one step
+        projectState = std::move(newState);
+        projectFile = file;
+        projectName = file.getFileNameWithoutExtension();
+        unsavedChanges = false;
+        
+        // The previous project's pending edits stay in its own journal
+        journal.close();
+        attachJournal(savedSequence);
+        
+        // Notify listeners
+        changeNotifier.sendChangeMessage();
+    });
+}
+
+void ProjectManager::cancelProjectIO()
+{
+    ioService.cancelAll();
+}
+
+bool ProjectManager::isProjectIOBusy() const
+{
+    return ioService.isBusy();
+}
+
+double ProjectManager::getProjectIOProgress() const
+{
+    return ioService.getProgress();
+}
+
 ProjectState& ProjectManager::getProjectState()
 {
     return *projectState;
@@ -153,6 +236,19 @@ juce::String ProjectManager::getProjectName() const
     return projectName;
 }
 
+void ProjectManager::attachJournal(juce::int64 savedSequence)
+{
+    // Without a journal the project still saves normally, just without autosave
+    if (journal.open(projectFile, projectState->getJournalId(), savedSequence))
+    {
+        projectState->setJournal(&journal);
+    }
+    else
+    {
+        projectState->setJournal(nullptr);
+    }
+}
+
 void ProjectManager::addListener(juce::ChangeListener* listener)
 {
     changeNotifier.addChangeListener(listener);
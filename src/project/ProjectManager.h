@@ -8,6 +8,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ProjectIOService.h"
+#include "ProjectJournal.h"
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -41,10 +44,27 @@ public:
     bool createNewProject(const juce::String& name, double sampleRate = 44100.0);
     
     /**
-     * @brief Save the current project
+     * @brief Asks the user where to save, then calls back with the chosen file
+     * 
+     * The callback is given an empty File if the user cancels.
+     */
+    using SaveLocationChooser = std::function<void(std::function<void(const juce::File&)>)>;
+    
+    /**
+     * @brief Set how saveProject() asks for a filename
+     * 
+     * The project manager has no user interface of its own; the application
+     * supplies one (e.g. a juce::FileChooser).
+     * 
+     * @param chooser The chooser, or nullptr to disable prompting
+     */
+    void setSaveLocationChooser(SaveLocationChooser chooser);
+    
+    /**
+     * @brief Save the current project in the background
      * 
      * @param saveAs Whether to prompt for a new filename
-     * @return true if successful
+     * @return true if the save was started, false if a filename is needed and no chooser is set
      */
     bool saveProject(bool saveAs = false);
     
@@ -64,6 +84,41 @@ public:
      */
     bool loadProject(const juce::File& file);
     
+    /**
+     * @brief Save the current project to a file in the background
+     * 
+     * The project is snapshotted immediately, so it can be edited while the
+     * file is written. Listeners are notified when the save completes.
+     * 
+     * @param file The file to save to
+     */
+    void saveProjectAsync(const juce::File& file);
+    
+    /**
+     * @brief Load a project from a file in the background
+     * 
+     * The current project stays in use until the new one is fully loaded,
+     * then the two are swapped and listeners are notified.
+     * 
+     * @param file The file to load from
+     */
+    void loadProjectAsync(const juce::File& file);
+    
+    /**
+     * @brief Cancel any background load or save
+     */
+    void cancelProjectIO();
+    
+    /**
+     * @brief Check whether a background load or save is in progress
+     */
+    bool isProjectIOBusy() const;
+    
+    /**
+     * @brief Get the progress of the running background load or save, from 0 to 1
+     */
+    double getProjectIOProgress() const;
+    
     /**
      * @brief Get the current project state
      * 
@@ -113,6 +168,16 @@ private:
     bool unsavedChanges;
     
     juce::ChangeBroadcaster changeNotifier;
+    SaveLocationChooser saveLocationChooser;
+    
+    // Completion callbacks only run on the message thread, so none can fire during destruction
+    ProjectIOService ioService;
+    
+    // Records edits for autosave; compacts through ioService
+    ProjectJournal journal { ioService };
+    
+    // Journal edits to the current project file, which contains entries up to savedSequence
+    void attachJournal(juce::int64 savedSequence);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectManager)
 };
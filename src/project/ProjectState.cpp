@@ -4,6 +4,7 @@
  */
 
 #include "ProjectState.h"
+#include <algorithm>
 
 namespace UndergroundBeats {
 
@@ -29,12 +30,17 @@ ProjectState::~ProjectState()
 
 void ProjectState::initializeDefault(const juce::String& name, double sampleRate)
 {
+    discardProjectFile();
+    
     // Set up new project data
     projectData = std::make_unique<juce::XmlElement>("UndergroundBeatsProject");
     
     // Add version attribute
     projectData->setAttribute("version", "1.0");
     
+    // Journals are tagged with this, so one never replays into another project
+    projectData->setAttribute("journalId", juce::Uuid().toString());
+    
     // Update settings
     settings.name = name;
     settings.sampleRate = sampleRate;
@@ -80,14 +86,43 @@ void ProjectState::setSettings(const ProjectSettings& newSettings)
         settingsXml->setAttribute("timeSignatureDenominator", settings.timeSignatureDenominator);
         settingsXml->setAttribute("snapToGrid", settings.snapToGrid);
         settingsXml->setAttribute("snapDivision", settings.snapDivision);
+        
+        recordEdit(ProjectJournal::Operation::SetSettings, -1, *settingsXml);
     }
     
     // Mark as modified
     modified = true;
 }
 
+bool ProjectState::restoreSettingsFromXml(const juce::XmlElement* settingsXml)
+{
+    if (settingsXml == nullptr || settingsXml->getTagName() != "Settings")
+    {
+        return false;
+    }
+    
+    ProjectSettings newSettings;
+    newSettings.name = settingsXml->getStringAttribute("name", "Untitled");
+    newSettings.sampleRate = settingsXml->getDoubleAttribute("sampleRate", 44100.0);
+    newSettings.bitsPerSample = settingsXml->getIntAttribute("bitsPerSample", 24);
+    newSettings.tempo = settingsXml->getIntAttribute("tempo", 120);
+    newSettings.timeSignatureNumerator = settingsXml->getIntAttribute("timeSignatureNumerator", 4);
+    newSettings.timeSignatureDenominator = settingsXml->getIntAttribute("timeSignatureDenominator", 4);
+    newSettings.snapToGrid = settingsXml->getBoolAttribute("snapToGrid", true);
+    newSettings.snapDivision = settingsXml->getIntAttribute("snapDivision", 16);
+    
+    setSettings(newSettings);
+    
+    return true;
+}
+
 std::unique_ptr<juce::XmlElement> ProjectState::createXml() const
 {
+    loadSection(ProjectFile::ChunkType::Track);
+    loadSection(ProjectFile::ChunkType::Pattern);
+    loadSection(ProjectFile::ChunkType::Instrument);
+    loadSection(ProjectFile::ChunkType::Effect);
+    
     // Create a copy of the project data
     return std::make_unique<juce::XmlElement>(*projectData);
 }
@@ -100,6 +135,8 @@ bool ProjectState::restoreFromXml(const juce::XmlElement* xml)
         return false;
     }
     
+    discardProjectFile();
+    
     // Copy the XML data
     projectData = std::make_unique<juce::XmlElement>(*xml);
     
@@ -116,6 +153,12 @@ bool ProjectState::restoreFromXml(const juce::XmlElement* xml)
         settings.snapDivision = settingsXml->getIntAttribute("snapDivision", 16);
     }
     
+    // Projects saved before journaling have no identifier yet
+    if (!projectData->hasAttribute("journalId"))
+    {
+        projectData->setAttribute("journalId", juce::Uuid().toString());
+    }
+    
     // Ensure required sections exist
     if (!projectData->getChildByName("Tracks"))
     {
@@ -143,6 +186,39 @@ bool ProjectState::restoreFromXml(const juce::XmlElement* xml)
     return true;
 }
 
+bool ProjectState::restoreFromProjectFile(std::unique_ptr<ProjectFile> file)
+{
+    if (file == nullptr || !file->isOpen())
+    {
+        return false;
+    }
+    
+    const auto rootChunks = file->getChunksOfType(ProjectFile::ChunkType::Root);
+    
+    if (rootChunks.size() != 1)
+    {
+        return false;
+    }
+    
+    std::unique_ptr<juce::XmlElement> root = file->readChunk(rootChunks.front());
+    
+    if (!restoreFromXml(root.get()))
+    {
+        return false;
+    }
+    
+    // The root holds the sections as empty elements; fill them in on demand
+    lazyFile = std::move(file);
+    pendingSections = {
+        ProjectFile::ChunkType::Track,
+        ProjectFile::ChunkType::Pattern,
+        ProjectFile::ChunkType::Instrument,
+        ProjectFile::ChunkType::Effect
+    };
+    
+    return true;
+}
+
 void ProjectState::setModified(bool isModified)
 {
     modified = isModified;
@@ -155,6 +231,8 @@ bool ProjectState::isModified() const
 
 bool ProjectState::addPattern(const juce::XmlElement* patternXml)
 {
+    loadSection(ProjectFile::ChunkType::Pattern);
+    
     if (patternXml == nullptr || patternXml->getTagName() != "Pattern")
     {
         return false;
@@ -166,6 +244,8 @@ bool ProjectState::addPattern(const juce::XmlElement* patternXml)
         // Add a copy of the pattern
         patternsXml->addChildElement(new juce::XmlElement(*patternXml));
         
+        recordEdit(ProjectJournal::Operation::AddPattern, -1, *patternXml);
+        
         // Mark as modified
         modified = true;
         
@@ -177,6 +257,8 @@ bool ProjectState::addPattern(const juce::XmlElement* patternXml)
 
 juce::Array<juce::XmlElement*> ProjectState::getPatterns() const
 {
+    loadSection(ProjectFile::ChunkType::Pattern);
+    
     juce::Array<juce::XmlElement*> patterns;
     
     if (auto* patternsXml = projectData->getChildByName("Patterns"))
@@ -193,8 +275,27 @@ juce::Array<juce::XmlElement*> ProjectState::getPatterns() const
     return patterns;
 }
 
+bool ProjectState::updatePattern(int index, const juce::XmlElement* patternXml)
+{
+    loadSection(ProjectFile::ChunkType::Pattern);
+    
+    if (!replaceElement("Patterns", "Pattern", index, patternXml))
+    {
+        return false;
+    }
+    
+    recordEdit(ProjectJournal::Operation::UpdatePattern, index, *patternXml);
+    
+    // Mark as modified
+    modified = true;
+    
+    return true;
+}
+
 bool ProjectState::addTrack(const juce::XmlElement* trackXml)
 {
+    loadSection(ProjectFile::ChunkType::Track);
+    
     if (trackXml == nullptr || trackXml->getTagName() != "Track")
     {
         return false;
@@ -206,6 +307,8 @@ bool ProjectState::addTrack(const juce::XmlElement* trackXml)
         // Add a copy of the track
         tracksXml->addChildElement(new juce::XmlElement(*trackXml));
         
+        recordEdit(ProjectJournal::Operation::AddTrack, -1, *trackXml);
+        
         // Mark as modified
         modified = true;
         
@@ -217,6 +320,8 @@ bool ProjectState::addTrack(const juce::XmlElement* trackXml)
 
 juce::Array<juce::XmlElement*> ProjectState::getTracks() const
 {
+    loadSection(ProjectFile::ChunkType::Track);
+    
     juce::Array<juce::XmlElement*> tracks;
     
     if (auto* tracksXml = projectData->getChildByName("Tracks"))
@@ -233,4 +338,152 @@ juce::Array<juce::XmlElement*> ProjectState::getTracks() const
     return tracks;
 }
 
+bool ProjectState::loadAllSections(const ProjectFile::ProgressCallback& progress)
+{
+    if (lazyFile == nullptr)
+    {
+        return true;
+    }
+    
+    int totalChunks = 0;
+    
+    for (auto type : pendingSections)
+    {
+        totalChunks += static_cast<int>(lazyFile->getChunksOfType(type).size());
+    }
+    
+    int chunksDone = 0;
+    
+    while (lazyFile != nullptr && !pendingSections.empty())
+    {
+        if (!decodeSection(pendingSections.front(), progress, chunksDone, totalChunks))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool ProjectState::updateTrack(int index, const juce::XmlElement* trackXml)
+{
+    loadSection(ProjectFile::ChunkType::Track);
+    
+    if (!replaceElement("Tracks", "Track", index, trackXml))
+    {
+        return false;
+    }
+    
+    recordEdit(ProjectJournal::Operation::UpdateTrack, index, *trackXml);
+    
+    // Mark as modified
+    modified = true;
+    
+    return true;
+}
+
+void ProjectState::setJournal(ProjectJournal* journalToUse)
+{
+    journal = journalToUse;
+}
+
+juce::String ProjectState::getJournalId() const
+{
+    return projectData->getStringAttribute("journalId");
+}
+
+juce::int64 ProjectState::getJournalSequence() const
+{
+    return projectData->getStringAttribute("journalSequence", "0").getLargeIntValue();
+}
+
+void ProjectState::setJournalSequence(juce::int64 sequence)
+{
+    projectData->setAttribute("journalSequence", juce::String(sequence));
+}
+
+void ProjectState::loadSection(ProjectFile::ChunkType type) const
+{
+    int chunksDone = 0;
+    decodeSection(type, nullptr, chunksDone, 0);
+}
+
+bool ProjectState::decodeSection(ProjectFile::ChunkType type, const ProjectFile::ProgressCallback& progress,
+                                 int& chunksDone, int totalChunks) const
+{
+    auto pending = std::find(pendingSections.begin(), pendingSections.end(), type);
+    
+    if (pending == pendingSections.end())
+    {
+        return true;
+    }
+    
+    pendingSections.erase(pending);
+    
+    if (auto* sectionXml = projectData->getChildByName(ProjectFile::getSectionName(type)))
+    {
+        for (int index : lazyFile->getChunksOfType(type))
+        {
+            if (progress && !progress(totalChunks > 0 ? static_cast<double>(chunksDone) / totalChunks : 0.0))
+            {
+                return false;
+            }
+            
+            ++chunksDone;
+            
+            // A damaged chunk loses that element only
+            if (auto element = lazyFile->readChunk(index))
+            {
+                sectionXml->addChildElement(element.release());
+            }
+        }
+    }
+    
+    // Everything is decoded, so the mapping is no longer needed
+    if (pendingSections.empty())
+    {
+        lazyFile.reset();
+    }
+    
+    return true;
+}
+
+void ProjectState::discardProjectFile()
+{
+    pendingSections.clear();
+    lazyFile.reset();
+}
+
+bool ProjectState::replaceElement(const juce::String& sectionName, const juce::String& tagName,
+                                  int index, const juce::XmlElement* elementXml)
+{
+    if (elementXml == nullptr || elementXml->getTagName() != tagName || index < 0)
+    {
+        return false;
+    }
+    
+    if (auto* sectionXml = projectData->getChildByName(sectionName))
+    {
+        int position = 0;
+        
+        for (auto* child : sectionXml->getChildIterator())
+        {
+            if (child->getTagName() == tagName && position++ == index)
+            {
+                return sectionXml->replaceChildElement(child, new juce::XmlElement(*elementXml));
+            }
+        }
+    }
+    
+    return false;
+}
+
+void ProjectState::recordEdit(ProjectJournal::Operation operation, int index, const juce::XmlElement& element)
+{
+    if (journal != nullptr)
+    {
+        setJournalSequence(journal->append(operation, index, element));
+    }
+}
+
 } // namespace UndergroundBeats
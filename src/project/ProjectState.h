@@ -8,6 +8,8 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ProjectFile.h"
+#include "ProjectJournal.h"
 #include <memory>
 #include <vector>
 #include <string>
@@ -38,6 +40,14 @@ struct ProjectSettings
  * patterns, tracks, instruments, effects, and project settings.
  * It provides methods for serializing and deserializing the
  * project data to/from XML.
+ * 
+ * When restored from a binary project file, the track, pattern, instrument
+ * and effect sections are decoded from the file the first time they are
+ * accessed, and the file is released once all of them have been.
+ * 
+ * With a journal attached, every edit made through this class is also
+ * appended to the journal, and the project records the sequence number of
+ * the last edit it contains so journal entries are never applied twice.
  */
 class ProjectState
 {
@@ -67,6 +77,14 @@ public:
      */
     void setSettings(const ProjectSettings& newSettings);
     
+    /**
+     * @brief Set the project settings from a Settings element
+     * 
+     * @param settingsXml XML element containing the settings
+     * @return true if successful
+     */
+    bool restoreSettingsFromXml(const juce::XmlElement* settingsXml);
+    
     /**
      * @brief Create an XML element representing the project state
      * 
@@ -82,6 +100,27 @@ public:
      */
     bool restoreFromXml(const juce::XmlElement* xml);
     
+    /**
+     * @brief Restore the project state from an open binary project file
+     * 
+     * Only the root chunk is decoded here; the sections follow on demand.
+     * 
+     * @param file The open project file, kept until every section is decoded
+     * @return true if successful
+     */
+    bool restoreFromProjectFile(std::unique_ptr<ProjectFile> file);
+    
+    /**
+     * @brief Decode every section still pending in the binary project file
+     * 
+     * Lets a background loader finish all decoding before the state is used.
+     * A cancelled load leaves the state incomplete, so it should be discarded.
+     * 
+     * @param progress Optional callback, called before each chunk
+     * @return true if every section was decoded, false if cancelled
+     */
+    bool loadAllSections(const ProjectFile::ProgressCallback& progress = nullptr);
+    
     /**
      * @brief Mark the project as modified or unmodified
      * 
@@ -111,6 +150,15 @@ public:
      */
     juce::Array<juce::XmlElement*> getPatterns() const;
     
+    /**
+     * @brief Replace a pattern in the project
+     * 
+     * @param index The index of the pattern, as returned by getPatterns()
+     * @param patternXml XML element containing the new pattern data
+     * @return true if successful
+     */
+    bool updatePattern(int index, const juce::XmlElement* patternXml);
+    
     /**
      * @brief Add a track to the project
      * 
@@ -126,11 +174,67 @@ public:
      */
     juce::Array<juce::XmlElement*> getTracks() const;
     
+    /**
+     * @brief Replace a track in the project
+     * 
+     * @param index The index of the track, as returned by getTracks()
+     * @param trackXml XML element containing the new track data
+     * @return true if successful
+     */
+    bool updateTrack(int index, const juce::XmlElement* trackXml);
+    
+    /**
+     * @brief Set the journal edits are recorded in
+     * 
+     * @param journalToUse The journal, or nullptr to stop recording
+     */
+    void setJournal(ProjectJournal* journalToUse);
+    
+    /**
+     * @brief Get the identifier journals of this project are tagged with
+     * 
+     * @return The identifier, kept across saves and loads
+     */
+    juce::String getJournalId() const;
+    
+    /**
+     * @brief Get the sequence number of the last journal entry the project contains
+     */
+    juce::int64 getJournalSequence() const;
+    
+    /**
+     * @brief Set the sequence number of the last journal entry the project contains
+     */
+    void setJournalSequence(juce::int64 sequence);
+    
 private:
     ProjectSettings settings;
     std::unique_ptr<juce::XmlElement> projectData;
     bool modified;
     
+    // Binary file the sections below are still to be decoded from
+    mutable std::unique_ptr<ProjectFile> lazyFile;
+    mutable std::vector<ProjectFile::ChunkType> pendingSections;
+    
+    // Decode a section from the binary file if it has not been yet
+    void loadSection(ProjectFile::ChunkType type) const;
+    
+    // Decode a pending section, reporting progress over all pending chunks
+    bool decodeSection(ProjectFile::ChunkType type, const ProjectFile::ProgressCallback& progress,
+                       int& chunksDone, int totalChunks) const;
+    
+    // Drop any sections still pending in the binary file
+    void discardProjectFile();
+    
+    // Replace the child of a section with the given tag at an index
+    bool replaceElement(const juce::String& sectionName, const juce::String& tagName,
+                        int index, const juce::XmlElement* elementXml);
+    
+    // Append an edit to the journal, if there is one
+    void recordEdit(ProjectJournal::Operation operation, int index, const juce::XmlElement& element);
+    
+    ProjectJournal* journal = nullptr;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectState)
 };
 
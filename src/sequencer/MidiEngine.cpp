@@ -6,18 +6,64 @@
  */
 
 #include "MidiEngine.h"
+#include <algorithm>
+#include <cmath>
 
 namespace UndergroundBeats {
 
+//==============================================================================
+// Thread that passes scheduled messages from the audio thread to the device
+//==============================================================================
+
+class MidiEngine::OutputThread : public juce::Thread {
+public:
+    explicit OutputThread(MidiEngine& ownerToUse)
+        : juce::Thread("MIDI output")
+        , owner(ownerToUse)
+        , messagesQueued(0)
+    {
+    }
+    
+    // Lock-free, so the audio thread can call it
+    void wake() noexcept
+    {
+        messagesQueued.notify();
+    }
+    
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            // The device schedules the send times, so this only has to keep the queue moving
+            if (!owner.sendQueuedMessages())
+            {
+                messagesQueued.wait();
+            }
+        }
+    }
+    
+private:
+    MidiEngine& owner;
+    
+    // Messages arrive at most once per audio block, so sleep rather than spin
+    Concurrency::WakeSignal messagesQueued;
+};
+
+//==============================================================================
+
 MidiEngine::MidiEngine()
 {
-    // Start a timer to handle MIDI processing
-    startTimer(10); // 10ms timer interval for low latency
+    scheduledMessages.ensureSize(1024 * 3);
+    
+    outputThread = std::make_unique<OutputThread>(*this);
+    outputThread->startThread(juce::Thread::Priority::highest);
 }
 
 MidiEngine::~MidiEngine()
 {
-    stopTimer();
+    outputThread->signalThreadShouldExit();
+    outputThread->wake();
+    outputThread->stopThread(1000);
     
     // Clean up MIDI devices
     midiInput.reset();
@@ -88,6 +134,8 @@ bool MidiEngine::setInputDevice(const std::string& deviceName)
 
 bool MidiEngine::setOutputDevice(const std::string& deviceName)
 {
+    juce::ScopedLock lock(outputLock);
+    
     // Close any existing device
     midiOutput.reset();
     
@@ -103,6 +151,8 @@ bool MidiEngine::setOutputDevice(const std::string& deviceName)
             
             if (midiOutput != nullptr)
             {
+                // The device's own thread sends scheduled blocks on time
+                midiOutput->startBackgroundThread();
                 currentOutputDeviceName = deviceName;
                 return true;
             }
@@ -124,16 +174,68 @@ std::string MidiEngine::getOutputDeviceName() const
 
 void MidiEngine::sendMessageNow(const juce::MidiMessage& message)
 {
+    juce::ScopedLock lock(outputLock);
+    
     if (midiOutput != nullptr)
     {
         midiOutput->sendMessageNow(message);
     }
 }
 
-void MidiEngine::processMidiBuffer(const juce::MidiBuffer& midiBuffer)
+void MidiEngine::processMidiBuffer(const juce::MidiBuffer& midiBuffer, int numSamples, double sampleRate)
 {
-    // Add to outgoing messages
-    outgoingMessages.addEvents(midiBuffer, 0, -1, 0);
+    if (numSamples <= 0 || sampleRate <= 0.0)
+    {
+        return;
+    }
+    
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    const double blockMs = numSamples * 1000.0 / sampleRate;
+    
+    // Advance by exactly one block so callback jitter does not reach the
+    // output; resynchronise after a stall or when the clocks drift apart
+    double blockStart = nextBlockTime;
+    
+    if (std::abs(blockStart - now) > 2.0 * blockMs)
+    {
+        blockStart = now;
+    }
+    
+    nextBlockTime = blockStart + blockMs;
+    
+    if (midiBuffer.isEmpty())
+    {
+        return;
+    }
+    
+    const double startTime = blockStart + outputLatencyMs.load(std::memory_order_relaxed);
+    bool queued = false;
+    
+    for (const auto metadata : midiBuffer)
+    {
+        if (metadata.numBytes <= 0 || metadata.numBytes > 3)
+        {
+            continue;
+        }
+        
+        OutgoingMessage outgoing;
+        outgoing.sendTime = startTime + metadata.samplePosition * 1000.0 / sampleRate;
+        outgoing.size = static_cast<juce::uint8>(metadata.numBytes);
+        std::copy(metadata.data, metadata.data + metadata.numBytes, outgoing.data);
+        
+        // Dropped if the output thread has fallen a whole queue behind
+        queued = outgoingMessages.push(outgoing) || queued;
+    }
+    
+    if (queued)
+    {
+        outputThread->wake();
+    }
+}
+
+void MidiEngine::setOutputLatency(double seconds)
+{
+    outputLatencyMs.store(juce::jmax(0.0, seconds * 1000.0), std::memory_order_relaxed);
 }
 
 void MidiEngine::setMidiInputCallback(std::function<void(const juce::MidiMessage&)> callback)
@@ -176,43 +278,89 @@ bool MidiEngine::restoreStateFromXml(const juce::XmlElement* xml)
     return true;
 }
 
+void MidiEngine::readIncomingMessages(juce::MidiBuffer& midiBuffer, int numSamples, double sampleRate)
+{
+    if (numSamples <= 0 || sampleRate <= 0.0)
+    {
+        return;
+    }
+    
+    const double now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+    
+    // The block stands for the time since the last read, capped at one block;
+    // the first block and any block after a stall look back a single block
+    const double blockStart = juce::jmax(lastReadTime, now - numSamples / sampleRate);
+    lastReadTime = now;
+    
+    IncomingMessage incoming;
+    
+    while (incomingMessages.pop(incoming))
+    {
+        const int offset = juce::jlimit(0, numSamples - 1,
+                                        juce::roundToInt((incoming.timestamp - blockStart) * sampleRate));
+        
+        midiBuffer.addEvent(incoming.data, incoming.size, offset);
+    }
+}
+
 void MidiEngine::handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message)
 {
-    // Add the message to the incoming queue
-    juce::MidiBuffer buffer;
-    buffer.addEvent(message, 0);
+    juce::ignoreUnused(source);
     
+    const int size = message.getRawDataSize();
+    
+    if (size > 0 && size <= 3)
     {
-        juce::ScopedLock lock(midiCallbackLock);
-        incomingMessages.addEvents(buffer, 0, -1, 0);
+        // MidiInput stamps messages with the high-resolution clock on arrival
+        IncomingMessage incoming;
+        incoming.timestamp = message.getTimeStamp() > 0.0 ? message.getTimeStamp()
+                                                          : juce::Time::getMillisecondCounterHiRes() * 0.001;
+        incoming.size = static_cast<juce::uint8>(size);
+        std::copy(message.getRawData(), message.getRawData() + size, incoming.data);
+        
+        // Dropped if the audio thread is not draining the queue
+        incomingMessages.push(incoming);
     }
     
     // Call the callback if set
+    juce::ScopedLock lock(midiCallbackLock);
+    
     if (midiInputCallback)
     {
         midiInputCallback(message);
     }
 }
 
-void MidiEngine::timerCallback()
+bool MidiEngine::sendQueuedMessages()
 {
-    // Send any outgoing messages
-    if (midiOutput != nullptr && !outgoingMessages.isEmpty())
+    OutgoingMessage outgoing;
+    
+    if (!outgoingMessages.pop(outgoing))
     {
-        for (const auto metadata : outgoingMessages)
-        {
-            const auto message = metadata.getMessage();
-            midiOutput->sendMessageNow(message);
-        }
-        
-        outgoingMessages.clear();
+        return false;
     }
     
-    // Clear incoming messages buffer as it's been processed
+    // Send everything queued as one block, positioned in microseconds from the first message
+    const double blockStart = outgoing.sendTime;
+    constexpr double positionsPerSecond = 1000000.0;
+    
+    scheduledMessages.clear();
+    
+    do
     {
-        juce::ScopedLock lock(midiCallbackLock);
-        incomingMessages.clear();
+        const double position = (outgoing.sendTime - blockStart) * positionsPerSecond / 1000.0;
+        scheduledMessages.addEvent(outgoing.data, outgoing.size, juce::jmax(0, juce::roundToInt(position)));
     }
+    while (outgoingMessages.pop(outgoing));
+    
+    juce::ScopedLock lock(outputLock);
+    
+    if (midiOutput != nullptr)
+    {
+        midiOutput->sendBlockOfMessages(scheduledMessages, blockStart, positionsPerSecond);
+    }
+    
+    return true;
 }
 
 void MidiEngine::refreshDeviceLists()
@@ -8,6 +8,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "../utils/Concurrency.h"
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 #include <functional>
@@ -20,9 +23,17 @@ namespace UndergroundBeats {
  * 
  * The MidiEngine class manages MIDI devices, handling input and output
  * of MIDI messages, device selection, and MIDI routing.
+ * 
+ * Incoming short messages are stamped with the high-resolution clock and
+ * queued without locks or allocations; the audio callback collects them with
+ * readIncomingMessages(), which places each one at a sample offset in the
+ * block according to when it arrived.
+ * 
+ * Outgoing messages take the opposite path: the audio callback stamps them
+ * with the time their sample position will be heard and queues them, and a
+ * dedicated output thread hands them to the device with scheduled send times.
  */
-class MidiEngine : private juce::MidiInputCallback,
-                  private juce::Timer {
+class MidiEngine : private juce::MidiInputCallback {
 public:
     MidiEngine();
     ~MidiEngine();
@@ -86,11 +97,27 @@ public:
     void sendMessageNow(const juce::MidiMessage& message);
     
     /**
-     * @brief Process MIDI messages
+     * @brief Schedule a block of MIDI messages for the output device (audio thread)
+     * 
+     * Each message is sent when its sample position will be heard, measured
+     * from a clock that advances by exactly one block per call. SysEx is not
+     * scheduled; send it with sendMessageNow().
+     * 
+     * @param midiBuffer The block's MIDI messages
+     * @param numSamples The number of samples in the block
+     * @param sampleRate The sample rate in Hz
+     */
+    void processMidiBuffer(const juce::MidiBuffer& midiBuffer, int numSamples, double sampleRate);
+    
+    /**
+     * @brief Set how far ahead of the audio callback the output is heard
+     * 
+     * Outgoing MIDI is delayed by this amount so external gear lines up with
+     * the audio, e.g. the audio device's output latency.
      * 
-     * @param midiBuffer The buffer of MIDI messages to process
+     * @param seconds The latency in seconds
      */
-    void processMidiBuffer(const juce::MidiBuffer& midiBuffer);
+    void setOutputLatency(double seconds);
     
     /**
      * @brief Set a callback function for incoming MIDI messages
@@ -99,6 +126,20 @@ public:
      */
     void setMidiInputCallback(std::function<void(const juce::MidiMessage&)> callback);
     
+    /**
+     * @brief Move incoming MIDI messages into a block (audio thread)
+     * 
+     * Messages are placed one block after they arrived, so the spacing between
+     * them is kept exactly instead of being quantised to the block size.
+     * Messages that waited longer (e.g. after the audio stalled) go at the
+     * start of the block. SysEx is only delivered to the input callback.
+     * 
+     * @param midiBuffer The buffer to add the messages to
+     * @param numSamples The number of samples in the block
+     * @param sampleRate The sample rate in Hz
+     */
+    void readIncomingMessages(juce::MidiBuffer& midiBuffer, int numSamples, double sampleRate);
+    
     /**
      * @brief Create an XML element containing the MIDI engine's state
      * 
@@ -118,8 +159,24 @@ private:
     // MidiInputCallback implementation
     void handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message) override;
     
-    // Timer implementation
-    void timerCallback() override;
+    // A short message and the time it arrived, in seconds on the high-resolution clock
+    struct IncomingMessage {
+        double timestamp;
+        juce::uint8 data[3];
+        juce::uint8 size;
+    };
+    
+    // A short message and when to send it, in milliseconds on the high-resolution clock
+    struct OutgoingMessage {
+        double sendTime;
+        juce::uint8 data[3];
+        juce::uint8 size;
+    };
+    
+    class OutputThread;
+    
+    // Hand queued outgoing messages to the device (output thread)
+    bool sendQueuedMessages();
     
     // Refresh the list of available devices
     void refreshDeviceLists();
@@ -133,8 +190,23 @@ private:
     juce::CriticalSection midiCallbackLock;
     std::function<void(const juce::MidiMessage&)> midiInputCallback;
     
-    juce::MidiBuffer incomingMessages;
-    juce::MidiBuffer outgoingMessages;
+    // Filled by the MIDI input thread, drained by the audio thread
+    Concurrency::LockFreeQueue<IncomingMessage, 1024> incomingMessages;
+    
+    // End of the last block read by the audio thread, on the same clock
+    double lastReadTime = 0.0;
+    
+    // Filled by the audio thread, drained by the output thread
+    Concurrency::LockFreeQueue<OutgoingMessage, 1024> outgoingMessages;
+    
+    // Start of the next block on the output clock, in milliseconds (audio thread)
+    double nextBlockTime = 0.0;
+    std::atomic<double> outputLatencyMs { 0.0 };
+    
+    // Guards midiOutput between the message and output threads
+    juce::CriticalSection outputLock;
+    juce::MidiBuffer scheduledMessages;
+    std::unique_ptr<OutputThread> outputThread;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiEngine)
 };
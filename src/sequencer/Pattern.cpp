@@ -6,6 +6,7 @@
  */
 
 #include "Pattern.h"
+#include "PatternCodec.h"
 #include <algorithm>
 
 namespace UndergroundBeats {
@@ -13,9 +14,17 @@ namespace UndergroundBeats {
 // Initialize static member
 const std::vector<AutomationPoint> Pattern::emptyAutomationPoints;
 
+namespace {
+
+// Attribute holding the notes and automation in PatternCodec's encoding
+const char* const packedDataAttribute = "base64:data";
+
+} // namespace
+
 Pattern::Pattern(const std::string& name, double lengthInBeats)
     : name(name)
-    , length(lengthInBeats)
+    , length(TimeBase::beatsToTicks(lengthInBeats))
+    , noteVersion(0)
 {
 }
 
@@ -37,93 +46,230 @@ void Pattern::setLength(double lengthInBeats)
 {
     if (lengthInBeats > 0.0)
     {
-        length = lengthInBeats;
+        length = std::max<Tick>(1, TimeBase::beatsToTicks(lengthInBeats));
+        ++noteVersion;
     }
 }
 
 double Pattern::getLength() const
+{
+    return TimeBase::ticksToBeats(length);
+}
+
+Tick Pattern::getLengthInTicks() const
 {
     return length;
 }
 
 int Pattern::addNote(int note, int velocity, double startTime, double duration)
 {
-    // Clamp MIDI note values
-    note = juce::jlimit(0, 127, note);
-    velocity = juce::jlimit(1, 127, velocity);
-    
-    // Ensure positive duration
-    duration = std::max(0.001, duration);
+    return addNote(NoteEvent::fromBeats(note, velocity, startTime, duration));
+}
+
+int Pattern::addNote(const NoteEvent& noteEvent)
+{
+    const NoteEvent clamped = clampNote(noteEvent);
     
-    // Add the note
-    notes.push_back({note, velocity, startTime, duration});
+    // Insert after any notes with the same start time
+    const int index = upperBound(clamped.startTick);
+    insertNoteAt(index, clamped);
+    ++noteVersion;
     
     // Return the index of the added note
-    return static_cast<int>(notes.size() - 1);
+    return index;
 }
 
-int Pattern::addNote(const NoteEvent& noteEvent)
+void Pattern::addNotes(const std::vector<NoteEvent>& noteEvents)
 {
-    // Copy the note event to ensure proper clamping
-    return addNote(noteEvent.note, noteEvent.velocity, noteEvent.startTime, noteEvent.duration);
+    if (noteEvents.empty())
+        return;
+    
+    std::vector<NoteEvent> added;
+    added.reserve(noteEvents.size());
+    
+    for (const auto& noteEvent : noteEvents)
+        added.push_back(clampNote(noteEvent));
+    
+    std::stable_sort(added.begin(), added.end(),
+                     [](const NoteEvent& a, const NoteEvent& b) {
+                         return a.startTick < b.startTick;
+                     });
+    
+    // Merge the existing notes and the new ones into fresh columns
+    NoteColumns merged;
+    const size_t total = notes.startTicks.size() + added.size();
+    merged.startTicks.reserve(total);
+    merged.durationTicks.reserve(total);
+    merged.pitches.reserve(total);
+    merged.velocities.reserve(total);
+    
+    int existing = 0;
+    size_t next = 0;
+    
+    while (existing < notes.size() || next < added.size())
+    {
+        // Existing notes go first when start times are equal
+        const bool takeExisting = next == added.size()
+            || (existing < notes.size() && notes.startTicks[static_cast<size_t>(existing)] <= added[next].startTick);
+        
+        const NoteEvent noteEvent = takeExisting ? notes.getNote(existing++) : added[next++];
+        
+        merged.startTicks.push_back(noteEvent.startTick);
+        merged.durationTicks.push_back(noteEvent.durationTicks);
+        merged.pitches.push_back(static_cast<juce::uint8>(noteEvent.note));
+        merged.velocities.push_back(static_cast<juce::uint8>(noteEvent.velocity));
+    }
+    
+    notes = std::move(merged);
+    ++noteVersion;
 }
 
 bool Pattern::editNote(int index, int note, int velocity, double startTime, double duration)
 {
-    if (index < 0 || index >= static_cast<int>(notes.size()))
+    if (index < 0 || index >= notes.size())
     {
         return false;
     }
     
-    // Clamp MIDI note values
-    note = juce::jlimit(0, 127, note);
-    velocity = juce::jlimit(1, 127, velocity);
+    const NoteEvent clamped = clampNote(NoteEvent::fromBeats(note, velocity, startTime, duration));
+    const auto i = static_cast<size_t>(index);
     
-    // Ensure positive duration
-    duration = std::max(0.001, duration);
+    if (clamped.startTick == notes.startTicks[i])
+    {
+        // Update the note in place
+        notes.pitches[i] = static_cast<juce::uint8>(clamped.note);
+        notes.velocities[i] = static_cast<juce::uint8>(clamped.velocity);
+        notes.durationTicks[i] = clamped.durationTicks;
+    }
+    else
+    {
+        // Move the note to its new place in the order
+        eraseNoteAt(index);
+        insertNoteAt(upperBound(clamped.startTick), clamped);
+    }
     
-    // Update the note
-    notes[index].note = note;
-    notes[index].velocity = velocity;
-    notes[index].startTime = startTime;
-    notes[index].duration = duration;
+    ++noteVersion;
     
     return true;
 }
 
 bool Pattern::removeNote(int index)
 {
-    if (index < 0 || index >= static_cast<int>(notes.size()))
+    if (index < 0 || index >= notes.size())
     {
         return false;
     }
     
     // Remove the note
-    notes.erase(notes.begin() + index);
+    eraseNoteAt(index);
+    ++noteVersion;
     
     return true;
 }
 
-const NoteEvent* Pattern::getNote(int index) const
+NoteEvent Pattern::getNote(int index) const
 {
-    if (index < 0 || index >= static_cast<int>(notes.size()))
+    if (index < 0 || index >= notes.size())
     {
-        return nullptr;
+        return NoteEvent();
     }
     
-    return &notes[index];
+    return notes.getNote(index);
 }
 
 int Pattern::getNumNotes() const
 {
-    return static_cast<int>(notes.size());
+    return notes.size();
+}
+
+std::vector<NoteEvent> Pattern::getNotes() const
+{
+    std::vector<NoteEvent> result;
+    result.reserve(notes.startTicks.size());
+    
+    for (int i = 0; i < notes.size(); ++i)
+        result.push_back(notes.getNote(i));
+    
+    return result;
 }
 
-const std::vector<NoteEvent>& Pattern::getNotes() const
+const NoteColumns& Pattern::getNoteColumns() const
 {
     return notes;
 }
 
+Pattern::NoteRange Pattern::findNotes(Tick startTick, Tick endTick, PlaybackCursor& cursor) const
+{
+    int begin;
+    
+    if (cursor.version == noteVersion && cursor.tick == startTick)
+    {
+        // Continuing straight on from the previous range
+        begin = cursor.position;
+    }
+    else
+    {
+        begin = lowerBound(startTick);
+    }
+    
+    const int end = endTick > startTick ? lowerBound(endTick, begin) : begin;
+    
+    cursor.position = end;
+    cursor.tick = endTick;
+    cursor.version = noteVersion;
+    
+    return { begin, end };
+}
+
+juce::uint32 Pattern::getNoteVersion() const
+{
+    return noteVersion;
+}
+
+int Pattern::upperBound(Tick tick) const
+{
+    const auto& starts = notes.startTicks;
+    return static_cast<int>(std::upper_bound(starts.begin(), starts.end(), tick) - starts.begin());
+}
+
+int Pattern::lowerBound(Tick tick, int first) const
+{
+    const auto& starts = notes.startTicks;
+    return static_cast<int>(std::lower_bound(starts.begin() + first, starts.end(), tick) - starts.begin());
+}
+
+void Pattern::insertNoteAt(int index, const NoteEvent& noteEvent)
+{
+    const auto i = static_cast<std::ptrdiff_t>(index);
+    notes.startTicks.insert(notes.startTicks.begin() + i, noteEvent.startTick);
+    notes.durationTicks.insert(notes.durationTicks.begin() + i, noteEvent.durationTicks);
+    notes.pitches.insert(notes.pitches.begin() + i, static_cast<juce::uint8>(noteEvent.note));
+    notes.velocities.insert(notes.velocities.begin() + i, static_cast<juce::uint8>(noteEvent.velocity));
+}
+
+void Pattern::eraseNoteAt(int index)
+{
+    const auto i = static_cast<std::ptrdiff_t>(index);
+    notes.startTicks.erase(notes.startTicks.begin() + i);
+    notes.durationTicks.erase(notes.durationTicks.begin() + i);
+    notes.pitches.erase(notes.pitches.begin() + i);
+    notes.velocities.erase(notes.velocities.begin() + i);
+}
+
+NoteEvent Pattern::clampNote(const NoteEvent& noteEvent)
+{
+    NoteEvent clamped = noteEvent;
+    
+    // Clamp MIDI note values
+    clamped.note = juce::jlimit(0, 127, noteEvent.note);
+    clamped.velocity = juce::jlimit(1, 127, noteEvent.velocity);
+    
+    // Ensure positive duration
+    clamped.durationTicks = std::max<Tick>(1, noteEvent.durationTicks);
+    
+    return clamped;
+}
+
 int Pattern::addAutomationPoint(const std::string& paramId, double time, float value, CurveType curveType)
 {
     // Clamp value to 0-1 range
@@ -253,12 +399,20 @@ const std::vector<AutomationPoint>& Pattern::getAutomationPoints(const std::stri
 float Pattern::getParameterValueAtTime(const std::string& paramId, double time, float defaultValue) const
 {
     auto it = automation.find(paramId);
-    if (it == automation.end() || it->second.empty())
+    if (it == automation.end())
     {
         return defaultValue;
     }
     
-    const auto& points = it->second;
+    return getAutomationValueAtTime(it->second, time, defaultValue);
+}
+
+float Pattern::getAutomationValueAtTime(const std::vector<AutomationPoint>& points, double time, float defaultValue)
+{
+    if (points.empty())
+    {
+        return defaultValue;
+    }
     
     // If time is before first point, return first point value
     if (time <= points.front().time)
@@ -331,12 +485,14 @@ std::vector<std::string> Pattern::getAutomatedParameters() const
 void Pattern::clear()
 {
     notes.clear();
+    ++noteVersion;
     automation.clear();
 }
 
 void Pattern::clearNotes()
 {
     notes.clear();
+    ++noteVersion;
 }
 
 void Pattern::clearAutomation()
@@ -350,36 +506,13 @@ std::unique_ptr<juce::XmlElement> Pattern::createStateXml() const
     
     // Add pattern attributes
     xml->setAttribute("name", name);
-    xml->setAttribute("length", length);
-    
-    // Add notes
-    auto notesXml = xml->createNewChildElement("Notes");
-    
-    for (const auto& note : notes)
-    {
-        auto noteXml = notesXml->createNewChildElement("Note");
-        noteXml->setAttribute("note", note.note);
-        noteXml->setAttribute("velocity", note.velocity);
-        noteXml->setAttribute("startTime", note.startTime);
-        noteXml->setAttribute("duration", note.duration);
-    }
-    
-    // Add automation
-    auto automationXml = xml->createNewChildElement("Automation");
+    xml->setAttribute("length", getLength());
     
-    for (const auto& pair : automation)
-    {
-        auto paramXml = automationXml->createNewChildElement("Parameter");
-        paramXml->setAttribute("id", pair.first);
-        
-        for (const auto& point : pair.second)
-        {
-            auto pointXml = paramXml->createNewChildElement("Point");
-            pointXml->setAttribute("time", point.time);
-            pointXml->setAttribute("value", point.value);
-            pointXml->setAttribute("curveType", static_cast<int>(point.curveType));
-        }
-    }
+    // Notes and automation are packed into one binary block. The "base64:"
+    // prefix makes ValueTree hold it as raw bytes, so binary project files
+    // store it unexpanded.
+    const juce::MemoryBlock packed = PatternCodec::encode(notes, automation);
+    xml->setAttribute(packedDataAttribute, packed.toBase64Encoding());
     
     return xml;
 }
@@ -396,12 +529,24 @@ bool Pattern::restoreStateFromXml(const juce::XmlElement* xml)
     
     // Restore pattern attributes
     name = xml->getStringAttribute("name", "Untitled Pattern").toStdString();
-    length = xml->getDoubleAttribute("length", 4.0);
+    length = std::max<Tick>(1, TimeBase::beatsToTicks(xml->getDoubleAttribute("length", 4.0)));
+    ++noteVersion;
     
-    // Restore notes
+    // Patterns saved since the packed encoding
+    if (xml->hasAttribute(packedDataAttribute))
+    {
+        juce::MemoryBlock packed;
+        
+        return packed.fromBase64Encoding(xml->getStringAttribute(packedDataAttribute))
+            && PatternCodec::decode(packed.getData(), packed.getSize(), notes, automation);
+    }
+    
+    // Older patterns store each note and point as its own element
     auto notesXml = xml->getChildByName("Notes");
     if (notesXml != nullptr)
     {
+        std::vector<NoteEvent> restoredNotes;
+        
         for (auto* noteXml : notesXml->getChildWithTagNameIterator("Note"))
         {
             int note = noteXml->getIntAttribute("note", 60);
@@ -409,8 +554,11 @@ bool Pattern::restoreStateFromXml(const juce::XmlElement* xml)
             double startTime = noteXml->getDoubleAttribute("startTime", 0.0);
             double duration = noteXml->getDoubleAttribute("duration", 1.0);
             
-            addNote(note, velocity, startTime, duration);
+            restoredNotes.push_back(NoteEvent::fromBeats(note, velocity, startTime, duration));
         }
+        
+        // Sort and insert them in one go
+        addNotes(restoredNotes);
     }
     
     // Restore automation
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "TimeBase.h"
 #include <JuceHeader.h>
 #include <string>
 #include <vector>
@@ -22,13 +23,53 @@ namespace UndergroundBeats {
 struct NoteEvent {
     int note;          // MIDI note number (0-127)
     int velocity;      // Note velocity (0-127)
-    double startTime;  // Start time in beats
-    double duration;   // Duration in beats
+    Tick startTick;    // Start time in ticks
+    Tick durationTicks; // Duration in ticks
     
-    NoteEvent(int note = 60, int velocity = 100, double startTime = 0.0, double duration = 1.0)
-        : note(note), velocity(velocity), startTime(startTime), duration(duration)
+    NoteEvent(int note = 60, int velocity = 100, Tick startTick = 0, Tick durationTicks = TimeBase::ticksPerBeat)
+        : note(note), velocity(velocity), startTick(startTick), durationTicks(durationTicks)
     {
     }
+    
+    /**
+     * @brief Create a note event from a start time and duration in beats
+     */
+    static NoteEvent fromBeats(int note, int velocity, double startTime, double duration)
+    {
+        return NoteEvent(note, velocity, TimeBase::beatsToTicks(startTime), TimeBase::beatsToTicks(duration));
+    }
+    
+    double getStartTime() const { return TimeBase::ticksToBeats(startTick); } // Start time in beats
+    double getDuration() const { return TimeBase::ticksToBeats(durationTicks); } // Duration in beats
+};
+
+/**
+ * @brief A pattern's notes stored column by column, sorted by start time
+ * 
+ * Keeping each field in its own array means a range search only touches the
+ * start times, and scans over many notes read contiguous memory.
+ */
+struct NoteColumns {
+    std::vector<Tick> startTicks;        // Start times in ticks, ascending
+    std::vector<Tick> durationTicks;     // Durations in ticks
+    std::vector<juce::uint8> pitches;    // MIDI note numbers
+    std::vector<juce::uint8> velocities; // Note velocities
+    
+    int size() const { return static_cast<int>(startTicks.size()); }
+    
+    void clear()
+    {
+        startTicks.clear();
+        durationTicks.clear();
+        pitches.clear();
+        velocities.clear();
+    }
+    
+    NoteEvent getNote(int index) const
+    {
+        const auto i = static_cast<size_t>(index);
+        return NoteEvent(pitches[i], velocities[i], startTicks[i], durationTicks[i]);
+    }
 };
 
 
@@ -39,9 +80,34 @@ struct NoteEvent {
  * The Pattern class represents a musical pattern containing MIDI notes
  * and parameter automation data. It provides methods for adding, editing,
  * and removing notes and automation points, as well as for serialization.
+ *
+ * Notes are always kept in start-time order, so note indices refer to that
+ * order and change when notes are added, moved or removed. Playback reads the
+ * notes through findNotes() with a PlaybackCursor, which continues from the
+ * previous block without searching again.
  */
 class Pattern {
 public:
+    /**
+     * @brief Position of a playback read within the pattern's notes
+     * 
+     * Each reader (e.g. each placement of the pattern in a timeline) keeps its
+     * own cursor. A default-constructed cursor is always valid.
+     */
+    struct PlaybackCursor {
+        int position = 0;         // First note after the last range that was read
+        Tick tick = -1;           // End of the last range that was read
+        juce::uint32 version = 0; // Note version the position refers to
+    };
+    
+    /**
+     * @brief A range of note indices [begin, end)
+     */
+    struct NoteRange {
+        int begin;
+        int end;
+    };
+    
     Pattern(const std::string& name = "Untitled Pattern", double lengthInBeats = 4.0);
     ~Pattern();
     
@@ -73,9 +139,19 @@ public:
      */
     double getLength() const;
     
+    /**
+     * @brief Get the pattern length in ticks
+     * 
+     * @return The pattern length
+     */
+    Tick getLengthInTicks() const;
+    
     /**
      * @brief Add a note to the pattern
      * 
+     * The note is inserted at its place in start-time order, after any notes
+     * with the same start time.
+     * 
      * @param note The MIDI note number
      * @param velocity The note velocity
      * @param startTime The start time in beats
@@ -92,9 +168,22 @@ public:
      */
     int addNote(const NoteEvent& noteEvent);
     
+    /**
+     * @brief Add many notes at once
+     * 
+     * Sorts the new notes and merges them with the existing ones in a single
+     * pass, which is much cheaper than inserting them one at a time.
+     * 
+     * @param noteEvents The notes to add, in any order
+     */
+    void addNotes(const std::vector<NoteEvent>& noteEvents);
+    
     /**
      * @brief Edit a note in the pattern
      * 
+     * If the start time changes the note moves to its new place in the order,
+     * so its index may change.
+     * 
      * @param index The note index
      * @param note The new MIDI note number
      * @param velocity The new velocity
@@ -116,9 +205,9 @@ public:
      * @brief Get a note event by index
      * 
      * @param index The note index
-     * @return The note event, or nullptr if not found
+     * @return The note event, or a default note if the index is out of range
      */
-    const NoteEvent* getNote(int index) const;
+    NoteEvent getNote(int index) const;
     
     /**
      * @brief Get the number of notes in the pattern
@@ -128,11 +217,43 @@ public:
     int getNumNotes() const;
     
     /**
-     * @brief Get all notes in the pattern
+     * @brief Get a copy of all notes in the pattern
+     * 
+     * @return Vector of note events in start-time order
+     */
+    std::vector<NoteEvent> getNotes() const;
+    
+    /**
+     * @brief Get the note storage
+     * 
+     * @return The notes, column by column in start-time order
+     */
+    const NoteColumns& getNoteColumns() const;
+    
+    /**
+     * @brief Find the notes that start within a time range
+     * 
+     * If the range starts where the cursor's previous range ended and the notes
+     * have not changed since, the search resumes from the cursor; otherwise it
+     * is a binary search. The cursor is moved to the end of the range.
      * 
-     * @return Vector of note events
+     * @param startTick Start of the range in ticks, relative to the pattern start
+     * @param endTick End of the range in ticks, relative to the pattern start
+     * @param cursor The reader's playback cursor
+     * @return The indices of the notes starting in [startTick, endTick)
      */
-    const std::vector<NoteEvent>& getNotes() const;
+    NoteRange findNotes(Tick startTick, Tick endTick, PlaybackCursor& cursor) const;
+    
+    /**
+     * @brief Get the note version
+     * 
+     * The version changes whenever a note is added, edited or removed, or the
+     * pattern length changes, so cached views of the notes can tell when they
+     * are out of date.
+     * 
+     * @return The current note version
+     */
+    juce::uint32 getNoteVersion() const;
     
     /**
      * @brief Add an automation point for a parameter
@@ -201,6 +322,18 @@ public:
      */
     float getParameterValueAtTime(const std::string& paramId, double time, float defaultValue = 0.0f) const;
     
+    /**
+     * @brief Get the value of an automation lane at a specific time
+     * 
+     * Works on a copy of a lane as well as on the pattern's own.
+     * 
+     * @param points The lane's points, sorted by time
+     * @param time The time in beats
+     * @param defaultValue The default value to return if the lane is empty
+     * @return The parameter value
+     */
+    static float getAutomationValueAtTime(const std::vector<AutomationPoint>& points, double time, float defaultValue = 0.0f);
+    
     /**
      * @brief Get all parameter IDs that have automation
      * 
@@ -226,6 +359,9 @@ public:
     /**
      * @brief Create an XML element containing the pattern's state
      * 
+     * Notes and automation are stored as one binary attribute encoded by
+     * PatternCodec; restoreStateFromXml() also reads the older per-element form.
+     * 
      * @return XML element containing pattern state
      */
     std::unique_ptr<juce::XmlElement> createStateXml() const;
@@ -240,8 +376,22 @@ public:
     
 private:
     std::string name;
-    double length; // Length in beats
-    std::vector<NoteEvent> notes;
+    Tick length; // Length in ticks
+    NoteColumns notes;
+    juce::uint32 noteVersion;
+    
+    // Index of the first note starting after the given tick
+    int upperBound(Tick tick) const;
+    
+    // Index of the first note starting at or after the given tick
+    int lowerBound(Tick tick, int first = 0) const;
+    
+    // Insert a note at the given index / remove the note at the given index
+    void insertNoteAt(int index, const NoteEvent& noteEvent);
+    void eraseNoteAt(int index);
+    
+    // Clamp a note's values to their valid ranges
+    static NoteEvent clampNote(const NoteEvent& noteEvent);
     std::unordered_map<std::string, std::vector<AutomationPoint>> automation;
     
     // Empty vector for returning when parameter not found
@@ -0,0 +1,497 @@
+/*
+ * Underground Beats
+ * PatternCodec.cpp
+ *
+ * Implementation of the compact pattern encoding
+ */
+
+#include "PatternCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace UndergroundBeats {
+
+namespace {
+
+constexpr juce::uint8 formatMagic = 'P';
+constexpr juce::uint8 formatVersion = 1;
+
+// Lane flag: times are whole ticks, stored as deltas
+constexpr juce::uint8 tickGridFlag = 1;
+
+constexpr juce::uint64 maxCount = static_cast<juce::uint64>(std::numeric_limits<int>::max());
+
+void writeVarint(juce::MemoryOutputStream& output, juce::uint64 value)
+{
+    juce::uint8 bytes[10];
+    size_t size = 0;
+
+    while (value >= 0x80)
+    {
+        bytes[size++] = static_cast<juce::uint8>(value | 0x80);
+        value >>= 7;
+    }
+
+    bytes[size++] = static_cast<juce::uint8>(value);
+    output.write(bytes, size);
+}
+
+// Zigzag encoding keeps small negative values small
+void writeSigned(juce::MemoryOutputStream& output, juce::int64 value)
+{
+    writeVarint(output, (static_cast<juce::uint64>(value) << 1) ^ static_cast<juce::uint64>(value >> 63));
+}
+
+void writeColumn(juce::MemoryOutputStream& output, const void* data, size_t size)
+{
+    if (size > 0)
+    {
+        output.write(data, size);
+    }
+}
+
+bool isOnTickGrid(double time)
+{
+    return std::isfinite(time)
+        && std::abs(time) < 1.0e12
+        && TimeBase::ticksToBeats(TimeBase::beatsToTicks(time)) == time;
+}
+
+} // namespace
+
+//==============================================================================
+bool PatternCodec::Reader::Cursor::readVarint(juce::uint64& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (position == end)
+        {
+            return false;
+        }
+
+        const juce::uint8 byte = *position++;
+        value |= static_cast<juce::uint64>(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool PatternCodec::Reader::Cursor::readSigned(juce::int64& value)
+{
+    juce::uint64 encoded = 0;
+
+    if (!readVarint(encoded))
+    {
+        return false;
+    }
+
+    value = static_cast<juce::int64>(encoded >> 1) ^ -static_cast<juce::int64>(encoded & 1);
+    return true;
+}
+
+bool PatternCodec::Reader::Cursor::readBytes(const juce::uint8*& bytes, juce::uint64 count)
+{
+    if (count > static_cast<juce::uint64>(end - position))
+    {
+        return false;
+    }
+
+    bytes = position;
+    position += count;
+    return true;
+}
+
+bool PatternCodec::Reader::Cursor::readSection(Cursor& section, juce::uint64 size)
+{
+    const juce::uint8* start = nullptr;
+
+    if (!readBytes(start, size))
+    {
+        return false;
+    }
+
+    section.position = start;
+    section.end = start + size;
+    return true;
+}
+
+//==============================================================================
+PatternCodec::Reader::Reader(const void* data, size_t size)
+{
+    if (data == nullptr)
+    {
+        return;
+    }
+
+    Cursor block;
+    block.position = static_cast<const juce::uint8*>(data);
+    block.end = block.position + size;
+
+    const juce::uint8* header = nullptr;
+    juce::uint64 count = 0, startBytes = 0, durationBytes = 0, laneCount = 0;
+
+    if (!block.readBytes(header, 2) || header[0] != formatMagic || header[1] != formatVersion
+        || !block.readVarint(count) || count > maxCount
+        || !block.readVarint(startBytes) || !block.readVarint(durationBytes))
+    {
+        return;
+    }
+
+    // Every column has to fit in the block
+    if (!block.readSection(starts, startBytes) || !block.readSection(durations, durationBytes)
+        || !block.readSection(pitches, count) || !block.readSection(velocities, count)
+        || !block.readVarint(laneCount) || laneCount > maxCount)
+    {
+        return;
+    }
+
+    numNotes = static_cast<int>(count);
+    numLanes = static_cast<int>(laneCount);
+    lanes = block;
+    valid = true;
+}
+
+bool PatternCodec::Reader::isValid() const
+{
+    return valid;
+}
+
+int PatternCodec::Reader::getNumNotes() const
+{
+    return numNotes;
+}
+
+bool PatternCodec::Reader::readNote(NoteEvent& note)
+{
+    if (!valid || notesRead >= numNotes)
+    {
+        return false;
+    }
+
+    juce::int64 delta = 0;
+    juce::uint64 duration = 0;
+    const juce::uint8* pitch = nullptr;
+    const juce::uint8* velocity = nullptr;
+
+    if (!starts.readSigned(delta) || !durations.readVarint(duration)
+        || !pitches.readBytes(pitch, 1) || !velocities.readBytes(velocity, 1))
+    {
+        return fail();
+    }
+
+    // Notes are stored sorted, with values already clamped
+    if ((notesRead > 0 && delta < 0) || duration == 0 || duration > maxCount
+        || *pitch > 127 || *velocity == 0 || *velocity > 127)
+    {
+        return fail();
+    }
+
+    previousStart += delta;
+    note = NoteEvent(*pitch, *velocity, previousStart, static_cast<Tick>(duration));
+    ++notesRead;
+
+    return true;
+}
+
+bool PatternCodec::Reader::readNotes(NoteColumns& columns)
+{
+    if (!valid)
+    {
+        return false;
+    }
+
+    const size_t remaining = static_cast<size_t>(numNotes - notesRead);
+
+    columns.startTicks.reserve(columns.startTicks.size() + remaining);
+    columns.durationTicks.reserve(columns.durationTicks.size() + remaining);
+
+    // One tight loop per column rather than one pass over whole notes
+    for (size_t i = 0; i < remaining; ++i)
+    {
+        juce::int64 delta = 0;
+
+        if (!starts.readSigned(delta) || (notesRead + static_cast<int>(i) > 0 && delta < 0))
+        {
+            return fail();
+        }
+
+        previousStart += delta;
+        columns.startTicks.push_back(previousStart);
+    }
+
+    for (size_t i = 0; i < remaining; ++i)
+    {
+        juce::uint64 duration = 0;
+
+        if (!durations.readVarint(duration) || duration == 0 || duration > maxCount)
+        {
+            return fail();
+        }
+
+        columns.durationTicks.push_back(static_cast<Tick>(duration));
+    }
+
+    // Pitches and velocities are stored as they are held in memory
+    const juce::uint8* pitchBytes = nullptr;
+    const juce::uint8* velocityBytes = nullptr;
+
+    if (!pitches.readBytes(pitchBytes, remaining) || !velocities.readBytes(velocityBytes, remaining)
+        || std::any_of(pitchBytes, pitchBytes + remaining, [](juce::uint8 pitch) { return pitch > 127; })
+        || std::any_of(velocityBytes, velocityBytes + remaining,
+                       [](juce::uint8 velocity) { return velocity == 0 || velocity > 127; }))
+    {
+        return fail();
+    }
+
+    columns.pitches.insert(columns.pitches.end(), pitchBytes, pitchBytes + remaining);
+    columns.velocities.insert(columns.velocities.end(), velocityBytes, velocityBytes + remaining);
+    notesRead = numNotes;
+
+    return true;
+}
+
+int PatternCodec::Reader::getNumLanes() const
+{
+    return numLanes;
+}
+
+bool PatternCodec::Reader::readLane(std::string& paramId, int& numPoints)
+{
+    if (!valid || lanesRead >= numLanes)
+    {
+        return false;
+    }
+
+    juce::uint64 idLength = 0, count = 0, timeBytes = 0;
+    const juce::uint8* id = nullptr;
+    const juce::uint8* flags = nullptr;
+
+    // The lane cursor moves past the whole lane, so unread points are skipped
+    if (!lanes.readVarint(idLength) || !lanes.readBytes(id, idLength)
+        || !lanes.readVarint(count) || count > maxCount
+        || !lanes.readBytes(flags, 1) || !lanes.readVarint(timeBytes)
+        || !lanes.readSection(times, timeBytes) || !lanes.readSection(values, count * 4)
+        || !lanes.readSection(curves, count))
+    {
+        return fail();
+    }
+
+    paramId.assign(reinterpret_cast<const char*>(id), static_cast<size_t>(idLength));
+    numPoints = static_cast<int>(count);
+
+    lanePoints = numPoints;
+    pointsRead = 0;
+    laneOnTickGrid = (*flags & tickGridFlag) != 0;
+    previousTime = 0;
+    ++lanesRead;
+
+    return true;
+}
+
+bool PatternCodec::Reader::readPoint(AutomationPoint& point)
+{
+    if (!valid || pointsRead >= lanePoints)
+    {
+        return false;
+    }
+
+    double time = 0.0;
+
+    if (laneOnTickGrid)
+    {
+        juce::int64 delta = 0;
+
+        if (!times.readSigned(delta))
+        {
+            return fail();
+        }
+
+        previousTime += delta;
+        time = TimeBase::ticksToBeats(previousTime);
+    }
+    else
+    {
+        const juce::uint8* timeBytes = nullptr;
+
+        if (!times.readBytes(timeBytes, 8))
+        {
+            return fail();
+        }
+
+        const juce::uint64 bits = juce::ByteOrder::littleEndianInt64(timeBytes);
+        std::memcpy(&time, &bits, sizeof(time));
+    }
+
+    const juce::uint8* valueBytes = nullptr;
+    const juce::uint8* curve = nullptr;
+
+    if (!values.readBytes(valueBytes, 4) || !curves.readBytes(curve, 1)
+        || *curve > static_cast<int>(CurveType::Step))
+    {
+        return fail();
+    }
+
+    const juce::uint32 valueBits = juce::ByteOrder::littleEndianInt(valueBytes);
+    float value = 0.0f;
+    std::memcpy(&value, &valueBits, sizeof(value));
+
+    point = AutomationPoint(time, value, static_cast<CurveType>(*curve));
+    ++pointsRead;
+
+    return true;
+}
+
+bool PatternCodec::Reader::fail()
+{
+    valid = false;
+    return false;
+}
+
+//==============================================================================
+juce::MemoryBlock PatternCodec::encode(const NoteColumns& notes, const AutomationLanes& automation)
+{
+    const size_t numNotes = notes.startTicks.size();
+
+    juce::MemoryOutputStream startColumn, durationColumn;
+    Tick previousStart = 0;
+
+    for (size_t i = 0; i < numNotes; ++i)
+    {
+        writeSigned(startColumn, notes.startTicks[i] - previousStart);
+        previousStart = notes.startTicks[i];
+    }
+
+    for (size_t i = 0; i < numNotes; ++i)
+    {
+        writeVarint(durationColumn, static_cast<juce::uint64>(notes.durationTicks[i]));
+    }
+
+    juce::MemoryOutputStream output;
+    output.writeByte(static_cast<char>(formatMagic));
+    output.writeByte(static_cast<char>(formatVersion));
+
+    writeVarint(output, numNotes);
+    writeVarint(output, startColumn.getDataSize());
+    writeVarint(output, durationColumn.getDataSize());
+    writeColumn(output, startColumn.getData(), startColumn.getDataSize());
+    writeColumn(output, durationColumn.getData(), durationColumn.getDataSize());
+    writeColumn(output, notes.pitches.data(), numNotes);
+    writeColumn(output, notes.velocities.data(), numNotes);
+
+    // Lanes in ID order, so the same pattern always encodes the same way
+    std::vector<const AutomationLanes::value_type*> sortedLanes;
+    sortedLanes.reserve(automation.size());
+
+    for (const auto& lane : automation)
+    {
+        sortedLanes.push_back(&lane);
+    }
+
+    std::sort(sortedLanes.begin(), sortedLanes.end(), [](const auto* a, const auto* b) {
+        return a->first < b->first;
+    });
+
+    writeVarint(output, sortedLanes.size());
+
+    for (const auto* lane : sortedLanes)
+    {
+        const auto& points = lane->second;
+        const bool onTickGrid = std::all_of(points.begin(), points.end(), [](const AutomationPoint& point) {
+            return isOnTickGrid(point.time);
+        });
+
+        juce::MemoryOutputStream timeColumn;
+        Tick previousTime = 0;
+
+        for (const auto& point : points)
+        {
+            if (onTickGrid)
+            {
+                const Tick time = TimeBase::beatsToTicks(point.time);
+                writeSigned(timeColumn, time - previousTime);
+                previousTime = time;
+            }
+            else
+            {
+                timeColumn.writeDouble(point.time);
+            }
+        }
+
+        writeVarint(output, lane->first.size());
+        writeColumn(output, lane->first.data(), lane->first.size());
+        writeVarint(output, points.size());
+        output.writeByte(static_cast<char>(onTickGrid ? tickGridFlag : 0));
+        writeVarint(output, timeColumn.getDataSize());
+        writeColumn(output, timeColumn.getData(), timeColumn.getDataSize());
+
+        for (const auto& point : points)
+        {
+            output.writeFloat(point.value);
+        }
+
+        for (const auto& point : points)
+        {
+            output.writeByte(static_cast<char>(point.curveType));
+        }
+    }
+
+    return output.getMemoryBlock();
+}
+
+bool PatternCodec::decode(const void* data, size_t size, NoteColumns& notes, AutomationLanes& automation)
+{
+    Reader reader(data, size);
+    NoteColumns decodedNotes;
+
+    if (!reader.isValid() || !reader.readNotes(decodedNotes))
+    {
+        return false;
+    }
+
+    AutomationLanes decodedAutomation;
+    std::string paramId;
+    int numPoints = 0;
+
+    for (int lane = 0; lane < reader.getNumLanes(); ++lane)
+    {
+        if (!reader.readLane(paramId, numPoints) || decodedAutomation.count(paramId) > 0)
+        {
+            return false;
+        }
+
+        auto& points = decodedAutomation[paramId];
+        points.reserve(static_cast<size_t>(numPoints));
+
+        AutomationPoint point;
+
+        while (reader.readPoint(point))
+        {
+            points.push_back(point);
+        }
+
+        // Points are kept sorted by time
+        if (static_cast<int>(points.size()) != numPoints
+            || !std::is_sorted(points.begin(), points.end(), [](const auto& a, const auto& b) {
+                   return a.time < b.time;
+               }))
+        {
+            return false;
+        }
+    }
+
+    notes = std::move(decodedNotes);
+    automation = std::move(decodedAutomation);
+
+    return true;
+}
+
+} // namespace UndergroundBeats
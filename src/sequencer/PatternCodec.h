@@ -0,0 +1,166 @@
+/*
+ * Underground Beats
+ * PatternCodec.h
+ *
+ * Compact binary encoding of pattern notes and automation
+ */
+
+#pragma once
+
+#include "Pattern.h"
+#include <JuceHeader.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace UndergroundBeats {
+
+/**
+ * @class PatternCodec
+ * @brief Compact binary encoding of pattern notes and automation
+ *
+ * Notes are written column by column, like NoteColumns holds them: start
+ * times as deltas from the previous note, then durations, then pitches and
+ * velocities as one byte each. Integers are variable-length (7 bits per
+ * byte), with signed values zigzag-encoded, so the typical note takes four
+ * to six bytes instead of a hundred or so as an XML element.
+ *
+ * Each automation lane stores its parameter ID and its points' times,
+ * values and curve types, again column by column. Times on the tick grid
+ * are written as tick deltas; other times are kept as exact doubles.
+ *
+ * Reader walks an encoded block in place, one note or point at a time,
+ * without building any intermediate representation.
+ */
+class PatternCodec {
+public:
+    using AutomationLanes = std::unordered_map<std::string, std::vector<AutomationPoint>>;
+
+    /**
+     * @brief Sequential reader over an encoded block
+     *
+     * Notes and automation lanes have independent positions, so they can be
+     * read in any order. The reader does not copy the data, which must stay
+     * valid while it is in use.
+     */
+    class Reader {
+    public:
+        /**
+         * @brief Start reading an encoded block
+         *
+         * @param data The encoded data
+         * @param size The size of the data in bytes
+         */
+        Reader(const void* data, size_t size);
+
+        /**
+         * @brief Check whether the block header and section sizes are valid
+         */
+        bool isValid() const;
+
+        /**
+         * @brief Get the number of notes in the block
+         */
+        int getNumNotes() const;
+
+        /**
+         * @brief Read the next note, in start-time order
+         *
+         * @param note Receives the note
+         * @return false if there are no more notes or the data is damaged
+         */
+        bool readNote(NoteEvent& note);
+
+        /**
+         * @brief Read all remaining notes, appending them to columns
+         *
+         * Decodes each column in one pass, copying the pitch and velocity
+         * columns straight from the block.
+         *
+         * @param columns The columns to append to
+         * @return false if the data is damaged
+         */
+        bool readNotes(NoteColumns& columns);
+
+        /**
+         * @brief Get the number of automation lanes in the block
+         */
+        int getNumLanes() const;
+
+        /**
+         * @brief Move to the next automation lane
+         *
+         * @param paramId Receives the lane's parameter ID
+         * @param numPoints Receives the number of points in the lane
+         * @return false if there are no more lanes or the data is damaged
+         */
+        bool readLane(std::string& paramId, int& numPoints);
+
+        /**
+         * @brief Read the next point of the current automation lane
+         *
+         * @param point Receives the point
+         * @return false if the lane has no more points or the data is damaged
+         */
+        bool readPoint(AutomationPoint& point);
+
+    private:
+        struct Cursor {
+            const juce::uint8* position = nullptr;
+            const juce::uint8* end = nullptr;
+
+            bool readVarint(juce::uint64& value);
+            bool readSigned(juce::int64& value);
+            bool readBytes(const juce::uint8*& bytes, juce::uint64 count);
+            bool readSection(Cursor& section, juce::uint64 size);
+        };
+
+        // Mark the block as damaged; nothing more is read from it
+        bool fail();
+
+        bool valid = false;
+
+        // Notes: one cursor per column
+        int numNotes = 0;
+        int notesRead = 0;
+        Tick previousStart = 0;
+        Cursor starts, durations, pitches, velocities;
+
+        // Automation: the lane list, and the columns of the current lane
+        int numLanes = 0;
+        int lanesRead = 0;
+        Cursor lanes;
+        int lanePoints = 0;
+        int pointsRead = 0;
+        bool laneOnTickGrid = false;
+        Tick previousTime = 0;
+        Cursor times, values, curves;
+    };
+
+    /**
+     * @brief Encode notes and automation lanes
+     *
+     * @param notes The notes, sorted by start time
+     * @param automation The automation lanes
+     * @return The encoded block
+     */
+    static juce::MemoryBlock encode(const NoteColumns& notes, const AutomationLanes& automation);
+
+    /**
+     * @brief Decode a block written by encode()
+     *
+     * Nothing is changed unless the whole block is valid.
+     *
+     * @param data The encoded data
+     * @param size The size of the data in bytes
+     * @param notes Receives the notes
+     * @param automation Receives the automation lanes
+     * @return true if the block was decoded
+     */
+    static bool decode(const void* data, size_t size, NoteColumns& notes, AutomationLanes& automation);
+
+private:
+    PatternCodec() = delete;
+};
+
+} // namespace UndergroundBeats
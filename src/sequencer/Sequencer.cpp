@@ -13,27 +13,32 @@
 namespace UndergroundBeats {
 
 Sequencer::Sequencer()
-    : currentPosition(0.0),
-      tempo(120.0),
+    : tempo(120.0),
       timeSignatureNumerator(4),
       timeSignatureDenominator(4),
-      playing(false),
       looping(false),
       loopStart(0.0),
       loopEnd(4.0),
       quantizationGrid(0.25), // 16th notes
-      lastEventPosition(0.0),
       currentSampleRate(44100.0),
       currentBlockSize(512)
 {
     // Initialize the temp MIDI buffer
     tempMidiBuffer.ensureSize(256);
+    
+    activeNotes.reserve(maxActiveNotes);
+    blockNotes.reserve(256);
+    
+    auto initialMap = std::make_unique<TempoMap>(tempo);
+    initialMap->setSampleRate(currentSampleRate);
+    tempoMap.reset(std::move(initialMap));
+    automationPlan.reset(std::make_unique<AutomationPlan>());
+    notePlayback.reset(std::make_unique<NotePlayback>());
+    setAnchor(0);
 }
 
 Sequencer::~Sequencer()
 {
-    // Stop playback and timer
-    stop();
 }
 
 void Sequencer::setTimeline(std::shared_ptr<Timeline> newTimeline)
@@ -41,11 +46,21 @@ void Sequencer::setTimeline(std::shared_ptr<Timeline> newTimeline)
     // Update the timeline and reset position if needed
     timeline = newTimeline;
     
+    // Follow the new timeline's tempo map
+    if (timeline)
+    {
+        tempo = timeline->getTempoMap().getTempoPoints().front().bpm;
+    }
+    
+    tempoMapChanged();
+    arrangementChanged();
+    
     // If we're looping, check that loop points are valid
     if (looping && timeline)
     {
         double timelineLength = timeline->getLength();
         loopEnd = std::min(loopEnd, timelineLength);
+        sendCommand(TransportCommand::Type::SetLoopRange, loopStart, loopEnd);
     }
 }
 
@@ -56,62 +71,17 @@ std::shared_ptr<Timeline> Sequencer::getTimeline() const
 
 void Sequencer::play()
 {
-    if (!playing)
-    {
-        // Reset some state
-        lastEventPosition = currentPosition;
-        activeNotes.clear();
-        
-        // Start the timer for playback
-        startTimer(timerIntervalMs);
-        
-        // Mark as playing
-        playing = true;
-    }
+    sendCommand(TransportCommand::Type::Play);
 }
 
 void Sequencer::stop()
 {
-    if (playing)
-    {
-        // Stop the timer
-        stopTimer();
-        
-        // Send note-offs for any active notes
-        juce::MidiBuffer buffer;
-        for (const auto& note : activeNotes)
-        {
-            buffer.addEvent(juce::MidiMessage::noteOff(1, note.note, 0.0f), 0);
-            
-            // If we have a callback, notify it as well
-            if (noteEventCallback)
-            {
-                NoteEvent event;
-                event.note = note.note;
-                event.velocity = 0;
-                event.startTime = currentPosition;
-                event.duration = 0.0;
-                noteEventCallback(event);
-            }
-        }
-        
-        // Process these note-offs
-        if (parameterCallback)
-        {
-            processMidi(juce::MidiBuffer(), buffer);
-        }
-        
-        // Clear active notes
-        activeNotes.clear();
-        
-        // Mark as stopped
-        playing = false;
-    }
+    sendCommand(TransportCommand::Type::Stop);
 }
 
 void Sequencer::togglePlayStop()
 {
-    if (playing)
+    if (isPlaying())
         stop();
     else
         play();
@@ -119,34 +89,43 @@ void Sequencer::togglePlayStop()
 
 void Sequencer::setPosition(double positionInBeats)
 {
-    bool wasPlaying = playing;
-    
-    // Stop playback to clear any active notes
-    if (wasPlaying)
-        stop();
-    
-    // Update position
-    currentPosition = positionInBeats;
-    lastEventPosition = currentPosition;
-    
-    // Resume playback if needed
-    if (wasPlaying)
-        play();
+    // The audio thread releases any sounding notes when it applies the locate
+    sendCommand(TransportCommand::Type::Locate, std::max(0.0, positionInBeats));
 }
 
 double Sequencer::getPosition() const
 {
-    return currentPosition;
+    double beats;
+    juce::int64 samples;
+    bool isRunning;
+    readSnapshot(beats, samples, isRunning);
+    return beats;
+}
+
+juce::int64 Sequencer::getPositionInSamples() const
+{
+    double beats;
+    juce::int64 samples;
+    bool isRunning;
+    readSnapshot(beats, samples, isRunning);
+    return samples;
 }
 
 bool Sequencer::isPlaying() const
 {
-    return playing;
+    return snapshotPlaying.load(std::memory_order_acquire);
 }
 
 void Sequencer::setTempo(double bpm)
 {
     tempo = std::max(1.0, std::min(999.0, bpm));
+    
+    if (timeline)
+    {
+        timeline->getTempoMap().setInitialTempo(tempo);
+    }
+    
+    tempoMapChanged();
 }
 
 double Sequencer::getTempo() const
@@ -154,10 +133,70 @@ double Sequencer::getTempo() const
     return tempo;
 }
 
+void Sequencer::tempoMapChanged()
+{
+    // The audio thread gets its own copy, so the timeline's map can be edited freely
+    auto newMap = timeline ? std::make_unique<TempoMap>(timeline->getTempoMap()) : std::make_unique<TempoMap>(tempo);
+    newMap->setSampleRate(currentSampleRate);
+    
+    // Replaces any map the audio thread has not picked up yet
+    tempoMap.publish(std::move(newMap));
+}
+
+void Sequencer::arrangementChanged()
+{
+    auto playback = std::make_unique<NotePlayback>();
+    
+    if (timeline)
+    {
+        playback->index = timeline->createIndex();
+        playback->cursors = playback->index->createCursors();
+    }
+    
+    // Replaces any snapshot the audio thread has not picked up yet
+    notePlayback.publish(std::move(playback));
+    
+    automationChanged();
+}
+
+void Sequencer::automationChanged()
+{
+    auto plan = std::make_unique<AutomationPlan>();
+    
+    if (timeline)
+    {
+        for (const auto& instance : timeline->getPatternInstances())
+        {
+            if (instance.muted)
+                continue;
+            
+            if (const auto* pattern = timeline->getPattern(instance.patternId))
+            {
+                for (auto& paramId : pattern->getAutomatedParameters())
+                {
+                    AutomationLane lane;
+                    lane.points = pattern->getAutomationPoints(paramId);
+                    lane.paramId = std::move(paramId);
+                    lane.startTime = instance.getStartTime();
+                    plan->lanes.push_back(std::move(lane));
+                }
+            }
+        }
+    }
+    
+    // Every lane is sent once more when the audio thread picks the plan up
+    automationPlan.publish(std::move(plan));
+}
+
 void Sequencer::setTimeSignature(int numerator, int denominator)
 {
     timeSignatureNumerator = std::max(1, numerator);
     timeSignatureDenominator = std::max(1, denominator);
+    
+    if (timeline)
+    {
+        timeline->getTempoMap().setTimeSignature(0, timeSignatureNumerator, timeSignatureDenominator);
+    }
 }
 
 int Sequencer::getTimeSignatureNumerator() const
@@ -173,6 +212,7 @@ int Sequencer::getTimeSignatureDenominator() const
 void Sequencer::setLooping(bool shouldLoop)
 {
     looping = shouldLoop;
+    sendCommand(TransportCommand::Type::SetLooping, looping ? 1.0 : 0.0);
 }
 
 bool Sequencer::isLooping() const
@@ -189,6 +229,8 @@ void Sequencer::setLoopStart(double startInBeats)
     {
         loopEnd = loopStart + 1.0;
     }
+    
+    sendCommand(TransportCommand::Type::SetLoopRange, loopStart, loopEnd);
 }
 
 double Sequencer::getLoopStart() const
@@ -200,6 +242,7 @@ void Sequencer::setLoopEnd(double endInBeats)
 {
     // Ensure loop end is positive and after loop start
     loopEnd = std::max(loopStart + 0.1, endInBeats);
+    sendCommand(TransportCommand::Type::SetLoopRange, loopStart, loopEnd);
 }
 
 double Sequencer::getLoopEnd() const
@@ -217,58 +260,56 @@ double Sequencer::getQuantizationGrid() const
     return quantizationGrid;
 }
 
-void Sequencer::processMidi(const juce::MidiBuffer& midiInput, juce::MidiBuffer& midiOutput)
+void Sequencer::processMidi(const juce::MidiBuffer& midiInput, juce::MidiBuffer& midiOutput, int numSamples)
 {
-    // If we have a timeline and we're playing, generate events
-    if (timeline && playing)
+    acquirePendingTempoMap();
+    notePlayback.acquire();
+    applyTransportCommands(midiOutput);
+    
+    if (transport.playing && numSamples > 0)
     {
-        // Calculate how much time this buffer represents
-        double blockDuration = static_cast<double>(currentBlockSize) / currentSampleRate;
-        double blockDurationBeats = secondsToBeats(blockDuration);
-        
-        // Generate events from the current position to the next position
-        double nextPosition = currentPosition + blockDurationBeats;
-        generateEvents(lastEventPosition, nextPosition, midiOutput);
+        const juce::int64 blockStartSample = transport.playheadSample;
+        int offset = 0;
         
-        // Check for loop points
-        if (looping && nextPosition >= loopEnd)
+        // Split the block at the loop end, if it falls inside it
+        while (offset < numSamples)
         {
-            // We've reached the loop end, jump back to loop start
-            double overshoot = nextPosition - loopEnd;
-            currentPosition = loopStart + overshoot;
-            lastEventPosition = loopStart;
+            int length = numSamples - offset;
+            bool wrap = false;
             
-            // Send note-offs for any active notes
-            for (const auto& note : activeNotes)
+            if (transport.looping && transport.loopEnd > transport.loopStart)
             {
-                midiOutput.addEvent(juce::MidiMessage::noteOff(1, note.note, 0.0f), 0);
+                const juce::int64 loopEndSample = firstSampleAtOrAfterTick(transport.loopEnd);
                 
-                // If we have a callback, notify it as well
-                if (noteEventCallback)
+                if (loopEndSample < transport.playheadSample + length)
                 {
-                    NoteEvent event;
-                    event.note = note.note;
-                    event.velocity = 0;
-                    event.startTime = loopEnd;
-                    event.duration = 0.0;
-                    noteEventCallback(event);
+                    length = static_cast<int>(std::max<juce::int64>(0, loopEndSample - transport.playheadSample));
+                    wrap = true;
                 }
             }
             
-            // Clear active notes
-            activeNotes.clear();
+            if (length > 0)
+            {
+                generateEvents(blockStartSample, offset, length, midiOutput);
+            }
             
-            // Generate events for the new position
-            generateEvents(loopStart, currentPosition, midiOutput);
-        }
-        else
-        {
-            currentPosition = nextPosition;
+            offset += length;
+            transport.playheadSample += length;
+            
+            if (wrap)
+            {
+                // End every sounding note at the loop point and continue from the loop start
+                releaseActiveNotes(std::min(offset, numSamples - 1), transport.loopEnd, midiOutput);
+                setAnchor(transport.loopStart);
+            }
         }
         
-        lastEventPosition = currentPosition;
+        // Generate parameter automation events
+        generateParameterEvents(TimeBase::ticksToBeats(tickAtSample(transport.playheadSample)));
     }
     
+    publishSnapshot();
+    
     // Pass through any incoming MIDI messages
     if (!midiInput.isEmpty())
     {
@@ -309,8 +350,8 @@ void Sequencer::handleNoteOn(juce::MidiKeyboardState* keyboardState, int midiCha
         NoteEvent event;
         event.note = midiNoteNumber;
         event.velocity = static_cast<int>(velocity * 127.0f);
-        event.startTime = currentPosition;
-        event.duration = 0.0; // We don't know the duration yet
+        event.startTick = TimeBase::beatsToTicks(getPosition());
+        event.durationTicks = 0; // We don't know the duration yet
         noteEventCallback(event);
     }
 }
@@ -330,43 +371,26 @@ void Sequencer::handleNoteOff(juce::MidiKeyboardState* keyboardState, int midiCh
         NoteEvent event;
         event.note = midiNoteNumber;
         event.velocity = 0;
-        event.startTime = currentPosition;
-        event.duration = 0.0;
+        event.startTick = TimeBase::beatsToTicks(getPosition());
+        event.durationTicks = 0;
         noteEventCallback(event);
     }
 }
 
-void Sequencer::timerCallback()
-{
-    // This just advances the clock when we're playing without audio callbacks
-    if (playing)
-    {
-        // Calculate how much time has passed
-        double elapsedSeconds = timerIntervalMs / 1000.0;
-        double elapsedBeats = secondsToBeats(elapsedSeconds);
-        
-        // Update position
-        double nextPosition = currentPosition + elapsedBeats;
-        
-        // Check for loop points
-        if (looping && nextPosition >= loopEnd)
-        {
-            // We've reached the loop end, jump back to loop start
-            double overshoot = nextPosition - loopEnd;
-            nextPosition = loopStart + overshoot;
-        }
-        
-        currentPosition = nextPosition;
-        
-        // Generate parameter automation events
-        generateParameterEvents(currentPosition);
-    }
-}
-
 void Sequencer::prepare(double sampleRate, int blockSize)
 {
+    // Keep the musical position across a sample rate change
+    const Tick currentTick = static_cast<Tick>(std::llround(tickAtSample(transport.playheadSample)));
+    
     currentSampleRate = sampleRate;
     currentBlockSize = blockSize;
+    
+    // Keep the per-block buffers allocated before the audio thread starts
+    activeNotes.reserve(maxActiveNotes);
+    blockNotes.reserve(std::max<size_t>(256, blockNotes.capacity()));
+    
+    tempoMap.get()->setSampleRate(sampleRate);
+    setAnchor(currentTick);
 }
 
 std::unique_ptr<juce::XmlElement> Sequencer::createStateXml() const
@@ -377,7 +401,7 @@ std::unique_ptr<juce::XmlElement> Sequencer::createStateXml() const
     xml->setAttribute("tempo", tempo);
     xml->setAttribute("timeSignatureNumerator", timeSignatureNumerator);
     xml->setAttribute("timeSignatureDenominator", timeSignatureDenominator);
-    xml->setAttribute("position", currentPosition);
+    xml->setAttribute("position", getPosition());
     xml->setAttribute("looping", looping);
     xml->setAttribute("loopStart", loopStart);
     xml->setAttribute("loopEnd", loopEnd);
@@ -392,146 +416,317 @@ bool Sequencer::restoreStateFromXml(const juce::XmlElement* xml)
         return false;
     
     // Read basic properties
-    tempo = xml->getDoubleAttribute("tempo", 120.0);
-    timeSignatureNumerator = xml->getIntAttribute("timeSignatureNumerator", 4);
-    timeSignatureDenominator = xml->getIntAttribute("timeSignatureDenominator", 4);
-    currentPosition = xml->getDoubleAttribute("position", 0.0);
+    setTempo(xml->getDoubleAttribute("tempo", 120.0));
+    setTimeSignature(xml->getIntAttribute("timeSignatureNumerator", 4),
+                     xml->getIntAttribute("timeSignatureDenominator", 4));
     looping = xml->getBoolAttribute("looping", false);
     loopStart = xml->getDoubleAttribute("loopStart", 0.0);
     loopEnd = xml->getDoubleAttribute("loopEnd", 4.0);
     quantizationGrid = xml->getDoubleAttribute("quantizationGrid", 0.25);
     
-    // Reset last event position
-    lastEventPosition = currentPosition;
+    // Hand the transport settings to the audio thread
+    sendCommand(TransportCommand::Type::SetLooping, looping ? 1.0 : 0.0);
+    sendCommand(TransportCommand::Type::SetLoopRange, loopStart, loopEnd);
+    sendCommand(TransportCommand::Type::Locate, xml->getDoubleAttribute("position", 0.0));
     
     return true;
 }
 
-double Sequencer::beatsToSeconds(double beats) const
+void Sequencer::sendCommand(TransportCommand::Type type, double value1, double value2)
 {
-    // Convert beats to seconds based on tempo
-    // (60.0 / tempo) = seconds per beat
-    return beats * (60.0 / tempo);
+    const bool queued = commandQueue.push({ type, value1, value2 });
+    
+    // The audio thread drains the queue every block, so this only fills up
+    // if the audio callback is not running
+    jassert(queued);
+    juce::ignoreUnused(queued);
 }
 
-double Sequencer::secondsToBeats(double seconds) const
+void Sequencer::applyTransportCommands(juce::MidiBuffer& midiOutput)
 {
-    // Convert seconds to beats based on tempo
-    // (tempo / 60.0) = beats per second
-    return seconds * (tempo / 60.0);
+    TransportCommand command;
+    
+    while (commandQueue.pop(command))
+    {
+        const Tick currentTick = static_cast<Tick>(std::llround(tickAtSample(transport.playheadSample)));
+        
+        switch (command.type)
+        {
+            case TransportCommand::Type::Play:
+                transport.playing = true;
+                break;
+                
+            case TransportCommand::Type::Stop:
+                if (transport.playing)
+                {
+                    releaseActiveNotes(0, currentTick, midiOutput);
+                    transport.playing = false;
+                }
+                break;
+                
+            case TransportCommand::Type::Locate:
+                releaseActiveNotes(0, currentTick, midiOutput);
+                setAnchor(TimeBase::beatsToTicks(command.value1));
+                break;
+                
+            case TransportCommand::Type::SetLooping:
+                transport.looping = command.value1 != 0.0;
+                break;
+                
+            case TransportCommand::Type::SetLoopRange:
+                transport.loopStart = TimeBase::beatsToTicks(command.value1);
+                transport.loopEnd = TimeBase::beatsToTicks(command.value2);
+                break;
+        }
+    }
+}
+
+void Sequencer::publishSnapshot()
+{
+    // Sequence lock: odd while the fields are being written
+    const auto sequence = snapshotSequence.load(std::memory_order_relaxed);
+    snapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    snapshotBeats.store(TimeBase::ticksToBeats(tickAtSample(transport.playheadSample)), std::memory_order_relaxed);
+    snapshotSamples.store(transport.playheadSample, std::memory_order_relaxed);
+    snapshotPlaying.store(transport.playing, std::memory_order_relaxed);
+    
+    snapshotSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void Sequencer::readSnapshot(double& beats, juce::int64& samples, bool& isRunning) const
+{
+    for (;;)
+    {
+        const auto sequence = snapshotSequence.load(std::memory_order_acquire);
+        
+        if ((sequence & 1) != 0)
+            continue;
+        
+        beats = snapshotBeats.load(std::memory_order_relaxed);
+        samples = snapshotSamples.load(std::memory_order_relaxed);
+        isRunning = snapshotPlaying.load(std::memory_order_relaxed);
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        
+        if (snapshotSequence.load(std::memory_order_relaxed) == sequence)
+            return;
+    }
+}
+
+void Sequencer::acquirePendingTempoMap()
+{
+    Tick currentTick = 0;
+    
+    const bool swapped = tempoMap.acquire([this, &currentTick] (TempoMap& newMap)
+    {
+        // The new map takes over from the nearest tick to the playhead
+        currentTick = static_cast<Tick>(std::llround(tickAtSample(transport.playheadSample)));
+        
+        // In case the sample rate changed after the map was published
+        newMap.setSampleRate(currentSampleRate);
+    });
+    
+    if (!swapped)
+        return;
+    
+    tempoCursor = TempoMap::Cursor();
+    setAnchor(currentTick);
 }
 
-int Sequencer::secondsToSamples(double seconds) const
+double Sequencer::tickAtSample(juce::int64 sample) const
 {
-    return static_cast<int>(seconds * currentSampleRate);
+    const auto& anchor = transport.anchor;
+    const double mapSample = anchor.mapSample + static_cast<double>(sample - anchor.sample);
+    return tempoMap.get()->tickAtSample(mapSample, tempoCursor);
+}
+
+juce::int64 Sequencer::firstSampleAtOrAfterTick(Tick tick) const
+{
+    const auto& anchor = transport.anchor;
+    const double samplesFromAnchor = tempoMap.get()->sampleAtTick(static_cast<double>(tick), tempoCursor) - anchor.mapSample;
+    
+    // Allow for rounding in the map so that a tick exactly on a sample stays there
+    return anchor.sample + static_cast<juce::int64>(std::ceil(samplesFromAnchor - 1.0e-7));
+}
+
+Tick Sequencer::firstTickAtOrAfterSample(juce::int64 sample) const
+{
+    // Estimate, then correct against firstSampleAtOrAfterTick so that the tick
+    // ranges of consecutive segments line up exactly with their sample ranges
+    Tick tick = static_cast<Tick>(std::ceil(tickAtSample(sample)));
+    
+    while (firstSampleAtOrAfterTick(tick - 1) >= sample)
+        --tick;
+    
+    while (firstSampleAtOrAfterTick(tick) < sample)
+        ++tick;
+    
+    return tick;
+}
+
+void Sequencer::setAnchor(Tick tick)
+{
+    auto& anchor = transport.anchor;
+    anchor.tick = tick;
+    anchor.sample = transport.playheadSample;
+    anchor.mapSample = tempoMap.get()->sampleAtTick(static_cast<double>(tick), tempoCursor);
+}
+
+void Sequencer::releaseActiveNotes(int sampleOffset, Tick atTick, juce::MidiBuffer& midiBuffer)
+{
+    for (const auto& note : activeNotes)
+    {
+        midiBuffer.addEvent(juce::MidiMessage::noteOff(1, note.note, 0.0f), sampleOffset);
+        
+        // If we have a callback, notify it as well
+        if (noteEventCallback)
+        {
+            noteEventCallback(NoteEvent(note.note, 0, atTick, 0));
+        }
+    }
+    
+    activeNotes.clear();
 }
 
-void Sequencer::generateEvents(double startPosition, double endPosition, juce::MidiBuffer& midiBuffer)
+void Sequencer::generateEvents(juce::int64 blockStartSample, int segmentOffset, int segmentLength, juce::MidiBuffer& midiBuffer)
 {
-    if (!timeline)
+    const juce::int64 segmentStartSample = blockStartSample + segmentOffset;
+    const juce::int64 segmentEndSample = segmentStartSample + segmentLength;
+    
+    // End notes from earlier blocks first, so a retriggered note gets its note-off before the new note-on
+    checkNoteOffs(blockStartSample, segmentEndSample, midiBuffer);
+    
+    auto& playback = *notePlayback.get();
+    
+    if (playback.index == nullptr)
         return;
     
-    // Get all notes in the time range
-    std::vector<NoteEvent> notes = timeline->getNotesInRange(startPosition, endPosition);
+    // The ticks whose first sample falls inside this segment
+    const Tick startTick = firstTickAtOrAfterSample(segmentStartSample);
+    const Tick endTick = firstTickAtOrAfterSample(segmentEndSample);
+    
+    // Get all notes in the tick range (start ticks are relative to startTick)
+    blockNotes.clear();
+    playback.index->findNotes(startTick, endTick, blockNotes, &playback.cursors);
     
     // Generate MIDI messages for each note
-    for (const auto& note : notes)
+    for (const auto& note : blockNotes)
     {
-        // Calculate sample offsets
-        double noteStartSecs = beatsToSeconds(note.startTime - startPosition);
-        int noteStartSample = std::max(0, secondsToSamples(noteStartSecs));
+        const Tick noteStart = startTick + note.startTick;
+        
+        // Place the note-on on the first sample at or after the note's start
+        const juce::int64 noteSample = juce::jlimit(segmentStartSample, segmentEndSample - 1,
+                                                    firstSampleAtOrAfterTick(noteStart));
+        const int noteOffset = static_cast<int>(noteSample - blockStartSample);
+        
+        // Steal first, so a stolen note's note-off comes before this note-on
+        makeRoom(noteStart, noteOffset, midiBuffer);
         
         // Add note-on message
-        midiBuffer.addEvent(juce::MidiMessage::noteOn(1, note.note, static_cast<float>(note.velocity) / 127.0f), noteStartSample);
+        midiBuffer.addEvent(juce::MidiMessage::noteOn(1, note.note, static_cast<float>(note.velocity) / 127.0f), noteOffset);
         
         // Add to active notes
         ActiveNote activeNote;
         activeNote.note = note.note;
         activeNote.velocity = note.velocity;
-        activeNote.startTime = note.startTime;
-        activeNote.endTime = note.startTime + note.duration;
-        activeNotes.push_back(activeNote);
+        activeNote.startTick = noteStart;
+        activeNote.endTick = noteStart + note.durationTicks;
+        pushActiveNote(activeNote);
         
         // If we have a callback, notify it as well
         if (noteEventCallback)
         {
-            noteEventCallback(note);
+            NoteEvent event = note;
+            event.startTick = noteStart;
+            noteEventCallback(event);
         }
     }
     
-    // Check for note-offs that should happen in this time range
-    checkNoteOffs(endPosition, midiBuffer);
-    
-    // Generate parameter automation events
-    generateParameterEvents(endPosition);
+    // Notes that start and end within this segment
+    checkNoteOffs(blockStartSample, segmentEndSample, midiBuffer);
 }
 
-void Sequencer::checkNoteOffs(double currentTime, juce::MidiBuffer& midiBuffer)
+void Sequencer::checkNoteOffs(juce::int64 blockStartSample, juce::int64 segmentEndSample, juce::MidiBuffer& midiBuffer)
 {
-    // Find and process note-offs
-    std::vector<ActiveNote> remainingNotes;
-    
-    for (const auto& note : activeNotes)
+    // The heap keeps the note ending soonest at the front, so stop at the first one still sounding
+    while (!activeNotes.empty())
     {
-        if (note.endTime <= currentTime)
-        {
-            // This note should end now
-            double noteOffSecs = beatsToSeconds(note.endTime - lastEventPosition);
-            int noteOffSample = std::max(0, secondsToSamples(noteOffSecs));
-            
-            // Add note-off message
-            midiBuffer.addEvent(juce::MidiMessage::noteOff(1, note.note), noteOffSample);
-            
-            // If we have a callback, notify it as well
-            if (noteEventCallback)
-            {
-                NoteEvent event;
-                event.note = note.note;
-                event.velocity = 0;
-                event.startTime = note.endTime;
-                event.duration = 0.0;
-                noteEventCallback(event);
-            }
-        }
-        else
+        const ActiveNote& note = activeNotes.front();
+        const juce::int64 noteOffSample = firstSampleAtOrAfterTick(note.endTick);
+        
+        if (noteOffSample >= segmentEndSample)
+            break;
+        
+        // This note should end within the segment
+        const int noteOffOffset = static_cast<int>(std::max(noteOffSample, blockStartSample) - blockStartSample);
+        
+        // Add note-off message
+        midiBuffer.addEvent(juce::MidiMessage::noteOff(1, note.note), noteOffOffset);
+        
+        // If we have a callback, notify it as well
+        if (noteEventCallback)
         {
-            // This note is still active
-            remainingNotes.push_back(note);
+            noteEventCallback(NoteEvent(note.note, 0, note.endTick, 0));
         }
+        
+        std::pop_heap(activeNotes.begin(), activeNotes.end(), endsAfter);
+        activeNotes.pop_back();
     }
+}
+
+bool Sequencer::endsAfter(const ActiveNote& a, const ActiveNote& b)
+{
+    return a.endTick > b.endTick;
+}
+
+void Sequencer::makeRoom(Tick atTick, int sampleOffset, juce::MidiBuffer& midiBuffer)
+{
+    if (static_cast<int>(activeNotes.size()) < maxActiveNotes)
+        return;
+    
+    // Out of room: end the note that was due to end first
+    const ActiveNote& stolen = activeNotes.front();
+    midiBuffer.addEvent(juce::MidiMessage::noteOff(1, stolen.note), sampleOffset);
     
-    // Update the active notes list
-    activeNotes = std::move(remainingNotes);
+    if (noteEventCallback)
+    {
+        noteEventCallback(NoteEvent(stolen.note, 0, atTick, 0));
+    }
+    
+    std::pop_heap(activeNotes.begin(), activeNotes.end(), endsAfter);
+    activeNotes.pop_back();
+}
+
+void Sequencer::pushActiveNote(const ActiveNote& note)
+{
+    // makeRoom() has run, so this stays within the reserved capacity
+    jassert(static_cast<int>(activeNotes.size()) < maxActiveNotes);
+    
+    activeNotes.push_back(note);
+    std::push_heap(activeNotes.begin(), activeNotes.end(), endsAfter);
 }
 
 void Sequencer::generateParameterEvents(double currentTime)
 {
-    if (!timeline || !parameterCallback)
+    automationPlan.acquire();
+    
+    if (!parameterCallback)
         return;
     
-    // Get all automated parameters
-    if (auto patterns = timeline->getPatternInstances(); !patterns.empty())
+    for (auto& lane : automationPlan.get()->lanes)
     {
-        for (const auto& instance : patterns)
-        {
-            if (instance.muted)
-                continue;
-            
-            if (auto pattern = timeline->getPattern(instance.patternId))
-            {
-                // Get all automated parameters
-                auto params = pattern->getAutomatedParameters();
-                
-                for (const auto& paramId : params)
-                {
-                    // Get the value at the current time
-                    float value = pattern->getParameterValueAtTime(paramId, currentTime - instance.startTime);
-                    
-                    // Notify the callback
-                    parameterCallback(paramId, value);
-                }
-            }
-        }
+        // Get the value at the current time
+        const float value = Pattern::getAutomationValueAtTime(lane.points, currentTime - lane.startTime);
+        
+        // Only notify the callback when the value moves
+        if (lane.sent && value == lane.lastValue)
+            continue;
+        
+        lane.lastValue = value;
+        lane.sent = true;
+        parameterCallback(lane.paramId, value);
     }
 }
 
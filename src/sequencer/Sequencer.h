@@ -8,8 +8,11 @@
 #pragma once
 
 #include "Timeline.h"
+#include "../utils/Concurrency.h"
 #include <JuceHeader.h>
+#include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 #include <functional>
 
@@ -22,9 +25,20 @@ namespace UndergroundBeats {
  * The Sequencer class manages playback of a timeline, generating MIDI events
  * based on the notes and automation in the timeline. It handles transport
  * controls, tempo, time signature, and quantization.
+ *
+ * The transport clock runs on the audio thread and counts samples, so every
+ * note-on and note-off lands on its exact sample offset within the block.
+ * Musical time inside the sequencer is in integer ticks (see TimeBase.h);
+ * each block is mapped to the exact tick range whose notes fall on its
+ * samples, so no note is skipped or played twice and loops never drift.
+ * Ticks are converted to samples through the timeline's TempoMap, so tempo
+ * changes and ramps in the arrangement are followed exactly.
+ * Transport changes made from the message thread (play, stop, locate, tempo,
+ * loop) are queued and applied at the start of the next block, and the UI
+ * reads the position from a snapshot the audio thread publishes after each
+ * block.
  */
-class Sequencer : public juce::MidiKeyboardStateListener,
-                 public juce::Timer {
+class Sequencer : public juce::MidiKeyboardStateListener {
 public:
     Sequencer();
     ~Sequencer();
@@ -68,20 +82,32 @@ public:
     /**
      * @brief Get the current playback position
      * 
+     * Reads the snapshot published by the audio thread after its last block.
+     * 
      * @return The current position in beats
      */
     double getPosition() const;
     
+    /**
+     * @brief Get the transport's sample counter
+     * 
+     * @return The number of samples the transport has played
+     */
+    juce::int64 getPositionInSamples() const;
+    
     /**
      * @brief Check if the sequencer is currently playing
      * 
-     * @return true if playing, false if stopped
+     * @return true if the audio thread's transport is running
      */
     bool isPlaying() const;
     
     /**
      * @brief Set the tempo in beats per minute
      * 
+     * Sets the tempo at the start of the timeline's tempo map; later tempo
+     * changes in the map still apply.
+     * 
      * @param bpm Tempo in BPM
      */
     void setTempo(double bpm);
@@ -89,10 +115,38 @@ public:
     /**
      * @brief Get the current tempo
      * 
-     * @return The current tempo in BPM
+     * @return The tempo at the start of the timeline in BPM
      */
     double getTempo() const;
     
+    /**
+     * @brief Hand the timeline's current tempo map to the audio thread
+     * 
+     * Call this on the message thread after editing the timeline's tempo map.
+     * The audio thread switches to the new map at the start of its next block.
+     */
+    void tempoMapChanged();
+    
+    /**
+     * @brief Hand the timeline's notes and automation to the audio thread
+     * 
+     * Call this on the message thread after adding, removing, moving or
+     * muting pattern instances, or after editing any pattern's notes. The
+     * audio thread plays a snapshot of the arrangement, so the timeline can be
+     * edited freely in between; it switches to the new snapshot at the start
+     * of its next block. Also calls automationChanged().
+     */
+    void arrangementChanged();
+    
+    /**
+     * @brief Hand the timeline's automation to the audio thread
+     * 
+     * Call this on the message thread after any change to automation. The
+     * audio thread plays a copy of every automation lane, so the timeline's
+     * own lanes can be edited freely.
+     */
+    void automationChanged();
+    
     /**
      * @brief Set the time signature
      * 
@@ -172,16 +226,22 @@ public:
     double getQuantizationGrid() const;
     
     /**
-     * @brief Process incoming MIDI messages
+     * @brief Advance the transport by one block and generate its MIDI
+     * 
+     * Called on the audio thread. Note events are placed at their exact sample
+     * offsets within the block.
      * 
      * @param midiInput The MIDI messages to process
      * @param midiOutput Buffer to write output MIDI messages to
+     * @param numSamples The number of samples in this block
      */
-    void processMidi(const juce::MidiBuffer& midiInput, juce::MidiBuffer& midiOutput);
+    void processMidi(const juce::MidiBuffer& midiInput, juce::MidiBuffer& midiOutput, int numSamples);
     
     /**
      * @brief Set a callback function for note events
      * 
+     * The callback is invoked on the audio thread.
+     * 
      * @param callback Function to call when note events occur
      */
     void setNoteEventCallback(std::function<void(const NoteEvent&)> callback);
@@ -221,11 +281,6 @@ public:
      */
     void handleNoteOff(juce::MidiKeyboardState* keyboardState, int midiChannel, int midiNoteNumber, float velocity) override;
     
-    /**
-     * @brief Timer callback (to advance playback position)
-     */
-    void timerCallback() override;
-    
     /**
      * @brief Prepare the sequencer for playback
      * 
@@ -251,11 +306,11 @@ public:
     
 private:
     std::shared_ptr<Timeline> timeline;
-    double currentPosition; // Position in beats
+    
+    // Settings as last requested from the message thread
     double tempo; // Tempo in BPM
     int timeSignatureNumerator;
     int timeSignatureDenominator;
-    bool playing;
     bool looping;
     double loopStart; // Loop start in beats
     double loopEnd; // Loop end in beats
@@ -269,36 +324,127 @@ private:
     double currentSampleRate;
     int currentBlockSize;
     
-    // Timer interval in milliseconds (higher values = lower CPU usage, but less accuracy)
-    static constexpr int timerIntervalMs = 10;
+    // Transport changes sent from the message thread to the audio thread
+    struct TransportCommand {
+        enum class Type { Play, Stop, Locate, SetLooping, SetLoopRange };
+        
+        Type type;
+        double value1;
+        double value2;
+    };
+    
+    Concurrency::LockFreeQueue<TransportCommand, 64> commandQueue;
+    
+    void sendCommand(TransportCommand::Type type, double value1 = 0.0, double value2 = 0.0);
+    
+    // A whole tick the transport was placed on, the playhead sample it fell
+    // on, and that tick's position in the tempo map. Positions are converted
+    // relative to the anchor, so rounding never accumulates.
+    struct TransportAnchor {
+        Tick tick = 0;
+        juce::int64 sample = 0;
+        double mapSample = 0.0;
+    };
+    
+    // Transport state owned by the audio thread. The playhead is a sample
+    // counter; the anchor moves on locate, loop wrap and tempo map change.
+    struct TransportState {
+        bool playing = false;
+        bool looping = false;
+        Tick loopStart = 0;
+        Tick loopEnd = 4 * TimeBase::ticksPerBeat;
+        juce::int64 playheadSample = 0;
+        TransportAnchor anchor;
+    };
+    
+    TransportState transport;
+    
+    // The audio thread's copy of the tempo map: the message thread publishes a
+    // new copy, the audio thread swaps it in at the start of a block
+    Concurrency::RetiringPointer<TempoMap> tempoMap;
+    mutable TempoMap::Cursor tempoCursor;
+    
+    void acquirePendingTempoMap();
+    
+    // A copy of one automated parameter of an unmuted pattern instance, and
+    // the value last sent for it (audio thread)
+    struct AutomationLane {
+        std::vector<AutomationPoint> points;
+        std::string paramId;
+        double startTime = 0.0; // Instance start in beats
+        float lastValue = 0.0f;
+        bool sent = false;
+    };
     
-    // Last time we generated events (to avoid duplicates)
-    double lastEventPosition;
+    // The automated parameters, copied on the message thread so the audio
+    // thread never builds the list itself or reads the timeline's lanes
+    struct AutomationPlan {
+        std::vector<AutomationLane> lanes;
+    };
+    
+    Concurrency::RetiringPointer<AutomationPlan> automationPlan;
+    
+    // Position snapshot published by the audio thread (sequence-locked)
+    std::atomic<juce::uint32> snapshotSequence { 0 };
+    std::atomic<double> snapshotBeats { 0.0 };
+    std::atomic<juce::int64> snapshotSamples { 0 };
+    std::atomic<bool> snapshotPlaying { false };
+    
+    void publishSnapshot();
+    void readSnapshot(double& beats, juce::int64& samples, bool& isPlaying) const;
     
     // Currently playing notes (to handle note-offs correctly)
     struct ActiveNote {
         int note;
         int velocity;
-        double startTime;
-        double endTime;
+        Tick startTick;
+        Tick endTick;
     };
     
+    // Maximum number of notes sounding at once; further notes steal the one ending soonest
+    static constexpr int maxActiveNotes = 512;
+    
+    // Min-heap on end tick, with its capacity allocated up front, so the
+    // audio thread only looks at notes that are due and never allocates
     std::vector<ActiveNote> activeNotes;
     
-    // Convert beats to time in seconds
-    double beatsToSeconds(double beats) const;
+    static bool endsAfter(const ActiveNote& a, const ActiveNote& b);
+    
+    // Steal the note ending soonest if no more notes can sound, at the given block offset
+    void makeRoom(Tick atTick, int sampleOffset, juce::MidiBuffer& midiBuffer);
+    void pushActiveNote(const ActiveNote& note);
+    
+    // The audio thread's snapshot of the arrangement's notes, with its own
+    // playback cursors; published by the message thread like the tempo map
+    struct NotePlayback {
+        std::unique_ptr<TimelineIndex> index;
+        TimelineIndex::Cursors cursors;
+    };
+    
+    Concurrency::RetiringPointer<NotePlayback> notePlayback;
+    
+    // Notes fetched from the snapshot for the current block (reused between blocks)
+    std::vector<NoteEvent> blockNotes;
+    
+    // Apply queued transport commands at the start of a block
+    void applyTransportCommands(juce::MidiBuffer& midiOutput);
+    
+    // Convert between the sample playhead and ticks through the tempo map
+    double tickAtSample(juce::int64 sample) const;
+    juce::int64 firstSampleAtOrAfterTick(Tick tick) const;
+    Tick firstTickAtOrAfterSample(juce::int64 sample) const;
     
-    // Convert time in seconds to beats
-    double secondsToBeats(double seconds) const;
+    // Anchor the transport so that the current playhead is at the given tick
+    void setAnchor(Tick tick);
     
-    // Convert time in seconds to samples
-    int secondsToSamples(double seconds) const;
+    // Send note-offs for every active note at the given block offset
+    void releaseActiveNotes(int sampleOffset, Tick atTick, juce::MidiBuffer& midiBuffer);
     
-    // Generate events for the current position
-    void generateEvents(double startPosition, double endPosition, juce::MidiBuffer& midiBuffer);
+    // Generate events for the samples [segmentStart, segmentStart + segmentLength) of the block
+    void generateEvents(juce::int64 blockStartSample, int segmentOffset, int segmentLength, juce::MidiBuffer& midiBuffer);
     
-    // Check for note-offs that should happen
-    void checkNoteOffs(double currentTime, juce::MidiBuffer& midiBuffer);
+    // Send note-offs for the notes ending before the given sample, soonest first
+    void checkNoteOffs(juce::int64 blockStartSample, juce::int64 segmentEndSample, juce::MidiBuffer& midiBuffer);
     
     // Generate parameter automation events
     void generateParameterEvents(double currentTime);
@@ -0,0 +1,329 @@
+/*
+ * Underground Beats
+ * TempoMap.cpp
+ *
+ * Implementation of the tempo map
+ */
+
+#include "TempoMap.h"
+#include <algorithm>
+#include <cmath>
+
+namespace UndergroundBeats {
+
+namespace {
+
+constexpr double minTempo = 1.0;
+constexpr double maxTempo = 999.0;
+
+// Below this slope a ramp is treated as constant, avoiding 0 / 0 in the ramp formulas
+constexpr double minRampSlope = 1.0e-12;
+
+} // namespace
+
+TempoMap::TempoMap(double initialBpm)
+    : sampleRate(44100.0),
+      version(0)
+{
+    tempoPoints.push_back({ 0, juce::jlimit(minTempo, maxTempo, initialBpm), false });
+    timeSignatures.push_back({ 0, 4, 4 });
+    rebuildSegments();
+}
+
+TempoMap::~TempoMap()
+{
+}
+
+void TempoMap::setSampleRate(double newSampleRate)
+{
+    if (newSampleRate > 0.0 && newSampleRate != sampleRate)
+    {
+        sampleRate = newSampleRate;
+        rebuildSegments();
+    }
+}
+
+double TempoMap::getSampleRate() const
+{
+    return sampleRate;
+}
+
+int TempoMap::setTempo(Tick tick, double bpm, bool rampToNext)
+{
+    const TempoPoint point { std::max<Tick>(0, tick), juce::jlimit(minTempo, maxTempo, bpm), rampToNext };
+
+    auto it = std::lower_bound(tempoPoints.begin(), tempoPoints.end(), point.tick,
+                               [](const TempoPoint& p, Tick t) { return p.tick < t; });
+
+    if (it != tempoPoints.end() && it->tick == point.tick)
+        *it = point;
+    else
+        it = tempoPoints.insert(it, point);
+
+    rebuildSegments();
+
+    return static_cast<int>(std::distance(tempoPoints.begin(), it));
+}
+
+void TempoMap::setInitialTempo(double bpm)
+{
+    tempoPoints.front().bpm = juce::jlimit(minTempo, maxTempo, bpm);
+    rebuildSegments();
+}
+
+bool TempoMap::removeTempoPoint(int index)
+{
+    if (index <= 0 || index >= static_cast<int>(tempoPoints.size()))
+        return false;
+
+    tempoPoints.erase(tempoPoints.begin() + index);
+    rebuildSegments();
+
+    return true;
+}
+
+const std::vector<TempoPoint>& TempoMap::getTempoPoints() const
+{
+    return tempoPoints;
+}
+
+double TempoMap::getTempoAt(Tick tick) const
+{
+    const auto& segment = segments[static_cast<size_t>(findSegmentForTick(static_cast<double>(tick), 0))];
+    const double ticksIntoSegment = static_cast<double>(std::max<Tick>(0, tick - segment.startTick));
+    return segment.startBpm + segment.bpmPerTick * ticksIntoSegment;
+}
+
+int TempoMap::setTimeSignature(Tick tick, int numerator, int denominator)
+{
+    const TimeSignaturePoint point { std::max<Tick>(0, tick), std::max(1, numerator), std::max(1, denominator) };
+
+    auto it = std::lower_bound(timeSignatures.begin(), timeSignatures.end(), point.tick,
+                               [](const TimeSignaturePoint& p, Tick t) { return p.tick < t; });
+
+    if (it != timeSignatures.end() && it->tick == point.tick)
+        *it = point;
+    else
+        it = timeSignatures.insert(it, point);
+
+    ++version;
+
+    return static_cast<int>(std::distance(timeSignatures.begin(), it));
+}
+
+bool TempoMap::removeTimeSignature(int index)
+{
+    if (index <= 0 || index >= static_cast<int>(timeSignatures.size()))
+        return false;
+
+    timeSignatures.erase(timeSignatures.begin() + index);
+    ++version;
+
+    return true;
+}
+
+const std::vector<TimeSignaturePoint>& TempoMap::getTimeSignatures() const
+{
+    return timeSignatures;
+}
+
+const TimeSignaturePoint& TempoMap::getTimeSignatureAt(Tick tick) const
+{
+    // Last change at or before the tick; the first one is at tick 0
+    auto it = std::upper_bound(timeSignatures.begin(), timeSignatures.end(), tick,
+                               [](Tick t, const TimeSignaturePoint& p) { return t < p.tick; });
+
+    return it == timeSignatures.begin() ? *it : *(it - 1);
+}
+
+double TempoMap::sampleAtTick(double tick) const
+{
+    Cursor cursor;
+    return sampleAtTick(tick, cursor);
+}
+
+double TempoMap::sampleAtTick(double tick, Cursor& cursor) const
+{
+    cursor.segment = findSegmentForTick(tick, cursor.segment);
+    const auto& segment = segments[static_cast<size_t>(cursor.segment)];
+    return segment.startSample + samplesInto(segment, tick - static_cast<double>(segment.startTick));
+}
+
+double TempoMap::tickAtSample(double sample) const
+{
+    Cursor cursor;
+    return tickAtSample(sample, cursor);
+}
+
+double TempoMap::tickAtSample(double sample, Cursor& cursor) const
+{
+    cursor.segment = findSegmentForSample(sample, cursor.segment);
+    const auto& segment = segments[static_cast<size_t>(cursor.segment)];
+    return static_cast<double>(segment.startTick) + ticksInto(segment, sample - segment.startSample);
+}
+
+juce::uint32 TempoMap::getVersion() const
+{
+    return version;
+}
+
+std::unique_ptr<juce::XmlElement> TempoMap::createStateXml() const
+{
+    auto xml = std::make_unique<juce::XmlElement>("TempoMap");
+
+    for (const auto& point : tempoPoints)
+    {
+        auto pointXml = xml->createNewChildElement("Tempo");
+        pointXml->setAttribute("position", TimeBase::ticksToBeats(point.tick));
+        pointXml->setAttribute("bpm", point.bpm);
+        pointXml->setAttribute("ramp", point.rampToNext);
+    }
+
+    for (const auto& timeSignature : timeSignatures)
+    {
+        auto signatureXml = xml->createNewChildElement("TimeSignature");
+        signatureXml->setAttribute("position", TimeBase::ticksToBeats(timeSignature.tick));
+        signatureXml->setAttribute("numerator", timeSignature.numerator);
+        signatureXml->setAttribute("denominator", timeSignature.denominator);
+    }
+
+    return xml;
+}
+
+bool TempoMap::restoreStateFromXml(const juce::XmlElement* xml)
+{
+    if (xml == nullptr || xml->getTagName() != "TempoMap")
+        return false;
+
+    tempoPoints.assign(1, { 0, 120.0, false });
+    timeSignatures.assign(1, { 0, 4, 4 });
+
+    for (auto* pointXml : xml->getChildWithTagNameIterator("Tempo"))
+    {
+        setTempo(TimeBase::beatsToTicks(pointXml->getDoubleAttribute("position", 0.0)),
+                 pointXml->getDoubleAttribute("bpm", 120.0),
+                 pointXml->getBoolAttribute("ramp", false));
+    }
+
+    for (auto* signatureXml : xml->getChildWithTagNameIterator("TimeSignature"))
+    {
+        setTimeSignature(TimeBase::beatsToTicks(signatureXml->getDoubleAttribute("position", 0.0)),
+                         signatureXml->getIntAttribute("numerator", 4),
+                         signatureXml->getIntAttribute("denominator", 4));
+    }
+
+    rebuildSegments();
+
+    return true;
+}
+
+void TempoMap::rebuildSegments()
+{
+    segments.clear();
+    segments.reserve(tempoPoints.size());
+
+    double startSample = 0.0;
+
+    for (size_t i = 0; i < tempoPoints.size(); ++i)
+    {
+        const auto& point = tempoPoints[i];
+
+        Segment segment;
+        segment.startTick = point.tick;
+        segment.startSample = startSample;
+        segment.startBpm = point.bpm;
+        segment.bpmPerTick = 0.0;
+
+        if (i + 1 < tempoPoints.size())
+        {
+            const auto& next = tempoPoints[i + 1];
+            const double length = static_cast<double>(next.tick - point.tick);
+
+            if (point.rampToNext)
+                segment.bpmPerTick = (next.bpm - point.bpm) / length;
+
+            // The next segment starts where this one ends
+            startSample += samplesInto(segment, length);
+        }
+
+        segments.push_back(segment);
+    }
+
+    ++version;
+}
+
+double TempoMap::sampleScale() const
+{
+    // (60.0 / tempo) = seconds per beat
+    return sampleRate * 60.0 / static_cast<double>(TimeBase::ticksPerBeat);
+}
+
+double TempoMap::samplesInto(const Segment& segment, double ticks) const
+{
+    // Before the first point the initial tempo is extended backwards
+    if (std::abs(segment.bpmPerTick) < minRampSlope || ticks <= 0.0)
+        return sampleScale() * ticks / segment.startBpm;
+
+    // Integral of scale / (startBpm + slope * t) dt from 0 to ticks
+    const double endBpm = segment.startBpm + segment.bpmPerTick * ticks;
+    return sampleScale() / segment.bpmPerTick * std::log(endBpm / segment.startBpm);
+}
+
+double TempoMap::ticksInto(const Segment& segment, double samples) const
+{
+    if (std::abs(segment.bpmPerTick) < minRampSlope || samples <= 0.0)
+        return samples * segment.startBpm / sampleScale();
+
+    // Inverse of samplesInto: the tempo grows exponentially with elapsed samples
+    const double bpm = segment.startBpm * std::exp(samples * segment.bpmPerTick / sampleScale());
+    return (bpm - segment.startBpm) / segment.bpmPerTick;
+}
+
+int TempoMap::findSegmentForTick(double tick, int hint) const
+{
+    const int numSegments = static_cast<int>(segments.size());
+    auto contains = [&](int i) {
+        return (i == 0 || static_cast<double>(segments[static_cast<size_t>(i)].startTick) <= tick)
+            && (i + 1 == numSegments || tick < static_cast<double>(segments[static_cast<size_t>(i + 1)].startTick));
+    };
+
+    // Usually the reader is still in the same segment, or has just moved into the next one
+    if (hint >= 0 && hint < numSegments)
+    {
+        if (contains(hint))
+            return hint;
+
+        if (hint + 1 < numSegments && contains(hint + 1))
+            return hint + 1;
+    }
+
+    auto it = std::upper_bound(segments.begin() + 1, segments.end(), tick,
+                               [](double t, const Segment& s) { return t < static_cast<double>(s.startTick); });
+
+    return static_cast<int>(std::distance(segments.begin(), it)) - 1;
+}
+
+int TempoMap::findSegmentForSample(double sample, int hint) const
+{
+    const int numSegments = static_cast<int>(segments.size());
+    auto contains = [&](int i) {
+        return (i == 0 || segments[static_cast<size_t>(i)].startSample <= sample)
+            && (i + 1 == numSegments || sample < segments[static_cast<size_t>(i + 1)].startSample);
+    };
+
+    if (hint >= 0 && hint < numSegments)
+    {
+        if (contains(hint))
+            return hint;
+
+        if (hint + 1 < numSegments && contains(hint + 1))
+            return hint + 1;
+    }
+
+    auto it = std::upper_bound(segments.begin() + 1, segments.end(), sample,
+                               [](double s, const Segment& segment) { return s < segment.startSample; });
+
+    return static_cast<int>(std::distance(segments.begin(), it)) - 1;
+}
+
+} // namespace UndergroundBeats
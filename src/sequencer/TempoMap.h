@@ -0,0 +1,207 @@
+/*
+ * Underground Beats
+ * TempoMap.h
+ *
+ * Tempo and time signature changes along the timeline
+ */
+
+#pragma once
+
+#include "TimeBase.h"
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+namespace UndergroundBeats {
+
+/**
+ * @brief A tempo change at a position in the timeline
+ */
+struct TempoPoint {
+    Tick tick;         // Position of the change in ticks
+    double bpm;        // Tempo from this point on
+    bool rampToNext;   // Whether the tempo ramps linearly (in ticks) to the next point's tempo
+};
+
+/**
+ * @brief A time signature change at a position in the timeline
+ */
+struct TimeSignaturePoint {
+    Tick tick;         // Position of the change in ticks
+    int numerator;
+    int denominator;
+};
+
+/**
+ * @class TempoMap
+ * @brief Tempo and time signature changes along the timeline
+ *
+ * The map holds a list of tempo points, each either constant up to the next
+ * point or ramping linearly to the next point's tempo, plus a list of time
+ * signature changes. There is always a tempo point and a time signature at
+ * tick 0.
+ *
+ * Every change rebuilds a segment table that caches the sample position at
+ * which each tempo segment starts. Converting a tick to a sample (or back) is
+ * then a binary search for the segment plus a closed-form expression within
+ * it: constant segments are linear, and ramps integrate 1 / tempo exactly, so
+ * nothing is ever accumulated sample by sample. Readers that move forward
+ * through time can pass a Cursor, which makes the segment lookup O(1).
+ */
+class TempoMap {
+public:
+    /**
+     * @brief Remembers the segment used by the previous conversion
+     *
+     * Each reader keeps its own cursor. A default-constructed cursor is valid.
+     */
+    struct Cursor {
+        int segment = 0;
+    };
+
+    explicit TempoMap(double initialBpm = 120.0);
+    ~TempoMap();
+
+    /**
+     * @brief Set the sample rate used for sample positions
+     */
+    void setSampleRate(double sampleRate);
+
+    /**
+     * @brief Get the sample rate used for sample positions
+     */
+    double getSampleRate() const;
+
+    /**
+     * @brief Set or replace the tempo at a position
+     *
+     * @param tick Position of the change in ticks (negative values are clamped to 0)
+     * @param bpm Tempo in BPM
+     * @param rampToNext Whether to ramp linearly to the next tempo point
+     * @return Index of the tempo point
+     */
+    int setTempo(Tick tick, double bpm, bool rampToNext = false);
+
+    /**
+     * @brief Set the tempo at the start of the timeline
+     */
+    void setInitialTempo(double bpm);
+
+    /**
+     * @brief Remove a tempo point
+     *
+     * @param index Index of the point; the point at tick 0 cannot be removed
+     * @return true if the point was removed
+     */
+    bool removeTempoPoint(int index);
+
+    /**
+     * @brief Get all tempo points, sorted by position
+     */
+    const std::vector<TempoPoint>& getTempoPoints() const;
+
+    /**
+     * @brief Get the tempo at a position
+     *
+     * @param tick Position in ticks
+     * @return The tempo in BPM, including any ramp in progress
+     */
+    double getTempoAt(Tick tick) const;
+
+    /**
+     * @brief Set or replace the time signature at a position
+     *
+     * @param tick Position of the change in ticks (negative values are clamped to 0)
+     * @param numerator Time signature numerator
+     * @param denominator Time signature denominator
+     * @return Index of the time signature point
+     */
+    int setTimeSignature(Tick tick, int numerator, int denominator);
+
+    /**
+     * @brief Remove a time signature change
+     *
+     * @param index Index of the change; the one at tick 0 cannot be removed
+     * @return true if the change was removed
+     */
+    bool removeTimeSignature(int index);
+
+    /**
+     * @brief Get all time signature changes, sorted by position
+     */
+    const std::vector<TimeSignaturePoint>& getTimeSignatures() const;
+
+    /**
+     * @brief Get the time signature in effect at a position
+     */
+    const TimeSignaturePoint& getTimeSignatureAt(Tick tick) const;
+
+    /**
+     * @brief Convert a tick position to a sample position
+     *
+     * @param tick Position in ticks (may be fractional)
+     * @return Position in samples from the start of the timeline
+     */
+    double sampleAtTick(double tick) const;
+    double sampleAtTick(double tick, Cursor& cursor) const;
+
+    /**
+     * @brief Convert a sample position to a tick position
+     *
+     * @param sample Position in samples from the start of the timeline
+     * @return Position in ticks (fractional)
+     */
+    double tickAtSample(double sample) const;
+    double tickAtSample(double sample, Cursor& cursor) const;
+
+    /**
+     * @brief Get the version number, which changes with every edit
+     */
+    juce::uint32 getVersion() const;
+
+    /**
+     * @brief Create an XML element containing the tempo map
+     */
+    std::unique_ptr<juce::XmlElement> createStateXml() const;
+
+    /**
+     * @brief Restore the tempo map from an XML element
+     *
+     * @return true if the state was restored
+     */
+    bool restoreStateFromXml(const juce::XmlElement* xml);
+
+private:
+    std::vector<TempoPoint> tempoPoints;
+    std::vector<TimeSignaturePoint> timeSignatures;
+    double sampleRate;
+    juce::uint32 version;
+
+    // One entry per tempo point, with its cached start position in samples
+    struct Segment {
+        Tick startTick;
+        double startSample;
+        double startBpm;
+        double bpmPerTick; // Slope of a ramp; 0 for a constant tempo
+    };
+
+    std::vector<Segment> segments;
+
+    // Rebuild the segment table after a change
+    void rebuildSegments();
+
+    // Samples per (tick / bpm), i.e. sampleRate * 60 / ticksPerBeat
+    double sampleScale() const;
+
+    // Samples from the segment start to the given tick offset into it, and the inverse
+    double samplesInto(const Segment& segment, double ticks) const;
+    double ticksInto(const Segment& segment, double samples) const;
+
+    // Find the segment containing a tick / sample position, starting from a hint
+    int findSegmentForTick(double tick, int hint) const;
+    int findSegmentForSample(double sample, int hint) const;
+
+    JUCE_LEAK_DETECTOR(TempoMap)
+};
+
+} // namespace UndergroundBeats
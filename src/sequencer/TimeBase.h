@@ -0,0 +1,61 @@
+/*
+ * Underground Beats
+ * TimeBase.h
+ *
+ * Integer tick timebase used for musical time in the sequencer
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+
+namespace UndergroundBeats {
+
+/**
+ * @brief A musical position or length in ticks
+ *
+ * Ticks are a fixed fraction of a beat, so positions compare and add exactly
+ * and a loop that is replayed for hours lands on the same ticks every time.
+ * Beats (as double) remain the unit of the public editing API; conversion
+ * happens once, when a value enters or leaves the sequencer.
+ */
+using Tick = juce::int64;
+
+namespace TimeBase {
+
+/**
+ * @brief Ticks per beat (pulses per quarter note)
+ *
+ * 960 divides evenly into every common note length down to 64th-note
+ * triplets and quintuplets.
+ */
+constexpr Tick ticksPerBeat = 960;
+
+/**
+ * @brief Convert a time in beats to the nearest tick
+ */
+inline Tick beatsToTicks(double beats)
+{
+    return static_cast<Tick>(std::llround(beats * static_cast<double>(ticksPerBeat)));
+}
+
+/**
+ * @brief Convert a tick position to beats
+ */
+inline double ticksToBeats(Tick ticks)
+{
+    return static_cast<double>(ticks) / static_cast<double>(ticksPerBeat);
+}
+
+/**
+ * @brief Convert a fractional tick position to beats
+ */
+inline double ticksToBeats(double ticks)
+{
+    return ticks / static_cast<double>(ticksPerBeat);
+}
+
+} // namespace TimeBase
+
+} // namespace UndergroundBeats
@@ -11,7 +11,8 @@
 namespace UndergroundBeats {
 
 Timeline::Timeline()
-    : nextPatternId(0)
+    : nextPatternId(0),
+      noteIndex(createIndex())
 {
 }
 
@@ -31,6 +32,7 @@ int Timeline::addPattern(std::unique_ptr<Pattern> pattern)
     
     // Update any pattern instances that use this pattern
     updateAllPatternInstanceEndTimes();
+    rebuildIndex();
     
     return patternId;
 }
@@ -53,6 +55,7 @@ bool Timeline::removePattern(int patternId)
     
     // Remove the pattern from the library
     patterns.erase(it);
+    rebuildIndex();
     
     return true;
 }
@@ -82,10 +85,11 @@ int Timeline::addPatternInstance(int patternId, double startTime, bool muted)
     }
     
     // Create the pattern instance
-    PatternInstance instance(patternId, startTime, muted);
+    const Tick startTick = TimeBase::beatsToTicks(startTime);
+    PatternInstance instance(patternId, startTick, muted);
     
     // Calculate end time based on pattern length
-    instance.endTime = startTime + it->second->getLength();
+    instance.endTick = startTick + it->second->getLengthInTicks();
     
     // Add the instance to the timeline
     patternInstances.push_back(instance);
@@ -93,15 +97,17 @@ int Timeline::addPatternInstance(int patternId, double startTime, bool muted)
     // Sort by start time
     std::sort(patternInstances.begin(), patternInstances.end(),
              [](const PatternInstance& a, const PatternInstance& b) {
-                 return a.startTime < b.startTime;
+                 return a.startTick < b.startTick;
              });
     
     // Find the index of the added instance
     auto instanceIt = std::find_if(patternInstances.begin(), patternInstances.end(),
-                                 [patternId, startTime](const PatternInstance& p) {
-                                     return p.patternId == patternId && p.startTime == startTime;
+                                 [patternId, startTick](const PatternInstance& p) {
+                                     return p.patternId == patternId && p.startTick == startTick;
                                  });
     
+    rebuildIndex();
+    
     return static_cast<int>(std::distance(patternInstances.begin(), instanceIt));
 }
 
@@ -113,6 +119,7 @@ bool Timeline::removePatternInstance(int index)
     }
     
     patternInstances.erase(patternInstances.begin() + index);
+    rebuildIndex();
     
     return true;
 }
@@ -125,7 +132,7 @@ bool Timeline::movePatternInstance(int index, double newStartTime)
     }
     
     // Update start time
-    patternInstances[index].startTime = newStartTime;
+    patternInstances[index].startTick = TimeBase::beatsToTicks(newStartTime);
     
     // Update end time
     updatePatternInstanceEndTime(index);
@@ -133,9 +140,11 @@ bool Timeline::movePatternInstance(int index, double newStartTime)
     // Sort by start time
     std::sort(patternInstances.begin(), patternInstances.end(),
              [](const PatternInstance& a, const PatternInstance& b) {
-                 return a.startTime < b.startTime;
+                 return a.startTick < b.startTick;
              });
     
+    rebuildIndex();
+    
     return true;
 }
 
@@ -147,6 +156,7 @@ bool Timeline::setPatternInstanceMuted(int index, bool muted)
     }
     
     patternInstances[index].muted = muted;
+    rebuildIndex();
     
     return true;
 }
@@ -174,49 +184,26 @@ const std::vector<PatternInstance>& Timeline::getPatternInstances() const
 std::vector<NoteEvent> Timeline::getNotesInRange(double startTime, double endTime) const
 {
     std::vector<NoteEvent> result;
+    getNotesInRange(TimeBase::beatsToTicks(startTime), TimeBase::beatsToTicks(endTime), result);
+    return result;
+}
+
+void Timeline::getNotesInRange(Tick startTick, Tick endTick, std::vector<NoteEvent>& result) const
+{
+    result.clear();
     
-    // For each pattern instance that overlaps with the range
-    for (const auto& instance : patternInstances)
+    // Notes edited directly on a pattern are not in the index yet
+    if (noteIndex->isOutOfDate())
     {
-        // Skip muted patterns
-        if (instance.muted)
-        {
-            continue;
-        }
-        
-        // Check if the pattern instance overlaps with the requested range
-        if (instance.endTime > startTime && instance.startTime < endTime)
-        {
-            auto patternIt = patterns.find(instance.patternId);
-            if (patternIt == patterns.end())
-            {
-                continue;
-            }
-            
-            const Pattern* pattern = patternIt->second.get();
-            
-            // Calculate the intersection of the pattern time range and the requested range
-            double patternStartOffset = std::max(0.0, startTime - instance.startTime);
-            double patternEndOffset = std::min(pattern->getLength(), endTime - instance.startTime);
-            
-            // Get all notes in the pattern
-            const auto& notes = pattern->getNotes();
-            
-            for (const auto& note : notes)
-            {
-                // Check if the note falls within the intersection
-                if (note.startTime >= patternStartOffset && note.startTime < patternEndOffset)
-                {
-                    // Add the note with adjusted start time
-                    NoteEvent adjustedNote = note;
-                    adjustedNote.startTime += instance.startTime - startTime;
-                    result.push_back(adjustedNote);
-                }
-            }
-        }
+        noteIndex = createIndex();
     }
     
-    return result;
+    noteIndex->findNotes(startTick, endTick, result);
+}
+
+std::unique_ptr<TimelineIndex> Timeline::createIndex() const
+{
+    return std::make_unique<TimelineIndex>(patternInstances, patterns);
 }
 
 float Timeline::getParameterValueAtTime(const std::string& paramId, double time, float defaultValue) const
@@ -231,7 +218,7 @@ float Timeline::getParameterValueAtTime(const std::string& paramId, double time,
         }
         
         // Check if the time falls within this pattern instance
-        if (time >= instance.startTime && time < instance.endTime)
+        if (time >= instance.getStartTime() && time < instance.getEndTime())
         {
             auto patternIt = patterns.find(instance.patternId);
             if (patternIt == patterns.end())
@@ -242,7 +229,7 @@ float Timeline::getParameterValueAtTime(const std::string& paramId, double time,
             const Pattern* pattern = patternIt->second.get();
             
             // Get the parameter value from the pattern
-            double patternTime = time - instance.startTime;
+            double patternTime = time - instance.getStartTime();
             return pattern->getParameterValueAtTime(paramId, patternTime, defaultValue);
         }
     }
@@ -253,19 +240,30 @@ float Timeline::getParameterValueAtTime(const std::string& paramId, double time,
 double Timeline::getLength() const
 {
     // Find the end time of the last pattern instance
-    double maxEndTime = 0.0;
+    Tick maxEndTick = 0;
     
     for (const auto& instance : patternInstances)
     {
-        maxEndTime = std::max(maxEndTime, instance.endTime);
+        maxEndTick = std::max(maxEndTick, instance.endTick);
     }
     
-    return maxEndTime;
+    return TimeBase::ticksToBeats(maxEndTick);
+}
+
+TempoMap& Timeline::getTempoMap()
+{
+    return tempoMap;
+}
+
+const TempoMap& Timeline::getTempoMap() const
+{
+    return tempoMap;
 }
 
 void Timeline::clear()
 {
     patternInstances.clear();
+    rebuildIndex();
 }
 
 std::unique_ptr<juce::XmlElement> Timeline::createStateXml() const
@@ -289,10 +287,13 @@ std::unique_ptr<juce::XmlElement> Timeline::createStateXml() const
     {
         auto instanceXml = instancesXml->createNewChildElement("Instance");
         instanceXml->setAttribute("patternId", instance.patternId);
-        instanceXml->setAttribute("startTime", instance.startTime);
+        instanceXml->setAttribute("startTime", instance.getStartTime());
         instanceXml->setAttribute("muted", instance.muted);
     }
     
+    // Add tempo and time signature changes
+    xml->addChildElement(tempoMap.createStateXml().release());
+    
     // Add next pattern ID
     xml->setAttribute("nextPatternId", nextPatternId);
     
@@ -348,9 +349,22 @@ bool Timeline::restoreStateFromXml(const juce::XmlElement* xml)
         }
     }
     
+    // Restore tempo and time signature changes (older projects have none)
+    if (!tempoMap.restoreStateFromXml(xml->getChildByName("TempoMap")))
+    {
+        tempoMap = TempoMap();
+    }
+    
+    rebuildIndex();
+    
     return true;
 }
 
+void Timeline::rebuildIndex()
+{
+    noteIndex = createIndex();
+}
+
 void Timeline::updatePatternInstanceEndTime(int index)
 {
     if (index < 0 || index >= static_cast<int>(patternInstances.size()))
@@ -366,7 +380,7 @@ void Timeline::updatePatternInstanceEndTime(int index)
         return;
     }
     
-    instance.endTime = instance.startTime + patternIt->second->getLength();
+    instance.endTick = instance.startTick + patternIt->second->getLengthInTicks();
 }
 
 void Timeline::updateAllPatternInstanceEndTimes()
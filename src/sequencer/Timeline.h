@@ -8,6 +8,8 @@
 #pragma once
 
 #include "Pattern.h"
+#include "TimelineIndex.h"
+#include "TempoMap.h"
 #include <JuceHeader.h>
 #include <string>
 #include <vector>
@@ -21,14 +23,17 @@ namespace UndergroundBeats {
  */
 struct PatternInstance {
     int patternId;     // ID of the pattern
-    double startTime;  // Start time in beats
-    double endTime;    // End time in beats (calculated from pattern length)
+    Tick startTick;    // Start time in ticks
+    Tick endTick;      // End time in ticks (calculated from pattern length)
     bool muted;        // Whether the pattern is muted
     
-    PatternInstance(int patternId = -1, double startTime = 0.0, bool muted = false)
-        : patternId(patternId), startTime(startTime), endTime(0.0), muted(muted)
+    PatternInstance(int patternId = -1, Tick startTick = 0, bool muted = false)
+        : patternId(patternId), startTick(startTick), endTick(0), muted(muted)
     {
     }
+    
+    double getStartTime() const { return TimeBase::ticksToBeats(startTick); } // Start time in beats
+    double getEndTime() const { return TimeBase::ticksToBeats(endTick); } // End time in beats
 };
 
 /**
@@ -142,6 +147,29 @@ public:
      */
     std::vector<NoteEvent> getNotesInRange(double startTime, double endTime) const;
     
+    /**
+     * @brief Get all note events that occur within a tick range
+     * 
+     * Clears the result vector and fills it. Reads the timeline's own index,
+     * which is rebuilt here if a pattern's notes have changed, so only call
+     * this on the message thread; other threads query a createIndex() copy.
+     * 
+     * @param startTick Start of the range in ticks
+     * @param endTick End of the range in ticks
+     * @param result Vector to fill with note events with start ticks relative to startTick
+     */
+    void getNotesInRange(Tick startTick, Tick endTick, std::vector<NoteEvent>& result) const;
+    
+    /**
+     * @brief Take a snapshot of the arrangement's notes for another thread
+     * 
+     * The snapshot does not follow later edits; build a new one after the
+     * arrangement or any pattern's notes change.
+     * 
+     * @return A new index over the unmuted pattern instances
+     */
+    std::unique_ptr<TimelineIndex> createIndex() const;
+    
     /**
      * @brief Get the value of a parameter at a specific time
      * 
@@ -159,6 +187,17 @@ public:
      */
     double getLength() const;
     
+    /**
+     * @brief Get the timeline's tempo and time signature changes
+     * 
+     * After editing the map, call Sequencer::tempoMapChanged() so playback
+     * picks up the changes.
+     * 
+     * @return The tempo map
+     */
+    TempoMap& getTempoMap();
+    const TempoMap& getTempoMap() const;
+    
     /**
      * @brief Clear the timeline (remove all pattern instances)
      */
@@ -184,6 +223,14 @@ private:
     std::vector<PatternInstance> patternInstances;
     int nextPatternId;
     
+    TempoMap tempoMap;
+    
+    // Time-sorted index used by getNotesInRange (message thread)
+    mutable std::unique_ptr<TimelineIndex> noteIndex;
+    
+    // Rebuild the index after the arrangement changes
+    void rebuildIndex();
+    
     // Update the end time of a pattern instance based on its pattern
     void updatePatternInstanceEndTime(int index);
     
@@ -0,0 +1,228 @@
+/*
+ * Underground Beats
+ * TimelineIndex.cpp
+ *
+ * Implementation of the timeline range query index
+ */
+
+#include "TimelineIndex.h"
+#include "Timeline.h"
+#include <algorithm>
+
+namespace UndergroundBeats {
+
+TimelineIndex::TimelineIndex(const std::vector<PatternInstance>& instances,
+                             const std::unordered_map<int, std::unique_ptr<Pattern>>& patterns)
+    : rootLevel(-1)
+{
+    std::unordered_map<int, int> indexForPattern;
+    entries.reserve(instances.size());
+
+    for (const auto& instance : instances)
+    {
+        // Muted instances never produce notes, so leave them out of the tree
+        if (instance.muted)
+            continue;
+
+        auto patternIt = patterns.find(instance.patternId);
+        if (patternIt == patterns.end())
+            continue;
+
+        // Copy each pattern's notes once, however many instances use it
+        auto [slot, isNew] = indexForPattern.emplace(instance.patternId, static_cast<int>(patternNotes.size()));
+
+        if (isNew)
+        {
+            const Pattern& pattern = *patternIt->second;
+
+            PatternNotes copy;
+            copy.notes = pattern.getNoteColumns();
+            copy.lengthInTicks = pattern.getLengthInTicks();
+            copy.source = &pattern;
+            copy.version = pattern.getNoteVersion();
+            patternNotes.push_back(std::move(copy));
+        }
+
+        InstanceEntry entry;
+        entry.startTick = instance.startTick;
+        entry.endTick = instance.endTick;
+        entry.maxEndTick = instance.endTick;
+        entry.patternIndex = slot->second;
+        entries.push_back(entry);
+    }
+
+    // The timeline keeps instances sorted, but the tree must not rely on it
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const InstanceEntry& a, const InstanceEntry& b) {
+                         return a.startTick < b.startTick;
+                     });
+
+    rootLevel = buildTree();
+}
+
+TimelineIndex::~TimelineIndex()
+{
+}
+
+TimelineIndex::Cursors TimelineIndex::createCursors() const
+{
+    Cursors cursors;
+    cursors.cursors.resize(entries.size());
+    return cursors;
+}
+
+bool TimelineIndex::isOutOfDate() const
+{
+    for (const auto& notes : patternNotes)
+    {
+        if (notes.source->getNoteVersion() != notes.version)
+            return true;
+    }
+
+    return false;
+}
+
+int TimelineIndex::buildTree()
+{
+    // Node i sits at the level given by its number of trailing 1 bits: even
+    // indices are leaves, and the node at level k has children i -/+ 2^(k-1).
+    // The array length need not be a power of two; missing right subtrees
+    // borrow the end tick of the last node that does exist.
+    const size_t n = entries.size();
+
+    if (n == 0)
+        return -1;
+
+    size_t lastIndex = 0;
+    Tick lastMax = 0;
+
+    for (size_t i = 0; i < n; i += 2)
+    {
+        lastIndex = i;
+        lastMax = entries[i].maxEndTick = entries[i].endTick;
+    }
+
+    int level = 1;
+
+    for (; (size_t(1) << level) <= n; ++level)
+    {
+        const size_t halfSpan = size_t(1) << (level - 1);
+        const size_t first = (halfSpan << 1) - 1;
+        const size_t step = halfSpan << 2;
+
+        for (size_t i = first; i < n; i += step)
+        {
+            const Tick leftMax = entries[i - halfSpan].maxEndTick;
+            const Tick rightMax = i + halfSpan < n ? entries[i + halfSpan].maxEndTick : lastMax;
+            entries[i].maxEndTick = std::max({ entries[i].endTick, leftMax, rightMax });
+        }
+
+        // Move the rightmost path up one level
+        lastIndex = ((lastIndex >> level) & 1) != 0 ? lastIndex - halfSpan : lastIndex + halfSpan;
+
+        if (lastIndex < n)
+            lastMax = std::max(lastMax, entries[lastIndex].maxEndTick);
+    }
+
+    return level - 1;
+}
+
+void TimelineIndex::findNotes(Tick startTick, Tick endTick, std::vector<NoteEvent>& result,
+                              Cursors* cursors) const
+{
+    if (rootLevel < 0 || endTick <= startTick)
+        return;
+
+    struct StackItem {
+        size_t index;
+        int level;
+        bool leftDone;
+    };
+
+    // The tree is at most 64 levels deep, and each level pushes at most two items
+    StackItem stack[128];
+    int stackSize = 0;
+
+    const size_t n = entries.size();
+    stack[stackSize++] = { (size_t(1) << rootLevel) - 1, rootLevel, false };
+
+    // Cursors made for another index would point at the wrong notes
+    if (cursors != nullptr && cursors->cursors.size() != n)
+        cursors = nullptr;
+
+    auto visit = [&](size_t i) {
+        const InstanceEntry& entry = entries[i];
+
+        if (startTick < entry.endTick)
+        {
+            const Tick startOffset = std::max<Tick>(0, startTick - entry.startTick);
+            collectNotes(i, startOffset, endTick - entry.startTick,
+                         entry.startTick - startTick, result, cursors);
+        }
+    };
+
+    // In-order traversal, pruning subtrees that end before the range or start after it
+    while (stackSize > 0)
+    {
+        const StackItem item = stack[--stackSize];
+
+        if (item.level <= 3)
+        {
+            // Small subtree: a linear scan is cheaper than descending further
+            const size_t first = (item.index >> item.level) << item.level;
+            const size_t last = std::min(n, first + (size_t(1) << (item.level + 1)) - 1);
+
+            for (size_t i = first; i < last && entries[i].startTick < endTick; ++i)
+                visit(i);
+        }
+        else if (!item.leftDone)
+        {
+            const size_t left = item.index - (size_t(1) << (item.level - 1));
+
+            stack[stackSize++] = { item.index, item.level, true };
+
+            if (left >= n || entries[left].maxEndTick > startTick)
+                stack[stackSize++] = { left, item.level - 1, false };
+        }
+        else if (item.index < n && entries[item.index].startTick < endTick)
+        {
+            visit(item.index);
+            stack[stackSize++] = { item.index + (size_t(1) << (item.level - 1)), item.level - 1, false };
+        }
+    }
+}
+
+void TimelineIndex::collectNotes(size_t entryIndex, Tick startOffset, Tick endOffset, Tick tickShift,
+                                 std::vector<NoteEvent>& result, Cursors* cursors) const
+{
+    const PatternNotes& pattern = patternNotes[static_cast<size_t>(entries[entryIndex].patternIndex)];
+    const NoteColumns& notes = pattern.notes;
+    const auto& starts = notes.startTicks;
+
+    endOffset = std::min(endOffset, pattern.lengthInTicks);
+
+    Cursors::Cursor unused;
+    Cursors::Cursor& cursor = cursors != nullptr ? cursors->cursors[entryIndex] : unused;
+
+    // Continue straight on from the previous range, or search for its start
+    const int begin = cursor.tick == startOffset
+        ? cursor.position
+        : static_cast<int>(std::lower_bound(starts.begin(), starts.end(), startOffset) - starts.begin());
+
+    const int end = endOffset > startOffset
+        ? static_cast<int>(std::lower_bound(starts.begin() + begin, starts.end(), endOffset) - starts.begin())
+        : begin;
+
+    cursor.position = end;
+    cursor.tick = endOffset;
+
+    for (int i = begin; i < end; ++i)
+    {
+        // Add the note with adjusted start time
+        NoteEvent adjustedNote = notes.getNote(i);
+        adjustedNote.startTick += tickShift;
+        result.push_back(adjustedNote);
+    }
+}
+
+} // namespace UndergroundBeats
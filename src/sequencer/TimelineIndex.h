@@ -0,0 +1,130 @@
+/*
+ * Underground Beats
+ * TimelineIndex.h
+ *
+ * Time-sorted index of pattern instances and notes for range queries
+ */
+
+#pragma once
+
+#include "Pattern.h"
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace UndergroundBeats {
+
+struct PatternInstance;
+
+/**
+ * @class TimelineIndex
+ * @brief Time-sorted index of pattern instances and notes for range queries
+ *
+ * The index keeps the unmuted pattern instances in an implicit augmented
+ * interval tree: the instances are stored sorted by start time, and each
+ * node of a binary tree laid out over the array indices records the latest
+ * end time in its subtree. Finding the instances that overlap a range is
+ * then O(log n + k) rather than a scan of the whole arrangement.
+ *
+ * An index is an immutable snapshot: it copies the notes of every pattern it
+ * uses, so it can be built on the message thread and handed to another
+ * thread while the timeline goes on being edited. A new snapshot is needed
+ * whenever the arrangement or the notes change.
+ *
+ * Readers that query consecutive ranges, like playback, keep a Cursors
+ * object per reader. It remembers where each instance's last range ended,
+ * so the next block picks up there instead of searching again.
+ */
+class TimelineIndex {
+public:
+    /**
+     * @brief Where each instance's last query ended, for one reader
+     */
+    class Cursors {
+    public:
+        Cursors() = default;
+
+    private:
+        friend class TimelineIndex;
+
+        struct Cursor {
+            int position = 0; // First note after the last range that was read
+            Tick tick = -1;   // End of the last range that was read
+        };
+
+        std::vector<Cursor> cursors;
+    };
+
+    /**
+     * @brief Build an index from the timeline's instances and patterns
+     *
+     * @param instances The pattern instances in the timeline
+     * @param patterns The timeline's pattern library
+     */
+    TimelineIndex(const std::vector<PatternInstance>& instances,
+                  const std::unordered_map<int, std::unique_ptr<Pattern>>& patterns);
+    ~TimelineIndex();
+
+    /**
+     * @brief Create cursors sized for this index
+     *
+     * Call this off the audio thread; the cursors only suit this index.
+     */
+    Cursors createCursors() const;
+
+    /**
+     * @brief Check whether any pattern's notes changed since the index was built
+     *
+     * Reads the patterns, so only call it where they can't be edited or
+     * removed at the same time (the message thread).
+     */
+    bool isOutOfDate() const;
+
+    /**
+     * @brief Collect the notes that start within a time range
+     *
+     * Notes are appended in instance start order, and within each instance in
+     * note start order. Start ticks are relative to the start of the range.
+     * Never allocates once the result vector has enough capacity.
+     *
+     * @param startTick Start of the range in ticks
+     * @param endTick End of the range in ticks
+     * @param result Vector the notes are appended to
+     * @param cursors Optional cursors from createCursors() to continue from the previous range
+     */
+    void findNotes(Tick startTick, Tick endTick, std::vector<NoteEvent>& result,
+                   Cursors* cursors = nullptr) const;
+
+private:
+    // A copy of one pattern's notes
+    struct PatternNotes {
+        NoteColumns notes;
+        Tick lengthInTicks = 0;
+        const Pattern* source = nullptr; // Only compared, never read, off the message thread
+        juce::uint32 version = 0;
+    };
+
+    // A node of the implicit interval tree
+    struct InstanceEntry {
+        Tick startTick;
+        Tick endTick;
+        Tick maxEndTick; // Latest end tick in this node's subtree
+        int patternIndex;
+    };
+
+    std::vector<PatternNotes> patternNotes;
+    std::vector<InstanceEntry> entries;
+    int rootLevel;
+
+    // Fill in the subtree end times and return the level of the root
+    int buildTree();
+
+    // Append an instance's notes within [startOffset, endOffset) of the pattern
+    void collectNotes(size_t entryIndex, Tick startOffset, Tick endOffset, Tick tickShift,
+                      std::vector<NoteEvent>& result, Cursors* cursors) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimelineIndex)
+};
+
+} // namespace UndergroundBeats
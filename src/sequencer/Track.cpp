@@ -129,7 +129,7 @@ void Track::saveToXml(juce::XmlElement& xml) const
 
 void Track::loadFromXml(const juce::XmlElement& xml)
 {
-    name = xml.getStringAttribute("name", "New Track");
+    name = xml.getStringAttribute("name", "New Track").toStdString();
     muted = xml.getBoolAttribute("muted", false);
     solo = xml.getBoolAttribute("solo", false);
     volume = xml.getDoubleAttribute("volume", 1.0);
@@ -144,7 +144,7 @@ void Track::loadFromXml(const juce::XmlElement& xml)
         {
             // TODO: Implement pattern deserialization
             auto pattern = std::make_shared<Pattern>(
-                patternXml->getStringAttribute("name", "Untitled Pattern")
+                patternXml->getStringAttribute("name", "Untitled Pattern").toStdString()
             );
             patterns.push_back(pattern);
         }
@@ -10,8 +10,32 @@
 
 namespace UndergroundBeats {
 
+namespace {
+    enum EnvelopeParameter
+    {
+        attackParam, decayParam, sustainParam, releaseParam,
+        attackCurveParam, decayCurveParam, releaseCurveParam
+    };
+    
+    const ParameterLayout& getEnvelopeLayout()
+    {
+        // Times in milliseconds; envelope settings take effect at the next stage, so no smoothing
+        static const ParameterLayout layout {
+            { "attack", 0.0f, 30000.0f, 10.0f, 0.0f },
+            { "decay", 0.0f, 30000.0f, 100.0f, 0.0f },
+            { "sustain", 0.0f, 1.0f, 0.7f, 0.0f },
+            { "release", 0.0f, 30000.0f, 200.0f, 0.0f },
+            { "attackCurve", 0.1f, 10.0f, 1.0f, 0.0f },
+            { "decayCurve", 0.1f, 10.0f, 1.0f, 0.0f },
+            { "releaseCurve", 0.1f, 10.0f, 1.0f, 0.0f }
+        };
+        return layout;
+    }
+}
+
 EnvelopeProcessor::EnvelopeProcessor()
-    : attackTime(10.0f)
+    : ProcessorNode(getEnvelopeLayout())
+    , attackTime(10.0f)
     , decayTime(100.0f)
     , sustainLevel(0.7f)
     , releaseTime(200.0f)
@@ -26,22 +50,6 @@ EnvelopeProcessor::EnvelopeProcessor()
     , releaseRate(0.0f)
     , levelAtReleaseStart(0.0f)
 {
-    // Initialize parameters vector with default values
-    for (int i = 0; i < MAX_PARAMETERS; ++i) {
-        parameters[i].store(0.0f);
-    }
-    
-    // Store ADSR parameters in the parameters array
-    parameters[0].store(attackTime);
-    parameters[1].store(decayTime);
-    parameters[2].store(sustainLevel);
-    parameters[3].store(releaseTime);
-    
-    // Store curve parameters
-    parameters[4].store(attackCurve);
-    parameters[5].store(decayCurve);
-    parameters[6].store(releaseCurve);
-    
     updateRates();
 }
 
@@ -51,76 +59,77 @@ EnvelopeProcessor::~EnvelopeProcessor()
 
 void EnvelopeProcessor::setAttackTime(float timeMs)
 {
-    attackTime = timeMs;
-    parameters[0].store(attackTime);
+    attackTime = getParameterLayout().clampValue(attackParam, timeMs);
+    setParameter(attackParam, attackTime);
     updateRates();
 }
 
 float EnvelopeProcessor::getAttackTime() const
 {
-    return parameters[0].load();
+    return getParameterValue(attackParam);
 }
 
 void EnvelopeProcessor::setDecayTime(float timeMs)
 {
-    decayTime = timeMs;
-    parameters[1].store(decayTime);
+    decayTime = getParameterLayout().clampValue(decayParam, timeMs);
+    setParameter(decayParam, decayTime);
     updateRates();
 }
 
 float EnvelopeProcessor::getDecayTime() const
 {
-    return parameters[1].load();
+    return getParameterValue(decayParam);
 }
 
 void EnvelopeProcessor::setSustainLevel(float level)
 {
-    sustainLevel = juce::jlimit(0.0f, 1.0f, level);
-    parameters[2].store(sustainLevel);
+    sustainLevel = getParameterLayout().clampValue(sustainParam, level);
+    setParameter(sustainParam, sustainLevel);
     updateRates();
 }
 
 float EnvelopeProcessor::getSustainLevel() const
 {
-    return parameters[2].load();
+    return getParameterValue(sustainParam);
 }
 
 void EnvelopeProcessor::setReleaseTime(float timeMs)
 {
-    releaseTime = timeMs;
-    parameters[3].store(releaseTime);
+    releaseTime = getParameterLayout().clampValue(releaseParam, timeMs);
+    setParameter(releaseParam, releaseTime);
     updateRates();
 }
 
 float EnvelopeProcessor::getReleaseTime() const
 {
-    return parameters[3].load();
+    return getParameterValue(releaseParam);
 }
 
 void EnvelopeProcessor::setCurves(float attack, float decay, float release)
 {
-    attackCurve = juce::jlimit(0.1f, 10.0f, attack);
-    decayCurve = juce::jlimit(0.1f, 10.0f, decay);
-    releaseCurve = juce::jlimit(0.1f, 10.0f, release);
+    const auto& layout = getParameterLayout();
+    attackCurve = layout.clampValue(attackCurveParam, attack);
+    decayCurve = layout.clampValue(decayCurveParam, decay);
+    releaseCurve = layout.clampValue(releaseCurveParam, release);
     
-    parameters[4].store(attackCurve);
-    parameters[5].store(decayCurve);
-    parameters[6].store(releaseCurve);
+    setParameter(attackCurveParam, attackCurve);
+    setParameter(decayCurveParam, decayCurve);
+    setParameter(releaseCurveParam, releaseCurve);
 }
 
 float EnvelopeProcessor::getAttackCurve() const
 {
-    return parameters[4].load();
+    return getParameterValue(attackCurveParam);
 }
 
 float EnvelopeProcessor::getDecayCurve() const
 {
-    return parameters[5].load();
+    return getParameterValue(decayCurveParam);
 }
 
 float EnvelopeProcessor::getReleaseCurve() const
 {
-    return parameters[6].load();
+    return getParameterValue(releaseCurveParam);
 }
 
 EnvelopeStage EnvelopeProcessor::getCurrentStage() const
@@ -6,6 +6,7 @@
  */
 
 #include "Filter.h"
+#include "../utils/SIMDKernels.h"
 #include <cmath>
 
 namespace UndergroundBeats {
@@ -102,28 +103,29 @@ float Filter::processSample(float sample)
 
 void Filter::process(float* buffer, int numSamples)
 {
-    for (int i = 0; i < numSamples; ++i)
-    {
-        buffer[i] = processSample(buffer[i]);
-    }
+    const SIMD::BiquadCoefficients coefficients { a0, a1, a2, b1, b2 };
+    SIMD::BiquadState state { z1, z2 };
+    
+    SIMD::processBiquadCascade(buffer, numSamples, &coefficients, &state, 1);
+    
+    z1 = state.z1;
+    z2 = state.z2;
 }
 
 void Filter::processStereo(float* leftBuffer, float* rightBuffer, int numSamples)
 {
-    for (int i = 0; i < numSamples; ++i)
-    {
-        // Process left channel
-        float outputL = a0 * leftBuffer[i] + z1;
-        z1 = a1 * leftBuffer[i] - b1 * outputL + z2;
-        z2 = a2 * leftBuffer[i] - b2 * outputL;
-        leftBuffer[i] = outputL;
-        
-        // Process right channel
-        float outputR = a0 * rightBuffer[i] + z1Right;
-        z1Right = a1 * rightBuffer[i] - b1 * outputR + z2Right;
-        z2Right = a2 * rightBuffer[i] - b2 * outputR;
-        rightBuffer[i] = outputR;
-    }
+    // Both channels share coefficients, so they are filtered side by side
+    const SIMD::BiquadCoefficients coefficients { a0, a1, a2, b1, b2 };
+    SIMD::BiquadState leftState { z1, z2 };
+    SIMD::BiquadState rightState { z1Right, z2Right };
+    
+    SIMD::processBiquadCascadeStereo(leftBuffer, rightBuffer, numSamples, &coefficients,
+                                     &leftState, &rightState, 1);
+    
+    z1 = leftState.z1;
+    z2 = leftState.z2;
+    z1Right = rightState.z1;
+    z2Right = rightState.z2;
 }
 
 void Filter::prepare(double sampleRate)
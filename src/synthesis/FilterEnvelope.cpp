@@ -9,8 +9,37 @@
 
 namespace UndergroundBeats {
 
+namespace {
+    enum FilterEnvelopeParameter
+    {
+        cutoffParam, resonanceParam, cutoffAmountParam, resonanceAmountParam,
+        attackParam, decayParam, sustainParam, releaseParam,
+        attackCurveParam, decayCurveParam, releaseCurveParam
+    };
+    
+    const ParameterLayout& getFilterEnvelopeLayout()
+    {
+        // The filter is re-tuned per sample from the envelope, so these are not smoothed
+        static const ParameterLayout layout {
+            { "cutoff", 20.0f, 20000.0f, 1000.0f, 0.0f },
+            { "resonance", 0.0f, 1.0f, 0.3f, 0.0f },
+            { "cutoffAmount", -1.0f, 1.0f, 0.8f, 0.0f },
+            { "resonanceAmount", -1.0f, 1.0f, 0.0f, 0.0f },
+            { "attack", 0.0f, 30000.0f, 10.0f, 0.0f },
+            { "decay", 0.0f, 30000.0f, 500.0f, 0.0f },
+            { "sustain", 0.0f, 1.0f, 0.3f, 0.0f },
+            { "release", 0.0f, 30000.0f, 200.0f, 0.0f },
+            { "attackCurve", 0.1f, 10.0f, 1.0f, 0.0f },
+            { "decayCurve", 0.1f, 10.0f, 1.0f, 0.0f },
+            { "releaseCurve", 0.1f, 10.0f, 1.0f, 0.0f }
+        };
+        return layout;
+    }
+}
+
 FilterEnvelope::FilterEnvelope()
-    : baseCutoff(1000.0f)
+    : ProcessorNode(getFilterEnvelopeLayout())
+    , baseCutoff(1000.0f)
     , baseResonance(0.3f)
     , cutoffEnvelopeAmount(0.8f)
     , resonanceEnvelopeAmount(0.0f)
@@ -25,28 +54,6 @@ FilterEnvelope::FilterEnvelope()
     envelope.setDecayTime(500.0f);    // 500 ms
     envelope.setSustainLevel(0.3f);   // 30%
     envelope.setReleaseTime(200.0f);  // 200 ms
-    
-    // Initialize parameters for the ProcessorNode
-    for (int i = 0; i < MAX_PARAMETERS; ++i) {
-        parameters[i].store(0.0f);
-    }
-    
-    // Store parameters
-    parameters[0].store(baseCutoff);
-    parameters[1].store(baseResonance);
-    parameters[2].store(cutoffEnvelopeAmount);
-    parameters[3].store(resonanceEnvelopeAmount);
-    
-    // Envelope ADSR parameters
-    parameters[4].store(envelope.getAttackTime());
-    parameters[5].store(envelope.getDecayTime());
-    parameters[6].store(envelope.getSustainLevel());
-    parameters[7].store(envelope.getReleaseTime());
-    
-    // Envelope curve parameters
-    parameters[8].store(envelope.getAttackCurve());
-    parameters[9].store(envelope.getDecayCurve());
-    parameters[10].store(envelope.getReleaseCurve());
 }
 
 FilterEnvelope::~FilterEnvelope()
@@ -55,26 +62,26 @@ FilterEnvelope::~FilterEnvelope()
 
 void FilterEnvelope::setBaseCutoff(float frequencyHz)
 {
-    baseCutoff = frequencyHz;
-    parameters[0].store(baseCutoff);
+    baseCutoff = getParameterLayout().clampValue(cutoffParam, frequencyHz);
+    setParameter(cutoffParam, baseCutoff);
     updateFilterParameters();
 }
 
 float FilterEnvelope::getBaseCutoff() const
 {
-    return parameters[0].load();
+    return getParameterValue(cutoffParam);
 }
 
 void FilterEnvelope::setBaseResonance(float amount)
 {
-    baseResonance = amount;
-    parameters[1].store(baseResonance);
+    baseResonance = getParameterLayout().clampValue(resonanceParam, amount);
+    setParameter(resonanceParam, baseResonance);
     updateFilterParameters();
 }
 
 float FilterEnvelope::getBaseResonance() const
 {
-    return parameters[1].load();
+    return getParameterValue(resonanceParam);
 }
 
 void FilterEnvelope::setFilterType(FilterType type)
@@ -89,78 +96,87 @@ FilterType FilterEnvelope::getFilterType() const
 
 void FilterEnvelope::setCutoffEnvelopeAmount(float amount)
 {
-    cutoffEnvelopeAmount = amount;
-    parameters[2].store(cutoffEnvelopeAmount);
+    cutoffEnvelopeAmount = getParameterLayout().clampValue(cutoffAmountParam, amount);
+    setParameter(cutoffAmountParam, cutoffEnvelopeAmount);
     updateFilterParameters();
 }
 
 float FilterEnvelope::getCutoffEnvelopeAmount() const
 {
-    return parameters[2].load();
+    return getParameterValue(cutoffAmountParam);
 }
 
 void FilterEnvelope::setResonanceEnvelopeAmount(float amount)
 {
-    resonanceEnvelopeAmount = amount;
-    parameters[3].store(resonanceEnvelopeAmount);
+    resonanceEnvelopeAmount = getParameterLayout().clampValue(resonanceAmountParam, amount);
+    setParameter(resonanceAmountParam, resonanceEnvelopeAmount);
     updateFilterParameters();
 }
 
 float FilterEnvelope::getResonanceEnvelopeAmount() const
 {
-    return parameters[3].load();
+    return getParameterValue(resonanceAmountParam);
 }
 
 void FilterEnvelope::setAttackTime(float timeMs)
 {
-    envelope.setAttackTime(timeMs);
-    parameters[4].store(timeMs);
+    const float value = getParameterLayout().clampValue(attackParam, timeMs);
+    envelope.setAttackTime(value);
+    setParameter(attackParam, value);
 }
 
 float FilterEnvelope::getAttackTime() const
 {
-    return parameters[4].load();
+    return getParameterValue(attackParam);
 }
 
 void FilterEnvelope::setDecayTime(float timeMs)
 {
-    envelope.setDecayTime(timeMs);
-    parameters[5].store(timeMs);
+    const float value = getParameterLayout().clampValue(decayParam, timeMs);
+    envelope.setDecayTime(value);
+    setParameter(decayParam, value);
 }
 
 float FilterEnvelope::getDecayTime() const
 {
-    return parameters[5].load();
+    return getParameterValue(decayParam);
 }
 
 void FilterEnvelope::setSustainLevel(float level)
 {
-    envelope.setSustainLevel(level);
-    parameters[6].store(level);
+    const float value = getParameterLayout().clampValue(sustainParam, level);
+    envelope.setSustainLevel(value);
+    setParameter(sustainParam, value);
 }
 
 float FilterEnvelope::getSustainLevel() const
 {
-    return parameters[6].load();
+    return getParameterValue(sustainParam);
 }
 
 void FilterEnvelope::setReleaseTime(float timeMs)
 {
-    envelope.setReleaseTime(timeMs);
-    parameters[7].store(timeMs);
+    const float value = getParameterLayout().clampValue(releaseParam, timeMs);
+    envelope.setReleaseTime(value);
+    setParameter(releaseParam, value);
 }
 
 float FilterEnvelope::getReleaseTime() const
 {
-    return parameters[7].load();
+    return getParameterValue(releaseParam);
 }
 
 void FilterEnvelope::setCurves(float attackCurve, float decayCurve, float releaseCurve)
 {
-    envelope.setCurves(attackCurve, decayCurve, releaseCurve);
-    parameters[8].store(attackCurve);
-    parameters[9].store(decayCurve);
-    parameters[10].store(releaseCurve);
+    const auto& layout = getParameterLayout();
+    const float attack = layout.clampValue(attackCurveParam, attackCurve);
+    const float decay = layout.clampValue(decayCurveParam, decayCurve);
+    const float release = layout.clampValue(releaseCurveParam, releaseCurve);
+    
+    envelope.setCurves(attack, decay, release);
+    setParameter(attackCurveParam, attack);
+    setParameter(decayCurveParam, decay);
+    setParameter(releaseCurveParam, release);
 }
 
 void FilterEnvelope::noteOn()
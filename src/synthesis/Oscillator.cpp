@@ -6,14 +6,31 @@
  */
 
 #include "Oscillator.h"
+#include "../utils/SIMDKernels.h"
 
 namespace UndergroundBeats {
 
+namespace {
+    enum OscillatorParameter { pulseWidthParam, detuneParam, gainParam };
+    
+    const ParameterLayout& getOscillatorLayout()
+    {
+        static const ParameterLayout layout {
+            { "pulseWidth", 0.01f, 0.99f, 0.5f, 20.0f },
+            { "detune", -1200.0f, 1200.0f, 0.0f, 0.0f },
+            { "gain", 0.0f, 1.0f, 1.0f, 20.0f }
+        };
+        return layout;
+    }
+}
+
 Oscillator::Oscillator()
-    : waveformType(WaveformType::Sine)
+    : ProcessorNode(getOscillatorLayout())
+    , waveformType(WaveformType::Sine)
     , frequency(440.0f)
     , phase(0.0f)
     , phaseIncrement(0.0f)
+    , pulseWidth(0.5f)
     , currentSampleRate(44100.0)
     , wavetableSize(0)
     , lastOutput(0.0f)
@@ -57,19 +74,18 @@ void Oscillator::setPhase(float newPhase)
 void Oscillator::setPulseWidth(float width)
 {
     // Store pulse width as a parameter
-    setParameter(0, width);
+    setParameter(pulseWidthParam, width);
 }
 
 float Oscillator::getPulseWidth() const
 {
-    // Direct atomic access instead of using deprecated getParameter
-    return parameters[0].load();
+    return getParameterValue(pulseWidthParam);
 }
 
 void Oscillator::setDetune(float cents)
 {
     // Store detune as a parameter
-    setParameter(1, cents);
+    setParameter(detuneParam, cents);
     
     // Recalculate actual frequency with detune
     updatePhaseIncrement();
@@ -77,20 +93,18 @@ void Oscillator::setDetune(float cents)
 
 float Oscillator::getDetune() const
 {
-    // Direct atomic access instead of using deprecated getParameter
-    return parameters[1].load();
+    return getParameterValue(detuneParam);
 }
 
 void Oscillator::setGain(float gain)
 {
     // Store gain as a parameter
-    setParameter(2, gain);
+    setParameter(gainParam, gain);
 }
 
 float Oscillator::getGain() const
 {
-    // Direct atomic access instead of using deprecated getParameter
-    return parameters[2].load();
+    return getParameterValue(gainParam);
 }
 
 float Oscillator::getPhase() const
@@ -162,28 +176,34 @@ float Oscillator::getSample(float frequencyModulation)
 
 void Oscillator::process(float* buffer, int numSamples, const float* frequencyModulation)
 {
-    if (frequencyModulation == nullptr)
-    {
-        // No frequency modulation, generate samples directly
-        for (int i = 0; i < numSamples; ++i)
-        {
-            buffer[i] = getSample(0.0f);
-        }
-    }
-    else
+    if (numSamples <= 0)
+        return;
+    
+    // Step the pulse width every sample so width changes don't click
+    updateSmoothedParameters(numSamples);
+    const auto widthRamp = getParameterRamp(pulseWidthParam);
+    const float widthStep = (widthRamp.end - widthRamp.start) / static_cast<float>(numSamples);
+    
+    for (int i = 0; i < numSamples; ++i)
     {
-        // Apply per-sample frequency modulation
-        for (int i = 0; i < numSamples; ++i)
-        {
-            buffer[i] = getSample(frequencyModulation[i]);
-        }
+        pulseWidth = widthRamp.start + widthStep * static_cast<float>(i);
+        buffer[i] = getSample(frequencyModulation != nullptr ? frequencyModulation[i] : 0.0f);
     }
+    
+    pulseWidth = widthRamp.end;
+    
+    // Ramp the gain across the block
+    const auto gainRamp = getParameterRamp(gainParam);
+    SIMD::applyGainRamp(buffer, gainRamp.start, gainRamp.end, numSamples);
 }
 
 void Oscillator::prepare(double sampleRate)
 {
     currentSampleRate = sampleRate;
     updatePhaseIncrement();
+    
+    // Restart the parameter smoothers at the new rate
+    prepareToPlay(sampleRate, currentBlockSize);
 }
 
 void Oscillator::updatePhaseIncrement()
@@ -225,8 +245,8 @@ float Oscillator::generateSawtooth(float phase)
 
 float Oscillator::generateSquare(float phase)
 {
-    // Basic square wave
-    return (phase < juce::MathConstants<float>::pi) ? 1.0f : -1.0f;
+    // Pulse wave, high for the pulse width's share of the cycle
+    return (phase < juce::MathConstants<float>::twoPi * pulseWidth) ? 1.0f : -1.0f;
 }
 
 float Oscillator::generateNoise()
@@ -141,6 +141,9 @@ public:
     /**
      * @brief Generate a single sample
      * 
+     * The gain is not applied, and square waves use the pulse width reached
+     * by the last call to process().
+     * 
      * @param frequencyModulation Optional frequency modulation value (-1 to 1)
      * @return The generated sample value (-1 to 1)
      */
@@ -149,6 +152,9 @@ public:
     /**
      * @brief Process a buffer of samples
      * 
+     * Pulse width and gain ramp towards their latest values across the
+     * buffer, and the gain is applied to the output.
+     * 
      * @param buffer The buffer to fill with generated samples
      * @param numSamples The number of samples to generate
      * @param frequencyModulation Optional buffer of frequency modulation values
@@ -167,6 +173,7 @@ private:
     float frequency;
     float phase;
     float phaseIncrement;
+    float pulseWidth;
     double currentSampleRate;
     
     // Wavetable data
@@ -5,23 +5,27 @@
  * Implementation of the oscillator bank with multiple oscillators
  */
 #include "OscillatorBank.h"
+#include "../utils/SIMDKernels.h"
 #include <cmath>
 
 namespace UndergroundBeats {
 
+namespace {
+    enum OscillatorBankParameter { masterLevelParam, fmAmountParam };
+    
+    const ParameterLayout& getOscillatorBankLayout()
+    {
+        static const ParameterLayout layout {
+            { "masterLevel", 0.0f, 1.0f, 0.5f, 20.0f },
+            { "fmAmount", 0.0f, 10.0f, 0.0f, 20.0f }
+        };
+        return layout;
+    }
+}
+
 OscillatorBank::OscillatorBank(int numOscillators)
+    : ProcessorNode(getOscillatorBankLayout())
 {
-    // Initialize parameters for oscillator mixing
-    for (int i = 0; i < MAX_PARAMETERS; ++i) {
-        parameters[i].store(0.0f);
-    }
-    
-    // Store master level as parameter 0
-    parameters[0].store(masterLevel);
-    
-    // Store FM amount as parameter 1
-    parameters[1].store(fmAmount);
-    
     // Create default oscillators
     for (int i = 0; i < numOscillators; ++i)
     {
@@ -60,52 +64,39 @@ void OscillatorBank::process(float* buffer, int numSamples)
     // Clear the buffer
     std::fill(buffer, buffer + numSamples, 0.0f);
     
-    // Get the current master level
-    float currentMasterLevel = parameters[0].load();
-    
     // Return if no oscillators
     if (oscillators.empty())
         return;
     
+    // Smooth the master level and FM amount across the block
+    updateSmoothedParameters(numSamples);
+    const auto masterRamp = getParameterRamp(masterLevelParam);
+    
+    // Scratch space for the oscillators; only grows if called outside the graph
+    ensureScratchSize(numSamples);
+    float* oscBuffer = processingBuffer.getWritePointer(0);
+    
     // Process FM synthesis if enabled
     if (fmEnabled && oscillators.size() >= 2)
     {
-        // Create temporary buffer for modulator
-        std::vector<float> modulatorBuffer(numSamples, 0.0f);
-        
-        // Get current FM amount
-        float currentFMAmount = parameters[1].load();
+        float* modulatorBuffer = processingBuffer.getWritePointer(1);
         
         // Process modulator oscillator (typically the second oscillator modulates the first)
-        oscillators[1]->process(modulatorBuffer.data(), numSamples);
-        
-        // Modulate carrier with the modulator
-        for (int i = 0; i < numSamples; ++i)
-        {
-            // Scale modulator by FM amount
-            modulatorBuffer[i] *= currentFMAmount;
-        }
+        oscillators[1]->process(modulatorBuffer, numSamples);
         
-        // Use oscillator 0 as carrier
-        std::vector<float> carrierBuffer(numSamples, 0.0f);
-        oscillators[0]->process(carrierBuffer.data(), numSamples, modulatorBuffer.data());
+        // Scale modulator by FM amount
+        const auto fmRamp = getParameterRamp(fmAmountParam);
+        SIMD::applyGainRamp(modulatorBuffer, fmRamp.start, fmRamp.end, numSamples);
         
-        // Mix carrier into output buffer
-        for (int i = 0; i < numSamples; ++i)
-        {
-            buffer[i] += carrierBuffer[i] * oscillators[0]->getGain() * currentMasterLevel;
-        }
+        // Use oscillator 0 as carrier and mix it into the output buffer
+        oscillators[0]->process(oscBuffer, numSamples, modulatorBuffer);
+        SIMD::addWithGain(buffer, oscBuffer, 1.0f, numSamples);
         
         // Add any remaining oscillators to the output
         for (size_t oscIndex = 2; oscIndex < oscillators.size(); ++oscIndex)
         {
-            std::vector<float> oscBuffer(numSamples, 0.0f);
-            oscillators[oscIndex]->process(oscBuffer.data(), numSamples);
-            
-            for (int i = 0; i < numSamples; ++i)
-            {
-                buffer[i] += oscBuffer[i] * oscillators[oscIndex]->getGain() * currentMasterLevel;
-            }
+            oscillators[oscIndex]->process(oscBuffer, numSamples);
+            SIMD::addWithGain(buffer, oscBuffer, 1.0f, numSamples);
         }
     }
     else
@@ -113,16 +104,14 @@ void OscillatorBank::process(float* buffer, int numSamples)
         // Normal processing without FM
         for (auto& osc : oscillators)
         {
-            std::vector<float> oscBuffer(numSamples, 0.0f);
-            osc->process(oscBuffer.data(), numSamples);
-            
-            for (int i = 0; i < numSamples; ++i)
-            {
-                buffer[i] += oscBuffer[i] * osc->getGain() * currentMasterLevel;
-            }
+            osc->process(oscBuffer, numSamples);
+            SIMD::addWithGain(buffer, oscBuffer, 1.0f, numSamples);
         }
     }
     
+    // Apply the master level last so a level change ramps instead of stepping
+    SIMD::applyGainRamp(buffer, masterRamp.start, masterRamp.end, numSamples);
+    
     // Apply sync if enabled
     if (syncEnabled && oscillators.size() >= 2)
     {
@@ -151,74 +140,49 @@ void OscillatorBank::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBu
     }
     
     // Return if no oscillators
-    if (oscillators.empty())
+    if (oscillators.empty() || buffer.getNumChannels() == 0)
         return;
     
+    const int numSamples = buffer.getNumSamples();
+    ensureScratchSize(numSamples);
+    updateSmoothedParameters(numSamples);
+    
+    // Render mono into the first channel, then copy it to the others
+    float* output = buffer.getWritePointer(0);
+    float* oscBuffer = processingBuffer.getWritePointer(0);
+    size_t firstMixedOscillator = 0;
+    
     // Process FM synthesis if enabled
     if (fmEnabled && oscillators.size() >= 2)
     {
-        // Create temporary buffer for modulator
-        juce::AudioBuffer<float> modulatorBuffer(1, buffer.getNumSamples());
-        modulatorBuffer.clear();
+        float* modulatorBuffer = processingBuffer.getWritePointer(1);
         
         // Process modulator oscillator (typically the second oscillator modulates the first)
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
-        {
-            float modulatorSample = oscillators[1]->getSample() * fmAmount;
-            modulatorBuffer.setSample(0, i, modulatorSample);
-        }
-        
-        // Apply modulation to carrier frequency
-        float baseFreq = oscillators[0]->getFrequency();
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
-        {
-            float modulation = modulatorBuffer.getSample(0, i);
-            // Exponential FM modulation: carrier frequency * 2^(modulation)
-            float modulatedFreq = baseFreq * std::pow(2.0f, modulation);
-            oscillators[0]->setFrequency(modulatedFreq);
-            
-            // Generate the carrier sample with the modulated frequency
-            float sample = oscillators[0]->getSample(0.0f) * masterLevel;
-            
-            // Add to output buffer
-            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-            {
-                buffer.addSample(channel, i, sample);
-            }
-        }
+        oscillators[1]->process(modulatorBuffer, numSamples);
+        const auto fmRamp = getParameterRamp(fmAmountParam);
+        SIMD::applyGainRamp(modulatorBuffer, fmRamp.start, fmRamp.end, numSamples);
         
-        // Reset carrier frequency
-        oscillators[0]->setFrequency(baseFreq);
+        // Exponential FM: the carrier's frequency is multiplied by 2^(modulation)
+        oscillators[0]->process(oscBuffer, numSamples, modulatorBuffer);
+        SIMD::addWithGain(output, oscBuffer, 1.0f, numSamples);
         
         // Add any remaining oscillators to the output
-        for (size_t oscIndex = 2; oscIndex < oscillators.size(); ++oscIndex)
-        {
-            for (int i = 0; i < buffer.getNumSamples(); ++i)
-            {
-                float sample = oscillators[oscIndex]->getSample(0.0f) * masterLevel;
-                
-                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-                {
-                    buffer.addSample(channel, i, sample);
-                }
-            }
-        }
+        firstMixedOscillator = 2;
     }
-    else
+    
+    for (size_t oscIndex = firstMixedOscillator; oscIndex < oscillators.size(); ++oscIndex)
     {
-        // Normal processing without FM
-        for (auto& osc : oscillators)
-        {
-            for (int i = 0; i < buffer.getNumSamples(); ++i)
-            {
-                float sample = osc->getSample(0.0f) * masterLevel;
-                
-                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-                {
-                    buffer.addSample(channel, i, sample);
-                }
-            }
-        }
+        oscillators[oscIndex]->process(oscBuffer, numSamples);
+        SIMD::addWithGain(output, oscBuffer, 1.0f, numSamples);
+    }
+    
+    // Apply the master level last so a level change ramps instead of stepping
+    const auto masterRamp = getParameterRamp(masterLevelParam);
+    SIMD::applyGainRamp(output, masterRamp.start, masterRamp.end, numSamples);
+    
+    for (int channel = 1; channel < buffer.getNumChannels(); ++channel)
+    {
+        buffer.copyFrom(channel, 0, buffer, 0, 0, numSamples);
     }
     
     // Implement hard sync if enabled
@@ -230,6 +194,14 @@ void OscillatorBank::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBu
     }
 }
 
+void OscillatorBank::ensureScratchSize(int numSamples)
+{
+    if (processingBuffer.getNumChannels() < 2 || processingBuffer.getNumSamples() < numSamples)
+    {
+        processingBuffer.setSize(2, numSamples, false, false, true);
+    }
+}
+
 void OscillatorBank::addOscillator(std::unique_ptr<Oscillator> osc)
 {
     if (osc != nullptr)
@@ -261,8 +233,8 @@ void OscillatorBank::setMasterFrequency(float frequencyHz)
 
 void OscillatorBank::setMasterLevel(float level)
 {
-    masterLevel = juce::jlimit(0.0f, 1.0f, level);
-    parameters[0].store(masterLevel); // Store in parameters array
+    masterLevel = getParameterLayout().clampValue(masterLevelParam, level);
+    setParameter(masterLevelParam, masterLevel);
 }
 
 void OscillatorBank::setFrequency(int oscillatorIndex, float frequencyHz)
@@ -320,8 +292,8 @@ void OscillatorBank::enableFM(bool enable)
 
 void OscillatorBank::setFMAmount(float amount)
 {
-    fmAmount = juce::jlimit(0.0f, 10.0f, amount); // Limit to reasonable range
-    parameters[1].store(fmAmount); // Store in parameters array
+    fmAmount = getParameterLayout().clampValue(fmAmountParam, amount);
+    setParameter(fmAmountParam, fmAmount);
 }
 
 void OscillatorBank::noteOn(int midiNoteNumber, float velocity)
@@ -93,6 +93,9 @@ private:
     
     // Updates the frequency of all oscillators based on master frequency and individual settings
     void updateFrequencies();
+    
+    // Grows the scratch buffer used to render each oscillator before mixing
+    void ensureScratchSize(int numSamples);
 };
 
 } // namespace UndergroundBeats;
\ No newline at end of file
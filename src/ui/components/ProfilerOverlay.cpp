@@ -0,0 +1,121 @@
+/*
+ * Underground Beats
+ * ProfilerOverlay.cpp
+ * 
+ * Implementation of the ProfilerOverlay class
+ */
+
+#include "ProfilerOverlay.h"
+
+namespace UndergroundBeats {
+
+namespace {
+
+constexpr int refreshRateHz = 4;
+constexpr int lineHeight = 16;
+constexpr int margin = 6;
+constexpr int numSummaryLines = 3;
+
+juce::String formatMicroseconds(double nanoseconds)
+{
+    return juce::String(nanoseconds / 1000.0, 1) + " us";
+}
+
+} // namespace
+
+ProfilerOverlay::ProfilerOverlay(AudioProfiler& profilerToUse, juce::AudioDeviceManager& deviceManagerToUse)
+    : profiler(profilerToUse)
+    , deviceManager(deviceManagerToUse)
+    , numNodesShown(5)
+{
+    setInterceptsMouseClicks(false, false);
+}
+
+ProfilerOverlay::~ProfilerOverlay()
+{
+    stopTimer();
+}
+
+void ProfilerOverlay::setNumNodesShown(int numNodes)
+{
+    numNodesShown = juce::jmax(0, numNodes);
+    repaint();
+}
+
+int ProfilerOverlay::getIdealHeight() const
+{
+    return (numSummaryLines + numNodesShown) * lineHeight + 2 * margin;
+}
+
+void ProfilerOverlay::paint(juce::Graphics& g)
+{
+    g.setColour(juce::Colours::black.withAlpha(0.75f));
+    g.fillRoundedRectangle(getLocalBounds().toFloat(), 4.0f);
+    
+    auto area = getLocalBounds().reduced(margin);
+    g.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+    
+    // Turn red once the slowest callbacks no longer fit in the buffer
+    const bool overBudget = summary.budget > 0.0 && summary.callback.p99 > summary.budget;
+    g.setColour(overBudget ? juce::Colours::orangered : juce::Colours::white);
+    
+    g.drawText("Callback p50 " + formatMicroseconds(summary.callback.p50)
+                   + "  p99 " + formatMicroseconds(summary.callback.p99)
+                   + "  max " + formatMicroseconds(summary.callback.max),
+               area.removeFromTop(lineHeight), juce::Justification::centredLeft, true);
+    
+    g.drawText("Budget " + formatMicroseconds(summary.budget)
+                   + "  load " + juce::String(summary.load * 100.0, 1) + "%",
+               area.removeFromTop(lineHeight), juce::Justification::centredLeft, true);
+    
+    juce::String dropouts = "Misses " + juce::String(summary.deadlineMisses)
+                          + "  xruns " + juce::String(summary.xruns);
+    
+    if (summary.deviceXRuns >= 0)
+        dropouts << "  device " << summary.deviceXRuns;
+    
+    if (summary.droppedRecords > 0)
+        dropouts << "  dropped " << summary.droppedRecords;
+    
+    g.setColour(summary.deadlineMisses > 0 || summary.xruns > 0 ? juce::Colours::orange : juce::Colours::white);
+    g.drawText(dropouts, area.removeFromTop(lineHeight), juce::Justification::centredLeft, true);
+    
+    g.setColour(juce::Colours::lightgrey);
+    
+    const int numNodes = juce::jmin(numNodesShown, static_cast<int>(summary.nodes.size()));
+    
+    for (int i = 0; i < numNodes; ++i)
+    {
+        const auto& node = summary.nodes[static_cast<size_t>(i)];
+        g.drawText(node.name + "  p99 " + formatMicroseconds(node.stats.p99)
+                       + "  max " + formatMicroseconds(node.stats.max),
+                   area.removeFromTop(lineHeight), juce::Justification::centredLeft, true);
+    }
+}
+
+void ProfilerOverlay::visibilityChanged()
+{
+    if (isVisible())
+    {
+        profiler.reset();
+        profiler.setEnabled(true);
+        startTimerHz(refreshRateHz);
+    }
+    else
+    {
+        stopTimer();
+        profiler.setEnabled(false);
+    }
+}
+
+void ProfilerOverlay::timerCallback()
+{
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        profiler.setDeviceXRunCount(device->getXRunCount());
+    
+    profiler.update();
+    summary = profiler.getSummary();
+    repaint();
+}
+
+} // namespace UndergroundBeats
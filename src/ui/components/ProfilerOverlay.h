@@ -0,0 +1,62 @@
+/*
+ * Underground Beats
+ * ProfilerOverlay.h
+ * 
+ * Overlay showing audio callback timing and dropouts
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../audio-engine/AudioProfiler.h"
+
+namespace UndergroundBeats {
+
+/**
+ * @class ProfilerOverlay
+ * @brief Overlay showing audio callback timing and dropouts
+ * 
+ * While visible, the overlay drains an AudioProfiler a few times a second
+ * and shows the callback time percentiles against the buffer's budget, the
+ * deadline misses and xruns so far, and the slowest nodes. Profiling is
+ * switched on while the overlay is shown and off again when it is hidden.
+ */
+class ProfilerOverlay : public juce::Component,
+                        private juce::Timer {
+public:
+    /**
+     * @brief Create an overlay for a profiler
+     * 
+     * @param profilerToUse The profiler to display; must outlive the overlay
+     * @param deviceManagerToUse Queried for the device's own xrun count
+     */
+    ProfilerOverlay(AudioProfiler& profilerToUse, juce::AudioDeviceManager& deviceManagerToUse);
+    ~ProfilerOverlay() override;
+    
+    /**
+     * @brief Set how many of the slowest nodes are listed
+     */
+    void setNumNodesShown(int numNodes);
+    
+    /**
+     * @brief Get the height the overlay needs to show everything
+     */
+    int getIdealHeight() const;
+    
+    void paint(juce::Graphics& g) override;
+    void visibilityChanged() override;
+    
+private:
+    // Timer implementation
+    void timerCallback() override;
+    
+    AudioProfiler& profiler;
+    juce::AudioDeviceManager& deviceManager;
+    
+    AudioProfiler::Summary summary;
+    int numNodesShown;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProfilerOverlay)
+};
+
+} // namespace UndergroundBeats
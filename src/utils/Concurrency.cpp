@@ -0,0 +1,212 @@
+/*
+ * Underground Beats
+ * Concurrency.cpp
+ * 
+ * Operating system primitives behind the lock-free wake-up helpers
+ */
+
+#include "Concurrency.h"
+#include <thread>
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #include <windows.h>
+ #include <intrin.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <semaphore.h>
+ #include <cerrno>
+ #include <ctime>
+#endif
+
+namespace UndergroundBeats {
+namespace Concurrency {
+
+void pauseCpu() noexcept
+{
+   #if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+   #elif defined(_MSC_VER) && defined(_M_ARM64)
+    __yield();
+   #elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+   #elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__ ("yield");
+   #else
+    std::this_thread::yield();
+   #endif
+}
+
+//==============================================================================
+// Semaphore
+//==============================================================================
+
+#if JUCE_WINDOWS
+
+struct Semaphore::Impl
+{
+    HANDLE handle = CreateSemaphoreW(nullptr, 0, 0x7fffffff, nullptr);
+    
+    ~Impl() { CloseHandle(handle); }
+    
+    void post() { ReleaseSemaphore(handle, 1, nullptr); }
+    
+    bool wait(int timeoutMilliseconds)
+    {
+        const DWORD timeout = timeoutMilliseconds < 0 ? INFINITE : static_cast<DWORD>(timeoutMilliseconds);
+        return WaitForSingleObject(handle, timeout) == WAIT_OBJECT_0;
+    }
+};
+
+#elif JUCE_MAC || JUCE_IOS
+
+struct Semaphore::Impl
+{
+    dispatch_semaphore_t handle = dispatch_semaphore_create(0);
+    
+    ~Impl() { dispatch_release(handle); }
+    
+    void post() { dispatch_semaphore_signal(handle); }
+    
+    bool wait(int timeoutMilliseconds)
+    {
+        const dispatch_time_t timeout = timeoutMilliseconds < 0
+            ? DISPATCH_TIME_FOREVER
+            : dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(timeoutMilliseconds) * 1000000);
+        return dispatch_semaphore_wait(handle, timeout) == 0;
+    }
+};
+
+#else
+
+struct Semaphore::Impl
+{
+    sem_t handle;
+    
+    Impl() { sem_init(&handle, 0, 0); }
+    ~Impl() { sem_destroy(&handle); }
+    
+    void post() { sem_post(&handle); }
+    
+    bool wait(int timeoutMilliseconds)
+    {
+        if (timeoutMilliseconds < 0)
+        {
+            while (sem_wait(&handle) != 0)
+            {
+                if (errno != EINTR)
+                    return false;
+            }
+            
+            return true;
+        }
+        
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeoutMilliseconds / 1000;
+        deadline.tv_nsec += static_cast<long>(timeoutMilliseconds % 1000) * 1000000;
+        
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        
+        while (sem_timedwait(&handle, &deadline) != 0)
+        {
+            if (errno != EINTR)
+                return false;
+        }
+        
+        return true;
+    }
+};
+
+#endif
+
+Semaphore::Semaphore()
+    : impl(std::make_unique<Impl>())
+{
+}
+
+Semaphore::~Semaphore() = default;
+
+void Semaphore::post()
+{
+    impl->post();
+}
+
+bool Semaphore::wait(int timeoutMilliseconds)
+{
+    return impl->wait(timeoutMilliseconds);
+}
+
+//==============================================================================
+// WakeSignal
+//==============================================================================
+
+WakeSignal::WakeSignal(int spinIterationsToUse)
+    : spinIterations(spinIterationsToUse)
+{
+}
+
+void WakeSignal::notify() noexcept
+{
+    generation.fetch_add(1, std::memory_order_seq_cst);
+    
+    // Only pay for a system call if the waiter has gone to sleep
+    if (sleeping.load(std::memory_order_seq_cst) && sleeping.exchange(false, std::memory_order_acq_rel))
+    {
+        semaphore.post();
+    }
+}
+
+bool WakeSignal::wait(int timeoutMilliseconds)
+{
+    for (int i = 0; i < spinIterations; ++i)
+    {
+        if (consumeNotification())
+            return true;
+        
+        pauseCpu();
+    }
+    
+    sleeping.store(true, std::memory_order_seq_cst);
+    
+    // A notify() between the last check and now may not have seen the flag
+    if (generation.load(std::memory_order_seq_cst) == lastSeenGeneration)
+    {
+        if (semaphore.wait(timeoutMilliseconds))
+            return consumeNotification();
+    }
+    
+    // Clear the flag ourselves; if a notifier beat us to it, it has posted
+    // (or is about to), and that post must be taken now so that it doesn't
+    // cut the next wait short
+    if (!sleeping.exchange(false, std::memory_order_acq_rel))
+    {
+        semaphore.wait();
+    }
+    
+    return consumeNotification();
+}
+
+bool WakeSignal::consumeNotification() noexcept
+{
+    const auto current = generation.load(std::memory_order_acquire);
+    
+    if (current == lastSeenGeneration)
+        return false;
+    
+    lastSeenGeneration = current;
+    return true;
+}
+
+} // namespace Concurrency
+} // namespace UndergroundBeats
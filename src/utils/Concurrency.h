@@ -9,6 +9,8 @@
 
 #include <JuceHeader.h>
 #include <atomic>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
@@ -119,6 +121,221 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LockFreeQueue)
 };
 
+/**
+ * @class RetiringPointer
+ * @brief Hands objects from one thread to a real-time thread without freeing on it
+ * 
+ * The writer publishes a new object; the reader picks it up with acquire()
+ * at a point of its choosing, so switching costs a pointer swap. The object
+ * it replaces goes into a retired queue and is deleted by the writer on its
+ * next publish() or releaseRetired(), never by the reader. If the retired
+ * queue is full the reader keeps its current object and tries again later.
+ * 
+ * @tparam T The type of object handed over
+ * @tparam Size Capacity of the retired queue (power of 2); up to Size - 1
+ *              objects can wait to be freed
+ */
+template<typename T, int Size = 8>
+class RetiringPointer
+{
+public:
+    RetiringPointer() = default;
+    
+    ~RetiringPointer()
+    {
+        reset();
+    }
+    
+    /**
+     * @brief Make a new object available to the reader (writer thread)
+     * 
+     * Replaces any object the reader has not picked up yet, and frees
+     * objects the reader has finished with.
+     * 
+     * @param object The new object
+     */
+    void publish(std::unique_ptr<T> object)
+    {
+        releaseRetired();
+        delete pending.exchange(object.release(), std::memory_order_acq_rel);
+    }
+    
+    /**
+     * @brief Pick up a published object, if any (reader thread)
+     * 
+     * @return true if the current object changed
+     */
+    bool acquire()
+    {
+        return acquire([] (T&) {});
+    }
+    
+    /**
+     * @brief Pick up a published object, if any (reader thread)
+     * 
+     * @param beforeSwap Called with the new object while get() still returns the old one
+     * @return true if the current object changed
+     */
+    template<typename Callback>
+    bool acquire(Callback&& beforeSwap)
+    {
+        if (pending.load(std::memory_order_acquire) == nullptr)
+            return false;
+        
+        // Only swap if the old object can be handed back, so nothing is freed here
+        if (active != nullptr && retired.getNumReady() >= Size - 1)
+            return false;
+        
+        T* next = pending.exchange(nullptr, std::memory_order_acq_rel);
+        
+        if (next == nullptr)
+            return false;
+        
+        beforeSwap(*next);
+        
+        if (active != nullptr)
+        {
+            retired.push(active.release());
+        }
+        
+        active.reset(next);
+        return true;
+    }
+    
+    /**
+     * @brief Get the object the reader is using (reader thread)
+     * 
+     * @return The current object, or nullptr if none has been acquired
+     */
+    T* get() const noexcept
+    {
+        return active.get();
+    }
+    
+    /**
+     * @brief Free objects the reader has finished with (writer thread)
+     */
+    void releaseRetired()
+    {
+        T* object = nullptr;
+        
+        while (retired.pop(object))
+        {
+            delete object;
+        }
+    }
+    
+    /**
+     * @brief Free everything and start again from the given object
+     * 
+     * Only call this while the reader is not running.
+     * 
+     * @param initial The object get() returns afterwards (may be nullptr)
+     */
+    void reset(std::unique_ptr<T> initial = nullptr)
+    {
+        delete pending.exchange(nullptr, std::memory_order_acq_rel);
+        releaseRetired();
+        active = std::move(initial);
+    }
+    
+private:
+    std::atomic<T*> pending { nullptr };
+    std::unique_ptr<T> active;
+    LockFreeQueue<T*, Size> retired;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RetiringPointer)
+};
+
+/**
+ * @brief Tell the CPU the caller is spin-waiting
+ * 
+ * Cheaper than yielding to the OS scheduler, and never blocks, so the audio
+ * thread can use it while it waits for other threads to finish their part of
+ * a block.
+ */
+void pauseCpu() noexcept;
+
+/**
+ * @class Semaphore
+ * @brief A counting semaphore backed by the operating system
+ * 
+ * post() takes no lock, so it is safe to call from the audio thread.
+ */
+class Semaphore
+{
+public:
+    Semaphore();
+    ~Semaphore();
+    
+    /**
+     * @brief Increment the count, waking one waiting thread if there is one
+     */
+    void post();
+    
+    /**
+     * @brief Wait for the count to be non-zero, then decrement it
+     * 
+     * @param timeoutMilliseconds How long to wait, or -1 to wait forever
+     * @return true if the count was decremented, false on timeout
+     */
+    bool wait(int timeoutMilliseconds = -1);
+    
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Semaphore)
+};
+
+/**
+ * @class WakeSignal
+ * @brief Wakes one waiting thread without taking a lock on the notifying side
+ * 
+ * notify() bumps a generation counter and only posts the semaphore if the
+ * waiter has gone to sleep, so it costs an atomic increment when the waiter
+ * is busy or spinning. The waiter spins briefly before sleeping, so it picks
+ * up notifications that arrive in quick succession without a system call.
+ * Any number of threads may notify; only one thread may wait.
+ */
+class WakeSignal
+{
+public:
+    /**
+     * @brief Constructor
+     * 
+     * @param spinIterations How many times wait() checks for a notification before sleeping
+     */
+    explicit WakeSignal(int spinIterations = 2000);
+    
+    /**
+     * @brief Wake the waiting thread (any thread, lock-free)
+     */
+    void notify() noexcept;
+    
+    /**
+     * @brief Wait for a notification (waiting thread only)
+     * 
+     * Notifications that arrive while the waiter is busy are not lost: the
+     * next wait() returns straight away. Several of them count as one.
+     * 
+     * @param timeoutMilliseconds How long to sleep, or -1 to sleep until notified
+     * @return true if notified since the last call, false on timeout
+     */
+    bool wait(int timeoutMilliseconds = -1);
+    
+private:
+    std::atomic<std::uint32_t> generation { 0 };
+    std::atomic<bool> sleeping { false };
+    std::uint32_t lastSeenGeneration = 0;
+    const int spinIterations;
+    Semaphore semaphore;
+    
+    bool consumeNotification() noexcept;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WakeSignal)
+};
+
 /**
  * @class ParameterQueue
  * @brief Queue for thread-safe parameter updates from UI to audio thread
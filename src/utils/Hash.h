@@ -0,0 +1,104 @@
+/*
+ * Underground Beats
+ * Hash.h
+ * 
+ * FNV-1a hashing for cache keys, content hashes and checksums
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <string>
+#include <type_traits>
+
+namespace UndergroundBeats {
+namespace Hash {
+
+// FNV-1a rather than std::hash: the result is the same on every run and
+// platform, so it can be stored on disk or used in file names
+constexpr juce::uint64 offsetBasis = 0xcbf29ce484222325ULL;
+constexpr juce::uint64 prime = 0x100000001b3ULL;
+
+/**
+ * @brief Hash a block of bytes with 64-bit FNV-1a
+ * 
+ * @param data The bytes to hash
+ * @param numBytes How many bytes to hash
+ * @param hash The hash to continue from, or offsetBasis to start a new one
+ * @return The updated hash
+ */
+inline juce::uint64 fnv1a(const void* data, size_t numBytes, juce::uint64 hash = offsetBasis) noexcept
+{
+    auto* bytes = static_cast<const juce::uint8*>(data);
+    
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= prime;
+    }
+    
+    return hash;
+}
+
+/**
+ * @brief Hash a block of bytes with 32-bit FNV-1a
+ * 
+ * @param data The bytes to hash
+ * @param numBytes How many bytes to hash
+ * @return The hash
+ */
+inline juce::uint32 fnv1a32(const void* data, size_t numBytes) noexcept
+{
+    juce::uint32 hash = 0x811c9dc5;
+    auto* bytes = static_cast<const juce::uint8*>(data);
+    
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x01000193;
+    }
+    
+    return hash;
+}
+
+/**
+ * @brief Add a plain value to a hash
+ * 
+ * @param hash The hash so far
+ * @param value A value with no padding bytes (integers, floats, enums)
+ * @return The updated hash
+ */
+template<typename T>
+inline juce::uint64 combine(juce::uint64 hash, const T& value) noexcept
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be hashed by their bytes");
+    return fnv1a(&value, sizeof(T), hash);
+}
+
+/**
+ * @brief Add a piece of text to a hash
+ * 
+ * A separator byte follows the text, so "ab" + "c" and "a" + "bc" differ.
+ * 
+ * @param hash The hash so far
+ * @param text The text
+ * @param numBytes The length of the text in bytes
+ * @return The updated hash
+ */
+inline juce::uint64 combineText(juce::uint64 hash, const char* text, size_t numBytes) noexcept
+{
+    return combine(fnv1a(text, numBytes, hash), static_cast<juce::uint8>(0xff));
+}
+
+inline juce::uint64 combineText(juce::uint64 hash, const std::string& text) noexcept
+{
+    return combineText(hash, text.data(), text.size());
+}
+
+inline juce::uint64 combineText(juce::uint64 hash, const juce::String& text) noexcept
+{
+    return combineText(hash, text.toRawUTF8(), text.getNumBytesAsUTF8());
+}
+
+} // namespace Hash
+} // namespace UndergroundBeats
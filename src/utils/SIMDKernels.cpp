@@ -0,0 +1,705 @@
+/*
+ * Underground Beats
+ * SIMDKernels.cpp
+ *
+ * Scalar, SSE2 and NEON kernels and runtime dispatch
+ */
+
+#include "SIMDKernels.h"
+#include "SIMDKernelsInternal.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define UB_SIMD_HAS_SSE2 1
+ #include <emmintrin.h>
+#else
+ #define UB_SIMD_HAS_SSE2 0
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+ #define UB_SIMD_HAS_NEON 1
+ #include <arm_neon.h>
+#else
+ #define UB_SIMD_HAS_NEON 0
+#endif
+
+namespace UndergroundBeats {
+namespace SIMD {
+
+using detail::KernelTable;
+
+//==============================================================================
+// Scalar kernels (reference implementation and tail handling)
+//==============================================================================
+
+namespace scalar {
+
+void applyGain(float* data, float gain, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        data[i] *= gain;
+}
+
+void applyGainRamp(float* data, float startGain, float endGain, int numSamples)
+{
+    const float step = numSamples > 0 ? (endGain - startGain) / static_cast<float>(numSamples) : 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+        data[i] *= startGain + step * static_cast<float>(i);
+}
+
+void copyWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] = src[i] * gain;
+}
+
+void addWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] += src[i] * gain;
+}
+
+void mix(float* dest, const float* src, float destGain, float srcGain, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] = dest[i] * destGain + src[i] * srcGain;
+}
+
+float findPeak(const float* data, int numSamples)
+{
+    float peak = 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+        peak = std::max(peak, std::abs(data[i]));
+
+    return peak;
+}
+
+float sumOfSquares(const float* data, int numSamples)
+{
+    float sum = 0.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+        sum += data[i] * data[i];
+
+    return sum;
+}
+
+void clamp(float* data, float minValue, float maxValue, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        data[i] = std::min(maxValue, std::max(minValue, data[i]));
+}
+
+void softClip(float* data, float drive, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float x = std::min(3.0f, std::max(-3.0f, data[i] * drive));
+        const float x2 = x * x;
+        data[i] = x * (27.0f + x2) / (27.0f + 9.0f * x2);
+    }
+}
+
+const KernelTable table = {
+    applyGain, applyGainRamp, copyWithGain, addWithGain, mix,
+    findPeak, sumOfSquares, clamp, softClip
+};
+
+} // namespace scalar
+
+//==============================================================================
+// SSE2 kernels (4 lanes)
+//==============================================================================
+
+#if UB_SIMD_HAS_SSE2
+namespace sse2 {
+
+inline float horizontalSum(__m128 v)
+{
+    const __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    const __m128 sums = _mm_add_ps(v, shuffled);
+    return _mm_cvtss_f32(_mm_add_ss(sums, _mm_movehl_ps(shuffled, sums)));
+}
+
+inline float horizontalMax(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(v);
+}
+
+void applyGain(float* data, float gain, int numSamples)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+
+    scalar::applyGain(data + i, gain, numSamples - i);
+}
+
+void applyGainRamp(float* data, float startGain, float endGain, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    const float step = (endGain - startGain) / static_cast<float>(numSamples);
+    __m128 g = _mm_setr_ps(startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step);
+    const __m128 increment = _mm_set1_ps(4.0f * step);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+        g = _mm_add_ps(g, increment);
+    }
+
+    for (; i < numSamples; ++i)
+        data[i] *= startGain + step * static_cast<float>(i);
+}
+
+void copyWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+
+    scalar::copyWithGain(dest + i, src + i, gain, numSamples - i);
+}
+
+void addWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+
+    scalar::addWithGain(dest + i, src + i, gain, numSamples - i);
+}
+
+void mix(float* dest, const float* src, float destGain, float srcGain, int numSamples)
+{
+    const __m128 dg = _mm_set1_ps(destGain);
+    const __m128 sg = _mm_set1_ps(srcGain);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 d = _mm_mul_ps(_mm_loadu_ps(dest + i), dg);
+        _mm_storeu_ps(dest + i, _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(src + i), sg)));
+    }
+
+    scalar::mix(dest + i, src + i, destGain, srcGain, numSamples - i);
+}
+
+float findPeak(const float* data, int numSamples)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_setzero_ps();
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(data + i), absMask));
+
+    return std::max(horizontalMax(peak), scalar::findPeak(data + i, numSamples - i));
+}
+
+float sumOfSquares(const float* data, int numSamples)
+{
+    __m128 sum = _mm_setzero_ps();
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(data + i);
+        sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+    }
+
+    return horizontalSum(sum) + scalar::sumOfSquares(data + i, numSamples - i);
+}
+
+void clamp(float* data, float minValue, float maxValue, int numSamples)
+{
+    const __m128 lo = _mm_set1_ps(minValue);
+    const __m128 hi = _mm_set1_ps(maxValue);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        _mm_storeu_ps(data + i, _mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(data + i))));
+
+    scalar::clamp(data + i, minValue, maxValue, numSamples - i);
+}
+
+void softClip(float* data, float drive, int numSamples)
+{
+    const __m128 d = _mm_set1_ps(drive);
+    const __m128 lo = _mm_set1_ps(-3.0f);
+    const __m128 hi = _mm_set1_ps(3.0f);
+    const __m128 c27 = _mm_set1_ps(27.0f);
+    const __m128 c9 = _mm_set1_ps(9.0f);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 x = _mm_min_ps(hi, _mm_max_ps(lo, _mm_mul_ps(_mm_loadu_ps(data + i), d)));
+        const __m128 x2 = _mm_mul_ps(x, x);
+        const __m128 numerator = _mm_mul_ps(x, _mm_add_ps(c27, x2));
+        const __m128 denominator = _mm_add_ps(c27, _mm_mul_ps(c9, x2));
+        _mm_storeu_ps(data + i, _mm_div_ps(numerator, denominator));
+    }
+
+    scalar::softClip(data + i, drive, numSamples - i);
+}
+
+const KernelTable table = {
+    applyGain, applyGainRamp, copyWithGain, addWithGain, mix,
+    findPeak, sumOfSquares, clamp, softClip
+};
+
+} // namespace sse2
+#endif
+
+//==============================================================================
+// NEON kernels (4 lanes, ARM64)
+//==============================================================================
+
+#if UB_SIMD_HAS_NEON
+namespace neon {
+
+void applyGain(float* data, float gain, int numSamples)
+{
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        vst1q_f32(data + i, vmulq_n_f32(vld1q_f32(data + i), gain));
+
+    scalar::applyGain(data + i, gain, numSamples - i);
+}
+
+void applyGainRamp(float* data, float startGain, float endGain, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    const float step = (endGain - startGain) / static_cast<float>(numSamples);
+    const float initial[4] = { startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step };
+    float32x4_t g = vld1q_f32(initial);
+    const float32x4_t increment = vdupq_n_f32(4.0f * step);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), g));
+        g = vaddq_f32(g, increment);
+    }
+
+    for (; i < numSamples; ++i)
+        data[i] *= startGain + step * static_cast<float>(i);
+}
+
+void copyWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        vst1q_f32(dest + i, vmulq_n_f32(vld1q_f32(src + i), gain));
+
+    scalar::copyWithGain(dest + i, src + i, gain, numSamples - i);
+}
+
+void addWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        vst1q_f32(dest + i, vmlaq_n_f32(vld1q_f32(dest + i), vld1q_f32(src + i), gain));
+
+    scalar::addWithGain(dest + i, src + i, gain, numSamples - i);
+}
+
+void mix(float* dest, const float* src, float destGain, float srcGain, int numSamples)
+{
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const float32x4_t d = vmulq_n_f32(vld1q_f32(dest + i), destGain);
+        vst1q_f32(dest + i, vmlaq_n_f32(d, vld1q_f32(src + i), srcGain));
+    }
+
+    scalar::mix(dest + i, src + i, destGain, srcGain, numSamples - i);
+}
+
+float findPeak(const float* data, int numSamples)
+{
+    float32x4_t peak = vdupq_n_f32(0.0f);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(data + i)));
+
+    return std::max(vmaxvq_f32(peak), scalar::findPeak(data + i, numSamples - i));
+}
+
+float sumOfSquares(const float* data, int numSamples)
+{
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const float32x4_t x = vld1q_f32(data + i);
+        sum = vmlaq_f32(sum, x, x);
+    }
+
+    return vaddvq_f32(sum) + scalar::sumOfSquares(data + i, numSamples - i);
+}
+
+void clamp(float* data, float minValue, float maxValue, int numSamples)
+{
+    const float32x4_t lo = vdupq_n_f32(minValue);
+    const float32x4_t hi = vdupq_n_f32(maxValue);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+        vst1q_f32(data + i, vminq_f32(hi, vmaxq_f32(lo, vld1q_f32(data + i))));
+
+    scalar::clamp(data + i, minValue, maxValue, numSamples - i);
+}
+
+void softClip(float* data, float drive, int numSamples)
+{
+    const float32x4_t lo = vdupq_n_f32(-3.0f);
+    const float32x4_t hi = vdupq_n_f32(3.0f);
+    const float32x4_t c27 = vdupq_n_f32(27.0f);
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const float32x4_t x = vminq_f32(hi, vmaxq_f32(lo, vmulq_n_f32(vld1q_f32(data + i), drive)));
+        const float32x4_t x2 = vmulq_f32(x, x);
+        const float32x4_t numerator = vmulq_f32(x, vaddq_f32(c27, x2));
+        const float32x4_t denominator = vmlaq_n_f32(c27, x2, 9.0f);
+        vst1q_f32(data + i, vdivq_f32(numerator, denominator));
+    }
+
+    scalar::softClip(data + i, drive, numSamples - i);
+}
+
+const KernelTable table = {
+    applyGain, applyGainRamp, copyWithGain, addWithGain, mix,
+    findPeak, sumOfSquares, clamp, softClip
+};
+
+} // namespace neon
+#endif
+
+//==============================================================================
+// Dispatch
+//==============================================================================
+
+namespace {
+
+struct Dispatch
+{
+    const KernelTable* kernels = &scalar::table;
+    InstructionSet instructionSet = InstructionSet::Scalar;
+
+    Dispatch()
+    {
+       #if UB_SIMD_HAS_SSE2
+        if (juce::SystemStats::hasSSE2())
+        {
+            kernels = &sse2::table;
+            instructionSet = InstructionSet::SSE2;
+        }
+
+        if (auto* avx2 = detail::getAVX2Kernels())
+        {
+            if (juce::SystemStats::hasAVX2())
+            {
+                kernels = avx2;
+                instructionSet = InstructionSet::AVX2;
+            }
+        }
+       #elif UB_SIMD_HAS_NEON
+        kernels = &neon::table;
+        instructionSet = InstructionSet::NEON;
+       #endif
+    }
+};
+
+const Dispatch& getDispatch()
+{
+    static const Dispatch dispatch;
+    return dispatch;
+}
+
+inline const KernelTable& kernels()
+{
+    return *getDispatch().kernels;
+}
+
+} // namespace
+
+InstructionSet getInstructionSet()
+{
+    return getDispatch().instructionSet;
+}
+
+const char* getInstructionSetName(InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+        case InstructionSet::SSE2: return "SSE2";
+        case InstructionSet::AVX2: return "AVX2";
+        case InstructionSet::NEON: return "NEON";
+        case InstructionSet::Scalar:
+        default:                   return "Scalar";
+    }
+}
+
+//==============================================================================
+// Gain and mixing
+
+void applyGain(float* data, float gain, int numSamples)
+{
+    if (gain == 1.0f)
+        return;
+
+    if (gain == 0.0f)
+    {
+        std::fill(data, data + numSamples, 0.0f);
+        return;
+    }
+
+    kernels().applyGain(data, gain, numSamples);
+}
+
+void applyGainRamp(float* data, float startGain, float endGain, int numSamples)
+{
+    if (startGain == endGain)
+    {
+        applyGain(data, startGain, numSamples);
+        return;
+    }
+
+    kernels().applyGainRamp(data, startGain, endGain, numSamples);
+}
+
+void copyWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    kernels().copyWithGain(dest, src, gain, numSamples);
+}
+
+void addWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    if (gain == 0.0f)
+        return;
+
+    kernels().addWithGain(dest, src, gain, numSamples);
+}
+
+void mix(float* dest, const float* src, float destGain, float srcGain, int numSamples)
+{
+    kernels().mix(dest, src, destGain, srcGain, numSamples);
+}
+
+void crossfade(float* dest, const float* src, float amount, int numSamples)
+{
+    if (amount <= 0.0f)
+        return;
+
+    if (amount >= 1.0f)
+    {
+        std::copy(src, src + numSamples, dest);
+        return;
+    }
+
+    kernels().mix(dest, src, 1.0f - amount, amount, numSamples);
+}
+
+void panMonoToStereo(const float* src, float* left, float* right, float pan, int numSamples)
+{
+    const float angle = (juce::jlimit(-1.0f, 1.0f, pan) + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+
+    kernels().copyWithGain(left, src, std::cos(angle), numSamples);
+    kernels().copyWithGain(right, src, std::sin(angle), numSamples);
+}
+
+void applyBalance(float* left, float* right, float pan, int numSamples)
+{
+    const float balance = juce::jlimit(-1.0f, 1.0f, pan);
+
+    applyGain(left, std::min(1.0f, 1.0f - balance), numSamples);
+    applyGain(right, std::min(1.0f, 1.0f + balance), numSamples);
+}
+
+//==============================================================================
+// Channel layout
+
+void interleave(const float* const* channels, float* dest, int numChannels, int numSamples)
+{
+    int i = 0;
+
+   #if UB_SIMD_HAS_SSE2
+    if (numChannels == 2)
+    {
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 l = _mm_loadu_ps(channels[0] + i);
+            const __m128 r = _mm_loadu_ps(channels[1] + i);
+            _mm_storeu_ps(dest + 2 * i, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(dest + 2 * i + 4, _mm_unpackhi_ps(l, r));
+        }
+    }
+   #elif UB_SIMD_HAS_NEON
+    if (numChannels == 2)
+    {
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            float32x4x2_t frames;
+            frames.val[0] = vld1q_f32(channels[0] + i);
+            frames.val[1] = vld1q_f32(channels[1] + i);
+            vst2q_f32(dest + 2 * i, frames);
+        }
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+        for (int channel = 0; channel < numChannels; ++channel)
+            dest[i * numChannels + channel] = channels[channel][i];
+}
+
+void deinterleave(const float* src, float* const* channels, int numChannels, int numSamples)
+{
+    int i = 0;
+
+   #if UB_SIMD_HAS_SSE2
+    if (numChannels == 2)
+    {
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(src + 2 * i);
+            const __m128 b = _mm_loadu_ps(src + 2 * i + 4);
+            _mm_storeu_ps(channels[0] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(channels[1] + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+    }
+   #elif UB_SIMD_HAS_NEON
+    if (numChannels == 2)
+    {
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const float32x4x2_t frames = vld2q_f32(src + 2 * i);
+            vst1q_f32(channels[0] + i, frames.val[0]);
+            vst1q_f32(channels[1] + i, frames.val[1]);
+        }
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][i] = src[i * numChannels + channel];
+}
+
+//==============================================================================
+// Filtering
+
+void processBiquadCascade(float* data, int numSamples, const BiquadCoefficients* coefficients,
+                          BiquadState* states, int numStages)
+{
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        const auto c = coefficients[stage];
+        float z1 = states[stage].z1;
+        float z2 = states[stage].z2;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float x = data[i];
+            const float y = c.b0 * x + z1;
+            z1 = c.b1 * x - c.a1 * y + z2;
+            z2 = c.b2 * x - c.a2 * y;
+            data[i] = y;
+        }
+
+        states[stage].z1 = z1;
+        states[stage].z2 = z2;
+    }
+}
+
+void processBiquadCascadeStereo(float* left, float* right, int numSamples,
+                                const BiquadCoefficients* coefficients,
+                                BiquadState* leftStates, BiquadState* rightStates, int numStages)
+{
+    // Scalar, with both channels in one loop: each channel's recurrence is
+    // latency bound, so the two chains overlap in the pipeline and run as fast
+    // as a two-lane vector would, without packing every sample into a register
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        const auto c = coefficients[stage];
+        float leftZ1 = leftStates[stage].z1;
+        float leftZ2 = leftStates[stage].z2;
+        float rightZ1 = rightStates[stage].z1;
+        float rightZ2 = rightStates[stage].z2;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float leftIn = left[i];
+            const float rightIn = right[i];
+            const float leftOut = c.b0 * leftIn + leftZ1;
+            const float rightOut = c.b0 * rightIn + rightZ1;
+            leftZ1 = c.b1 * leftIn - c.a1 * leftOut + leftZ2;
+            rightZ1 = c.b1 * rightIn - c.a1 * rightOut + rightZ2;
+            leftZ2 = c.b2 * leftIn - c.a2 * leftOut;
+            rightZ2 = c.b2 * rightIn - c.a2 * rightOut;
+            left[i] = leftOut;
+            right[i] = rightOut;
+        }
+
+        leftStates[stage].z1 = leftZ1;
+        leftStates[stage].z2 = leftZ2;
+        rightStates[stage].z1 = rightZ1;
+        rightStates[stage].z2 = rightZ2;
+    }
+}
+
+//==============================================================================
+// Analysis
+
+float findPeak(const float* data, int numSamples)
+{
+    return numSamples > 0 ? kernels().findPeak(data, numSamples) : 0.0f;
+}
+
+float calculateRMS(const float* data, int numSamples)
+{
+    if (numSamples <= 0)
+        return 0.0f;
+
+    return std::sqrt(kernels().sumOfSquares(data, numSamples) / static_cast<float>(numSamples));
+}
+
+//==============================================================================
+// Limiting
+
+void clamp(float* data, float minValue, float maxValue, int numSamples)
+{
+    kernels().clamp(data, minValue, maxValue, numSamples);
+}
+
+void softClip(float* data, float drive, int numSamples)
+{
+    kernels().softClip(data, drive, numSamples);
+}
+
+} // namespace SIMD
+} // namespace UndergroundBeats
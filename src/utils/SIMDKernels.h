@@ -0,0 +1,191 @@
+/*
+ * Underground Beats
+ * SIMDKernels.h
+ *
+ * Vectorised DSP kernels with runtime CPU dispatch
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace UndergroundBeats {
+namespace SIMD {
+
+/**
+ * @brief Instruction sets the kernels can be dispatched to
+ */
+enum class InstructionSet
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+/**
+ * @brief Get the instruction set selected for this CPU
+ *
+ * The choice is made once, the first time a kernel is called: AVX2 if the
+ * CPU supports it, otherwise SSE2 on x86, NEON on ARM64, and plain C++
+ * everywhere else.
+ *
+ * @return The instruction set in use
+ */
+InstructionSet getInstructionSet();
+
+/**
+ * @brief Get a readable name for an instruction set
+ *
+ * @param instructionSet The instruction set
+ * @return The name, e.g. "AVX2"
+ */
+const char* getInstructionSetName(InstructionSet instructionSet);
+
+//==============================================================================
+// Gain and mixing
+
+/**
+ * @brief Multiply a buffer by a constant gain
+ */
+void applyGain(float* data, float gain, int numSamples);
+
+/**
+ * @brief Multiply a buffer by a gain that ramps linearly from startGain to endGain
+ */
+void applyGainRamp(float* data, float startGain, float endGain, int numSamples);
+
+/**
+ * @brief Copy a buffer, scaling it by a constant gain (dest = src * gain)
+ */
+void copyWithGain(float* dest, const float* src, float gain, int numSamples);
+
+/**
+ * @brief Accumulate a scaled buffer into another (dest += src * gain)
+ */
+void addWithGain(float* dest, const float* src, float gain, int numSamples);
+
+/**
+ * @brief Weighted sum of two buffers in place (dest = dest * destGain + src * srcGain)
+ */
+void mix(float* dest, const float* src, float destGain, float srcGain, int numSamples);
+
+/**
+ * @brief Crossfade from dest towards src by amount (0 = dest, 1 = src)
+ *
+ * This is the wet/dry mix used throughout the effects: dest holds the dry
+ * signal and src the wet one.
+ */
+void crossfade(float* dest, const float* src, float amount, int numSamples);
+
+/**
+ * @brief Pan a mono signal into a stereo pair with a constant-power law
+ *
+ * @param pan Pan position from -1 (left) to 1 (right)
+ */
+void panMonoToStereo(const float* src, float* left, float* right, float pan, int numSamples);
+
+/**
+ * @brief Apply a balance control to a stereo pair
+ *
+ * The channel being panned towards stays at unity; the other is attenuated
+ * linearly to silence at the extreme.
+ *
+ * @param pan Balance from -1 (left) to 1 (right)
+ */
+void applyBalance(float* left, float* right, float pan, int numSamples);
+
+//==============================================================================
+// Channel layout
+
+/**
+ * @brief Interleave separate channel buffers into a single frame-ordered buffer
+ */
+void interleave(const float* const* channels, float* dest, int numChannels, int numSamples);
+
+/**
+ * @brief Split a frame-ordered buffer into separate channel buffers
+ */
+void deinterleave(const float* src, float* const* channels, int numChannels, int numSamples);
+
+//==============================================================================
+// Filtering
+
+/**
+ * @brief Normalised biquad coefficients (feed-forward b, feedback a, a0 == 1)
+ */
+struct BiquadCoefficients
+{
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+    float a1 = 0.0f, a2 = 0.0f;
+};
+
+/**
+ * @brief Transposed direct form II state for one biquad stage
+ */
+struct BiquadState
+{
+    float z1 = 0.0f, z2 = 0.0f;
+
+    void reset() { z1 = z2 = 0.0f; }
+};
+
+/**
+ * @brief Run a buffer through a cascade of biquad sections in place
+ *
+ * The recursion cannot be vectorised along time, so each stage runs over
+ * the whole block before the next one starts; this keeps a stage's
+ * coefficients and state in registers.
+ *
+ * @param data The samples to filter
+ * @param numSamples Number of samples
+ * @param coefficients One set of coefficients per stage
+ * @param states One state per stage
+ * @param numStages Number of stages in the cascade
+ */
+void processBiquadCascade(float* data, int numSamples, const BiquadCoefficients* coefficients,
+                          BiquadState* states, int numStages);
+
+/**
+ * @brief Run a stereo pair through the same biquad cascade
+ *
+ * Both channels share coefficients and are filtered in the same loop with
+ * separate state, so their recurrences overlap.
+ */
+void processBiquadCascadeStereo(float* left, float* right, int numSamples,
+                                const BiquadCoefficients* coefficients,
+                                BiquadState* leftStates, BiquadState* rightStates, int numStages);
+
+//==============================================================================
+// Analysis
+
+/**
+ * @brief Find the largest absolute sample value
+ */
+float findPeak(const float* data, int numSamples);
+
+/**
+ * @brief Calculate the RMS level of a buffer
+ */
+float calculateRMS(const float* data, int numSamples);
+
+//==============================================================================
+// Limiting
+
+/**
+ * @brief Clamp every sample to [minValue, maxValue]
+ */
+void clamp(float* data, float minValue, float maxValue, int numSamples);
+
+/**
+ * @brief Apply a smooth tanh-like saturation
+ *
+ * Uses a rational approximation of tanh that is exact at +/-3 and hard-limits
+ * beyond it, so the output never exceeds +/-1.
+ *
+ * @param drive Gain applied before the curve
+ */
+void softClip(float* data, float drive, int numSamples);
+
+} // namespace SIMD
+} // namespace UndergroundBeats
@@ -0,0 +1,224 @@
+/*
+ * Underground Beats
+ * SIMDKernelsAVX2.cpp
+ *
+ * AVX2 kernels, built with AVX2 code generation and only called after a CPU check
+ */
+
+#include "SIMDKernelsInternal.h"
+
+#if defined(__AVX2__)
+ #include <immintrin.h>
+#endif
+
+namespace UndergroundBeats {
+namespace SIMD {
+namespace detail {
+
+#if defined(__AVX2__)
+namespace avx2 {
+
+// Only intrinsics and plain loops in here; see SIMDKernelsInternal.h
+
+static inline __m128 reduceTo128(__m256 v, bool useMax)
+{
+    const __m128 lo = _mm256_castps256_ps128(v);
+    const __m128 hi = _mm256_extractf128_ps(v, 1);
+    return useMax ? _mm_max_ps(lo, hi) : _mm_add_ps(lo, hi);
+}
+
+static inline float horizontalSum(__m256 v)
+{
+    __m128 x = reduceTo128(v, false);
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+static inline float horizontalMax(__m256 v)
+{
+    __m128 x = reduceTo128(v, true);
+    x = _mm_max_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_max_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+static void applyGain(float* data, float gain, int numSamples)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), g));
+
+    for (; i < numSamples; ++i)
+        data[i] *= gain;
+}
+
+static void applyGainRamp(float* data, float startGain, float endGain, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    const float step = (endGain - startGain) / static_cast<float>(numSamples);
+    __m256 g = _mm256_add_ps(_mm256_set1_ps(startGain),
+                             _mm256_mul_ps(_mm256_set1_ps(step), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)));
+    const __m256 increment = _mm256_set1_ps(8.0f * step);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), g));
+        g = _mm256_add_ps(g, increment);
+    }
+
+    for (; i < numSamples; ++i)
+        data[i] *= startGain + step * static_cast<float>(i);
+}
+
+static void copyWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+
+    for (; i < numSamples; ++i)
+        dest[i] = src[i] * gain;
+}
+
+static void addWithGain(float* dest, const float* src, float gain, int numSamples)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i),
+                                                 _mm256_mul_ps(_mm256_loadu_ps(src + i), g)));
+
+    for (; i < numSamples; ++i)
+        dest[i] += src[i] * gain;
+}
+
+static void mix(float* dest, const float* src, float destGain, float srcGain, int numSamples)
+{
+    const __m256 dg = _mm256_set1_ps(destGain);
+    const __m256 sg = _mm256_set1_ps(srcGain);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m256 d = _mm256_mul_ps(_mm256_loadu_ps(dest + i), dg);
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(src + i), sg)));
+    }
+
+    for (; i < numSamples; ++i)
+        dest[i] = dest[i] * destGain + src[i] * srcGain;
+}
+
+static float findPeak(const float* data, int numSamples)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 peak = _mm256_setzero_ps();
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+        peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(data + i), absMask));
+
+    float result = horizontalMax(peak);
+
+    for (; i < numSamples; ++i)
+    {
+        const float magnitude = data[i] < 0.0f ? -data[i] : data[i];
+        if (magnitude > result)
+            result = magnitude;
+    }
+
+    return result;
+}
+
+static float sumOfSquares(const float* data, int numSamples)
+{
+    __m256 sum = _mm256_setzero_ps();
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(data + i);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(x, x));
+    }
+
+    float result = horizontalSum(sum);
+
+    for (; i < numSamples; ++i)
+        result += data[i] * data[i];
+
+    return result;
+}
+
+static void clamp(float* data, float minValue, float maxValue, int numSamples)
+{
+    const __m256 lo = _mm256_set1_ps(minValue);
+    const __m256 hi = _mm256_set1_ps(maxValue);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+        _mm256_storeu_ps(data + i, _mm256_min_ps(hi, _mm256_max_ps(lo, _mm256_loadu_ps(data + i))));
+
+    for (; i < numSamples; ++i)
+        data[i] = data[i] < minValue ? minValue : (data[i] > maxValue ? maxValue : data[i]);
+}
+
+static void softClip(float* data, float drive, int numSamples)
+{
+    const __m256 d = _mm256_set1_ps(drive);
+    const __m256 lo = _mm256_set1_ps(-3.0f);
+    const __m256 hi = _mm256_set1_ps(3.0f);
+    const __m256 c27 = _mm256_set1_ps(27.0f);
+    const __m256 c9 = _mm256_set1_ps(9.0f);
+    int i = 0;
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m256 x = _mm256_min_ps(hi, _mm256_max_ps(lo, _mm256_mul_ps(_mm256_loadu_ps(data + i), d)));
+        const __m256 x2 = _mm256_mul_ps(x, x);
+        const __m256 numerator = _mm256_mul_ps(x, _mm256_add_ps(c27, x2));
+        const __m256 denominator = _mm256_add_ps(c27, _mm256_mul_ps(c9, x2));
+        _mm256_storeu_ps(data + i, _mm256_div_ps(numerator, denominator));
+    }
+
+    for (; i < numSamples; ++i)
+    {
+        float x = data[i] * drive;
+        x = x < -3.0f ? -3.0f : (x > 3.0f ? 3.0f : x);
+        const float x2 = x * x;
+        data[i] = x * (27.0f + x2) / (27.0f + 9.0f * x2);
+    }
+}
+
+static const KernelTable table = {
+    applyGain, applyGainRamp, copyWithGain, addWithGain, mix,
+    findPeak, sumOfSquares, clamp, softClip
+};
+
+} // namespace avx2
+
+const KernelTable* getAVX2Kernels()
+{
+    return &avx2::table;
+}
+
+#else
+
+const KernelTable* getAVX2Kernels()
+{
+    // Built without AVX2 code generation (e.g. non-x86 targets)
+    return nullptr;
+}
+
+#endif
+
+} // namespace detail
+} // namespace SIMD
+} // namespace UndergroundBeats
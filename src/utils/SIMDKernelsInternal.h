@@ -0,0 +1,44 @@
+/*
+ * Underground Beats
+ * SIMDKernelsInternal.h
+ *
+ * Dispatch table shared by the per-instruction-set kernel implementations
+ */
+
+#pragma once
+
+// This header is included by translation units built with extra instruction
+// set flags (e.g. -mavx2). It must not pull in JUCE or standard library
+// headers with inline functions: the linker may keep the copy compiled with
+// the wider instruction set and run it on a CPU that lacks it.
+
+namespace UndergroundBeats {
+namespace SIMD {
+namespace detail {
+
+/**
+ * @brief Function pointers for the kernels that have per-ISA implementations
+ */
+struct KernelTable
+{
+    void (*applyGain)(float* data, float gain, int numSamples);
+    void (*applyGainRamp)(float* data, float startGain, float endGain, int numSamples);
+    void (*copyWithGain)(float* dest, const float* src, float gain, int numSamples);
+    void (*addWithGain)(float* dest, const float* src, float gain, int numSamples);
+    void (*mix)(float* dest, const float* src, float destGain, float srcGain, int numSamples);
+    float (*findPeak)(const float* data, int numSamples);
+    float (*sumOfSquares)(const float* data, int numSamples);
+    void (*clamp)(float* data, float minValue, float maxValue, int numSamples);
+    void (*softClip)(float* data, float drive, int numSamples);
+};
+
+/**
+ * @brief Get the AVX2 kernels
+ *
+ * @return The kernel table, or nullptr if the build has no AVX2 support
+ */
+const KernelTable* getAVX2Kernels();
+
+} // namespace detail
+} // namespace SIMD
+} // namespace UndergroundBeats
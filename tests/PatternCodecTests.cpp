@@ -0,0 +1,259 @@
+/*
+ * Underground Beats
+ * PatternCodecTests.cpp
+ *
+ * Round trips and damaged input for the compact pattern encoding
+ */
+
+#include <JuceHeader.h>
+#include "../src/sequencer/PatternCodec.h"
+#include <algorithm>
+#include <limits>
+
+namespace UndergroundBeats {
+
+class PatternCodecTests : public juce::UnitTest {
+public:
+    PatternCodecTests()
+        : juce::UnitTest("PatternCodec", "Underground Beats")
+    {
+    }
+
+    void runTest() override
+    {
+        beginTest("Notes and automation survive a round trip");
+        {
+            NoteColumns notes;
+            addNote(notes, 0, 240, 36, 127);
+            addNote(notes, 0, 480, 42, 1);       // Same start as the previous note
+            addNote(notes, 960, 960, 127, 100);
+            addNote(notes, 123457, 17, 0, 64);
+
+            PatternCodec::AutomationLanes automation;
+            automation["cutoff"] = { AutomationPoint(0.0, 0.0f, CurveType::Linear),
+                                     AutomationPoint(0.5, 0.25f, CurveType::Exponential),
+                                     AutomationPoint(1.25, 1.0f, CurveType::Step) };
+            automation["gain"] = { AutomationPoint(0.1, 0.5f, CurveType::SCurve),
+                                   AutomationPoint(1.0 / 3.0, -0.75f, CurveType::Logarithmic),
+                                   AutomationPoint(2.7, 0.125f, CurveType::Linear) };
+
+            expectRoundTrip(notes, automation);
+        }
+
+        beginTest("An empty pattern survives a round trip");
+        {
+            expectRoundTrip(NoteColumns(), PatternCodec::AutomationLanes());
+        }
+
+        beginTest("Varint and zigzag limits survive a round trip");
+        {
+            const Tick maxDuration = std::numeric_limits<int>::max();
+            const Tick farStart = Tick(1) << 62;
+
+            NoteColumns notes;
+            addNote(notes, -960, 1, 60, 100);        // The first delta may be negative
+            addNote(notes, -1, maxDuration, 61, 100);
+            addNote(notes, farStart, 127, 62, 100);  // A delta needing all ten varint bytes
+
+            PatternCodec::AutomationLanes automation;
+            automation["far"] = { AutomationPoint(-4.0, 0.0f), AutomationPoint(1.0e9, 1.0f) };
+
+            expectRoundTrip(notes, automation);
+        }
+
+        beginTest("Off-grid automation times are stored exactly");
+        {
+            PatternCodec::AutomationLanes automation;
+
+            // One off-grid time puts the whole lane into exact doubles
+            automation["mixed"] = { AutomationPoint(0.0, 0.0f), AutomationPoint(0.5, 0.5f),
+                                    AutomationPoint(0.5 + 1.0e-9, 0.6f), AutomationPoint(2.0, 1.0f) };
+
+            // Too far out for the tick grid, though a whole number of ticks
+            automation["huge"] = { AutomationPoint(1.0e13, 0.0f) };
+
+            expectRoundTrip(NoteColumns(), automation);
+        }
+
+        beginTest("Truncated blocks are rejected without touching the output");
+        {
+            NoteColumns notes;
+            addNote(notes, 0, 960, 60, 100);
+            addNote(notes, 960, 960, 64, 90);
+
+            PatternCodec::AutomationLanes automation;
+            automation["cutoff"] = { AutomationPoint(0.0, 0.0f), AutomationPoint(1.0 / 3.0, 1.0f) };
+
+            const auto block = PatternCodec::encode(notes, automation);
+
+            for (size_t size = 0; size < block.getSize(); ++size)
+            {
+                expectRejected(block.getData(), size, "truncated to " + juce::String(static_cast<int>(size)) + " bytes");
+            }
+
+            expectRejected(nullptr, 0, "null data");
+        }
+
+        beginTest("Damaged headers are rejected");
+        {
+            auto block = PatternCodec::encode(NoteColumns(), PatternCodec::AutomationLanes());
+
+            auto badMagic = block;
+            static_cast<juce::uint8*>(badMagic.getData())[0] = 'X';
+            expectRejected(badMagic.getData(), badMagic.getSize(), "bad magic");
+
+            auto badVersion = block;
+            static_cast<juce::uint8*>(badVersion.getData())[1] = 99;
+            expectRejected(badVersion.getData(), badVersion.getSize(), "unknown version");
+
+            // A note count whose varint never ends
+            juce::MemoryBlock overlong;
+            const juce::uint8 header[] = { 'P', 1 };
+            overlong.append(header, sizeof(header));
+
+            for (int i = 0; i < 11; ++i)
+            {
+                const juce::uint8 continuation = 0x80;
+                overlong.append(&continuation, 1);
+            }
+
+            expectRejected(overlong.getData(), overlong.getSize(), "overlong varint");
+
+            // A note count larger than the block
+            juce::MemoryBlock oversized;
+            const juce::uint8 bytes[] = { 'P', 1, 0xff, 0xff, 0x03, 0, 0, 0 };
+            oversized.append(bytes, sizeof(bytes));
+            expectRejected(oversized.getData(), oversized.getSize(), "note count past the end");
+        }
+
+        beginTest("Notes breaking the invariants are rejected");
+        {
+            NoteColumns unsorted;
+            addNote(unsorted, 960, 960, 60, 100);
+            addNote(unsorted, 0, 960, 62, 100);
+            expectEncodingRejected(unsorted, {}, "decreasing start times");
+
+            NoteColumns zeroDuration;
+            addNote(zeroDuration, 0, 0, 60, 100);
+            expectEncodingRejected(zeroDuration, {}, "zero duration");
+
+            NoteColumns silent;
+            addNote(silent, 0, 960, 60, 0);
+            expectEncodingRejected(silent, {}, "zero velocity");
+
+            NoteColumns badPitch;
+            addNote(badPitch, 0, 960, 200, 100);
+            expectEncodingRejected(badPitch, {}, "pitch above 127");
+        }
+
+        beginTest("Automation breaking the invariants is rejected");
+        {
+            PatternCodec::AutomationLanes unsorted;
+            unsorted["cutoff"] = { AutomationPoint(2.0, 0.0f), AutomationPoint(1.0, 1.0f) };
+            expectEncodingRejected(NoteColumns(), unsorted, "unsorted on-grid points");
+
+            PatternCodec::AutomationLanes unsortedOffGrid;
+            unsortedOffGrid["cutoff"] = { AutomationPoint(2.0 / 3.0, 0.0f), AutomationPoint(1.0 / 3.0, 1.0f) };
+            expectEncodingRejected(NoteColumns(), unsortedOffGrid, "unsorted off-grid points");
+
+            // The last byte of a block is the curve type of the last point
+            PatternCodec::AutomationLanes lanes;
+            lanes["cutoff"] = { AutomationPoint(0.0, 0.0f), AutomationPoint(1.0, 1.0f) };
+
+            auto block = PatternCodec::encode(NoteColumns(), lanes);
+            static_cast<juce::uint8*>(block.getData())[block.getSize() - 1] = static_cast<juce::uint8>(CurveType::Step) + 1;
+            expectRejected(block.getData(), block.getSize(), "unknown curve type");
+        }
+    }
+
+private:
+    static void addNote(NoteColumns& notes, Tick start, Tick duration, int pitch, int velocity)
+    {
+        notes.startTicks.push_back(start);
+        notes.durationTicks.push_back(duration);
+        notes.pitches.push_back(static_cast<juce::uint8>(pitch));
+        notes.velocities.push_back(static_cast<juce::uint8>(velocity));
+    }
+
+    void expectRoundTrip(const NoteColumns& notes, const PatternCodec::AutomationLanes& automation)
+    {
+        const auto block = PatternCodec::encode(notes, automation);
+
+        NoteColumns decodedNotes;
+        PatternCodec::AutomationLanes decodedAutomation;
+
+        expect(PatternCodec::decode(block.getData(), block.getSize(), decodedNotes, decodedAutomation),
+               "A block written by encode() should decode");
+
+        expect(decodedNotes.startTicks == notes.startTicks, "Start times differ");
+        expect(decodedNotes.durationTicks == notes.durationTicks, "Durations differ");
+        expect(decodedNotes.pitches == notes.pitches, "Pitches differ");
+        expect(decodedNotes.velocities == notes.velocities, "Velocities differ");
+
+        expectEquals(static_cast<int>(decodedAutomation.size()), static_cast<int>(automation.size()));
+
+        for (const auto& [paramId, points] : automation)
+        {
+            const auto decoded = decodedAutomation.find(paramId);
+
+            if (decoded == decodedAutomation.end())
+            {
+                expect(false, "Lane " + juce::String(paramId) + " is missing");
+                continue;
+            }
+
+            expectEquals(static_cast<int>(decoded->second.size()), static_cast<int>(points.size()));
+
+            for (size_t i = 0; i < std::min(points.size(), decoded->second.size()); ++i)
+            {
+                // Exact comparisons: the encoding is lossless
+                expect(decoded->second[i].time == points[i].time, "Time differs in lane " + juce::String(paramId));
+                expect(decoded->second[i].value == points[i].value, "Value differs in lane " + juce::String(paramId));
+                expect(decoded->second[i].curveType == points[i].curveType, "Curve differs in lane " + juce::String(paramId));
+            }
+        }
+
+        // The streaming reader sees the same notes
+        PatternCodec::Reader reader(block.getData(), block.getSize());
+        expect(reader.isValid());
+        expectEquals(reader.getNumNotes(), notes.size());
+
+        NoteEvent note;
+
+        for (int i = 0; i < notes.size(); ++i)
+        {
+            expect(reader.readNote(note));
+            expectEquals(note.startTick, notes.startTicks[static_cast<size_t>(i)]);
+            expectEquals(note.durationTicks, notes.durationTicks[static_cast<size_t>(i)]);
+            expectEquals(note.note, static_cast<int>(notes.pitches[static_cast<size_t>(i)]));
+        }
+
+        expect(!reader.readNote(note), "The reader should stop after the last note");
+    }
+
+    void expectRejected(const void* data, size_t size, const juce::String& what)
+    {
+        // Decoding must leave the outputs alone unless the whole block is valid
+        NoteColumns notes;
+        notes.startTicks.push_back(42);
+
+        PatternCodec::AutomationLanes automation;
+        automation["untouched"] = { AutomationPoint(1.0, 1.0f) };
+
+        expect(!PatternCodec::decode(data, size, notes, automation), "Accepted a block with " + what);
+        expect(notes.size() == 1 && notes.startTicks.front() == 42, "Changed the notes for a block with " + what);
+        expect(automation.size() == 1 && automation.count("untouched") == 1,
+               "Changed the automation for a block with " + what);
+    }
+
+    void expectEncodingRejected(const NoteColumns& notes, const PatternCodec::AutomationLanes& automation,
+                                const juce::String& what)
+    {
+        const auto block = PatternCodec::encode(notes, automation);
+        expectRejected(block.getData(), block.getSize(), what);
+    }
+};
+
+static PatternCodecTests patternCodecTests;
+
+} // namespace UndergroundBeats
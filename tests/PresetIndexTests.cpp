@@ -0,0 +1,123 @@
+/*
+ * Underground Beats
+ * PresetIndexTests.cpp
+ *
+ * Indexing preset files and ranking search results
+ */
+
+#include <JuceHeader.h>
+#include "../src/effects/PresetIndex.h"
+
+namespace UndergroundBeats {
+
+class PresetIndexTests : public juce::UnitTest {
+public:
+    PresetIndexTests()
+        : juce::UnitTest("PresetIndex", "Underground Beats")
+    {
+    }
+
+    void runTest() override
+    {
+        const juce::File root = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                    .getNonexistentChildFile("ugbeats_preset_index_test", "", false);
+        const juce::File presets = root.getChildFile("Presets");
+        const juce::File factory = root.getChildFile("Factory");
+        presets.createDirectory();
+        factory.createDirectory();
+
+        writePreset(presets, "Delay + Reverb");
+        writePreset(presets, "Deep Bass");
+        writePreset(presets, "Bass Drop");
+        writePreset(presets, "Reverb Hall");
+        writePreset(presets, "Dark Delay");
+        writePreset(presets, "Drum Bus");
+        presets.getChildFile("Broken.xml").replaceWithText("<EffectChainPreset>");
+
+        PresetIndex index(root.getChildFile("index.dat"));
+
+        beginTest("Refreshing indexes the valid presets");
+        {
+            expect(index.refresh({ presets }));
+            expectEquals(static_cast<int>(index.getEntries().size()), 6);
+            expect(!index.refresh({ presets }), "A second refresh with nothing changed should do nothing");
+        }
+
+        beginTest("Prefix matches rank before substring matches");
+        {
+            expectResults(index.search("de", 10), { "Deep Bass", "Delay + Reverb", "Dark Delay" });
+            expectResults(index.search("bass", 10), { "Bass Drop", "Deep Bass" });
+            expectResults(index.search("REV", 10), { "Reverb Hall", "Delay + Reverb" });
+        }
+
+        beginTest("Fuzzy matches need the characters in order");
+        {
+            expectResults(index.search("dlrv", 10), { "Delay + Reverb" });
+            expectResults(index.search("vrld", 10), {});
+        }
+
+        beginTest("Fuzzy matches rank by word starts, then by name");
+        {
+            // Both of the first two match at two word starts; "Delay + Reverb" only at one
+            expectResults(index.search("db", 10), { "Deep Bass", "Drum Bus", "Delay + Reverb" });
+        }
+
+        beginTest("Results are limited to the requested count");
+        {
+            expectResults(index.search("de", 2), { "Deep Bass", "Delay + Reverb" });
+            expectResults(index.search("", 2), { "Bass Drop", "Dark Delay" });
+            expectResults(index.search("de", 0), {});
+        }
+
+        beginTest("Finding a preset ignores case and prefers user presets");
+        {
+            writePreset(factory, "Deep Bass", true);
+            index.refresh({ presets, factory });
+
+            const auto* entry = index.find("deep bass");
+            expect(entry != nullptr && !entry->isFactory);
+            expect(index.find("Deep") == nullptr);
+        }
+
+        beginTest("A saved index is loaded back");
+        {
+            PresetIndex reloaded(root.getChildFile("index.dat"));
+            expectEquals(static_cast<int>(reloaded.getEntries().size()), 7);
+            expect(!reloaded.refresh({ presets, factory }), "Nothing changed since the index was saved");
+            expectResults(reloaded.search("dlrv", 10), { "Delay + Reverb" });
+        }
+
+        root.deleteRecursively();
+    }
+
+private:
+    static void writePreset(const juce::File& directory, const juce::String& name, bool isFactory = false)
+    {
+        juce::XmlElement xml("EffectChainPreset");
+
+        auto* info = xml.createNewChildElement("PresetInfo");
+        info->setAttribute("name", name);
+        info->setAttribute("category", "Test");
+        info->setAttribute("factory", isFactory ? 1 : 0);
+
+        xml.createNewChildElement("EffectChainState");
+
+        xml.writeTo(directory.getChildFile(juce::File::createLegalFileName(name) + ".xml"));
+    }
+
+    void expectResults(const std::vector<const PresetIndex::Entry*>& results, const juce::StringArray& expected)
+    {
+        juce::StringArray names;
+
+        for (const auto* entry : results)
+        {
+            names.add(entry->name);
+        }
+
+        expectEquals(names.joinIntoString(", "), expected.joinIntoString(", "));
+    }
+};
+
+static PresetIndexTests presetIndexTests;
+
+} // namespace UndergroundBeats
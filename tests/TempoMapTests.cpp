@@ -0,0 +1,161 @@
+/*
+ * Underground Beats
+ * TempoMapTests.cpp
+ *
+ * Tick and sample conversions across constant tempos and ramps
+ */
+
+#include <JuceHeader.h>
+#include "../src/sequencer/TempoMap.h"
+#include <cmath>
+
+namespace UndergroundBeats {
+
+class TempoMapTests : public juce::UnitTest {
+public:
+    TempoMapTests()
+        : juce::UnitTest("TempoMap", "Underground Beats")
+    {
+    }
+
+    void runTest() override
+    {
+        beginTest("A constant tempo converts linearly");
+        {
+            TempoMap map(120.0);
+            map.setSampleRate(sampleRate);
+
+            // At 120 BPM a beat lasts half a second
+            expectWithinAbsoluteError(map.sampleAtTick(0.0), 0.0, tolerance);
+            expectWithinAbsoluteError(map.sampleAtTick(960.0), 24000.0, tolerance);
+            expectWithinAbsoluteError(map.sampleAtTick(480.5), 12012.5, tolerance);
+            expectWithinAbsoluteError(map.tickAtSample(24000.0), 960.0, tolerance);
+
+            // The initial tempo extends before the start of the timeline
+            expectWithinAbsoluteError(map.sampleAtTick(-960.0), -24000.0, tolerance);
+            expectWithinAbsoluteError(map.tickAtSample(-24000.0), -960.0, tolerance);
+        }
+
+        beginTest("Ramps integrate the tempo exactly");
+        {
+            TempoMap map;
+            buildRampedMap(map);
+
+            // Samples over a ramp: scale / slope * ln(endBpm / startBpm), with scale = sampleRate * 60 / 960
+            const double scale = sampleRate * 60.0 / 960.0;
+            const double rampUp = scale / (60.0 / 3840.0) * std::log(180.0 / 120.0);
+            const double rampDown = scale / (-90.0 / 3840.0) * std::log(90.0 / 180.0);
+            const double constant = scale * 3840.0 / 90.0;
+
+            expectWithinAbsoluteError(map.sampleAtTick(3840.0), rampUp, tolerance);
+            expectWithinAbsoluteError(map.sampleAtTick(7680.0), rampUp + rampDown, tolerance);
+            expectWithinAbsoluteError(map.sampleAtTick(11520.0), rampUp + rampDown + constant, tolerance);
+
+            expectWithinAbsoluteError(map.tickAtSample(rampUp), 3840.0, tolerance);
+            expectWithinAbsoluteError(map.tickAtSample(rampUp + rampDown), 7680.0, tolerance);
+
+            // Halfway through a ramp in ticks is past halfway in tempo-weighted time
+            const double halfway = scale / (60.0 / 3840.0) * std::log(150.0 / 120.0);
+            expectWithinAbsoluteError(map.sampleAtTick(1920.0), halfway, tolerance);
+        }
+
+        beginTest("The tempo is interpolated along a ramp");
+        {
+            TempoMap map;
+            buildRampedMap(map);
+
+            expectWithinAbsoluteError(map.getTempoAt(0), 120.0, tolerance);
+            expectWithinAbsoluteError(map.getTempoAt(1920), 150.0, tolerance);
+            expectWithinAbsoluteError(map.getTempoAt(3840), 180.0, tolerance);
+            expectWithinAbsoluteError(map.getTempoAt(5760), 135.0, tolerance);
+            expectWithinAbsoluteError(map.getTempoAt(9000), 90.0, tolerance);
+            expectWithinAbsoluteError(map.getTempoAt(20000), 140.0, tolerance);
+        }
+
+        beginTest("Ticks survive a round trip through samples");
+        {
+            TempoMap map;
+            buildRampedMap(map);
+
+            for (double tick = -500.0; tick <= 16000.0; tick += 37.25)
+            {
+                const double sample = map.sampleAtTick(tick);
+                expectWithinAbsoluteError(map.tickAtSample(sample), tick, tolerance,
+                                          "at tick " + juce::String(tick));
+            }
+        }
+
+        beginTest("Samples survive a round trip through ticks");
+        {
+            TempoMap map;
+            buildRampedMap(map);
+
+            for (double sample = -1000.0; sample <= 400000.0; sample += 1234.5)
+            {
+                const double tick = map.tickAtSample(sample);
+                expectWithinAbsoluteError(map.sampleAtTick(tick), sample, tolerance,
+                                          "at sample " + juce::String(sample));
+            }
+        }
+
+        beginTest("Conversions increase with position");
+        {
+            TempoMap map;
+            buildRampedMap(map);
+
+            double previous = map.sampleAtTick(-1.0);
+
+            for (int tick = 0; tick <= 16000; ++tick)
+            {
+                const double sample = map.sampleAtTick(static_cast<double>(tick));
+
+                if (!(sample > previous))
+                {
+                    expect(false, "Sample position stopped increasing at tick " + juce::String(tick));
+                    break;
+                }
+
+                previous = sample;
+            }
+        }
+
+        beginTest("A cursor gives the same answers as stateless calls");
+        {
+            TempoMap map;
+            buildRampedMap(map);
+
+            // Forward through every segment, as the audio thread reads the timeline
+            TempoMap::Cursor tickCursor;
+            TempoMap::Cursor sampleCursor;
+
+            for (double sample = 0.0; sample <= 400000.0; sample += 512.0)
+            {
+                const double tick = map.tickAtSample(sample, sampleCursor);
+                expectEquals(tick, map.tickAtSample(sample));
+                expectEquals(map.sampleAtTick(tick, tickCursor), map.sampleAtTick(tick));
+            }
+
+            // Jumping backwards (a loop or a seek) falls back to the search
+            expectEquals(map.tickAtSample(1000.0, sampleCursor), map.tickAtSample(1000.0));
+            expectEquals(map.sampleAtTick(100.0, tickCursor), map.sampleAtTick(100.0));
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr double tolerance = 1.0e-6;
+
+    // 120 ramping up to 180, back down to 90, 90 held, then 140 held
+    static void buildRampedMap(TempoMap& map)
+    {
+        map.setSampleRate(sampleRate);
+        map.setTempo(0, 120.0, true);
+        map.setTempo(3840, 180.0, true);
+        map.setTempo(7680, 90.0, false);
+        map.setTempo(11520, 140.0, false);
+    }
+};
+
+static TempoMapTests tempoMapTests;
+
+} // namespace UndergroundBeats
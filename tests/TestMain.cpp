@@ -0,0 +1,77 @@
+/*
+ * Underground Beats
+ * TestMain.cpp
+ *
+ * Entry point of the headless unit test runner
+ */
+
+#include <JuceHeader.h>
+#include <cstdio>
+
+namespace {
+
+void printUsage()
+{
+    std::printf("Usage: ugbeats_tests [--list] [--test=<name>]\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    // Tests register themselves in this category when their file is linked in
+    const juce::String category = "Underground Beats";
+
+    if (args.containsOption("--list"))
+    {
+        for (auto* test : juce::UnitTest::getTestsInCategory(category))
+        {
+            std::printf("%s\n", test->getName().toRawUTF8());
+        }
+
+        return 0;
+    }
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    const juce::String testName = args.getValueForOption("--test");
+
+    if (testName.isNotEmpty())
+    {
+        juce::Array<juce::UnitTest*> selected;
+
+        for (auto* test : juce::UnitTest::getTestsInCategory(category))
+        {
+            if (test->getName().containsIgnoreCase(testName))
+            {
+                selected.add(test);
+            }
+        }
+
+        runner.runTests(selected);
+    }
+    else
+    {
+        runner.runTestsInCategory(category);
+    }
+
+    int failures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+    {
+        failures += runner.getResult(i)->failures;
+    }
+
+    std::printf("%d test group(s), %d failure(s)\n", runner.getNumResults(), failures);
+
+    return failures > 0 ? 1 : 0;
+}